@@ -0,0 +1,246 @@
+#include "AudioStages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "AudioStreamProcessor.h"
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr float kSilentPcm16 = 8.0f / 32768.0f;
+constexpr float kSilentPcm32 = 32.0f / 32768.0f;
+constexpr float kSilentFloat = 1e-4f;
+constexpr std::uint32_t kVadBlocksPerSecond = 100;
+
+inline std::int16_t toPcm16(float s) { return static_cast<std::int16_t>(std::lround(std::clamp(s, -1.0f, 1.0f) * 32767.0f)); }
+inline std::int16_t toPcm16(std::int32_t s) { return static_cast<std::int16_t>(s >> 16); }
+inline std::int16_t toPcm16(std::int16_t s) { return s; }
+inline std::int32_t toPcm32(float s) {
+    return static_cast<std::int32_t>(std::lround(static_cast<double>(std::clamp(s, -1.0f, 1.0f)) * 2147483647.0));
+}
+inline std::int32_t toPcm32(std::int16_t s) { return static_cast<std::int32_t>(s) << 16; }
+inline std::int32_t toPcm32(std::int32_t s) { return s; }
+inline float toFloat(std::int16_t s) { return static_cast<float>(s) / 32768.0f; }
+inline float toFloat(std::int32_t s) { return static_cast<float>(s) / 2147483648.0f; }
+inline float toFloat(float s) { return s; }
+
+// Forward loop: with out no wider than in, each write lands at or before the bytes just read.
+template <typename In> void convertFrom(const In *in, const AudioSpan &out, std::size_t samples) {
+    switch (out.format.sample) {
+    case SampleFormat::Pcm16: {
+        auto *o = out.as<std::int16_t>();
+        for (std::size_t i = 0; i < samples; ++i) o[i] = toPcm16(in[i]);
+        break;
+    }
+    case SampleFormat::Pcm32: {
+        auto *o = out.as<std::int32_t>();
+        for (std::size_t i = 0; i < samples; ++i) o[i] = toPcm32(in[i]);
+        break;
+    }
+    case SampleFormat::Float32: {
+        auto *o = out.as<float>();
+        for (std::size_t i = 0; i < samples; ++i) o[i] = toFloat(in[i]);
+        break;
+    }
+    }
+}
+
+} // namespace
+
+StreamStats analyzeSpan(const AudioSpan &span) {
+    const std::size_t channels = span.format.channels;
+    const std::size_t samples = span.frames * channels;
+    if (!span.data || samples == 0) {
+        return {};
+    }
+    switch (span.format.sample) {
+    case SampleFormat::Pcm16:
+        return analyzePcm16(span.as<std::int16_t>(), samples, channels);
+    case SampleFormat::Pcm32:
+        return analyzePcm32(span.as<std::int32_t>(), samples, channels);
+    case SampleFormat::Float32:
+        return analyzeFloat32(span.as<float>(), samples, channels);
+    }
+    return {};
+}
+
+bool isSpanSilent(const AudioSpan &span) {
+    if (!span.data || span.frames == 0 || span.format.channels == 0) {
+        return true;
+    }
+    const std::size_t samples = span.frames * span.format.channels;
+    switch (span.format.sample) {
+    case SampleFormat::Pcm16:
+        return !reachesLevel(span.as<const std::int16_t>(), samples, kSilentPcm16);
+    case SampleFormat::Pcm32:
+        return !reachesLevel(span.as<const std::int32_t>(), samples, kSilentPcm32);
+    case SampleFormat::Float32:
+        return !reachesLevel(span.as<const float>(), samples, kSilentFloat);
+    }
+    return true;
+}
+
+StageIo ConvertStage::io(const StreamFormat &in) const {
+    return sampleBytes(m_target) <= sampleBytes(in.sample) ? StageIo::InPlace : StageIo::Separate;
+}
+
+StreamFormat ConvertStage::outputFormat(const StreamFormat &in) const {
+    StreamFormat out = in;
+    out.sample = m_target;
+    return out;
+}
+
+std::size_t ConvertStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    (void)ctx;
+    const std::size_t frames = std::min(in.frames, out.frames);
+    const std::size_t samples = frames * in.format.channels;
+    switch (in.format.sample) {
+    case SampleFormat::Pcm16:
+        convertFrom(in.as<const std::int16_t>(), out, samples);
+        break;
+    case SampleFormat::Pcm32:
+        convertFrom(in.as<const std::int32_t>(), out, samples);
+        break;
+    case SampleFormat::Float32:
+        convertFrom(in.as<const float>(), out, samples);
+        break;
+    }
+    return frames;
+}
+
+std::size_t AnalyzeStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    (void)out;
+    ctx.peak = analyzeSpan(in).peak;
+    ctx.silent = isSpanSilent(in);
+    return in.frames;
+}
+
+std::size_t VadStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    (void)out;
+    const std::size_t channels = in.format.channels;
+    const std::size_t block = std::max<std::size_t>(1, in.format.sampleRate / kVadBlocksPerSecond);
+    const auto *pcm = in.as<const std::int16_t>();
+    bool voiced = false;
+    for (std::size_t start = 0; start < in.frames; start += block) {
+        const std::size_t len = std::min(block, in.frames - start);
+        if (isVoiceActive(analyzePcm16(pcm + start * channels, len * channels, channels))) {
+            m_quietBlocks = 0;
+        } else if (m_quietBlocks < kHangoverBlocks) {
+            ++m_quietBlocks;
+        }
+        voiced = voiced || m_quietBlocks < kHangoverBlocks;
+    }
+    ctx.voiced = voiced;
+    return in.frames;
+}
+
+std::size_t StretchStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    const std::size_t frameBytes = in.format.frameBytes();
+    const std::size_t target = std::min(ctx.targetFrames ? ctx.targetFrames : in.frames, out.frames);
+    // processTempoInto queues the input before writing anything, so `out` may alias `in`.
+    const auto res = m_stream.processTempoInto(static_cast<const std::uint8_t *>(in.data), in.frames * frameBytes,
+                                               static_cast<std::uint8_t *>(out.data), target * frameBytes,
+                                               ctx.speed, false, ctx.key);
+    ctx.backlogBytes = res.cbufferSize;
+    return target;
+}
+
+StreamFormat ResampleStage::outputFormat(const StreamFormat &in) const {
+    StreamFormat out = in;
+    out.sampleRate = m_targetRate;
+    return out;
+}
+
+std::size_t ResampleStage::maxOutputFrames(const StreamFormat &in, std::size_t inFrames) const {
+    const std::uint64_t scaled = static_cast<std::uint64_t>(inFrames) * m_targetRate / std::max<std::uint32_t>(1, in.sampleRate);
+    return static_cast<std::size_t>(scaled) + 2;
+}
+
+std::size_t ResampleStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    (void)ctx;
+    const std::size_t channels = in.format.channels;
+    if (in.frames == 0) {
+        return 0;
+    }
+    const auto *src = in.as<const std::int16_t>();
+    auto *dst = out.as<std::int16_t>();
+    if (m_last.size() != channels) {
+        m_last.assign(src, src + channels); // first call: hold the first frame
+        m_phase = 0;
+    }
+    const std::uint32_t step = static_cast<std::uint32_t>(
+        (static_cast<std::uint64_t>(in.format.sampleRate) << 16) / m_targetRate);
+    // Source frame k: 0 is m_last, k >= 1 is src[k - 1].
+    auto frameAt = [&](std::size_t k) { return k == 0 ? m_last.data() : src + (k - 1) * channels; };
+    std::size_t written = 0;
+    std::uint64_t pos = m_phase;
+    while (written < out.frames) {
+        const std::size_t k = static_cast<std::size_t>(pos >> 16);
+        if (k + 1 > in.frames) {
+            break;
+        }
+        const std::int32_t frac = static_cast<std::int32_t>(pos & 0xFFFF);
+        const std::int16_t *a = frameAt(k);
+        const std::int16_t *b = frameAt(k + 1);
+        for (std::size_t c = 0; c < channels; ++c) {
+            const std::int32_t d = static_cast<std::int32_t>(b[c]) - a[c];
+            dst[written * channels + c] = static_cast<std::int16_t>(a[c] + ((d * (frac >> 1)) >> 15));
+        }
+        ++written;
+        pos += step;
+    }
+    m_phase = static_cast<std::uint32_t>(pos - (static_cast<std::uint64_t>(in.frames) << 16));
+    std::memcpy(m_last.data(), src + (in.frames - 1) * channels, channels * sizeof(std::int16_t));
+    return written;
+}
+
+void ResampleStage::reset() {
+    m_last.clear();
+    m_phase = 0;
+}
+
+std::size_t FitToSizeStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    const std::size_t frameBytes = in.format.frameBytes();
+    const std::size_t target = std::min(ctx.targetFrames ? ctx.targetFrames : in.frames, out.frames);
+    const std::size_t keep = std::min(in.frames, target);
+    auto *dst = static_cast<std::uint8_t *>(out.data);
+    if (out.data != in.data && keep > 0) {
+        std::memmove(dst, in.data, keep * frameBytes);
+    }
+    if (target > keep) {
+        std::memset(dst + keep * frameBytes, 0, (target - keep) * frameBytes);
+    }
+    return target;
+}
+
+std::size_t LimiterStage::process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) {
+    (void)ctx;
+    const std::size_t channels = in.format.channels;
+    const std::size_t frames = std::min(in.frames, out.frames);
+    if (m_releaseRate != in.format.sampleRate) {
+        m_releaseRate = in.format.sampleRate;
+        const double samples = std::max(1.0, m_releaseMs * 0.001 * m_releaseRate);
+        m_release = static_cast<float>(1.0 - std::exp(-1.0 / samples));
+    }
+    const auto *src = in.as<const float>();
+    auto *dst = out.as<float>();
+    for (std::size_t f = 0; f < frames; ++f) {
+        float peak = 0.0f;
+        for (std::size_t c = 0; c < channels; ++c) {
+            peak = std::max(peak, std::fabs(src[f * channels + c]));
+        }
+        m_gain += (1.0f - m_gain) * m_release;
+        if (peak * m_gain > m_ceiling) {
+            m_gain = m_ceiling / peak;
+        }
+        for (std::size_t c = 0; c < channels; ++c) {
+            dst[f * channels + c] = src[f * channels + c] * m_gain;
+        }
+    }
+    return frames;
+}
+
+} // namespace krkrspeed
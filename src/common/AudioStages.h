@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "StageGraph.h"
+#include "StreamAnalysis.h"
+
+namespace krkrspeed {
+
+class AudioStreamProcessor;
+
+StreamStats analyzeSpan(const AudioSpan &span);
+// Near-digital-silence check with per-format floors (pcm16 8 LSB, pcm32 32/32768, float 1e-4; NaN/Inf is not
+// silent). Uses reachesLevel(), so a loud buffer is answered from its first block.
+bool isSpanSilent(const AudioSpan &span);
+
+// Sample format conversion. Works in place when the target samples are no wider than the source.
+class ConvertStage : public Stage {
+public:
+    explicit ConvertStage(SampleFormat target) : m_target(target) {}
+
+    const char *name() const override { return "convert"; }
+    StageIo io(const StreamFormat &in) const override;
+    bool accepts(const StreamFormat &in) const override { return in.channels > 0; }
+    StreamFormat outputFormat(const StreamFormat &in) const override;
+    bool isIdentity(const StreamFormat &in) const override { return in.sample == m_target; }
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+
+private:
+    SampleFormat m_target;
+};
+
+// Sets StageContext::peak and ::silent.
+class AnalyzeStage : public Stage {
+public:
+    const char *name() const override { return "analyze"; }
+    StageIo io(const StreamFormat &) const override { return StageIo::Observe; }
+    bool accepts(const StreamFormat &in) const override { return in.channels > 0; }
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+};
+
+// Sets StageContext::voiced from 10 ms isVoiceActive() blocks, holding voiced through short pauses.
+class VadStage : public Stage {
+public:
+    const char *name() const override { return "vad"; }
+    StageIo io(const StreamFormat &) const override { return StageIo::Observe; }
+    bool accepts(const StreamFormat &in) const override { return in.sample == SampleFormat::Pcm16 && in.channels > 0; }
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+    void reset() override { m_quietBlocks = kHangoverBlocks; }
+
+private:
+    static constexpr std::uint32_t kHangoverBlocks = 20;
+    std::uint32_t m_quietBlocks = kHangoverBlocks;
+};
+
+// Tempo stretch through the stream's AudioStreamProcessor, producing exactly StageContext::targetFrames
+// (the input length when 0). Never produces more frames than it is given.
+class StretchStage : public Stage {
+public:
+    explicit StretchStage(AudioStreamProcessor &stream) : m_stream(stream) {}
+
+    const char *name() const override { return "stretch"; }
+    StageIo io(const StreamFormat &) const override { return StageIo::InPlace; }
+    bool accepts(const StreamFormat &in) const override { return in.sample == SampleFormat::Pcm16 && in.channels > 0; }
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+
+private:
+    AudioStreamProcessor &m_stream;
+};
+
+// Linear-interpolation sample rate conversion (Q16 phase, carried across calls).
+class ResampleStage : public Stage {
+public:
+    explicit ResampleStage(std::uint32_t targetRate) : m_targetRate(targetRate) {}
+
+    const char *name() const override { return "resample"; }
+    StageIo io(const StreamFormat &) const override { return StageIo::Separate; }
+    bool accepts(const StreamFormat &in) const override {
+        return in.sample == SampleFormat::Pcm16 && in.channels > 0 && m_targetRate > 0;
+    }
+    StreamFormat outputFormat(const StreamFormat &in) const override;
+    bool isIdentity(const StreamFormat &in) const override { return in.sampleRate == m_targetRate; }
+    std::size_t maxOutputFrames(const StreamFormat &in, std::size_t inFrames) const override;
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+    void reset() override;
+
+private:
+    std::uint32_t m_targetRate;
+    std::vector<std::int16_t> m_last; // previous input frame
+    std::uint32_t m_phase = 0;        // Q16 position relative to m_last
+};
+
+// Pads with silence or truncates to StageContext::targetFrames.
+class FitToSizeStage : public Stage {
+public:
+    const char *name() const override { return "fit"; }
+    StageIo io(const StreamFormat &) const override { return StageIo::InPlace; }
+    bool accepts(const StreamFormat &in) const override { return in.channels > 0; }
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+};
+
+// Peak limiter for float output: instant attack, exponential release back to unity gain.
+class LimiterStage : public Stage {
+public:
+    explicit LimiterStage(float ceiling = 0.98f, float releaseMs = 50.0f) : m_ceiling(ceiling), m_releaseMs(releaseMs) {}
+
+    const char *name() const override { return "limiter"; }
+    StageIo io(const StreamFormat &) const override { return StageIo::InPlace; }
+    bool accepts(const StreamFormat &in) const override { return in.sample == SampleFormat::Float32 && in.channels > 0; }
+    std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) override;
+    void reset() override { m_gain = 1.0f; }
+
+private:
+    float m_ceiling;
+    float m_releaseMs;
+    float m_gain = 1.0f;
+    float m_release = 0.0f;
+    std::uint32_t m_releaseRate = 0; // sample rate m_release was computed for
+};
+
+} // namespace krkrspeed
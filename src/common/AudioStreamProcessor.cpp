@@ -1,5 +1,9 @@
 #include "AudioStreamProcessor.h"
+#include "DspPipelinePool.h"
 #include "Logging.h"
+#include "StreamAnalysis.h"
+#include "WorkerPool.h"
+#include "XxHash64.h"
 
 #include <algorithm>
 #include <cmath>
@@ -7,13 +11,403 @@
 
 namespace krkrspeed {
 
+namespace {
+
+// Remove `removeFrames` frames of interleaved PCM16 by splicing out evenly spaced grains, each joined
+// with a short linear crossfade. Returns false (buffer untouched) when the backlog is too short.
+bool spliceOutGrains(std::vector<std::uint8_t> &buf, std::size_t channels, std::size_t removeFrames,
+                     std::size_t grainFrames, std::size_t fadeFrames) {
+    const std::size_t blockAlign = channels * sizeof(std::int16_t);
+    if (channels == 0 || grainFrames == 0 || removeFrames == 0) return false;
+    const std::size_t frames = buf.size() / blockAlign;
+    const std::size_t grains = (removeFrames + grainFrames - 1) / grainFrames;
+    const std::size_t spacing = frames / (grains + 1);
+    if (spacing <= grainFrames + 2 * fadeFrames) return false;
+
+    const auto *src = reinterpret_cast<const std::int16_t *>(buf.data());
+    std::vector<std::uint8_t> out((frames - removeFrames) * blockAlign);
+    auto *dst = reinterpret_cast<std::int16_t *>(out.data());
+    std::size_t srcPos = 0;
+    std::size_t dstPos = 0;
+    std::size_t remaining = removeFrames;
+    for (std::size_t g = 0; g < grains; ++g) {
+        const std::size_t len = std::min(grainFrames, remaining);
+        remaining -= len;
+        const std::size_t cut = (g + 1) * spacing;
+        const std::size_t head = cut - fadeFrames - srcPos;
+        std::memcpy(dst + dstPos * channels, src + srcPos * channels, head * blockAlign);
+        dstPos += head;
+        for (std::size_t i = 0; i < fadeFrames; ++i) {
+            const float w = static_cast<float>(i + 1) / static_cast<float>(fadeFrames + 1);
+            const std::size_t a = (cut - fadeFrames + i) * channels;
+            const std::size_t b = (cut + len - fadeFrames + i) * channels;
+            for (std::size_t c = 0; c < channels; ++c) {
+                const float mixed = static_cast<float>(src[a + c]) * (1.0f - w) + static_cast<float>(src[b + c]) * w;
+                dst[(dstPos + i) * channels + c] = static_cast<std::int16_t>(std::lround(mixed));
+            }
+        }
+        dstPos += fadeFrames;
+        srcPos = cut + len;
+    }
+    std::memcpy(dst + dstPos * channels, src + srcPos * channels, (frames - srcPos) * blockAlign);
+    buf.swap(out);
+    return true;
+}
+
+// Channel elision: a channel drops out of the DSP after this much digital silence, and |sample| at or
+// below kChannelSilenceLevel counts as silent. Rebuilt pipelines are primed with kChannelPrimeMs of
+// recent input so SoundTouch's overlap/seek window is already filled when the channel comes back.
+constexpr std::uint32_t kChannelIdleMs = 500;
+constexpr int kChannelSilenceLevel = 1;
+constexpr std::uint32_t kChannelPrimeMs = 100;
+constexpr std::uint32_t kMaxMaskedChannels = 32;
+
+std::uint32_t countChannels(std::uint32_t mask) {
+    std::uint32_t n = 0;
+    for (; mask; mask &= mask - 1) ++n;
+    return n;
+}
+
+// Keep only the channels set in `mask` from interleaved PCM16.
+std::vector<std::uint8_t> compactChannels(const std::uint8_t *data, std::size_t bytes, std::uint32_t channels,
+                                          std::uint32_t mask) {
+    const std::uint32_t active = countChannels(mask);
+    const std::size_t frames = bytes / (channels * sizeof(std::int16_t));
+    std::vector<std::uint8_t> out(frames * active * sizeof(std::int16_t));
+    const auto *src = reinterpret_cast<const std::int16_t *>(data);
+    auto *dst = reinterpret_cast<std::int16_t *>(out.data());
+    for (std::size_t f = 0; f < frames; ++f) {
+        for (std::uint32_t c = 0; c < channels; ++c) {
+            if (mask & (1u << c)) *dst++ = src[c];
+        }
+        src += channels;
+    }
+    return out;
+}
+
+// Inverse of compactChannels: scatter back to `channels`, zeros for channels outside `mask`.
+std::vector<std::uint8_t> expandChannels(const std::vector<std::uint8_t> &data, std::uint32_t channels,
+                                         std::uint32_t mask) {
+    const std::uint32_t active = countChannels(mask);
+    if (active == 0) return {};
+    const std::size_t frames = data.size() / (active * sizeof(std::int16_t));
+    std::vector<std::uint8_t> out(frames * channels * sizeof(std::int16_t), 0);
+    const auto *src = reinterpret_cast<const std::int16_t *>(data.data());
+    auto *dst = reinterpret_cast<std::int16_t *>(out.data());
+    for (std::size_t f = 0; f < frames; ++f) {
+        for (std::uint32_t c = 0; c < channels; ++c) {
+            if (mask & (1u << c)) dst[c] = *src++;
+        }
+        dst += channels;
+    }
+    return out;
+}
+
+// Segmented pitch processing for long one-shot buffers. Segments overlap their neighbours by
+// kSeamLeadMs before the seam (warm-up plus crossfade) and kSeamTailMs after it (covers SoundTouch's
+// latency so the previous segment's output reaches the seam).
+constexpr double kSegmentedMinSec = 1.0;
+constexpr double kSegmentMinSec = 0.4;
+constexpr std::uint32_t kSeamFadeMs = 10;
+constexpr std::uint32_t kSeamSearchMs = 8;
+constexpr std::uint32_t kSeamLeadMs = 40;
+constexpr std::uint32_t kSeamTailMs = 250;
+
+// In-place streaming for huge buffers: inputs of at least kInPlaceMinSec are processed kInPlaceChunkMs at
+// a time; results are written behind the read cursor so unread input is never overwritten.
+constexpr double kInPlaceMinSec = 10.0;
+constexpr std::uint32_t kInPlaceChunkMs = 250;
+
+// Adaptive idle reset: the threshold follows the 95th percentile of recent continuation gaps (how late
+// a stream's next buffer arrived after the predicted play end) times kIdleGapScale plus a margin,
+// bounded to [fallback/2, fallback*4]. The caller's fallback applies until enough gaps were seen.
+constexpr std::size_t kIdleGapHistory = 32;
+constexpr std::size_t kIdleGapMinSamples = 8;
+constexpr float kIdleGapScale = 2.0f;
+constexpr std::int64_t kIdleGapMarginMs = 50;
+
+// Micro-batching (pitch path): fragments shorter than kBatchFragmentMs are queued and run through the DSP
+// together once kBatchBudgetMs of input has gathered; meanwhile output is served from Cbuffer.
+constexpr std::uint32_t kBatchFragmentMs = 10;
+constexpr std::uint32_t kBatchBudgetMs = 20;
+
+// Stream start: a primed pipeline's first frame out is real input, but the call that drops its pre-roll
+// comes up short by the algorithmic latency, and the tempo path then needs a batch of output in hand before
+// it can go back to batching. Both are made up by running the engine up to this much slower (tempo trim,
+// pitch unchanged) instead of padding the line with silence.
+constexpr float kStartTrimMin = 0.5f;
+
+// Offset in [-search, search] frames that best aligns `next` with `prev` over `frames` frames
+// (normalized cross-correlation of interleaved PCM16). `next` must be readable over the whole range.
+std::ptrdiff_t bestSeamOffset(const std::int16_t *prev, const std::int16_t *next, std::size_t frames,
+                              std::size_t channels, std::ptrdiff_t searchLo, std::ptrdiff_t searchHi) {
+    std::ptrdiff_t best = 0;
+    double bestScore = -1e300;
+    const std::size_t samples = frames * channels;
+    for (std::ptrdiff_t off = searchLo; off <= searchHi; ++off) {
+        const std::int16_t *cand = next + off * static_cast<std::ptrdiff_t>(channels);
+        std::int64_t dot = 0;
+        std::int64_t energy = 0;
+        for (std::size_t i = 0; i < samples; ++i) {
+            dot += static_cast<std::int32_t>(prev[i]) * cand[i];
+            energy += static_cast<std::int32_t>(cand[i]) * cand[i];
+        }
+        const double score = static_cast<double>(dot) / std::sqrt(static_cast<double>(energy) + 1.0);
+        if (score > bestScore || (score == bestScore && std::abs(off) < std::abs(best))) {
+            bestScore = score;
+            best = off;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
 AudioStreamProcessor::AudioStreamProcessor(std::uint32_t sampleRate, std::uint32_t channels, std::uint32_t blockAlign,
                                            const DspConfig &cfg)
-    : m_sampleRate(sampleRate), m_blockAlign(blockAlign) {
-    m_dsp = std::make_unique<DspPipeline>(sampleRate, channels, cfg);
+    : m_sampleRate(sampleRate), m_channels(channels), m_blockAlign(blockAlign), m_config(cfg) {
     if (m_blockAlign == 0 && channels > 0) {
         m_blockAlign = channels * sizeof(std::int16_t);
     }
+    m_activeMask = fullChannelMask();
+}
+
+AudioStreamProcessor::~AudioStreamProcessor() {
+    finishRender();
+    DspPipelinePool::instance().recycle(std::move(m_dsp));
+}
+
+bool AudioStreamProcessor::ensureDsp() {
+    if (!m_dsp && m_sampleRate > 0 && m_channels > 0) {
+        const std::uint32_t dspChannels = (m_activeMask == fullChannelMask()) ? m_channels : countChannels(m_activeMask);
+        m_dsp = DspPipelinePool::instance().acquire(m_sampleRate, dspChannels, m_config);
+    }
+    return m_dsp != nullptr;
+}
+
+void AudioStreamProcessor::setDspConfig(const DspConfig &cfg) {
+    if (cfg == m_config) return;
+    m_config = cfg;
+    m_recording.reset(); // the rest of the line renders differently
+    m_replay.reset();
+    if (m_dsp) {
+        m_dsp->setConfig(cfg);
+    }
+}
+
+std::uint32_t AudioStreamProcessor::fullChannelMask() const {
+    if (m_channels == 0 || m_channels > kMaxMaskedChannels) return 0;
+    return (m_channels == 32) ? 0xFFFFFFFFu : ((1u << m_channels) - 1u);
+}
+
+std::uint32_t AudioStreamProcessor::trackChannelActivity(const std::uint8_t *data, std::size_t bytes) {
+    const std::uint32_t full = fullChannelMask();
+    // Only multichannel PCM16 layouts; stereo duplicates are handled by DspPipeline's mono path.
+    if (m_channels < 3 || full == 0 || m_blockAlign != m_channels * sizeof(std::int16_t) || !data) {
+        return full;
+    }
+    if (m_silentFrames.size() != m_channels) {
+        m_silentFrames.assign(m_channels, 0);
+    }
+    const std::size_t frames = bytes / m_blockAlign;
+    const auto *pcm = reinterpret_cast<const std::int16_t *>(data);
+    const std::uint32_t idleFrames = static_cast<std::uint32_t>(
+        static_cast<std::uint64_t>(m_sampleRate) * kChannelIdleMs / 1000);
+    const std::uint32_t loud = loudChannels(pcm, frames, m_channels, kChannelSilenceLevel);
+    std::uint32_t mask = 0;
+    for (std::uint32_t c = 0; c < m_channels; ++c) {
+        if (!(loud & (1u << c))) {
+            m_silentFrames[c] = static_cast<std::uint32_t>(
+                std::min<std::uint64_t>(static_cast<std::uint64_t>(m_silentFrames[c]) + frames, 0xFFFFFFFFu));
+        } else {
+            m_silentFrames[c] = 0;
+        }
+        if (m_silentFrames[c] < idleFrames) mask |= (1u << c);
+    }
+    // Everything silent: keep the current layout rather than rebuilding around nothing.
+    return mask ? mask : m_activeMask;
+}
+
+void AudioStreamProcessor::applyChannelMask(std::uint32_t mask, float speed, bool shouldLog, std::uintptr_t key) {
+    if (mask == m_activeMask) return;
+    if (shouldLog) {
+        KRKR_LOG_DEBUG("AudioStream: active channel mask " + std::to_string(m_activeMask) + " -> " +
+                       std::to_string(mask) + " key=" + std::to_string(key));
+    }
+    const bool drained = m_dsp != nullptr;
+    if (m_dsp) {
+        // What the old layout still holds plays out instead of being dropped with the pipeline.
+        auto tail = m_dsp->finish();
+        if (m_activeMask != fullChannelMask()) tail = expandChannels(tail, m_channels, m_activeMask);
+        m_cbuffer.insert(m_cbuffer.end(), tail.begin(), tail.end());
+    }
+    DspPipelinePool::instance().recycle(std::move(m_dsp));
+    m_activeMask = mask;
+    m_maskSkipBytes = 0;
+    if (!ensureDsp() || m_history.empty()) return;
+    // Prime with recent input (output discarded) so the new pipeline continues where the old one left off.
+    const bool full = (mask == fullChannelMask());
+    std::size_t primedOut = 0;
+    if (full) {
+        primedOut = m_dsp->process(m_history.data(), m_history.size(), speed, DspMode::Tempo).size();
+    } else {
+        const auto primed = compactChannels(m_history.data(), m_history.size(), m_channels, mask);
+        primedOut = m_dsp->process(primed.data(), primed.size(), speed, DspMode::Tempo).size();
+    }
+    if (!drained) return;
+    // The end of the history is now the new pipeline's latency, which the drained tail already covers: skip the
+    // output it still owes for it so the two meet without repeating.
+    const std::size_t frames = m_history.size() / m_blockAlign;
+    const std::size_t dspFrameBytes = sizeof(std::int16_t) * m_dsp->channels();
+    const double owed = static_cast<double>(frames) / std::max(0.01f, speed * m_dsp->tempoTrim()) -
+                        static_cast<double>(primedOut / dspFrameBytes);
+    m_maskSkipBytes = static_cast<std::size_t>(std::max(0.0, std::floor(owed + 0.5))) * m_blockAlign;
+}
+
+void AudioStreamProcessor::releaseDsp() {
+    finishRender();
+    DspPipelinePool::instance().recycle(std::move(m_dsp));
+    std::vector<std::uint8_t>().swap(m_cbuffer);
+    std::vector<std::uint8_t>().swap(m_abuffer);
+    std::vector<std::uint8_t>().swap(m_history);
+    std::vector<std::uint8_t>().swap(m_batch);
+    m_maskSkipBytes = 0;
+    m_startLatencyFrames = 0.0;
+    m_startShortFrames = 0.0;
+    m_startTrim = 1.0f;
+    m_primeNext = true;
+    m_drainTempo = 1.0f;
+}
+
+float AudioStreamProcessor::backlogMs() const {
+    const std::size_t bytesPerSec = static_cast<std::size_t>(m_blockAlign) * m_sampleRate;
+    if (bytesPerSec == 0) return 0.0f;
+    return static_cast<float>(m_cbuffer.size()) * 1000.0f / static_cast<float>(bytesPerSec);
+}
+
+void AudioStreamProcessor::enforceBacklog(bool shouldLog, std::uintptr_t key) {
+    const std::size_t align = m_blockAlign ? m_blockAlign : 1;
+    const std::size_t bytesPerSec = static_cast<std::size_t>(m_blockAlign) * m_sampleRate;
+    if (bytesPerSec == 0 || m_backlog.maxMs <= 0.0f) return;
+    const std::size_t capBytes =
+        (static_cast<std::size_t>(static_cast<double>(bytesPerSec) * m_backlog.maxMs / 1000.0) / align) * align;
+
+    if (m_backlog.policy == BacklogPolicy::Accelerate && m_dsp) {
+        // Proportional drain: up to +25% tempo at twice the cap, released once back under half the cap.
+        float trim = 1.0f;
+        if (m_cbuffer.size() > capBytes / 2 && capBytes > 0) {
+            const float fill = static_cast<float>(m_cbuffer.size()) / static_cast<float>(capBytes);
+            trim = 1.0f + std::clamp((fill - 0.5f) / 1.5f, 0.0f, 1.0f) * 0.25f;
+        }
+        if (std::fabs(trim - m_drainTempo) > 0.01f || (trim == 1.0f && m_drainTempo != 1.0f)) {
+            m_drainTempo = trim;
+            m_dsp->setTempoTrim(trim * m_startTrim);
+        }
+    }
+
+    const std::size_t limit = (m_backlog.policy == BacklogPolicy::Accelerate) ? capBytes * 2 : capBytes;
+    if (m_cbuffer.size() <= limit) return;
+    const std::size_t excess = ((m_cbuffer.size() - capBytes) / align) * align;
+    if (excess == 0) return;
+
+    bool compressed = false;
+    if (m_backlog.policy == BacklogPolicy::Compress && m_blockAlign >= sizeof(std::int16_t)) {
+        const std::size_t channels = m_blockAlign / sizeof(std::int16_t);
+        const std::size_t grain = std::max<std::size_t>(1, m_sampleRate / 100); // 10 ms
+        const std::size_t fade = std::max<std::size_t>(1, m_sampleRate / 400);  // 2.5 ms
+        compressed = spliceOutGrains(m_cbuffer, channels, excess / m_blockAlign, grain, fade);
+    }
+    if (!compressed) {
+        m_cbuffer.erase(m_cbuffer.begin(), m_cbuffer.begin() + static_cast<std::ptrdiff_t>(excess));
+    }
+    if (shouldLog) {
+        KRKR_LOG_DEBUG(std::string("AudioStream: backlog over cap; ") + (compressed ? "compressed " : "dropped ") +
+                       std::to_string(excess) + " bytes key=" + std::to_string(key) +
+                       " backlogMs=" + std::to_string(backlogMs()));
+    }
+}
+
+void AudioStreamProcessor::primeDsp(float ratio, DspMode mode, bool shouldLog, std::uintptr_t key) {
+    m_primeNext = false;
+    if (!m_dsp) return;
+    const std::size_t lead = m_dsp->prime(ratio, mode);
+    // How much output the queued pre-roll costs depends on the engine (IntWsola releases it almost 1:1), so
+    // count it at the slower of 1:1 and the tempo; any excess only adds to Cbuffer.
+    m_startLatencyFrames =
+        static_cast<double>(lead) / (mode == DspMode::Tempo ? std::clamp(ratio, 0.01f, 1.0f) : 1.0f);
+    m_startShortFrames = 0.0;
+    if (shouldLog && lead > 0) {
+        KRKR_LOG_DEBUG("AudioStream: primed DSP, start latency " + std::to_string(lead) +
+                       " frames key=" + std::to_string(key));
+    }
+}
+
+void AudioStreamProcessor::applyStartTrim(double outFrames) {
+    double trim = 1.0;
+    if (outFrames > 0.0) {
+        if (m_startLatencyFrames > 0.0) {
+            // The pre-roll is dropped from this call's output, and it is dropped at the trimmed tempo too.
+            trim = (outFrames - m_startLatencyFrames) / outFrames;
+        } else if (m_startShortFrames > 0.0) {
+            trim = outFrames / (outFrames + m_startShortFrames);
+        }
+    }
+    const float next = std::clamp(static_cast<float>(trim), kStartTrimMin, 1.0f);
+    if (next != m_startTrim) {
+        m_startTrim = next;
+        m_dsp->setTempoTrim(m_drainTempo * next);
+    }
+}
+
+void AudioStreamProcessor::settleStart(std::size_t producedBytes, double shortFrames) {
+    if (m_startLatencyFrames <= 0.0 && m_startShortFrames <= 0.0) {
+        return; // no start in progress (nothing was primed, or it has been made up)
+    }
+    if (producedBytes > 0) {
+        m_startLatencyFrames = 0.0; // the pre-roll has been dropped; real input is coming out
+    }
+    m_startShortFrames = m_startLatencyFrames > 0.0 ? 0.0 : std::max(0.0, shortFrames);
+}
+
+std::vector<std::uint8_t> AudioStreamProcessor::timedProcess(const std::uint8_t *data, std::size_t bytes, float ratio,
+                                                             DspMode mode, std::uintptr_t key) {
+    // Pipelines come back from flush() and the pool at QualityTier::Full.
+    const QualityTier tier = qualityTier(mode);
+    if (m_dsp->qualityTier() != tier) {
+        m_dsp->setQualityTier(tier);
+    }
+    const auto start = m_quality.now();
+    auto out = m_dsp->process(data, bytes, ratio, mode);
+    const std::size_t frameBytes = sizeof(std::int16_t) * std::max<std::uint32_t>(1, m_dsp->channels());
+    double playbackSec = static_cast<double>(bytes / frameBytes) / std::max<std::uint32_t>(1, m_sampleRate);
+    if (mode == DspMode::Tempo) {
+        playbackSec /= std::max(0.01f, ratio);
+    }
+    recordDspLoad(start, playbackSec, tier, mode, key);
+    return out;
+}
+
+void AudioStreamProcessor::recordDspLoad(std::chrono::steady_clock::time_point start, double playbackSec,
+                                         QualityTier tier, DspMode mode, std::uintptr_t key) {
+    m_quality.record(start, playbackSec);
+    const QualityTier next = qualityTier(mode);
+    if (next != tier) {
+        m_dsp->setQualityTier(next);
+        KRKR_LOG_INFO("AudioStream: DSP quality tier " + std::to_string(static_cast<std::uint32_t>(tier)) + " -> " +
+                      std::to_string(static_cast<std::uint32_t>(next)) + " load=" + std::to_string(m_quality.load()) +
+                      " key=" + std::to_string(key));
+    }
+}
+
+std::size_t AudioStreamProcessor::memoryFootprint() const {
+    std::size_t bytes = m_cbuffer.capacity() + m_abuffer.capacity() + m_history.capacity() + m_batch.capacity();
+    if (m_dsp) {
+        bytes += m_dsp->memoryFootprint();
+    }
+    if (m_recording) {
+        bytes += m_recording->footprint();
+    }
+    return bytes;
 }
 
 AudioProcessResult AudioStreamProcessor::process(const std::uint8_t *data, std::size_t bytes, float userSpeed,
@@ -26,39 +420,45 @@ AudioProcessResult AudioStreamProcessor::process(const std::uint8_t *data, std::
         result.cbufferSize = m_cbuffer.size();
         result.appliedSpeed = appliedSpeed;
     };
-    if (!data || bytes == 0 || !m_dsp) {
+    if (!data || bytes == 0) {
         fillPassthrough(1.0f);
         return result;
     }
-    if (bytes < 10) {
-        // Ignore tiny buffers entirely.
-        fillPassthrough(userSpeed);
+    if (serveCachedRender(data, bytes, userSpeed, result, shouldLog, key)) {
+        return result;
+    }
+    if (!ensureDsp()) {
+        fillPassthrough(1.0f);
         return result;
     }
 
     const float denom = std::max(0.01f, userSpeed);
     const float pitchDown = 1.0f / denom;
 
+    const std::size_t align = m_blockAlign ? m_blockAlign : 1;
     const std::size_t bytesPerSec = std::max<std::size_t>(1, m_blockAlign * m_sampleRate);
     result.output.reserve(bytes);
     std::size_t need = bytes;
 
-    if (m_padNext) {
-        const double durationSec = static_cast<double>(bytes) / static_cast<double>(bytesPerSec);
-        if (durationSec < 1.01) {
-            const std::size_t align = m_blockAlign ? m_blockAlign : 1;
-            std::size_t padBytesTarget = static_cast<std::size_t>(bytesPerSec * 0.03);
-            padBytesTarget = (padBytesTarget / align) * align;
-            if (padBytesTarget == 0) padBytesTarget = align;
-            const std::size_t padBytes = std::min(padBytesTarget, bytes);
-            result.output.insert(result.output.end(), padBytes, 0); // zero padding
-            need -= padBytes;
-            if (shouldLog) {
-                KRKR_LOG_DEBUG("AudioStream: initial front-pad " + std::to_string(padBytes) +
-                               " bytes key=" + std::to_string(key));
-            }
-        }
-        m_padNext = false;
+    // Input for this call's DSP run: the new buffer, or queued fragments plus the new buffer.
+    const std::uint8_t *input = data;
+    std::size_t inputBytes = bytes;
+    bool runDsp = true;
+    const bool fragment = bytes * 1000 < bytesPerSec * kBatchFragmentMs;
+    const std::size_t budget = std::max(align, (bytesPerSec * kBatchBudgetMs / 1000) / align * align);
+    if (fragment) {
+        // Tiny fragment: queue its input and serve its output from audio processed earlier. The queue
+        // is processed in one DSP call once it holds kBatchBudgetMs (whole frames only), or at once when
+        // Cbuffer cannot cover this fragment (a line start, or a carry the engine's output steps ate up):
+        // holding it would answer the call with silence.
+        m_batch.insert(m_batch.end(), data, data + bytes);
+        inputBytes = (m_batch.size() / align) * align;
+        runDsp = inputBytes > 0 && (inputBytes >= budget || m_cbuffer.size() < bytes);
+        input = m_batch.data();
+    } else if (!m_batch.empty()) {
+        m_batch.insert(m_batch.end(), data, data + bytes);
+        input = m_batch.data();
+        inputBytes = m_batch.size();
     }
 
     // 1) Consume already-processed tail first; do not re-run through DSP.
@@ -69,38 +469,431 @@ AudioProcessResult AudioStreamProcessor::process(const std::uint8_t *data, std::
         need -= take;
     }
 
-    // 2) Always process new input; if output already filled, stash everything to cbuffer.
-    auto out = m_dsp->process(data, bytes, pitchDown, DspMode::Pitch);
-    if (out.empty()) {
-        if (shouldLog) {
-            KRKR_LOG_DEBUG("AudioStream: pitch-compensate produced 0 bytes; passthrough key=" +
-                           std::to_string(key));
+    // 2) Always process new input (unless it is still being batched); if output already filled, stash
+    // everything to cbuffer.
+    if (runDsp) {
+        std::vector<std::uint8_t> out;
+        const bool starting = m_primeNext || m_startLatencyFrames > 0.0 || m_startShortFrames > 0.0;
+        if (!processPitchSegmented(input, inputBytes, pitchDown, out, shouldLog, key)) {
+            if (m_primeNext) {
+                primeDsp(pitchDown, DspMode::Pitch, shouldLog, key);
+            }
+            applyStartTrim(static_cast<double>(inputBytes / align));
+            out = timedProcess(input, inputBytes, pitchDown, DspMode::Pitch, key);
         }
-        out.assign(data, data + bytes);
-    }
-    if (need > 0) {
-        const std::size_t take = std::min<std::size_t>(need, out.size());
-        result.output.insert(result.output.end(), out.begin(), out.begin() + take);
-        need -= take;
-        if (out.size() > take) {
-            m_cbuffer.insert(m_cbuffer.end(), out.begin() + take, out.end());
+        if (out.empty() && !starting) {
+            if (shouldLog) {
+                KRKR_LOG_DEBUG("AudioStream: pitch-compensate produced 0 bytes; passthrough key=" +
+                               std::to_string(key));
+            }
+            out.assign(input, input + inputBytes);
+        }
+        if (starting) {
+            // A line arriving in fragments is made up until Cbuffer carries a batch, so the engine's output
+            // steps and the batching that follows are covered; a call that ran dry inside the latency stays
+            // short (padded below) rather than playing unprocessed input.
+            const std::size_t want = need + (fragment ? budget : 0);
+            const std::size_t inHand = m_cbuffer.size() + out.size();
+            settleStart(out.size(), static_cast<double>(want - std::min(want, inHand)) / align);
+        }
+        if (input == m_batch.data()) {
+            if (shouldLog && inputBytes > bytes) {
+                KRKR_LOG_DEBUG("AudioStream: processed " + std::to_string(inputBytes) +
+                               " batched bytes key=" + std::to_string(key));
+            }
+            m_batch.erase(m_batch.begin(), m_batch.begin() + static_cast<std::ptrdiff_t>(inputBytes));
+        }
+        if (need > 0) {
+            const std::size_t take = std::min<std::size_t>(need, out.size());
+            result.output.insert(result.output.end(), out.begin(), out.begin() + take);
+            need -= take;
+            if (out.size() > take) {
+                m_cbuffer.insert(m_cbuffer.end(), out.begin() + take, out.end());
+            }
+        } else if (!out.empty()) {
+            m_cbuffer.insert(m_cbuffer.end(), out.begin(), out.end());
         }
-    } else if (!out.empty()) {
-        m_cbuffer.insert(m_cbuffer.end(), out.begin(), out.end());
     }
 
-    // 3) Front-pad if still short to satisfy exact Abuffer length (per new requirement).
+    // 3) Still short (the engine is inside its start latency, or input is being batched): pad the tail, so
+    // whatever was produced plays first and without a gap before it.
     if (need > 0) {
-        result.output.insert(result.output.begin(), need, 0);
+        result.output.insert(result.output.end(), need, 0);
         if (shouldLog) {
-            KRKR_LOG_DEBUG("AudioStream: front-padded " + std::to_string(need) +
+            KRKR_LOG_DEBUG("AudioStream: tail-padded " + std::to_string(need) +
                            " bytes (pitch) key=" + std::to_string(key));
         }
         need = 0;
     }
 
+    enforceBacklog(shouldLog, key);
     result.cbufferSize = m_cbuffer.size();
+    result.backlogMs = backlogMs();
+    result.appliedSpeed = userSpeed;
+    m_lastAppliedSpeed = result.appliedSpeed;
+    recordRender(data, bytes, userSpeed, result);
+    return result;
+}
+
+bool AudioStreamProcessor::serveCachedRender(const std::uint8_t *data, std::size_t bytes, float userSpeed,
+                                             AudioProcessResult &result, bool shouldLog, std::uintptr_t key) {
+    auto &cache = VoiceRenderCache::instance();
+    if (!cache.enabled() || bytes > 0xFFFFFFFFu) {
+        return false;
+    }
+    const bool lineStart = m_primeNext && !m_replay && m_cbuffer.empty() && m_batch.empty();
+    if (lineStart) {
+        m_recording.reset();
+        m_recordingReplaces = false;
+        m_renderKey = VoiceRenderCache::makeKey(data, bytes, m_sampleRate, m_channels, m_blockAlign, userSpeed,
+                                                m_config, qualityTier(DspMode::Pitch));
+        m_replay = cache.find(m_renderKey);
+        m_replayStep = 0;
+        if (!m_replay) {
+            m_recording = std::make_shared<VoiceRender>();
+            return false;
+        }
+        if (shouldLog) {
+            KRKR_LOG_DEBUG("AudioStream: replaying cached render key=" + std::to_string(key));
+        }
+    } else if (!m_replay && m_recording && !m_recordingReplaces && !m_recording->steps.empty()) {
+        // A store (disk cache, pre-render pack) may have delivered this line while it played live; switch over
+        // if everything so far matches it. A line that diverged from the entry under its key skips this: that
+        // entry is the one it is about to replace.
+        if (auto late = cache.peek(m_renderKey)) {
+            const auto &done = m_recording->steps;
+            bool same = late->steps.size() > done.size();
+            for (std::size_t i = 0; same && i < done.size(); ++i) {
+                same = done[i].inputHash == late->steps[i].inputHash &&
+                       done[i].inputBytes == late->steps[i].inputBytes &&
+                       done[i].outputBytes == late->steps[i].outputBytes;
+            }
+            if (same) {
+                m_replay = std::move(late);
+                m_replayStep = done.size();
+                if (shouldLog) {
+                    KRKR_LOG_DEBUG("AudioStream: joined cached render at step " + std::to_string(m_replayStep) +
+                                   " key=" + std::to_string(key));
+                }
+            }
+            // Either way the line is cached now; recording it again would be discarded.
+            m_recording.reset();
+        }
+    }
+    if (!m_replay) {
+        return false;
+    }
+    if (m_replayStep < m_replay->steps.size() && userSpeed == m_renderKey.speed) {
+        const auto &step = m_replay->steps[m_replayStep];
+        if (step.inputBytes == bytes && step.inputHash == xxh64(data, bytes)) {
+            const auto *out = m_replay->output.data() + step.outputOffset;
+            result.output.assign(out, out + step.outputBytes);
+            result.cbufferSize = 0;
+            result.appliedSpeed = userSpeed;
+            m_lastAppliedSpeed = userSpeed;
+            ++m_replayStep;
+            cache.noteServed(step.outputBytes);
+            return true;
+        }
+    }
+    // Input went past or away from the recording: continue live from a freshly primed pipeline. The line
+    // shares its first buffers with the cached one but is a different line; record it, starting with the
+    // steps already served, so it replaces that entry instead of missing on every play.
+    if (shouldLog) {
+        KRKR_LOG_DEBUG("AudioStream: cached render diverged at step " + std::to_string(m_replayStep) +
+                       "; processing live key=" + std::to_string(key));
+    }
+    if (userSpeed == m_renderKey.speed) {
+        auto recording = std::make_shared<VoiceRender>();
+        const std::size_t served = std::min(m_replayStep, m_replay->steps.size());
+        recording->steps.assign(m_replay->steps.begin(), m_replay->steps.begin() + static_cast<std::ptrdiff_t>(served));
+        const std::size_t servedBytes =
+            served ? recording->steps.back().outputOffset + recording->steps.back().outputBytes : 0;
+        recording->output.assign(m_replay->output.begin(),
+                                 m_replay->output.begin() + static_cast<std::ptrdiff_t>(servedBytes));
+        m_recording = std::move(recording);
+        m_recordingReplaces = true;
+    }
+    m_replay.reset();
+    if (m_dsp) {
+        m_dsp->flush();
+    }
+    m_primeNext = true;
+    return false;
+}
+
+void AudioStreamProcessor::recordRender(const std::uint8_t *data, std::size_t bytes, float userSpeed,
+                                        const AudioProcessResult &result) {
+    if (!m_recording) {
+        return;
+    }
+    auto &render = *m_recording;
+    // Anything that makes this line's output differ from a fresh replay of it ends the recording.
+    if (userSpeed != m_renderKey.speed || qualityTier(DspMode::Pitch) != m_renderKey.tier ||
+        render.output.size() + result.output.size() > VoiceRenderCache::instance().maxEntryBytes() ||
+        render.output.size() + result.output.size() > 0xFFFFFFFFu) {
+        m_recording.reset();
+        return;
+    }
+    VoiceRender::Step step;
+    step.inputHash = xxh64(data, bytes);
+    step.inputBytes = static_cast<std::uint32_t>(bytes);
+    step.outputOffset = static_cast<std::uint32_t>(render.output.size());
+    step.outputBytes = static_cast<std::uint32_t>(result.output.size());
+    render.steps.push_back(step);
+    render.output.insert(render.output.end(), result.output.begin(), result.output.end());
+}
+
+void AudioStreamProcessor::finishRender() {
+    if (m_recording && !m_recording->steps.empty()) {
+        m_recording->output.shrink_to_fit();
+        m_recording->steps.shrink_to_fit();
+        VoiceRenderCache::instance().insert(m_renderKey, std::move(m_recording), m_recordingReplaces);
+    }
+    m_recording.reset();
+    m_recordingReplaces = false;
+    m_replay.reset();
+}
+
+bool AudioStreamProcessor::processPitchSegmented(const std::uint8_t *data, std::size_t bytes, float pitch,
+                                                 std::vector<std::uint8_t> &out, bool shouldLog, std::uintptr_t key) {
+    if (!m_dsp || m_blockAlign == 0 || m_sampleRate == 0 || m_blockAlign % sizeof(std::int16_t) != 0) return false;
+    // Bypassed speeds and an active backlog trim (output length no longer tracks input) stay serial.
+    if (std::fabs(pitch - 1.0f) <= 0.001f || std::fabs(m_dsp->tempoTrim() - 1.0f) > 0.001f) return false;
+    const std::size_t frames = bytes / m_blockAlign;
+    if (static_cast<double>(frames) < kSegmentedMinSec * m_sampleRate) return false;
+    const std::size_t minSegment = static_cast<std::size_t>(kSegmentMinSec * m_sampleRate);
+    const std::size_t segments = std::min(WorkerPool::instance().concurrency(), frames / std::max<std::size_t>(1, minSegment));
+    if (segments < 2) return false;
+
+    const std::size_t channels = m_blockAlign / sizeof(std::int16_t);
+    const std::size_t fade = std::max<std::size_t>(1, m_sampleRate * kSeamFadeMs / 1000);
+    const std::size_t search = m_sampleRate * kSeamSearchMs / 1000;
+    const std::size_t lead = m_sampleRate * kSeamLeadMs / 1000;
+    const std::size_t tail = m_sampleRate * kSeamTailMs / 1000;
+
+    struct Segment {
+        std::size_t inStart = 0;
+        std::size_t seam = 0; // input frame where the next segment takes over
+        std::vector<std::uint8_t> out;
+    };
+    std::vector<Segment> parts(segments);
+    for (std::size_t k = 0; k < segments; ++k) {
+        const std::size_t coreStart = frames * k / segments;
+        parts[k].inStart = (k == 0) ? 0 : coreStart - lead;
+        parts[k].seam = frames * (k + 1) / segments;
+    }
+
+    // Whatever the stream pipeline still holds from earlier input comes first. The last segment then runs on
+    // the emptied m_dsp and is not finished: its latency tail stays queued for the next call, exactly as on
+    // the serial path, so the stream continues without a cold start. Its lead covers the start-up, so no
+    // priming is needed either. At a line start nothing is queued ahead, so the output would come up that
+    // latency short: every segment runs as much slower instead, and the seams move with it.
+    float trim = 1.0f;
+    if (m_primeNext) {
+        const double latency = static_cast<double>(m_dsp->initialLatencyFrames(pitch, DspMode::Pitch));
+        trim = std::clamp(static_cast<float>((static_cast<double>(frames) - latency) / static_cast<double>(frames)),
+                          kStartTrimMin, 1.0f);
+    }
+    auto stretched = [trim](std::size_t inFrames) {
+        return static_cast<std::size_t>(std::lround(static_cast<double>(inFrames) / trim));
+    };
+    out = m_dsp->finish();
+    const std::size_t prefix = out.size();
+    m_primeNext = false;
+
+    // Segments share one governor step: the tier applies to every pipeline and the load is the wall time
+    // of the whole fan-out against the playback time it produced.
+    const QualityTier tier = qualityTier(DspMode::Pitch);
+    const auto start = m_quality.now();
+    WorkerPool::instance().parallelFor(segments, [&](std::size_t k) {
+        auto &part = parts[k];
+        const bool last = (k + 1 == segments);
+        const std::size_t inEnd = last ? frames : std::min(frames, part.seam + tail);
+        std::unique_ptr<DspPipeline> borrowed;
+        DspPipeline *dsp = m_dsp.get();
+        if (!last) {
+            borrowed = DspPipelinePool::instance().acquire(m_sampleRate, m_dsp->channels(), m_config);
+            dsp = borrowed.get();
+        }
+        if (dsp->qualityTier() != tier) {
+            dsp->setQualityTier(tier);
+        }
+        dsp->setTempoTrim(trim);
+        part.out = dsp->process(data + part.inStart * m_blockAlign, (inEnd - part.inStart) * m_blockAlign, pitch,
+                                DspMode::Pitch);
+        DspPipelinePool::instance().recycle(std::move(borrowed));
+    });
+    recordDspLoad(start, static_cast<double>(frames) / m_sampleRate, tier, DspMode::Pitch, key);
+    m_dsp->setTempoTrim(1.0f);
+
+    // Stitch: segment k contributes [cursor, seam - fade), then crossfades into segment k+1 at the offset
+    // (within +-search) where the two renderings line up best.
+    std::size_t cursor = 0;
+    for (std::size_t k = 0; k < segments; ++k) {
+        const auto &part = parts[k];
+        const std::size_t partFrames = part.out.size() / m_blockAlign;
+        const auto *pcm = reinterpret_cast<const std::int16_t *>(part.out.data());
+        if (k + 1 == segments) {
+            if (cursor < partFrames) {
+                out.insert(out.end(), part.out.begin() + cursor * m_blockAlign, part.out.end());
+            }
+            break;
+        }
+        const auto &next = parts[k + 1];
+        const std::size_t nextFrames = next.out.size() / m_blockAlign;
+        const std::size_t seamLocal = stretched(part.seam - part.inStart);
+        const std::size_t nextLocal = stretched(part.seam - next.inStart); // == lead
+        const std::size_t cut = std::min(seamLocal - fade, partFrames);
+        if (cursor < cut) {
+            out.insert(out.end(), part.out.begin() + cursor * m_blockAlign, part.out.begin() + cut * m_blockAlign);
+        }
+        if (partFrames < seamLocal || nextFrames < nextLocal + search || nextLocal < fade + search) {
+            // Previous rendering ended early (or next is too short): plain butt splice.
+            const std::size_t back = seamLocal - cut;
+            cursor = std::min(nextLocal > back ? nextLocal - back : 0, nextFrames);
+            continue;
+        }
+        const auto *nextPcm = reinterpret_cast<const std::int16_t *>(next.out.data());
+        const std::ptrdiff_t nominal = static_cast<std::ptrdiff_t>(nextLocal - fade);
+        const std::ptrdiff_t off = bestSeamOffset(pcm + cut * channels, nextPcm + nominal * channels, fade, channels,
+                                                  -static_cast<std::ptrdiff_t>(search),
+                                                  static_cast<std::ptrdiff_t>(search));
+        const std::int16_t *a = pcm + cut * channels;
+        const std::int16_t *b = nextPcm + (nominal + off) * static_cast<std::ptrdiff_t>(channels);
+        const std::size_t prev = out.size();
+        out.resize(prev + fade * m_blockAlign);
+        auto *dst = reinterpret_cast<std::int16_t *>(out.data() + prev);
+        for (std::size_t i = 0; i < fade; ++i) {
+            const float w = static_cast<float>(i + 1) / static_cast<float>(fade + 1);
+            for (std::size_t c = 0; c < channels; ++c) {
+                const float mixed = a[i * channels + c] * (1.0f - w) + b[i * channels + c] * w;
+                dst[i * channels + c] = static_cast<std::int16_t>(std::lround(mixed));
+            }
+        }
+        cursor = static_cast<std::size_t>(nominal + off) + fade;
+    }
+
+    if (shouldLog) {
+        KRKR_LOG_DEBUG("AudioStream: segmented pitch process segments=" + std::to_string(segments) +
+                       " inFrames=" + std::to_string(frames) +
+                       " outFrames=" + std::to_string((out.size() - prefix) / m_blockAlign) +
+                       " key=" + std::to_string(key));
+    }
+    return true;
+}
+
+bool AudioStreamProcessor::prefersInPlace(std::size_t bytes) const {
+    const double bytesPerSec = static_cast<double>(m_blockAlign) * m_sampleRate;
+    return bytesPerSec > 0.0 && static_cast<double>(bytes) >= kInPlaceMinSec * bytesPerSec;
+}
+
+AudioProcessResult AudioStreamProcessor::processInPlace(std::uint8_t *region1, std::size_t bytes1,
+                                                        std::uint8_t *region2, std::size_t bytes2, float userSpeed,
+                                                        bool shouldLog, std::uintptr_t key) {
+    AudioProcessResult result;
     result.appliedSpeed = userSpeed;
+    if (!region1) bytes1 = 0;
+    if (!region2) bytes2 = 0;
+    const std::size_t align = m_blockAlign ? m_blockAlign : 1;
+    const std::size_t total = ((bytes1 + bytes2) / align) * align;
+    if (total == 0 || !ensureDsp()) {
+        result.cbufferSize = m_cbuffer.size();
+        return result;
+    }
+
+    // The two lock regions form one logical buffer.
+    auto copyIn = [&](std::size_t pos, std::uint8_t *dst, std::size_t len) {
+        if (pos < bytes1) {
+            const std::size_t n = std::min(len, bytes1 - pos);
+            std::memcpy(dst, region1 + pos, n);
+            dst += n;
+            pos += n;
+            len -= n;
+        }
+        if (len > 0) std::memcpy(dst, region2 + (pos - bytes1), len);
+    };
+    auto copyOut = [&](std::size_t pos, const std::uint8_t *src, std::size_t len) {
+        if (pos < bytes1) {
+            const std::size_t n = std::min(len, bytes1 - pos);
+            std::memcpy(region1 + pos, src, n);
+            src += n;
+            pos += n;
+            len -= n;
+        }
+        if (len > 0) std::memcpy(region2 + (pos - bytes1), src, len);
+    };
+
+    const float pitchDown = 1.0f / std::max(0.01f, userSpeed);
+    if (m_primeNext) {
+        // Same start as process(): the pre-roll is dropped and the latency made up by the start trim below.
+        primeDsp(pitchDown, DspMode::Pitch, shouldLog, key);
+    }
+    if (!m_batch.empty()) {
+        // Queued fragments precede this buffer; their output joins the pending queue.
+        const auto out = timedProcess(m_batch.data(), m_batch.size(), pitchDown, DspMode::Pitch, key);
+        m_cbuffer.insert(m_cbuffer.end(), out.begin(), out.end());
+        m_batch.clear();
+    }
+    const std::size_t bytesPerSec = static_cast<std::size_t>(m_blockAlign) * m_sampleRate;
+    const std::size_t chunkBytes = std::max(align, (bytesPerSec * kInPlaceChunkMs / 1000) / align * align);
+    std::vector<std::uint8_t> chunk(chunkBytes);
+    std::size_t readPos = 0;
+    std::size_t writePos = 0;
+    // Cbuffer doubles as the pending queue: earlier output first, then each chunk's output.
+    auto writeBehind = [&](std::size_t limit) {
+        const std::size_t n = std::min(m_cbuffer.size(), limit - writePos);
+        if (n == 0) return;
+        copyOut(writePos, m_cbuffer.data(), n);
+        m_cbuffer.erase(m_cbuffer.begin(), m_cbuffer.begin() + static_cast<std::ptrdiff_t>(n));
+        writePos += n;
+    };
+    while (readPos < total) {
+        const std::size_t len = std::min(chunkBytes, total - readPos);
+        copyIn(readPos, chunk.data(), len);
+        readPos += len;
+        applyStartTrim(static_cast<double>(len / align));
+        // A chunk that comes back short (or empty, inside the latency) leaves its deficit for the start trim
+        // to make up on the following chunks; its input is never written back unprocessed.
+        const auto out = timedProcess(chunk.data(), len, pitchDown, DspMode::Pitch, key);
+        m_cbuffer.insert(m_cbuffer.end(), out.begin(), out.end());
+        writeBehind(readPos);
+        settleStart(out.size(), static_cast<double>((readPos - writePos) / align));
+        // Whatever is still pending has outrun the input (a pipeline that lengthens, e.g. the resampling
+        // fallback); cap it per chunk, not only at the end, so the queue cannot grow with the buffer.
+        enforceBacklog(shouldLog, key);
+    }
+    // No more input follows this buffer: release SoundTouch's latency tail, then pad any shortfall at the end.
+    const auto tail = m_dsp->finish();
+    m_cbuffer.insert(m_cbuffer.end(), tail.begin(), tail.end());
+    writeBehind(total);
+    if (writePos < total) {
+        std::fill(chunk.begin(), chunk.end(), 0);
+        const std::size_t shortfall = total - writePos;
+        while (writePos < total) {
+            const std::size_t n = std::min(chunkBytes, total - writePos);
+            copyOut(writePos, chunk.data(), n);
+            writePos += n;
+        }
+        if (shouldLog) {
+            KRKR_LOG_DEBUG("AudioStream: in-place tail-padded " + std::to_string(shortfall) +
+                           " bytes key=" + std::to_string(key));
+        }
+    }
+    // finish() flushed the pipeline: whatever comes next starts a new line.
+    m_startLatencyFrames = 0.0;
+    m_startShortFrames = 0.0;
+    m_startTrim = 1.0f;
+    m_drainTempo = 1.0f;
+    m_primeNext = true;
+
+    enforceBacklog(shouldLog, key);
+    if (shouldLog) {
+        KRKR_LOG_DEBUG("AudioStream: in-place processed " + std::to_string(total) + " bytes in " +
+                       std::to_string((total + chunkBytes - 1) / chunkBytes) + " chunks key=" + std::to_string(key));
+    }
+    result.cbufferSize = m_cbuffer.size();
+    result.backlogMs = backlogMs();
     m_lastAppliedSpeed = result.appliedSpeed;
     return result;
 }
@@ -108,67 +901,101 @@ AudioProcessResult AudioStreamProcessor::process(const std::uint8_t *data, std::
 AudioProcessResult AudioStreamProcessor::processTempoToSize(const std::uint8_t *data, std::size_t inputBytes,
                                                             std::size_t outputBytes, float userSpeed, bool shouldLog,
                                                             std::uintptr_t key) {
+    std::vector<std::uint8_t> output(outputBytes);
+    AudioProcessResult result =
+        processTempoInto(data, inputBytes, output.data(), outputBytes, userSpeed, shouldLog, key);
+    result.output = std::move(output);
+    return result;
+}
+
+AudioProcessResult AudioStreamProcessor::processTempoInto(const std::uint8_t *data, std::size_t inputBytes,
+                                                          std::uint8_t *out, std::size_t outputBytes, float userSpeed,
+                                                          bool shouldLog, std::uintptr_t key) {
     AudioProcessResult result;
-    if (outputBytes == 0) {
+    if (outputBytes == 0 || !out) {
         result.appliedSpeed = userSpeed;
         return result;
     }
 
     const float appliedSpeed = userSpeed <= 0.01f ? 1.0f : userSpeed;
     const std::size_t bytesPerSec = std::max<std::size_t>(1, m_blockAlign * m_sampleRate);
-    result.output.reserve(outputBytes);
     std::size_t need = outputBytes;
 
-    if (m_padNext) {
-        const double durationSec =
-            bytesPerSec > 0 ? static_cast<double>(inputBytes) / static_cast<double>(bytesPerSec) : 0.0;
-        if (durationSec < 1.01) {
-            const std::size_t align = m_blockAlign ? m_blockAlign : 1;
-            std::size_t padBytesTarget = static_cast<std::size_t>(bytesPerSec * 0.03);
-            padBytesTarget = (padBytesTarget / align) * align;
-            if (padBytesTarget == 0) padBytesTarget = align;
-            const std::size_t padBytes = std::min(padBytesTarget, need);
-            result.output.insert(result.output.end(), padBytes, 0);
-            need -= padBytes;
-            if (shouldLog) {
-                KRKR_LOG_DEBUG("AudioStream: initial front-pad " + std::to_string(padBytes) +
-                               " bytes key=" + std::to_string(key));
-            }
-        }
-        m_padNext = false;
+    std::uint32_t channelMask = m_activeMask;
+    if (data && inputBytes > 0) {
+        m_abuffer.insert(m_abuffer.end(), data, data + inputBytes);
+        channelMask = trackChannelActivity(data, inputBytes);
+    }
+    if (!m_abuffer.empty()) {
+        // May drain the old pipeline into Cbuffer, so before Cbuffer is served.
+        applyChannelMask(channelMask, appliedSpeed, shouldLog, key);
     }
 
-    if (!m_cbuffer.empty()) {
+    auto serveCbuffer = [&]() {
         const std::size_t take = std::min(m_cbuffer.size(), need);
-        result.output.insert(result.output.end(), m_cbuffer.begin(), m_cbuffer.begin() + take);
+        std::memcpy(out, m_cbuffer.data(), take);
+        out += take;
         m_cbuffer.erase(m_cbuffer.begin(), m_cbuffer.begin() + take);
         need -= take;
-    }
-
-    if (data && inputBytes > 0) {
-        m_abuffer.insert(m_abuffer.end(), data, data + inputBytes);
+    };
+    if (!m_cbuffer.empty()) {
+        serveCbuffer();
     }
 
     std::vector<std::uint8_t> processed;
-    if (m_dsp && !m_abuffer.empty()) {
+    if (!m_abuffer.empty() && ensureDsp()) {
         const std::size_t align = m_blockAlign ? m_blockAlign : 1;
         std::size_t minBytes = static_cast<std::size_t>(bytesPerSec * 0.03);
         minBytes = (minBytes / align) * align;
         if (minBytes == 0) minBytes = align;
-        if (m_abuffer.size() >= minBytes) {
-            processed = m_dsp->process(m_abuffer.data(), m_abuffer.size(), appliedSpeed, DspMode::Tempo);
+        // Output comes one minBytes batch at a time, so Cbuffer has to carry a batch between runs. A stream
+        // start does not wait for a full batch: every call runs, slowed, until Cbuffer holds one.
+        const std::size_t batchBytes =
+            static_cast<std::size_t>(static_cast<double>(minBytes) / appliedSpeed) / align * align;
+        const bool starting = m_primeNext || m_startLatencyFrames > 0.0 || m_startShortFrames > 0.0;
+        if (m_abuffer.size() >= minBytes || starting) {
+            if (m_primeNext) {
+                primeDsp(appliedSpeed, DspMode::Tempo, shouldLog, key);
+            }
+            applyStartTrim(static_cast<double>(m_abuffer.size() / align) / (appliedSpeed * m_drainTempo));
+            if (m_activeMask == fullChannelMask()) {
+                processed = timedProcess(m_abuffer.data(), m_abuffer.size(), appliedSpeed, DspMode::Tempo, key);
+            } else {
+                const auto compact = compactChannels(m_abuffer.data(), m_abuffer.size(), m_channels, m_activeMask);
+                processed = expandChannels(
+                    timedProcess(compact.data(), compact.size(), appliedSpeed, DspMode::Tempo, key), m_channels,
+                    m_activeMask);
+            }
+            if (m_channels >= 3) {
+                const std::size_t keep = static_cast<std::size_t>(bytesPerSec) * kChannelPrimeMs / 1000 / align * align;
+                m_history.insert(m_history.end(), m_abuffer.begin(), m_abuffer.end());
+                if (m_history.size() > keep) {
+                    m_history.erase(m_history.begin(), m_history.end() - static_cast<std::ptrdiff_t>(keep));
+                }
+            }
             m_abuffer.clear();
+            if (m_maskSkipBytes > 0 && !processed.empty()) {
+                const std::size_t skip = std::min(m_maskSkipBytes, processed.size());
+                processed.erase(processed.begin(), processed.begin() + static_cast<std::ptrdiff_t>(skip));
+                m_maskSkipBytes -= skip;
+            }
             if (processed.empty() && shouldLog) {
                 KRKR_LOG_DEBUG("AudioStream: tempo produced 0 bytes; holding output key=" +
                                std::to_string(key));
             }
+            if (starting) {
+                const std::size_t inHand = m_cbuffer.size() + processed.size();
+                settleStart(processed.size(),
+                            static_cast<double>(batchBytes + need - std::min(batchBytes + need, inHand)) / align);
+            }
         }
     }
 
     if (!processed.empty()) {
         if (need > 0) {
             const std::size_t take = std::min<std::size_t>(need, processed.size());
-            result.output.insert(result.output.end(), processed.begin(), processed.begin() + take);
+            std::memcpy(out, processed.data(), take);
+            out += take;
             need -= take;
             if (processed.size() > take) {
                 m_cbuffer.insert(m_cbuffer.end(), processed.begin() + take, processed.end());
@@ -177,9 +1004,8 @@ AudioProcessResult AudioStreamProcessor::processTempoToSize(const std::uint8_t *
             m_cbuffer.insert(m_cbuffer.end(), processed.begin(), processed.end());
         }
     }
-
     if (need > 0) {
-        result.output.insert(result.output.end(), need, 0);
+        std::memset(out, 0, need);
         if (shouldLog) {
             KRKR_LOG_DEBUG("AudioStream: tail-padded " + std::to_string(need) +
                            " bytes (tempo) key=" + std::to_string(key));
@@ -187,7 +1013,9 @@ AudioProcessResult AudioStreamProcessor::processTempoToSize(const std::uint8_t *
         need = 0;
     }
 
+    enforceBacklog(shouldLog, key);
     result.cbufferSize = m_cbuffer.size();
+    result.backlogMs = backlogMs();
     result.appliedSpeed = appliedSpeed;
     m_lastAppliedSpeed = result.appliedSpeed;
     return result;
@@ -202,7 +1030,7 @@ AudioProcessResult AudioStreamProcessor::processPitchToSize(const std::uint8_t *
         return result;
     }
 
-    if (!data || inputBytes == 0 || !m_dsp || m_blockAlign == 0) {
+    if (!data || inputBytes == 0 || m_blockAlign == 0 || !ensureDsp()) {
         result.output.assign(outputBytes, 0);
         result.cbufferSize = 0;
         result.appliedSpeed = userSpeed;
@@ -223,7 +1051,7 @@ AudioProcessResult AudioStreamProcessor::processPitchToSize(const std::uint8_t *
     const float ratio = static_cast<float>(outFrames) / static_cast<float>(inFrames);
     const float pitchDown = std::clamp(ratio, 0.01f, 4.0f);
 
-    std::vector<std::uint8_t> processed = m_dsp->process(data, inputBytes, pitchDown, DspMode::Pitch);
+    std::vector<std::uint8_t> processed = timedProcess(data, inputBytes, pitchDown, DspMode::Pitch, key);
     if (processed.empty()) {
         if (shouldLog) {
             KRKR_LOG_DEBUG("AudioStream: pitch process produced 0 bytes; fallback passthrough key=" +
@@ -266,7 +1094,7 @@ AudioProcessResult AudioStreamProcessor::processPitchToSize(const std::uint8_t *
     }
 
     m_cbuffer.clear();
-    m_padNext = false;
+    m_primeNext = false;
     result.cbufferSize = 0;
     result.appliedSpeed = userSpeed;
     m_lastAppliedSpeed = result.appliedSpeed;
@@ -277,18 +1105,46 @@ void AudioStreamProcessor::resetIfIdle(std::chrono::steady_clock::time_point now
                                        std::chrono::milliseconds idleThreshold, bool shouldLog, std::uintptr_t key) {
     if (m_lastPlayEnd.time_since_epoch().count() == 0) return;
     const auto idleMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastPlayEnd);
-    if (idleMs > idleThreshold) {
-        if (!m_cbuffer.empty() && shouldLog) {
-            KRKR_LOG_DEBUG("AudioStream: stream reset after idle gap key=" + std::to_string(key) +
-                           " idleMs=" + std::to_string(idleMs.count()));
-        }
-        m_cbuffer.clear();
-        m_abuffer.clear();
-        m_padNext = true;
-        if (m_dsp) {
-            m_dsp->flush();
+    const auto threshold = adaptiveIdleThreshold(idleThreshold);
+    if (idleMs <= threshold) {
+        // Continuation of the same stream: remember how late it arrived.
+        const float gap = static_cast<float>(std::max<std::chrono::milliseconds::rep>(0, idleMs.count()));
+        if (m_idleGapsMs.size() < kIdleGapHistory) {
+            m_idleGapsMs.push_back(gap);
+        } else {
+            m_idleGapsMs[m_idleGapNext] = gap;
         }
+        m_idleGapNext = (m_idleGapNext + 1) % kIdleGapHistory;
+        return;
     }
+    if (!m_cbuffer.empty() && shouldLog) {
+        KRKR_LOG_DEBUG("AudioStream: stream reset after idle gap key=" + std::to_string(key) +
+                       " idleMs=" + std::to_string(idleMs.count()) +
+                       " thresholdMs=" + std::to_string(threshold.count()));
+    }
+    finishRender();
+    m_cbuffer.clear();
+    m_abuffer.clear();
+    m_history.clear();
+    m_batch.clear();
+    m_maskSkipBytes = 0;
+    m_startLatencyFrames = 0.0;
+    m_startShortFrames = 0.0;
+    m_startTrim = 1.0f;
+    m_primeNext = true;
+    m_drainTempo = 1.0f;
+    if (m_dsp) {
+        m_dsp->flush();
+    }
+}
+
+std::chrono::milliseconds AudioStreamProcessor::adaptiveIdleThreshold(std::chrono::milliseconds fallback) const {
+    if (m_idleGapsMs.size() < kIdleGapMinSamples) return fallback;
+    std::vector<float> gaps(m_idleGapsMs);
+    const auto p95 = gaps.begin() + static_cast<std::ptrdiff_t>((gaps.size() - 1) * 95 / 100);
+    std::nth_element(gaps.begin(), p95, gaps.end());
+    const auto adapted = std::chrono::milliseconds(static_cast<std::int64_t>(*p95 * kIdleGapScale) + kIdleGapMarginMs);
+    return std::clamp(adapted, fallback / 2, fallback * 4);
 }
 
 void AudioStreamProcessor::recordPlaybackEnd(float durationSec, float appliedSpeed) {
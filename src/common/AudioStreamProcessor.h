@@ -1,50 +1,165 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <vector>
 #include <chrono>
 #include <memory>
 
 #include "DspPipeline.h"
+#include "QualityGovernor.h"
+#include "VoiceRenderCache.h"
 
 namespace krkrspeed {
 
 struct AudioProcessResult {
     std::vector<std::uint8_t> output;
     std::size_t cbufferSize = 0;
+    float backlogMs = 0.0f; // already-processed audio queued in Cbuffer
     float appliedSpeed = 1.0f;
 };
 
+// What to do when Cbuffer (processed output not yet returned) grows past BacklogConfig::maxMs.
+enum class BacklogPolicy : std::uint32_t {
+    DropOldest = 0, // discard the oldest queued output
+    Compress = 1,   // splice short grains out of the backlog with crossfades (pitch preserved)
+    Accelerate = 2  // raise DSP tempo until the backlog drains; drops oldest past twice the cap
+};
+
+struct BacklogConfig {
+    float maxMs = 250.0f;
+    BacklogPolicy policy = BacklogPolicy::Compress;
+};
+
 class AudioStreamProcessor {
 public:
     AudioStreamProcessor(std::uint32_t sampleRate, std::uint32_t channels, std::uint32_t blockAlign,
                          const DspConfig &cfg);
+    ~AudioStreamProcessor();
+
+    AudioStreamProcessor(const AudioStreamProcessor &) = delete;
+    AudioStreamProcessor &operator=(const AudioStreamProcessor &) = delete;
 
     AudioProcessResult process(const std::uint8_t *data, std::size_t bytes, float userSpeed, bool shouldLog,
                                std::uintptr_t key);
+    // Pitch path for very large one-shot buffers: streams the (up to two) destination regions through
+    // fixed-size chunks and writes the result back in place, so working memory does not grow with the
+    // buffer. `output` in the result stays empty.
+    AudioProcessResult processInPlace(std::uint8_t *region1, std::size_t bytes1, std::uint8_t *region2,
+                                      std::size_t bytes2, float userSpeed, bool shouldLog, std::uintptr_t key);
+    bool prefersInPlace(std::size_t bytes) const;
     AudioProcessResult processTempoToSize(const std::uint8_t *data, std::size_t inputBytes, std::size_t outputBytes,
                                           float userSpeed, bool shouldLog, std::uintptr_t key);
+    // processTempoToSize() writing its `outputBytes` straight into `out` instead of result.output, which stays
+    // empty. The input is queued before anything is written, so `data` may alias `out`.
+    AudioProcessResult processTempoInto(const std::uint8_t *data, std::size_t inputBytes, std::uint8_t *out,
+                                        std::size_t outputBytes, float userSpeed, bool shouldLog, std::uintptr_t key);
     AudioProcessResult processPitchToSize(const std::uint8_t *data, std::size_t inputBytes, std::size_t outputBytes,
                                           float userSpeed, bool shouldLog, std::uintptr_t key);
 
+    // Flushes stream state when the gap since the predicted play end exceeds the idle threshold.
+    // `idleThreshold` is the starting value; once a few gaps have been observed the threshold adapts
+    // to how late this stream's buffers usually arrive (see adaptiveIdleThreshold).
     void resetIfIdle(std::chrono::steady_clock::time_point now, std::chrono::milliseconds idleThreshold,
                      bool shouldLog, std::uintptr_t key);
+    std::chrono::milliseconds adaptiveIdleThreshold(std::chrono::milliseconds fallback) const;
 
     void recordPlaybackEnd(float durationSec, float appliedSpeed);
 
+    // DSP state is taken from DspPipelinePool on the first call that actually needs it; releaseDsp()
+    // returns it to the pool and drops carry buffers so idle or evicted buffers cost only this object.
+    bool hasDsp() const { return m_dsp != nullptr; }
+    void releaseDsp();
+    // Approximate heap bytes held by DSP state and carry buffers.
+    std::size_t memoryFootprint() const;
+
     float lastAppliedSpeed() const { return m_lastAppliedSpeed; }
     std::chrono::steady_clock::time_point lastPlayEnd() const { return m_lastPlayEnd; }
     std::size_t cbufferSize() const { return m_cbuffer.size(); }
 
+    // Multichannel (3+ channels) tempo path: bit per channel that is currently time-stretched.
+    // Channels silent for a while are dropped from the DSP and emitted as zeros.
+    std::uint32_t activeChannelMask() const { return m_activeMask; }
+
+    // Cost tier chosen by this stream's QualityGovernor and its smoothed DSP load (time / playback time),
+    // never better than the floor set by setTierFloor(). Pitch mode stops at QuickSeek: RateOnly drops the
+    // stretch, and a resampler alone cannot undo the pitch without changing the length.
+    QualityTier qualityTier(DspMode mode) const {
+        const QualityTier tier = std::max(m_quality.tier(), m_tierFloor);
+        return mode == DspMode::Pitch ? std::min(tier, QualityTier::QuickSeek) : tier;
+    }
+    // Cheapest-allowed-quality cap from content classification (music needs no WSOLA-grade stretch).
+    void setTierFloor(QualityTier floor) { m_tierFloor = floor; }
+    QualityTier tierFloor() const { return m_tierFloor; }
+    float dspLoad() const { return m_quality.load(); }
+
+    // SoundTouch settings (DspPreset) can change at runtime; the pipeline is retuned in place.
+    void setDspConfig(const DspConfig &cfg);
+    const DspConfig &dspConfig() const { return m_config; }
+
+    void setBacklogConfig(const BacklogConfig &cfg) { m_backlog = cfg; }
+    const BacklogConfig &backlogConfig() const { return m_backlog; }
+    float backlogMs() const;
+
 private:
+    bool ensureDsp();
+    void enforceBacklog(bool shouldLog, std::uintptr_t key);
+    void primeDsp(float ratio, DspMode mode, bool shouldLog, std::uintptr_t key);
+    // Stream start: slow the engine for a DSP call that would yield `outFrames`, so its output covers the
+    // pre-roll it drops and then the shortfall settleStart() recorded.
+    void applyStartTrim(double outFrames);
+    void settleStart(std::size_t producedBytes, double shortFrames);
+    // m_dsp->process() timed against the playback duration it produces; steps the quality tier.
+    std::vector<std::uint8_t> timedProcess(const std::uint8_t *data, std::size_t bytes, float ratio, DspMode mode,
+                                           std::uintptr_t key);
+    // Feeds one timed DSP run (wall time since `start`) to the governor and applies the tier it picks.
+    void recordDspLoad(std::chrono::steady_clock::time_point start, double playbackSec, QualityTier tier, DspMode mode,
+                       std::uintptr_t key);
+    // Long one-shot pitch input: split into overlapping segments, stretch them on WorkerPool and stitch
+    // the seams with correlation-aligned crossfades. The last segment runs on m_dsp, which keeps its
+    // state for the next call. Returns false when the input is not worth splitting.
+    bool processPitchSegmented(const std::uint8_t *data, std::size_t bytes, float pitch, std::vector<std::uint8_t> &out,
+                               bool shouldLog, std::uintptr_t key);
+    // Voice render cache (pitch path): a line starts with the first process() after a stream (re)start.
+    // A cached line is replayed while the input keeps matching; otherwise the line is recorded and handed
+    // to VoiceRenderCache when the stream resets, is released or destroyed.
+    bool serveCachedRender(const std::uint8_t *data, std::size_t bytes, float userSpeed, AudioProcessResult &result,
+                           bool shouldLog, std::uintptr_t key);
+    void recordRender(const std::uint8_t *data, std::size_t bytes, float userSpeed, const AudioProcessResult &result);
+    void finishRender();
+    std::uint32_t fullChannelMask() const;
+    std::uint32_t trackChannelActivity(const std::uint8_t *data, std::size_t bytes);
+    void applyChannelMask(std::uint32_t mask, float speed, bool shouldLog, std::uintptr_t key);
+
     std::uint32_t m_sampleRate = 0;
+    std::uint32_t m_channels = 0;
     std::uint32_t m_blockAlign = 0;
+    DspConfig m_config{};
     std::unique_ptr<DspPipeline> m_dsp;
     std::vector<std::uint8_t> m_cbuffer;
     std::vector<std::uint8_t> m_abuffer;
     std::chrono::steady_clock::time_point m_lastPlayEnd{};
     float m_lastAppliedSpeed = 1.0f;
-    bool m_padNext = true;
+    BacklogConfig m_backlog{};
+    float m_drainTempo = 1.0f;
+    QualityGovernor m_quality;
+    QualityTier m_tierFloor = QualityTier::Full;
+    bool m_primeNext = true; // stream (re)start: pre-roll the pipeline before the next DSP call
+    std::uint32_t m_activeMask = 0;
+    std::vector<std::uint32_t> m_silentFrames; // consecutive silent input frames per channel
+    std::vector<std::uint8_t> m_history;        // recent input, used to prime a pipeline rebuilt for a new mask
+    std::size_t m_maskSkipBytes = 0;            // rebuilt pipeline output that repeats the old pipeline's drained tail
+    double m_startLatencyFrames = 0.0;          // after a prime: output frames its pre-roll will cost the next call
+    double m_startShortFrames = 0.0;            // output frames the stream start is still short of
+    float m_startTrim = 1.0f;                   // tempo trim making both up, layered under m_drainTempo
+    std::vector<std::uint8_t> m_batch;          // pitch path: queued tiny-fragment input awaiting one DSP call
+    std::vector<float> m_idleGapsMs;            // ring of recent continuation gaps for the adaptive idle reset
+    std::size_t m_idleGapNext = 0;
+    VoiceRenderKey m_renderKey{};
+    std::shared_ptr<VoiceRender> m_recording;   // line being rendered live
+    bool m_recordingReplaces = false;           // m_recording diverged from the line cached under its key
+    std::shared_ptr<const VoiceRender> m_replay; // line being served from the cache
+    std::size_t m_replayStep = 0;
 };
 
 } // namespace krkrspeed
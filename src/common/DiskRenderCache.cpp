@@ -0,0 +1,479 @@
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#include "DiskRenderCache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "RenderRecord.h"
+#include "XxHash64.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr std::uint32_t kIndexMagic = 0x4943524Bu;  // "KRCI"
+constexpr std::uint32_t kVersion = 2; // 2: keys hash the whole first buffer
+constexpr std::uint32_t kProbeWindow = 8;
+constexpr std::uint64_t kMinDataBytes = 1u << 20;
+constexpr std::uint64_t kSlotSeed = 0x736c6f74u;
+
+struct IndexHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slotCount;
+    std::uint32_t reserved;
+    std::uint64_t capacity;
+    std::uint64_t check; // xxh64 of the fields above
+    std::uint64_t head;  // logical write position in the data ring; physical = head % capacity
+    std::uint8_t pad[24];
+};
+static_assert(sizeof(IndexHeader) == 64, "index header layout");
+
+// check is written last and is never 0 for a published slot, so a slot torn by a crash reads as empty.
+struct Slot {
+    std::uint64_t keyDigest;
+    std::uint64_t offset; // logical
+    std::uint32_t recordBytes;
+    std::uint32_t reserved;
+    std::uint64_t check;
+};
+static_assert(sizeof(Slot) == 32, "index slot layout");
+
+std::uint64_t headerCheck(const IndexHeader &header) {
+    return xxh64(&header, offsetof(IndexHeader, check));
+}
+
+std::uint64_t slotCheck(const Slot &slot) {
+    const std::uint64_t check = xxh64(&slot, offsetof(Slot, check), kSlotSeed);
+    return check ? check : 1;
+}
+
+std::uint64_t alignUp(std::uint64_t value) { return (value + 7) & ~std::uint64_t{7}; }
+
+} // namespace
+
+struct DiskRenderCache::Files {
+#ifdef _WIN32
+    HANDLE index = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    HANDLE data = INVALID_HANDLE_VALUE;
+#else
+    int index = -1;
+    int data = -1;
+#endif
+    void *view = nullptr;
+    std::size_t viewBytes = 0;
+    IndexHeader *header = nullptr;
+    Slot *slots = nullptr;
+
+    ~Files() {
+#ifdef _WIN32
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (index != INVALID_HANDLE_VALUE) CloseHandle(index);
+        if (data != INVALID_HANDLE_VALUE) CloseHandle(data);
+#else
+        if (view) munmap(view, viewBytes);
+        if (index >= 0) ::close(index);
+        if (data >= 0) ::close(data);
+#endif
+    }
+
+    bool readAt(std::uint64_t offset, void *buffer, std::size_t bytes) const {
+        auto *out = static_cast<std::uint8_t *>(buffer);
+        while (bytes > 0) {
+#ifdef _WIN32
+            OVERLAPPED ov{};
+            ov.Offset = static_cast<DWORD>(offset);
+            ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD got = 0;
+            const DWORD want = static_cast<DWORD>(std::min<std::size_t>(bytes, 1u << 30));
+            if (!ReadFile(data, out, want, &got, &ov) || got == 0) return false;
+#else
+            const ssize_t got = ::pread(data, out, bytes, static_cast<off_t>(offset));
+            if (got <= 0) return false;
+#endif
+            out += got;
+            offset += static_cast<std::uint64_t>(got);
+            bytes -= static_cast<std::size_t>(got);
+        }
+        return true;
+    }
+
+    bool writeAt(std::uint64_t offset, const void *buffer, std::size_t bytes) {
+        const auto *in = static_cast<const std::uint8_t *>(buffer);
+        while (bytes > 0) {
+#ifdef _WIN32
+            OVERLAPPED ov{};
+            ov.Offset = static_cast<DWORD>(offset);
+            ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD put = 0;
+            const DWORD want = static_cast<DWORD>(std::min<std::size_t>(bytes, 1u << 30));
+            if (!WriteFile(data, in, want, &put, &ov) || put == 0) return false;
+#else
+            const ssize_t put = ::pwrite(data, in, bytes, static_cast<off_t>(offset));
+            if (put <= 0) return false;
+#endif
+            in += put;
+            offset += static_cast<std::uint64_t>(put);
+            bytes -= static_cast<std::size_t>(put);
+        }
+        return true;
+    }
+
+    // A record is intact while the head has not come back around to any of its bytes.
+    bool live(const Slot &slot) const {
+        const std::uint64_t head = header->head;
+        return slot.offset + slot.recordBytes <= head && head <= slot.offset + header->capacity;
+    }
+
+    bool published(const Slot &slot) const { return slot.keyDigest != 0 && slot.check == slotCheck(slot); }
+
+    Slot *probe(std::uint64_t digest, std::uint32_t i) const {
+        return &slots[(digest + i) % header->slotCount];
+    }
+};
+
+namespace {
+
+// Opens both files, taking them exclusively, and maps the index at `indexBytes`. `fresh` reports that the
+// index had to be created or resized.
+#ifdef _WIN32
+bool openFiles(const std::filesystem::path &indexPath, const std::filesystem::path &dataPath,
+               std::size_t indexBytes, HANDLE &index, HANDLE &mapping, HANDLE &data, void *&view, bool &fresh,
+               std::string &error) {
+    index = CreateFileW(indexPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (index == INVALID_HANDLE_VALUE) {
+        error = GetLastError() == ERROR_SHARING_VIOLATION ? "render cache in use by another process"
+                                                           : "cannot open render cache index";
+        return false;
+    }
+    data = CreateFileW(dataPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (data == INVALID_HANDLE_VALUE) {
+        error = "cannot open render cache data file";
+        return false;
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(index, &size)) {
+        error = "cannot stat render cache index";
+        return false;
+    }
+    fresh = static_cast<std::uint64_t>(size.QuadPart) != indexBytes;
+    if (fresh) {
+        LARGE_INTEGER end{};
+        end.QuadPart = static_cast<LONGLONG>(indexBytes);
+        if (!SetFilePointerEx(index, end, nullptr, FILE_BEGIN) || !SetEndOfFile(index)) {
+            error = "cannot size render cache index";
+            return false;
+        }
+    }
+    mapping = CreateFileMappingW(index, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!mapping) {
+        error = "cannot map render cache index";
+        return false;
+    }
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, indexBytes);
+    if (!view) {
+        error = "cannot map render cache index";
+        return false;
+    }
+    return true;
+}
+#else
+bool openFiles(const std::filesystem::path &indexPath, const std::filesystem::path &dataPath,
+               std::size_t indexBytes, int &index, int &data, void *&view, bool &fresh, std::string &error) {
+    index = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (index < 0) {
+        error = "cannot open render cache index";
+        return false;
+    }
+    if (::flock(index, LOCK_EX | LOCK_NB) != 0) {
+        error = "render cache in use by another process";
+        return false;
+    }
+    data = ::open(dataPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (data < 0) {
+        error = "cannot open render cache data file";
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(index, &st) != 0) {
+        error = "cannot stat render cache index";
+        return false;
+    }
+    fresh = static_cast<std::uint64_t>(st.st_size) != indexBytes;
+    if (fresh && ::ftruncate(index, static_cast<off_t>(indexBytes)) != 0) {
+        error = "cannot size render cache index";
+        return false;
+    }
+    view = ::mmap(nullptr, indexBytes, PROT_READ | PROT_WRITE, MAP_SHARED, index, 0);
+    if (view == MAP_FAILED) {
+        view = nullptr;
+        error = "cannot map render cache index";
+        return false;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+DiskRenderCache::DiskRenderCache(LoadedFn onLoaded) : m_onLoaded(std::move(onLoaded)) {}
+
+DiskRenderCache::~DiskRenderCache() { close(); }
+
+bool DiskRenderCache::open(const std::filesystem::path &directory, const DiskRenderCacheOptions &options,
+                           std::string &error) {
+    close();
+    if (options.slots == 0) {
+        error = "render cache needs at least one index slot";
+        return false;
+    }
+    const std::uint64_t capacity = alignUp(std::max(options.dataBytes, kMinDataBytes));
+    const std::size_t indexBytes = sizeof(IndexHeader) + static_cast<std::size_t>(options.slots) * sizeof(Slot);
+
+    auto files = std::make_unique<Files>();
+    files->viewBytes = indexBytes;
+    bool fresh = false;
+#ifdef _WIN32
+    const bool opened = openFiles(directory / kRenderCacheIndexName, directory / kRenderCacheDataName, indexBytes,
+                                  files->index, files->mapping, files->data, files->view, fresh, error);
+#else
+    const bool opened = openFiles(directory / kRenderCacheIndexName, directory / kRenderCacheDataName, indexBytes,
+                                  files->index, files->data, files->view, fresh, error);
+#endif
+    if (!opened) {
+        return false;
+    }
+    files->header = static_cast<IndexHeader *>(files->view);
+    files->slots = reinterpret_cast<Slot *>(static_cast<std::uint8_t *>(files->view) + sizeof(IndexHeader));
+
+    // Only the header is checked; the data file is never scanned. A layout or size change starts over.
+    IndexHeader &header = *files->header;
+    if (fresh || header.magic != kIndexMagic || header.version != kVersion || header.slotCount != options.slots ||
+        header.capacity != capacity || header.check != headerCheck(header)) {
+        std::memset(files->view, 0, indexBytes);
+        header.magic = kIndexMagic;
+        header.version = kVersion;
+        header.slotCount = options.slots;
+        header.capacity = capacity;
+        header.head = 0;
+        header.check = headerCheck(header);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_files = std::move(files);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stop = false;
+    }
+    m_worker = std::thread([this]() { workerLoop(); });
+    return true;
+}
+
+void DiskRenderCache::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.clear();
+        m_busy = false;
+    }
+    m_idle.notify_all();
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    m_files.reset();
+}
+
+bool DiskRenderCache::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    return m_files != nullptr;
+}
+
+bool DiskRenderCache::enqueue(Task task) {
+    // Audio threads never wait here: a contended or full queue just drops the request.
+    std::unique_lock<std::mutex> lock(m_queueMutex, std::try_to_lock);
+    if (!lock.owns_lock() || m_stop || m_queue.size() >= kMaxQueued) {
+        m_dropped.fetch_add(1);
+        return false;
+    }
+    for (const auto &queued : m_queue) {
+        if (queued.key == task.key && (queued.render != nullptr) == (task.render != nullptr)) {
+            return true;
+        }
+    }
+    m_queue.push_back(std::move(task));
+    lock.unlock();
+    m_wake.notify_one();
+    return true;
+}
+
+void DiskRenderCache::requestAsync(const VoiceRenderKey &key) { enqueue(Task{key, nullptr}); }
+
+void DiskRenderCache::storeAsync(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render) {
+    if (render) {
+        enqueue(Task{key, std::move(render)});
+    }
+}
+
+void DiskRenderCache::drain() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    m_idle.wait(lock, [this]() { return (m_queue.empty() && !m_busy) || m_stop; });
+}
+
+void DiskRenderCache::workerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_busy = false;
+            if (m_queue.empty()) {
+                m_idle.notify_all();
+            }
+            m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_stop) {
+                return;
+            }
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_busy = true;
+        }
+        if (task.render) {
+            store(task.key, *task.render);
+        } else if (auto render = load(task.key); render && m_onLoaded) {
+            m_onLoaded(task.key, std::move(render));
+        }
+    }
+}
+
+std::shared_ptr<VoiceRender> DiskRenderCache::load(const VoiceRenderKey &key) {
+    const std::uint64_t digest = renderRecordDigest(key);
+    m_lookups.fetch_add(1);
+
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    if (!m_files) {
+        return nullptr;
+    }
+    Files &files = *m_files;
+    for (std::uint32_t i = 0; i < kProbeWindow; ++i) {
+        const Slot slot = *files.probe(digest, i);
+        if (slot.keyDigest != digest || !files.published(slot) || !files.live(slot)) {
+            continue;
+        }
+        std::vector<std::uint8_t> record(slot.recordBytes);
+        auto render = files.readAt(slot.offset % files.header->capacity, record.data(), record.size())
+                          ? decodeRenderRecord(record.data(), record.size(), key)
+                          : nullptr;
+        if (!render) {
+            m_corrupt.fetch_add(1);
+            return nullptr;
+        }
+        m_loaded.fetch_add(1);
+        return render;
+    }
+    return nullptr;
+}
+
+bool DiskRenderCache::store(const VoiceRenderKey &key, const VoiceRender &render) {
+    if (render.steps.empty()) {
+        return false;
+    }
+    const auto record = encodeRenderRecord(key, render);
+    const std::uint64_t recordBytes = record.size();
+    const std::uint64_t digest = renderRecordDigest(key);
+
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    if (!m_files) {
+        return false;
+    }
+    Files &files = *m_files;
+    IndexHeader &index = *files.header;
+    // Same rule as the memory cache: one line may take at most a quarter of the space.
+    if (recordBytes > index.capacity / 4) {
+        return false;
+    }
+
+    // Records never straddle the end of the ring; skip the tail to the next lap instead.
+    std::uint64_t offset = index.head;
+    const std::uint64_t physical = offset % index.capacity;
+    if (physical + recordBytes > index.capacity) {
+        offset += index.capacity - physical;
+    }
+    // Advance the head first: every slot pointing at the bytes about to be overwritten stops being live
+    // before they change, whatever happens to the write.
+    index.head = offset + recordBytes;
+    std::atomic_thread_fence(std::memory_order_release);
+    if (!files.writeAt(offset % index.capacity, record.data(), record.size())) {
+        return false;
+    }
+
+    // Publish: reuse the key's slot, else a free or dead one, else evict the oldest in the window.
+    Slot *target = nullptr;
+    Slot *oldest = nullptr;
+    for (std::uint32_t i = 0; i < kProbeWindow && !target; ++i) {
+        Slot *slot = files.probe(digest, i);
+        if (files.published(*slot) && slot->keyDigest == digest) {
+            target = slot;
+        }
+    }
+    for (std::uint32_t i = 0; i < kProbeWindow && !target; ++i) {
+        Slot *slot = files.probe(digest, i);
+        if (!files.published(*slot) || !files.live(*slot)) {
+            target = slot;
+        } else if (!oldest || slot->offset < oldest->offset) {
+            oldest = slot;
+        }
+    }
+    if (!target) {
+        target = oldest;
+    }
+    target->check = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    Slot slot{digest, offset, static_cast<std::uint32_t>(recordBytes), 0, 0};
+    slot.check = slotCheck(slot);
+    target->keyDigest = slot.keyDigest;
+    target->offset = slot.offset;
+    target->recordBytes = slot.recordBytes;
+    target->reserved = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    target->check = slot.check;
+
+    m_stored.fetch_add(1);
+    m_storedBytes.fetch_add(recordBytes);
+    return true;
+}
+
+DiskRenderCacheStats DiskRenderCache::stats() const {
+    DiskRenderCacheStats out;
+    out.lookups = m_lookups.load();
+    out.loaded = m_loaded.load();
+    out.stored = m_stored.load();
+    out.storedBytes = m_storedBytes.load();
+    out.dropped = m_dropped.load();
+    out.corrupt = m_corrupt.load();
+    return out;
+}
+
+} // namespace krkrspeed
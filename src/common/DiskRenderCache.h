@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "VoiceRenderCache.h"
+
+namespace krkrspeed {
+
+inline constexpr const wchar_t *kRenderCacheIndexName = L"krkr_render_cache.idx";
+inline constexpr const wchar_t *kRenderCacheDataName = L"krkr_render_cache.dat";
+
+struct DiskRenderCacheOptions {
+    std::uint64_t dataBytes = 256ull * 1024 * 1024; // data file cap; the oldest records are overwritten past it
+    std::uint32_t slots = 16384;                    // index slots (32 bytes each)
+};
+
+struct DiskRenderCacheStats {
+    std::uint64_t lookups = 0;
+    std::uint64_t loaded = 0;   // lookups answered from disk
+    std::uint64_t stored = 0;
+    std::uint64_t storedBytes = 0;
+    std::uint64_t dropped = 0;  // requests not queued because the queue was busy or full
+    std::uint64_t corrupt = 0;  // records rejected by a header, hash or key check
+};
+
+// Persistent second level for VoiceRenderCache, shared across play sessions.
+//
+// Records are appended to a data file used as a ring: once it reaches dataBytes, writing wraps to the
+// start and overwrites the oldest records. A memory-mapped, open-addressed index (linear probing over a
+// short window) maps the key digest to a record's logical offset; a record is live while the write head
+// has not lapped it. open() only maps the index and checks its header, so startup does not read the
+// data file.
+//
+// Crash consistency: the head is advanced before a record is written and the index slot is published
+// after, with a checksum over the slot. Every record carries its key and an XXH64 of its payload, which
+// are verified on load; anything torn or overwritten reads as a miss.
+//
+// Audio threads only queue work (try_lock, bounded queue); one worker thread does all file I/O and hands
+// loaded lines to `onLoaded`.
+class DiskRenderCache : public VoiceRenderStore {
+public:
+    using LoadedFn = std::function<void(const VoiceRenderKey &, std::shared_ptr<const VoiceRender>)>;
+
+    explicit DiskRenderCache(LoadedFn onLoaded);
+    ~DiskRenderCache() override;
+
+    DiskRenderCache(const DiskRenderCache &) = delete;
+    DiskRenderCache &operator=(const DiskRenderCache &) = delete;
+
+    // Opens or creates the cache files in `directory`. An index with another layout or size is reset.
+    bool open(const std::filesystem::path &directory, const DiskRenderCacheOptions &options, std::string &error);
+    void close();
+    bool isOpen() const;
+
+    void requestAsync(const VoiceRenderKey &key) override;
+    void storeAsync(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render) override;
+    // Blocks until the queue is empty (shutdown and tools).
+    void drain();
+
+    // Synchronous access, used by the worker.
+    std::shared_ptr<VoiceRender> load(const VoiceRenderKey &key);
+    bool store(const VoiceRenderKey &key, const VoiceRender &render);
+
+    DiskRenderCacheStats stats() const;
+
+private:
+    struct Files;
+    struct Task {
+        VoiceRenderKey key;
+        std::shared_ptr<const VoiceRender> render; // null: load request
+    };
+
+    void workerLoop();
+    bool enqueue(Task task);
+
+    static constexpr std::size_t kMaxQueued = 64;
+
+    LoadedFn m_onLoaded;
+    std::unique_ptr<Files> m_files;
+    mutable std::mutex m_ioMutex; // guards m_files
+    std::mutex m_queueMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Task> m_queue;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::thread m_worker;
+
+    std::atomic<std::uint64_t> m_lookups{0};
+    std::atomic<std::uint64_t> m_loaded{0};
+    std::atomic<std::uint64_t> m_stored{0};
+    std::atomic<std::uint64_t> m_storedBytes{0};
+    std::atomic<std::uint64_t> m_dropped{0};
+    std::atomic<std::uint64_t> m_corrupt{0};
+};
+
+} // namespace krkrspeed
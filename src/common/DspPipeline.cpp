@@ -1,5 +1,7 @@
 #include "DspPipeline.h"
+#include "IntWsola.h"
 #include "Logging.h"
+#include "StreamAnalysis.h"
 
 #include <algorithm>
 #include <cmath>
@@ -13,22 +15,499 @@
 
 namespace krkrspeed {
 
+namespace {
+
+// Buffers with identical channels needed in a row before switching to the mono engine, and the
+// stricter count used after a stream has bailed out of mono once (avoids flapping on near-mono mixes).
+constexpr std::uint32_t kMonoEnterBuffers = 4;
+constexpr std::uint32_t kMonoReenterBuffers = 32;
+// Engine switch: the outgoing engine's flushed tail is crossfaded into the incoming engine's first output
+// over 1/kSwitchFadeDivisor s; the last 1/kSwitchHistoryDivisor s of channel 0 are kept so the unconsumed
+// input can be handed to the incoming engine.
+constexpr std::uint32_t kSwitchFadeDivisor = 200;
+constexpr std::uint32_t kSwitchHistoryDivisor = 4;
+
+// Voice gate: 10 ms analysis blocks classified by isVoiceActive(). Spans stay voiced for
+// kGateHangoverBlocks after the last active block so phrase tails and short pauses still go through WSOLA.
+constexpr std::uint32_t kGateBlocksPerSecond = 100;
+constexpr std::uint32_t kGateHangoverBlocks = 20;
+constexpr std::uint32_t kGateFadeDivisor = 400; // 2.5 ms fade out where a silent span was cut short, and in after it
+
+// QualityTier::QuickSeek caps the seek window at this many ms.
+constexpr float kQuickSeekWindowMs = 12.0f;
+// setTempoTrim() range.
+constexpr float kMinTempoTrim = 0.5f;
+constexpr float kMaxTempoTrim = 2.0f;
+
+#ifdef USE_SOUNDTOUCH
+constexpr bool kHaveSoundTouch = true;
+#else
+constexpr bool kHaveSoundTouch = false;
+#endif
+
+// Built without SoundTouch, every stream runs on IntWsola: it stretches frame by frame and keeps the length
+// in pitch mode, which a plain resampler cannot.
+bool usesIntegerEngine(const DspConfig &config) { return config.integerPath || !kHaveSoundTouch; }
+
+void configureWsola(IntWsola &wsola, const DspConfig &config, QualityTier tier) {
+    const bool degraded = tier != QualityTier::Full;
+    wsola.setParameters(config.sequenceMs, config.overlapMs,
+                        degraded ? std::min(config.seekWindowMs, kQuickSeekWindowMs) : config.seekWindowMs,
+                        degraded || config.quickSeek);
+}
+
+#ifdef USE_SOUNDTOUCH
+void applyTier(soundtouch::SoundTouch &touch, const DspConfig &config, QualityTier tier) {
+    const bool degraded = tier != QualityTier::Full;
+    touch.setSetting(SETTING_USE_QUICKSEEK, (degraded || config.quickSeek) ? 1 : 0);
+    touch.setSetting(SETTING_SEEKWINDOW_MS, static_cast<int>(degraded ? std::min(config.seekWindowMs, kQuickSeekWindowMs)
+                                                                      : config.seekWindowMs));
+}
+
+void applyConfig(soundtouch::SoundTouch &touch, const DspConfig &config, QualityTier tier) {
+    touch.setSetting(SETTING_SEQUENCE_MS, static_cast<int>(config.sequenceMs));
+    touch.setSetting(SETTING_OVERLAP_MS, static_cast<int>(config.overlapMs));
+    touch.setSetting(SETTING_USE_AA_FILTER, config.antiAlias ? 1 : 0);
+    const std::uint32_t taps = std::clamp<std::uint32_t>(config.aaFilterLength, 8, 128) & ~3u;
+    touch.setSetting(SETTING_AA_FILTER_LENGTH, static_cast<int>(taps));
+    applyTier(touch, config, tier);
+}
+
+void configureTouch(soundtouch::SoundTouch &touch, std::uint32_t sampleRate, std::uint32_t channels,
+                    const DspConfig &config) {
+    touch.setSampleRate(sampleRate);
+    touch.setChannels(static_cast<unsigned int>(channels));
+    applyConfig(touch, config, QualityTier::Full);
+}
+#endif
+
+} // namespace
+
 struct DspPipeline::Impl {
 #ifdef USE_SOUNDTOUCH
+    using Sample = soundtouch::SAMPLETYPE;
     soundtouch::SoundTouch touch;
-    std::vector<soundtouch::SAMPLETYPE> scratch;
+    // Runs channel 0 only while all channels carry the same signal; built on the first switch to mono.
+    std::unique_ptr<soundtouch::SoundTouch> mono;
+    std::uint32_t sampleRate = 0;
+    const DspConfig *config = nullptr; // the owning pipeline's m_config (DspPipeline is not movable)
+    std::vector<Sample> scratch;
+    std::vector<Sample> monoInput;
+    std::vector<Sample> recent;     // last 1/kSwitchHistoryDivisor s of channel 0 fed to the active engine
+    std::vector<Sample> switchTail; // outgoing engine's flushed tail, interleaved, still to be crossfaded
+    std::size_t switchFaded = 0;    // frames of switchTail already blended into the output
+    bool monoActive = false;
+    std::uint32_t identicalRun = 0;
+    std::uint32_t enterAfter = kMonoEnterBuffers;
+    std::uint32_t quietBlocks = kGateHangoverBlocks; // start gated until the first active block
+    bool engineBusy = false;                         // SoundTouch holds voiced input that has not been flushed
+    double outputDebt = 0.0;                         // frames owed (expected input/tempo minus emitted)
+    std::size_t resumeFade = 0;                      // length of the fade-in owed after a cut (0: none)
+    std::size_t resumeFaded = 0;                     // frames of it already applied
+    std::vector<std::uint8_t> blockVoiced;
+
+    soundtouch::SoundTouch &engine() { return monoActive ? *mono : touch; }
+
+    soundtouch::SoundTouch &monoEngine() {
+        if (!mono) {
+            mono = std::make_unique<soundtouch::SoundTouch>();
+            configureTouch(*mono, sampleRate, 1, *config);
+            applyTier(*mono, *config, tier);
+        }
+        return *mono;
+    }
+
+    static void applyRatios(soundtouch::SoundTouch &st, DspMode mode, float tempo, float pitch, float trim) {
+        if (mode == DspMode::Tempo) {
+            st.setTempo(tempo * trim);
+            st.setRate(1.0f);
+            st.setPitch(1.0f);
+        } else {
+            st.setTempo(trim);
+            st.setRate(1.0f);
+            st.setPitch(pitch);
+        }
+    }
+
+    // Hysteresis: enter mono after a run of identical buffers, leave on the first buffer that differs.
+    bool wantMono(const Sample *input, std::size_t frames, std::uint32_t channels) {
+        if (channels < 2) return false;
+        if (!channelsIdentical(input, frames, channels)) {
+            if (monoActive) enterAfter = kMonoReenterBuffers;
+            identicalRun = 0;
+            return false;
+        }
+        if (identicalRun < enterAfter) ++identicalRun;
+        return monoActive || identicalRun >= enterAfter;
+    }
+
+    // Pull everything the engine has ready, re-interleaving mono output across `channels`.
+    void drain(soundtouch::SoundTouch &st, std::uint32_t channels, std::size_t maxFrames, std::vector<Sample> &out,
+               std::size_t stopSamples) {
+        const std::uint32_t stChannels = (&st == mono.get()) ? 1 : channels;
+        scratch.resize(maxFrames * stChannels);
+        while (true) {
+            const auto received = st.receiveSamples(scratch.data(), static_cast<unsigned int>(maxFrames));
+            if (received == 0) break;
+            const std::size_t prev = out.size();
+            out.resize(prev + static_cast<std::size_t>(received) * channels);
+            if (stChannels == channels) {
+                std::memcpy(out.data() + prev, scratch.data(), static_cast<std::size_t>(received) * channels * sizeof(Sample));
+            } else {
+                Sample *dst = out.data() + prev;
+                for (std::size_t i = 0; i < received; ++i) {
+                    std::fill_n(dst + i * channels, channels, scratch[i]);
+                }
+            }
+            if (stopSamples != 0 && out.size() >= stopSamples) break;
+        }
+    }
+
+    // Blend the outgoing engine's tail into output the incoming engine produced from out[from] on. Both
+    // render the same input (the unconsumed frames handed over at the switch), so the crossfade hides the
+    // WSOLA phase jump instead of cutting from one engine to the other.
+    void blendSwitchTail(std::vector<Sample> &out, std::size_t from, std::uint32_t channels) {
+        if (switchTail.empty()) return;
+        const std::size_t fade = std::max<std::size_t>(1, sampleRate / kSwitchFadeDivisor);
+        const std::size_t tailFrames = std::min(fade, switchTail.size() / channels);
+        const std::size_t available = (out.size() - from) / channels;
+        const std::size_t count = std::min(available, tailFrames - std::min(tailFrames, switchFaded));
+        for (std::size_t i = 0; i < count; ++i, ++switchFaded) {
+            const float g = static_cast<float>(switchFaded + 1) / static_cast<float>(tailFrames + 1);
+            Sample *dst = out.data() + from + i * channels;
+            const Sample *old = switchTail.data() + switchFaded * channels;
+            for (std::uint32_t c = 0; c < channels; ++c) {
+                dst[c] = static_cast<Sample>(static_cast<float>(old[c]) * (1.0f - g) + static_cast<float>(dst[c]) * g);
+            }
+        }
+        if (switchFaded >= tailFrames) {
+            switchTail.clear();
+            switchFaded = 0;
+        }
+    }
+
+    // Switch between the full and the mono engine without a cold start: the outgoing engine's unconsumed
+    // input (all channels were identical, so channel 0 stands for it) is handed to the incoming engine, and
+    // the outgoing engine's flushed tail is kept only to crossfade the join.
+    void switchEngine(bool toMono, std::uint32_t channels, std::size_t maxFrames, DspMode mode, float tempo,
+                      float pitch, float trim) {
+        auto &old = engine();
+        const std::size_t pending = std::min<std::size_t>(old.numUnprocessedSamples(), recent.size());
+        switchTail.clear();
+        switchFaded = 0;
+        if (old.numUnprocessedSamples() > 0) {
+            old.flush();
+            drain(old, channels, maxFrames, switchTail, 0);
+        }
+        old.clear();
+        monoActive = toMono;
+        auto &next = toMono ? monoEngine() : touch;
+        next.clear();
+        applyRatios(next, mode, tempo, pitch, trim);
+        if (pending > 0) {
+            const Sample *handover = recent.data() + (recent.size() - pending);
+            if (toMono) {
+                next.putSamples(handover, static_cast<unsigned int>(pending));
+            } else {
+                scratch.resize(pending * channels);
+                for (std::size_t i = 0; i < pending; ++i) {
+                    std::fill_n(scratch.data() + i * channels, channels, handover[i]);
+                }
+                next.putSamples(scratch.data(), static_cast<unsigned int>(pending));
+            }
+        }
+        KRKR_LOG_DEBUG(std::string("DspPipeline: ") + (toMono ? "identical channels, processing mono"
+                                                              : "channels diverged, processing all channels") +
+                       " handover=" + std::to_string(pending));
+    }
+
+    // Feed one interleaved buffer through the active engine, switching engines first if the
+    // channel layout changed.
+    void run(const Sample *input, std::size_t frames, std::uint32_t channels, DspMode mode, float tempo, float pitch,
+             float trim, std::size_t maxFrames, std::vector<Sample> &out, std::size_t stopSamples) {
+        const bool toMono = wantMono(input, frames, channels);
+        if (toMono != monoActive) {
+            switchEngine(toMono, channels, maxFrames, mode, tempo, pitch, trim);
+        }
+
+        auto &st = engine();
+        applyRatios(st, mode, tempo, pitch, trim);
+        if (monoActive) {
+            monoInput.resize(frames);
+            for (std::size_t i = 0; i < frames; ++i) {
+                monoInput[i] = input[i * channels];
+            }
+            st.putSamples(monoInput.data(), static_cast<unsigned int>(frames));
+        } else {
+            st.putSamples(input, static_cast<unsigned int>(frames));
+        }
+        if (channels > 1) {
+            // Only needed for a later switch, which requires identical channels, so channel 0 is enough.
+            const std::size_t keep = std::max<std::size_t>(1, sampleRate / kSwitchHistoryDivisor);
+            const std::size_t add = std::min(frames, keep);
+            if (recent.size() + add > keep) {
+                recent.erase(recent.begin(), recent.begin() + (recent.size() + add - keep));
+            }
+            for (std::size_t i = frames - add; i < frames; ++i) {
+                recent.push_back(input[i * channels]);
+            }
+        }
+        const std::size_t before = out.size();
+        drain(st, channels, maxFrames, out, stopSamples);
+        blendSwitchTail(out, before, channels);
+    }
+
+    // Push everything SoundTouch still holds out of the active engine (used at voiced -> silent edges).
+    void flushEngine(std::uint32_t channels, std::size_t maxFrames, std::vector<Sample> &out) {
+        auto &st = engine();
+        if (st.numUnprocessedSamples() > 0) {
+            st.flush();
+        }
+        const std::size_t before = out.size();
+        drain(st, channels, maxFrames, out, 0);
+        blendSwitchTail(out, before, channels);
+        switchTail.clear();
+        switchFaded = 0;
+        st.clear();
+    }
+
+    // Ramp output produced after a gate cut (from out[from] on) up from the silence the cut faded to.
+    void fadeInResume(std::vector<Sample> &out, std::size_t from, std::uint32_t channels) {
+        if (resumeFade == 0) return;
+        const std::size_t count = std::min((out.size() - from) / channels, resumeFade - resumeFaded);
+        for (std::size_t i = 0; i < count; ++i, ++resumeFaded) {
+            const float g = static_cast<float>(resumeFaded + 1) / static_cast<float>(resumeFade + 1);
+            Sample *f = out.data() + from + i * channels;
+            for (std::uint32_t c = 0; c < channels; ++c) {
+                f[c] = static_cast<Sample>(f[c] * g);
+            }
+        }
+        if (resumeFaded >= resumeFade) {
+            resumeFade = 0;
+            resumeFaded = 0;
+        }
+    }
+
+    // Tempo mode with the voice gate: voiced spans run through SoundTouch, silent spans are shortened by
+    // keeping only as many frames as the output-debt account says are due, faded out where cut.
+    void runGated(const std::int16_t *pcm, const Sample *input, std::size_t frames, std::uint32_t channels,
+                  std::uint32_t sampleRate, float tempo, float trim, std::size_t maxFrames, std::vector<Sample> &out) {
+        const std::size_t block = std::max<std::size_t>(1, sampleRate / kGateBlocksPerSecond);
+        const std::size_t blocks = (frames + block - 1) / block;
+        blockVoiced.resize(blocks);
+        for (std::size_t b = 0; b < blocks; ++b) {
+            const std::size_t start = b * block;
+            const std::size_t len = std::min(block, frames - start);
+            if (isVoiceActive(analyzePcm16(pcm + start * channels, len * channels, channels))) {
+                quietBlocks = 0;
+            } else if (quietBlocks < kGateHangoverBlocks) {
+                ++quietBlocks;
+            }
+            blockVoiced[b] = quietBlocks < kGateHangoverBlocks;
+        }
+
+        const double ratio = std::max(0.01, static_cast<double>(tempo) * trim);
+        std::size_t b = 0;
+        while (b < blocks) {
+            const bool voiced = blockVoiced[b] != 0;
+            std::size_t e = b + 1;
+            while (e < blocks && (blockVoiced[e] != 0) == voiced) ++e;
+            const std::size_t start = b * block;
+            const std::size_t len = std::min(e * block, frames) - start;
+            const std::size_t before = out.size();
+            if (voiced) {
+                run(input + start * channels, len, channels, DspMode::Tempo, tempo, 1.0f, trim, maxFrames, out, 0);
+                engineBusy = true;
+                fadeInResume(out, before, channels);
+            } else {
+                if (engineBusy) {
+                    flushEngine(channels, maxFrames, out);
+                    engineBusy = false;
+                }
+                const double owed = outputDebt - static_cast<double>(out.size() - before) / channels +
+                                    static_cast<double>(len) / ratio;
+                const std::size_t keep =
+                    static_cast<std::size_t>(std::clamp<double>(std::floor(owed + 0.5), 0.0, static_cast<double>(len)));
+                const std::size_t prev = out.size();
+                out.insert(out.end(), input + start * channels, input + (start + keep) * channels);
+                fadeInResume(out, before, channels);
+                if (keep < len) {
+                    const std::size_t fade = std::min<std::size_t>(keep, std::max<std::uint32_t>(1, sampleRate / kGateFadeDivisor));
+                    for (std::size_t i = 0; i < fade; ++i) {
+                        const float g = static_cast<float>(fade - i - 1) / static_cast<float>(fade);
+                        Sample *f = out.data() + prev + (keep - fade + i) * channels;
+                        for (std::uint32_t c = 0; c < channels; ++c) {
+                            f[c] = static_cast<Sample>(f[c] * g);
+                        }
+                    }
+                    // Whatever follows the cut (the next voiced span, possibly a call later) fades back in.
+                    resumeFade = std::max<std::uint32_t>(1, sampleRate / kGateFadeDivisor);
+                    resumeFaded = 0;
+                }
+                outputDebt = owed - static_cast<double>(keep);
+                b = e;
+                continue;
+            }
+            outputDebt += static_cast<double>(len) / ratio - static_cast<double>(out.size() - before) / channels;
+            b = e;
+        }
+    }
 #endif
-    std::mutex mutex;
+    std::unique_ptr<IntWsola> wsola; // DspConfig::integerPath engine, created on first use
+
+    IntWsola &integerEngine(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &config) {
+        if (!wsola) {
+            wsola = std::make_unique<IntWsola>(sampleRate, channels);
+            configureWsola(*wsola, config, tier);
+        }
+        return *wsola;
+    }
+
+    std::vector<double> rateTail; // RateOnly: last input frame, interpolated against the next call
+    double ratePhase = 0.0;       // RateOnly: next output position relative to the first new input frame
+
+    // RateOnly tier: linear-interpolation resampling by `ratio` with phase carried across calls.
+    template <typename T>
+    void resample(const T *input, std::size_t frames, std::uint32_t channels, double ratio, std::vector<T> &out) {
+        if (rateTail.size() != channels) {
+            rateTail.assign(input, input + channels);
+            ratePhase = 0.0;
+        }
+        auto at = [&](std::ptrdiff_t frame, std::uint32_t c) -> double {
+            return frame < 0 ? rateTail[c] : static_cast<double>(input[frame * channels + c]);
+        };
+        double pos = ratePhase;
+        while (static_cast<std::ptrdiff_t>(std::floor(pos)) + 1 < static_cast<std::ptrdiff_t>(frames)) {
+            const auto idx = static_cast<std::ptrdiff_t>(std::floor(pos));
+            const double frac = pos - static_cast<double>(idx);
+            for (std::uint32_t c = 0; c < channels; ++c) {
+                const double a = at(idx, c);
+                const double v = a + (at(idx + 1, c) - a) * frac;
+                if constexpr (std::is_floating_point_v<T>) {
+                    out.push_back(static_cast<T>(v));
+                } else {
+                    out.push_back(static_cast<T>(std::lround(v)));
+                }
+            }
+            pos += ratio;
+        }
+        ratePhase = pos - static_cast<double>(frames);
+        std::copy(input + (frames - 1) * channels, input + frames * channels, rateTail.begin());
+    }
+
+    // 16-bit input on IntWsola (DspConfig::integerPath, or any stream when built without SoundTouch).
+    void runInteger(const std::int16_t *pcm, std::size_t frames, std::uint32_t sampleRate, std::uint32_t channels,
+                    const DspConfig &config, DspMode mode, float ratio, float trim, std::vector<std::int16_t> &out) {
+        auto &engine = integerEngine(sampleRate, channels, config);
+        if (mode == DspMode::Tempo) {
+            engine.setRate(1.0);
+            engine.setTempo(static_cast<double>(ratio) * trim);
+        } else {
+            engine.setRate(ratio);
+            engine.setTempo(static_cast<double>(trim) / ratio);
+        }
+        engine.process(pcm, frames, out);
+        dropPrimed(out, channels);
+    }
+
+    // After prime(): most output frames its silent pre-roll can still produce. Leading all-zero frames are
+    // dropped up to this many, so the stream starts with the first audible frame of real input.
+    std::size_t primeSkip = 0;
+
+    // prime() left `lead` silent input frames queued. How many output frames they become depends on where
+    // the engine is in its first segment (IntWsola releases it almost 1:1), so the bound is lead plus one
+    // overlap, stretched by the slowest tempo the caller may run them at (its speed in Tempo mode, times the
+    // lowest trim it may set to catch up); the zero test stops the drop where real input begins.
+    std::size_t primed(std::size_t lead, std::uint32_t rate, const DspConfig &cfg, float speedRatio, DspMode mode) {
+        const double speed = mode == DspMode::Tempo ? static_cast<double>(speedRatio) : 1.0;
+        const double slowest = std::max(0.01, std::min(1.0, speed) * kMinTempoTrim);
+        const double overlap = static_cast<double>(rate) * cfg.overlapMs / 1000.0;
+        primeSkip = static_cast<std::size_t>(std::ceil((static_cast<double>(lead) + overlap) / slowest));
+        return lead;
+    }
+
+    // Returns the frames dropped.
+    template <typename T> std::size_t dropPrimed(std::vector<T> &out, std::uint32_t channels) {
+        std::size_t frames = 0;
+        while (primeSkip > 0 && (frames + 1) * channels <= out.size()) {
+            const T *f = out.data() + frames * channels;
+            if (std::any_of(f, f + channels, [](T v) { return v != T{}; })) {
+                primeSkip = 0; // real input has reached the output
+                break;
+            }
+            ++frames;
+            --primeSkip;
+        }
+        out.erase(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(frames * channels));
+        return frames;
+    }
+
+    float tempoTrim = 1.0f;
+    QualityTier tier = QualityTier::Full;
+    mutable std::mutex mutex;
 };
 
+#ifdef USE_SOUNDTOUCH
+namespace {
+std::vector<std::uint8_t> toPcm16Bytes(const std::vector<soundtouch::SAMPLETYPE> &samples) {
+    std::vector<std::uint8_t> output(samples.size() * sizeof(std::int16_t));
+    if constexpr (std::is_same_v<soundtouch::SAMPLETYPE, float>) {
+        auto *outPcm = reinterpret_cast<std::int16_t *>(output.data());
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            const float clamped = std::clamp(static_cast<float>(samples[i]), -1.0f, 1.0f);
+            outPcm[i] = static_cast<std::int16_t>(std::lround(clamped * 32767.0f));
+        }
+    } else if (!samples.empty()) {
+        std::memcpy(output.data(), samples.data(), output.size());
+    }
+    return output;
+}
+
+} // namespace
+#endif
+
+DspConfig dspPresetConfig(DspPreset preset) {
+    DspConfig cfg{};
+    switch (preset) {
+    case DspPreset::LowPower:
+        cfg.sequenceMs = 40.0f;
+        cfg.overlapMs = 8.0f;
+        cfg.seekWindowMs = 15.0f;
+        cfg.quickSeek = true;
+        cfg.antiAlias = false;
+        cfg.aaFilterLength = 32;
+        cfg.integerPath = true;
+        break;
+    case DspPreset::Quality:
+        cfg.seekWindowMs = 30.0f;
+        cfg.overlapMs = 12.0f;
+        cfg.aaFilterLength = 128;
+        break;
+    case DspPreset::Balanced:
+    default:
+        break;
+    }
+    return cfg;
+}
+
+const char *dspPresetName(DspPreset preset) {
+    switch (preset) {
+    case DspPreset::LowPower:
+        return "low-power";
+    case DspPreset::Quality:
+        return "quality";
+    case DspPreset::Balanced:
+    default:
+        return "balanced";
+    }
+}
+
 DspPipeline::DspPipeline(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &config)
     : m_sampleRate(sampleRate), m_channels(channels), m_config(config), m_impl(std::make_unique<Impl>()) {
 #ifdef USE_SOUNDTOUCH
-    m_impl->touch.setSampleRate(sampleRate);
-    m_impl->touch.setChannels(static_cast<unsigned int>(channels));
-    m_impl->touch.setSetting(SETTING_SEQUENCE_MS, static_cast<int>(config.sequenceMs));
-    m_impl->touch.setSetting(SETTING_OVERLAP_MS, static_cast<int>(config.overlapMs));
-    m_impl->touch.setSetting(SETTING_SEEKWINDOW_MS, static_cast<int>(config.seekWindowMs));
+    m_impl->sampleRate = sampleRate;
+    m_impl->config = &m_config;
+    configureTouch(m_impl->touch, sampleRate, channels, config);
 #endif
 }
 
@@ -42,23 +521,37 @@ std::vector<std::uint8_t> DspPipeline::process(const std::uint8_t *data, std::si
     }
 
     // Near-1.0 speed: bypass SoundTouch entirely and let callers passthrough the original buffer.
-    if (std::fabs(speedRatio - 1.0f) <= 0.001f) {
+    const float trim = m_impl->tempoTrim;
+    if (std::fabs(speedRatio - 1.0f) <= 0.001f && std::fabs(trim - 1.0f) <= 0.001f) {
         return {};
     }
 
     const float tempo = std::max(0.01f, speedRatio);
-    const float pitch = std::max(0.01f, speedRatio);
     const std::size_t sampleCount = bytes / sizeof(std::int16_t);
     const std::size_t frameCount = sampleCount / m_channels;
     if (frameCount == 0) {
         return {};
     }
 
+    // RateOnly replaces the stretch with a resampler in Tempo mode only; Pitch mode has no resampling-only
+    // equivalent (it would change the length) and keeps running the engine at QuickSeek settings.
+    const bool resampleOnly = m_impl->tier == QualityTier::RateOnly && mode == DspMode::Tempo;
+    const auto *pcm = reinterpret_cast<const std::int16_t *>(data);
+    if (usesIntegerEngine(m_config) && !resampleOnly) {
+        std::vector<std::int16_t> processed;
+        m_impl->runInteger(pcm, frameCount, m_sampleRate, m_channels, m_config, mode, tempo, trim, processed);
+        if (processed.empty()) {
+            return mode == DspMode::Pitch ? std::vector<std::uint8_t>(data, data + bytes) : std::vector<std::uint8_t>{};
+        }
+        std::vector<std::uint8_t> output(processed.size() * sizeof(std::int16_t));
+        std::memcpy(output.data(), processed.data(), output.size());
+        return output;
+    }
+
 #ifdef USE_SOUNDTOUCH
     using SampleType = soundtouch::SAMPLETYPE;
     constexpr bool kIsFloat = std::is_same_v<SampleType, float>;
-
-    const auto *pcm = reinterpret_cast<const std::int16_t *>(data);
+    const float pitch = tempo;
 
     // Prepare input for SoundTouch
     std::vector<SampleType> input(sampleCount);
@@ -71,46 +564,28 @@ std::vector<std::uint8_t> DspPipeline::process(const std::uint8_t *data, std::si
         std::memcpy(input.data(), pcm, sampleCount * sizeof(std::int16_t));
     }
 
-    if (mode == DspMode::Tempo) {
-        m_impl->touch.setTempo(tempo);
-        m_impl->touch.setRate(1.0f);
-        m_impl->touch.setPitch(1.0f);
-    } else {
-        m_impl->touch.setTempo(1.0f);
-        m_impl->touch.setRate(1.0f);
-        m_impl->touch.setPitch(pitch);
-    }
-
-    m_impl->touch.putSamples(input.data(), frameCount);
-
-    std::vector<std::uint8_t> output;
-
     const std::size_t maxFrames = static_cast<std::size_t>(std::ceil(frameCount / std::max(0.1f, tempo)) + 1024);
-    m_impl->scratch.resize(maxFrames * m_channels);
-
-    while (true) {
-        const auto receivedFrames = m_impl->touch.receiveSamples(m_impl->scratch.data(), maxFrames);
-        if (receivedFrames == 0) break;
-        const std::size_t receivedSamples = receivedFrames * m_channels;
-
-        if constexpr (kIsFloat) {
-            std::size_t prev = output.size();
-            output.resize(prev + receivedSamples * sizeof(std::int16_t));
-            auto *outPcm = reinterpret_cast<std::int16_t *>(output.data() + prev);
-            for (std::size_t i = 0; i < receivedSamples; ++i) {
-                const float clamped = std::clamp(static_cast<float>(m_impl->scratch[i]), -1.0f, 1.0f);
-                outPcm[i] = static_cast<std::int16_t>(std::lround(clamped * 32767.0f));
-            }
-        } else {
-            std::size_t prev = output.size();
-            output.resize(prev + receivedSamples * sizeof(std::int16_t));
-            std::memcpy(output.data() + prev, m_impl->scratch.data(), receivedSamples * sizeof(std::int16_t));
+    std::vector<SampleType> processed;
+    if (resampleOnly) {
+        m_impl->resample(input.data(), frameCount, m_channels, static_cast<double>(tempo) * trim, processed);
+    } else if (mode == DspMode::Tempo && m_config.voiceGate && static_cast<double>(tempo) * trim > 1.0) {
+        m_impl->runGated(pcm, input.data(), frameCount, m_channels, m_sampleRate, tempo, trim, maxFrames, processed);
+        // The gate counted the pre-roll as emitted output; it is owed again once dropped.
+        m_impl->outputDebt += static_cast<double>(m_impl->dropPrimed(processed, m_channels));
+    } else {
+        if (mode == DspMode::Tempo && m_config.voiceGate) {
+            // Silent spans can only be shortened, so slow-down keeps everything on SoundTouch; the gate picks up
+            // with a clean account once the speed goes back above 1.
+            m_impl->engineBusy = true;
+            m_impl->outputDebt = 0.0;
         }
-        if (output.size() >= bytes && mode == DspMode::Tempo) break;
-        // Logic for break: if we got enough samples.
-        // Note: original logic had `if (output.size() >= bytes) break;`.
+        m_impl->run(input.data(), frameCount, m_channels, mode, tempo, pitch, trim, maxFrames, processed,
+                    mode == DspMode::Tempo ? sampleCount : 0);
+        m_impl->dropPrimed(processed, m_channels);
     }
 
+    std::vector<std::uint8_t> output = toPcm16Bytes(processed);
+
     if (output.empty()) {
         if (mode == DspMode::Pitch) {
             return std::vector<std::uint8_t>(data, data + bytes);
@@ -120,23 +595,11 @@ std::vector<std::uint8_t> DspPipeline::process(const std::uint8_t *data, std::si
 
     return output;
 #else
-    if (sampleCount < 2 || std::abs(speedRatio - 1.0f) < 0.01f) {
-        KRKR_LOG_WARN("DspPipeline: SoundTouch disabled; speed unchanged (PCM path)");
-        return std::vector<std::uint8_t>(data, data + bytes);
-    }
-    const double inv = 1.0 / speedRatio;
-    const std::size_t outputSamples = static_cast<std::size_t>(sampleCount * inv);
-    std::vector<std::uint8_t> output(outputSamples * sizeof(std::int16_t));
-    const auto *input = reinterpret_cast<const std::int16_t *>(data);
-    auto *out = reinterpret_cast<std::int16_t *>(output.data());
-    for (std::size_t i = 0; i < outputSamples; ++i) {
-        const double srcIndex = i * speedRatio;
-        const std::size_t idx = static_cast<std::size_t>(srcIndex);
-        const std::size_t next = std::min<std::size_t>(idx + 1, sampleCount - 1);
-        const double frac = srcIndex - idx;
-        const std::int16_t a = input[idx];
-        const std::int16_t b = input[next];
-        out[i] = static_cast<std::int16_t>(a + (b - a) * frac);
+    std::vector<std::int16_t> processed;
+    m_impl->resample(pcm, frameCount, m_channels, static_cast<double>(tempo) * trim, processed);
+    std::vector<std::uint8_t> output(processed.size() * sizeof(std::int16_t));
+    if (!output.empty()) {
+        std::memcpy(output.data(), processed.data(), output.size());
     }
     return output;
 #endif
@@ -149,20 +612,22 @@ std::vector<float> DspPipeline::process(const float *data, std::size_t samples,
     }
 
     // Near-1.0 speed: bypass SoundTouch to avoid unnecessary processing and artifacts.
-    if (std::fabs(speedRatio - 1.0f) <= 0.001f) {
+    const float trim = m_impl->tempoTrim;
+    if (std::fabs(speedRatio - 1.0f) <= 0.001f && std::fabs(trim - 1.0f) <= 0.001f) {
         return {};
     }
 
     const float tempo = std::max(0.01f, speedRatio);
-    const float pitch = std::max(0.01f, speedRatio);
     const std::size_t frameCount = samples / m_channels;
     if (frameCount == 0) {
         return {};
     }
+    const bool resampleOnly = m_impl->tier == QualityTier::RateOnly && mode == DspMode::Tempo;
 
 #ifdef USE_SOUNDTOUCH
     using SampleType = soundtouch::SAMPLETYPE;
     constexpr bool kIsFloat = std::is_same_v<SampleType, float>;
+    const float pitch = tempo;
 
     // Prepare input
     std::vector<SampleType> input(samples);
@@ -176,39 +641,24 @@ std::vector<float> DspPipeline::process(const float *data, std::size_t samples,
         }
     }
 
-    if (mode == DspMode::Tempo) {
-        m_impl->touch.setTempo(tempo);
-        m_impl->touch.setRate(1.0f);
-        m_impl->touch.setPitch(1.0f);
+    const std::size_t maxFrames = static_cast<std::size_t>(std::ceil(frameCount / std::max(0.1f, tempo)) + 1024);
+    std::vector<SampleType> processed;
+    if (resampleOnly) {
+        m_impl->resample(input.data(), frameCount, m_channels, static_cast<double>(tempo) * trim, processed);
     } else {
-        m_impl->touch.setTempo(1.0f);
-        m_impl->touch.setRate(1.0f);
-        m_impl->touch.setPitch(pitch);
+        m_impl->run(input.data(), frameCount, m_channels, mode, tempo, pitch, trim, maxFrames, processed, 0);
+        m_impl->dropPrimed(processed, m_channels);
     }
 
-    m_impl->touch.putSamples(input.data(), frameCount);
-
-    std::vector<float> output;
-    const std::size_t maxFrames = static_cast<std::size_t>(std::ceil(frameCount / std::max(0.1f, tempo)) + 1024);
-    m_impl->scratch.resize(maxFrames * m_channels);
-
-    while (true) {
-        const auto receivedFrames = m_impl->touch.receiveSamples(m_impl->scratch.data(), maxFrames);
-        if (receivedFrames == 0) break;
-        const std::size_t receivedSamples = receivedFrames * m_channels;
-
-        std::size_t prev = output.size();
-        output.resize(prev + receivedSamples);
-
-        if constexpr (kIsFloat) {
-            for(size_t i=0; i<receivedSamples; ++i) {
-                output[prev + i] = static_cast<float>(m_impl->scratch[i]);
-            }
-        } else {
-            constexpr float invShortMax = 1.0f / 32768.0f;
-            for(size_t i=0; i<receivedSamples; ++i) {
-                output[prev + i] = static_cast<float>(m_impl->scratch[i]) * invShortMax;
-            }
+    std::vector<float> output(processed.size());
+    if constexpr (kIsFloat) {
+        if (!processed.empty()) {
+            std::memcpy(output.data(), processed.data(), processed.size() * sizeof(float));
+        }
+    } else {
+        constexpr float invShortMax = 1.0f / 32768.0f;
+        for (size_t i = 0; i < processed.size(); ++i) {
+            output[i] = static_cast<float>(processed[i]) * invShortMax;
         }
     }
 
@@ -220,31 +670,275 @@ std::vector<float> DspPipeline::process(const float *data, std::size_t samples,
     }
     return output;
 #else
-    if (samples < 2 || std::abs(speedRatio - 1.0f) < 0.01f) {
-        KRKR_LOG_WARN("DspPipeline: SoundTouch disabled; speed unchanged (float path)");
-        return std::vector<float>(data, data + samples);
-    }
-    const double inv = 1.0 / speedRatio;
-    const std::size_t outputSamples = static_cast<std::size_t>(samples * inv);
-    std::vector<float> output(outputSamples);
-    for (std::size_t i = 0; i < outputSamples; ++i) {
-        const double srcIndex = i * speedRatio;
-        const std::size_t idx = static_cast<std::size_t>(srcIndex);
-        const std::size_t next = std::min<std::size_t>(idx + 1, samples - 1);
-        const double frac = srcIndex - idx;
-        const float a = data[idx];
-        const float b = data[next];
-        output[i] = static_cast<float>(a + (b - a) * frac);
+    if (resampleOnly) {
+        std::vector<float> output;
+        m_impl->resample(data, frameCount, m_channels, static_cast<double>(tempo) * trim, output);
+        return output;
+    }
+    // IntWsola is 16-bit only; float callers round-trip through it.
+    std::vector<std::int16_t> pcm(frameCount * m_channels);
+    for (std::size_t i = 0; i < pcm.size(); ++i) {
+        pcm[i] = static_cast<std::int16_t>(std::lround(std::clamp(data[i], -1.0f, 1.0f) * 32767.0f));
+    }
+    std::vector<std::int16_t> processed;
+    m_impl->runInteger(pcm.data(), frameCount, m_sampleRate, m_channels, m_config, mode, tempo, trim, processed);
+    if (processed.empty()) {
+        return mode == DspMode::Pitch ? std::vector<float>(data, data + samples) : std::vector<float>{};
+    }
+    constexpr float invShortMax = 1.0f / 32768.0f;
+    std::vector<float> output(processed.size());
+    for (std::size_t i = 0; i < processed.size(); ++i) {
+        output[i] = static_cast<float>(processed[i]) * invShortMax;
     }
     return output;
 #endif
 }
 
+void DspPipeline::setTempoTrim(float trim) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->tempoTrim = std::clamp(trim, kMinTempoTrim, kMaxTempoTrim);
+}
+
+float DspPipeline::tempoTrim() const {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->tempoTrim;
+}
+
+void DspPipeline::setConfig(const DspConfig &config) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    if (config == m_config) {
+        return;
+    }
+#ifdef USE_SOUNDTOUCH
+    const bool engineSwitch = config.integerPath != m_config.integerPath;
+    const bool gateOn = config.voiceGate && !m_config.voiceGate;
+#endif
+    m_config = config;
+    if (m_impl->wsola) {
+        if (!usesIntegerEngine(m_config)) {
+            m_impl->wsola.reset();
+        } else {
+            configureWsola(*m_impl->wsola, m_config, m_impl->tier);
+        }
+    }
+#ifdef USE_SOUNDTOUCH
+    if (engineSwitch) {
+        // SoundTouch's buffered latency is dropped when the integer engine takes over.
+        m_impl->touch.clear();
+        if (m_impl->mono) m_impl->mono->clear();
+        m_impl->engineBusy = false;
+    } else if (gateOn) {
+        // Ungated input may still sit in SoundTouch; flush it at the first silent span like gated input.
+        m_impl->engineBusy = true;
+    }
+    applyConfig(m_impl->touch, m_config, m_impl->tier);
+    if (m_impl->mono) {
+        applyConfig(*m_impl->mono, m_config, m_impl->tier);
+    }
+#endif
+}
+
+void DspPipeline::setQualityTier(QualityTier tier) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    if (tier == m_impl->tier) {
+        return;
+    }
+    if (m_impl->wsola) {
+        if (tier == QualityTier::RateOnly) {
+            m_impl->wsola->clear();
+        }
+        configureWsola(*m_impl->wsola, m_config, tier);
+    }
+#ifdef USE_SOUNDTOUCH
+    if (tier == QualityTier::RateOnly) {
+        // Resampling starts from the next input; SoundTouch's buffered latency is dropped.
+        m_impl->touch.clear();
+        if (m_impl->mono) m_impl->mono->clear();
+        m_impl->engineBusy = false;
+    }
+    // Pitch mode keeps stretching at RateOnly; it gets the QuickSeek settings.
+    applyTier(m_impl->touch, m_config, tier);
+    if (m_impl->mono) {
+        applyTier(*m_impl->mono, m_config, tier);
+    }
+#endif
+    m_impl->rateTail.clear();
+    m_impl->tier = tier;
+}
+
+QualityTier DspPipeline::qualityTier() const {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->tier;
+}
+
+void DspPipeline::warmUp() {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    if (m_channels == 0 || m_sampleRate == 0) {
+        return;
+    }
+#ifdef USE_SOUNDTOUCH
+    // ~200 ms is enough for SoundTouch to reach its steady-state buffer sizes at 0.5x-2x.
+    const std::size_t frames = std::max<std::size_t>(1, m_sampleRate / 5);
+    std::vector<soundtouch::SAMPLETYPE> silence(frames * m_channels);
+    const std::size_t maxFrames = frames * 2 + 1024;
+    m_impl->scratch.resize(maxFrames * m_channels);
+    const float ratios[] = {1.5f, 0.75f};
+    for (const float ratio : ratios) {
+        m_impl->touch.setTempo(ratio);
+        m_impl->touch.setRate(1.0f);
+        m_impl->touch.setPitch(1.0f);
+        m_impl->touch.putSamples(silence.data(), static_cast<unsigned int>(frames));
+        while (m_impl->touch.receiveSamples(m_impl->scratch.data(), static_cast<unsigned int>(maxFrames)) > 0) {
+        }
+        m_impl->touch.setTempo(1.0f);
+        m_impl->touch.setPitch(ratio);
+        m_impl->touch.putSamples(silence.data(), static_cast<unsigned int>(frames));
+        while (m_impl->touch.receiveSamples(m_impl->scratch.data(), static_cast<unsigned int>(maxFrames)) > 0) {
+        }
+    }
+    m_impl->touch.clear();
+    if (m_impl->mono) { // only once a stream has gone mono; pooled pipelines build it on their first switch
+        auto &mono = *m_impl->mono;
+        for (const float ratio : ratios) {
+            mono.setTempo(ratio);
+            mono.setRate(1.0f);
+            mono.setPitch(1.0f);
+            mono.putSamples(silence.data(), static_cast<unsigned int>(frames));
+            while (mono.receiveSamples(m_impl->scratch.data(), static_cast<unsigned int>(maxFrames)) > 0) {
+            }
+        }
+        mono.clear();
+    }
+#endif
+}
+
+std::size_t DspPipeline::initialLatencyFrames(float speedRatio, DspMode mode) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    const float trim = m_impl->tempoTrim;
+    if (m_channels == 0 || (m_impl->tier == QualityTier::RateOnly && mode == DspMode::Tempo) ||
+        (std::fabs(speedRatio - 1.0f) <= 0.001f && std::fabs(trim - 1.0f) <= 0.001f)) {
+        return 0;
+    }
+#ifdef USE_SOUNDTOUCH
+    if (!usesIntegerEngine(m_config)) {
+        const float ratio = std::max(0.01f, speedRatio);
+        auto &st = m_impl->engine();
+        Impl::applyRatios(st, mode, ratio, ratio, trim);
+        return static_cast<std::size_t>(std::max(0, st.getSetting(SETTING_INITIAL_LATENCY)));
+    }
+#endif
+    return m_impl->integerEngine(m_sampleRate, m_channels, m_config).latencyFrames();
+}
+
+std::size_t DspPipeline::prime(float speedRatio, DspMode mode) {
+    const std::size_t latency = initialLatencyFrames(speedRatio, mode);
+    if (latency == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    if (usesIntegerEngine(m_config)) {
+        auto &wsola = m_impl->integerEngine(m_sampleRate, m_channels, m_config);
+        const std::vector<std::int16_t> silence(latency * m_channels);
+        std::vector<std::int16_t> discard;
+        wsola.process(silence.data(), latency, discard);
+        return m_impl->primed(wsola.bufferedFrames(), m_sampleRate, m_config, speedRatio, mode);
+    }
+#ifdef USE_SOUNDTOUCH
+    auto &st = m_impl->engine();
+    const std::uint32_t stChannels = m_impl->monoActive ? 1 : m_channels;
+    std::vector<soundtouch::SAMPLETYPE> silence(latency * stChannels);
+    st.putSamples(silence.data(), static_cast<unsigned int>(latency));
+    const std::size_t maxFrames = latency * 2 + 1024;
+    m_impl->scratch.resize(maxFrames * stChannels);
+    while (st.receiveSamples(m_impl->scratch.data(), static_cast<unsigned int>(maxFrames)) > 0) {
+    }
+    return m_impl->primed(st.numUnprocessedSamples(), m_sampleRate, m_config, speedRatio, mode);
+#else
+    return 0;
+#endif
+}
+
+std::size_t DspPipeline::memoryFootprint() const {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    std::size_t bytes = sizeof(Impl);
+    if (m_impl->wsola) {
+        bytes += m_impl->wsola->memoryFootprint();
+    }
+#ifdef USE_SOUNDTOUCH
+    using SampleType = soundtouch::SAMPLETYPE;
+    bytes += m_impl->scratch.capacity() * sizeof(SampleType);
+    // SoundTouch does not report FIFO capacity; its input/mid/output FIFOs plus the WSOLA
+    // work buffers settle around a quarter second of audio per channel.
+    bytes += static_cast<std::size_t>(m_sampleRate / 4) * m_channels * sizeof(SampleType) * 3;
+    bytes += (m_impl->monoInput.capacity() + m_impl->recent.capacity()) * sizeof(SampleType);
+    if (m_impl->mono) {
+        bytes += static_cast<std::size_t>(m_sampleRate / 4) * sizeof(SampleType) * 3;
+    }
+#endif
+    return bytes;
+}
+
+std::vector<std::uint8_t> DspPipeline::finish() {
+    std::vector<std::uint8_t> output;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        if (m_impl->wsola) {
+            std::vector<std::int16_t> tail;
+            m_impl->wsola->finish(tail);
+            m_impl->dropPrimed(tail, m_channels);
+            output.resize(tail.size() * sizeof(std::int16_t));
+            if (!tail.empty()) {
+                std::memcpy(output.data(), tail.data(), output.size());
+            }
+        }
+#ifdef USE_SOUNDTOUCH
+        if (m_channels > 0 && m_sampleRate > 0) {
+            std::vector<soundtouch::SAMPLETYPE> tail;
+            m_impl->flushEngine(m_channels, m_sampleRate, tail);
+            m_impl->dropPrimed(tail, m_channels);
+            const auto pcm = toPcm16Bytes(tail);
+            output.insert(output.end(), pcm.begin(), pcm.end());
+        }
+#endif
+    }
+    flush();
+    return output;
+}
+
 void DspPipeline::flush() {
     std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->tempoTrim = 1.0f;
+    m_impl->primeSkip = 0;
+    if (m_impl->wsola) {
+        m_impl->wsola->clear();
+        if (m_impl->tier != QualityTier::Full) {
+            configureWsola(*m_impl->wsola, m_config, QualityTier::Full);
+        }
+    }
 #ifdef USE_SOUNDTOUCH
+    if (m_impl->tier != QualityTier::Full) {
+        applyTier(m_impl->touch, m_config, QualityTier::Full);
+        if (m_impl->mono) {
+            applyTier(*m_impl->mono, m_config, QualityTier::Full);
+        }
+    }
     m_impl->touch.clear();
+    if (m_impl->mono) m_impl->mono->clear();
+    m_impl->monoActive = false;
+    m_impl->recent.clear();
+    m_impl->switchTail.clear();
+    m_impl->switchFaded = 0;
+    m_impl->identicalRun = 0;
+    m_impl->enterAfter = kMonoEnterBuffers;
+    m_impl->quietBlocks = kGateHangoverBlocks;
+    m_impl->engineBusy = false;
+    m_impl->outputDebt = 0.0;
+    m_impl->resumeFade = 0;
+    m_impl->resumeFaded = 0;
 #endif
+    m_impl->rateTail.clear();
+    m_impl->ratePhase = 0.0;
+    m_impl->tier = QualityTier::Full;
 }
 
 } // namespace krkrspeed
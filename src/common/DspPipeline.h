@@ -11,13 +11,48 @@ struct DspConfig {
     float sequenceMs = 35.0f;
     float overlapMs = 10.0f;
     float seekWindowMs = 25.0f;
+    // Tempo mode: skip WSOLA for silent spans (energy/zero-crossing VAD) and shorten them by dropping samples.
+    // Off by default: quiet music reads as silence to the VAD, so hooks enable it only for speech streams.
+    bool voiceGate = false;
+    bool quickSeek = false;            // SETTING_USE_QUICKSEEK: coarse-to-fine overlap search
+    bool antiAlias = true;             // SETTING_USE_AA_FILTER: low-pass in the rate transposer (pitch mode)
+    std::uint32_t aaFilterLength = 64; // SETTING_AA_FILTER_LENGTH taps (multiple of 4, 8..128)
+    // 16-bit PCM runs through IntWsola (fixed point, SSE2 correlation) instead of SoundTouch; no voice
+    // gate, mono engine or AA filter on that path. Builds without SoundTouch use IntWsola for every stream.
+    bool integerPath = false;
 };
 
+inline bool operator==(const DspConfig &a, const DspConfig &b) {
+    return a.sequenceMs == b.sequenceMs && a.overlapMs == b.overlapMs && a.seekWindowMs == b.seekWindowMs &&
+           a.voiceGate == b.voiceGate && a.quickSeek == b.quickSeek && a.antiAlias == b.antiAlias &&
+           a.aaFilterLength == b.aaFilterLength && a.integerPath == b.integerPath;
+}
+inline bool operator!=(const DspConfig &a, const DspConfig &b) { return !(a == b); }
+
+// Named DspConfig sets selectable per process (SharedSettings::dspPreset). The Balanced and Quality values are
+// provisional until measured with `krkr_dsp_autotune --presets` on a real SoundTouch build.
+enum class DspPreset : std::uint32_t {
+    Balanced = 0, // DspConfig defaults
+    LowPower = 1, // integer WSOLA with quick seek and a shorter seek window
+    Quality = 2   // exhaustive seek over a wider window, 128-tap AA filter
+};
+
+DspConfig dspPresetConfig(DspPreset preset);
+const char *dspPresetName(DspPreset preset);
+
 enum class DspMode {
     Tempo,   // change tempo (speed) while keeping pitch
     Pitch    // change pitch while keeping tempo
 };
 
+// Cost tiers stepped through under CPU pressure (see QualityGovernor).
+enum class QualityTier : std::uint32_t {
+    Full = 0,      // WSOLA with the configured sequence/overlap/seek window
+    QuickSeek = 1, // SoundTouch quick seek and a shorter seek window
+    RateOnly = 2   // Tempo mode resamples linearly (pitch follows) instead of stretching; Pitch mode cannot
+                   // correct pitch without a stretch and runs as QuickSeek
+};
+
 class DspPipeline {
 public:
     explicit DspPipeline(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &config = {});
@@ -38,9 +73,44 @@ public:
     // Flush internal buffered samples/state.
     void flush();
 
+    // Emit what SoundTouch still holds (its latency tail) as 16-bit PCM, then reset like flush().
+    // For one-shot input where no further samples will follow.
+    std::vector<std::uint8_t> finish();
+
+    // Extra tempo factor layered on top of either mode (1.0 = none, clamped to 0.5..2). Above 1 it drains
+    // output backlog, below 1 it makes up the output a prime() left short: in Pitch mode the stream plays
+    // slightly faster or slower, in Tempo mode the requested tempo is scaled.
+    void setTempoTrim(float trim);
+    float tempoTrim() const;
+
+    // Run silence through both modes so SoundTouch grows its FIFOs up front, then clear.
+    void warmUp();
+
+    // The engine's initial buffering for this ratio/mode: input frames it needs before the first
+    // output batch (SETTING_INITIAL_LATENCY, or IntWsola's latency). 0 when bypassed or resampling.
+    std::size_t initialLatencyFrames(float speedRatio, DspMode mode);
+
+    // Pre-roll after a flush: feed initialLatencyFrames() of silence and discard the first output batch,
+    // so the next real input comes out behind exactly the steady-state latency instead of after an
+    // empty first call. Returns the silent input frames left queued. The output they still produce is
+    // dropped as well (leading all-zero frames, so digital silence at the very start of the real input may
+    // be shortened with it) and the first frame out is real input. Output then runs that many frames behind
+    // the input; callers that must return one frame per input frame make it up with setTempoTrim().
+    std::size_t prime(float speedRatio, DspMode mode);
+
+    // Switch cost tier; SoundTouch keeps its state between Full and QuickSeek. Entering RateOnly drops
+    // what SoundTouch still holds. flush() returns to Full.
+    void setQualityTier(QualityTier tier);
+    QualityTier qualityTier() const;
+
+    // Approximate heap bytes held by SoundTouch FIFOs and scratch buffers.
+    std::size_t memoryFootprint() const;
+
     std::uint32_t sampleRate() const { return m_sampleRate; }
     std::uint32_t channels() const { return m_channels; }
     const DspConfig &config() const { return m_config; }
+    // Apply new SoundTouch settings in place; buffered audio and mono/gate state are kept.
+    void setConfig(const DspConfig &config);
 
 private:
     std::uint32_t m_sampleRate;
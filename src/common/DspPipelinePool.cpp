@@ -0,0 +1,167 @@
+#include "DspPipelinePool.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace krkrspeed {
+
+DspPipelinePool &DspPipelinePool::instance() {
+    // Intentionally leaked: streams owned by other function-local statics recycle into the pool
+    // during process teardown, after a normal static would already have been destroyed.
+    static DspPipelinePool *pool = new DspPipelinePool();
+    return *pool;
+}
+
+DspPipelinePool::Bucket &DspPipelinePool::bucketLocked(const Key &key) {
+    for (auto &bucket : m_buckets) {
+        if (bucket.key == key) {
+            return bucket;
+        }
+    }
+    m_buckets.push_back(Bucket{key, {}, 0});
+    return m_buckets.back();
+}
+
+std::unique_ptr<DspPipeline> DspPipelinePool::acquire(std::uint32_t sampleRate, std::uint32_t channels,
+                                                      const DspConfig &cfg) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &bucket = bucketLocked(Key{sampleRate, channels, cfg});
+        if (!bucket.idle.empty()) {
+            auto dsp = std::move(bucket.idle.back());
+            bucket.idle.pop_back();
+            m_hits.fetch_add(1);
+            return dsp;
+        }
+    }
+    m_misses.fetch_add(1);
+    return std::make_unique<DspPipeline>(sampleRate, channels, cfg);
+}
+
+void DspPipelinePool::recycle(std::unique_ptr<DspPipeline> dsp) {
+    if (!dsp) return;
+    dsp->flush();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &bucket = bucketLocked(Key{dsp->sampleRate(), dsp->channels(), dsp->config()});
+    if (bucket.idle.size() < kMaxIdlePerKey) {
+        bucket.idle.push_back(std::move(dsp));
+    }
+}
+
+std::size_t DspPipelinePool::idleFootprint() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::size_t bytes = 0;
+    for (const auto &bucket : m_buckets) {
+        for (const auto &dsp : bucket.idle) {
+            bytes += dsp->memoryFootprint();
+        }
+    }
+    return bytes;
+}
+
+std::size_t DspPipelinePool::trim(std::size_t maxBytes) {
+    std::vector<std::unique_ptr<DspPipeline>> dropped;
+    std::size_t freed = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::size_t bytes = 0;
+        for (const auto &bucket : m_buckets) {
+            for (const auto &dsp : bucket.idle) {
+                bytes += dsp->memoryFootprint();
+            }
+        }
+        while (bytes > maxBytes) {
+            auto fullest = std::max_element(m_buckets.begin(), m_buckets.end(), [](const Bucket &a, const Bucket &b) {
+                return a.idle.size() < b.idle.size();
+            });
+            if (fullest == m_buckets.end() || fullest->idle.empty()) break;
+            const std::size_t size = fullest->idle.back()->memoryFootprint();
+            dropped.push_back(std::move(fullest->idle.back()));
+            fullest->idle.pop_back();
+            bytes -= std::min(bytes, size);
+            freed += size;
+        }
+    }
+    // Destroy outside the lock so acquire() on the audio thread never waits on SoundTouch teardown.
+    dropped.clear();
+    return freed;
+}
+
+void DspPipelinePool::prewarm(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &cfg,
+                              std::size_t count) {
+    if (sampleRate == 0 || channels == 0) return;
+    const Key key{sampleRate, channels, cfg};
+    count = std::min(count, kMaxIdlePerKey);
+    std::size_t toBuild = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &bucket = bucketLocked(key);
+        const std::size_t have = bucket.idle.size() + bucket.pendingWarm;
+        if (have >= count) return;
+        toBuild = count - have;
+        bucket.pendingWarm += toBuild;
+    }
+    std::vector<std::unique_ptr<DspPipeline>> built;
+    built.reserve(toBuild);
+    for (std::size_t i = 0; i < toBuild; ++i) {
+        auto dsp = std::make_unique<DspPipeline>(sampleRate, channels, cfg);
+        dsp->warmUp();
+        built.push_back(std::move(dsp));
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &bucket = bucketLocked(key);
+    bucket.pendingWarm -= std::min(bucket.pendingWarm, toBuild);
+    for (auto &dsp : built) {
+        if (bucket.idle.size() >= kMaxIdlePerKey) break;
+        bucket.idle.push_back(std::move(dsp));
+    }
+    KRKR_LOG_DEBUG("DspPipelinePool: prewarmed sr=" + std::to_string(sampleRate) + " ch=" + std::to_string(channels) +
+                   " idle=" + std::to_string(bucket.idle.size()));
+}
+
+void DspPipelinePool::prewarmAsync(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &cfg,
+                                   std::size_t count) {
+    if (sampleRate == 0 || channels == 0) return;
+    const Key key{sampleRate, channels, cfg};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &bucket = bucketLocked(key);
+        if (bucket.idle.size() + bucket.pendingWarm >= std::min(count, kMaxIdlePerKey)) return;
+        auto queued = std::find_if(m_warmQueue.begin(), m_warmQueue.end(),
+                                   [&](const WarmRequest &request) { return request.key == key; });
+        if (queued != m_warmQueue.end()) {
+            queued->count = std::max(queued->count, count);
+        } else {
+            m_warmQueue.push_back(WarmRequest{key, count});
+        }
+        if (!m_warmThreadStarted) {
+            // One thread for the life of the process, like the pool itself; a burst of new buffers
+            // queues formats instead of spawning a thread each.
+            try {
+                std::thread([this]() { warmLoop(); }).detach();
+                m_warmThreadStarted = true;
+            } catch (...) {
+                m_warmQueue.clear();
+                KRKR_LOG_WARN("DspPipelinePool: failed to start prewarm thread");
+                return;
+            }
+        }
+    }
+    m_warmCv.notify_one();
+}
+
+void DspPipelinePool::warmLoop() {
+    for (;;) {
+        WarmRequest request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_warmCv.wait(lock, [this]() { return !m_warmQueue.empty(); });
+            request = m_warmQueue.front();
+            m_warmQueue.erase(m_warmQueue.begin());
+        }
+        prewarm(request.key.sampleRate, request.key.channels, request.key.config, request.count);
+    }
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "DspPipeline.h"
+
+namespace krkrspeed {
+
+// Process-wide cache of constructed DspPipelines keyed by (sampleRate, channels, DspConfig).
+// Pipelines are pre-warmed off the audio thread and recycled with flush() instead of destroyed,
+// so the first Unlock/ReleaseBuffer of a voice line does not pay for SoundTouch setup.
+class DspPipelinePool {
+public:
+    static DspPipelinePool &instance();
+
+    // Returns a parked pipeline when one matches, otherwise constructs a new one.
+    std::unique_ptr<DspPipeline> acquire(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &cfg);
+    // Flushes and parks the pipeline for reuse; drops it when the key already has enough spares.
+    void recycle(std::unique_ptr<DspPipeline> dsp);
+
+    // Ensure at least `count` warmed pipelines are parked for this format.
+    void prewarm(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &cfg, std::size_t count = 1);
+    // Same as prewarm() but queued to the pool's single warm-up thread so hook entry points never block on it.
+    void prewarmAsync(std::uint32_t sampleRate, std::uint32_t channels, const DspConfig &cfg, std::size_t count = 1);
+
+    // Approximate heap bytes held by parked pipelines.
+    std::size_t idleFootprint();
+    // Drops parked pipelines, fullest format first, until the rest hold at most `maxBytes`; returns bytes freed.
+    // Callers enforcing a memory cap count idle pipelines against it, since evicted streams park theirs here.
+    std::size_t trim(std::size_t maxBytes);
+
+    std::uint64_t hits() const { return m_hits.load(); }
+    std::uint64_t misses() const { return m_misses.load(); }
+
+private:
+    DspPipelinePool() = default;
+
+    struct Key {
+        std::uint32_t sampleRate = 0;
+        std::uint32_t channels = 0;
+        DspConfig config{};
+        bool operator==(const Key &other) const {
+            return sampleRate == other.sampleRate && channels == other.channels && config == other.config;
+        }
+    };
+    struct Bucket {
+        Key key;
+        std::vector<std::unique_ptr<DspPipeline>> idle;
+        std::size_t pendingWarm = 0;
+    };
+
+    struct WarmRequest {
+        Key key;
+        std::size_t count = 0;
+    };
+
+    Bucket &bucketLocked(const Key &key);
+    void warmLoop();
+
+    static constexpr std::size_t kMaxIdlePerKey = 4;
+
+    std::mutex m_mutex;
+    std::vector<Bucket> m_buckets; // a handful of formats per process; linear lookup is fine
+    std::vector<WarmRequest> m_warmQueue; // guarded by m_mutex
+    std::condition_variable m_warmCv;
+    bool m_warmThreadStarted = false;
+    std::atomic<std::uint64_t> m_hits{0};
+    std::atomic<std::uint64_t> m_misses{0};
+};
+
+} // namespace krkrspeed
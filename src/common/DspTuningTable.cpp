@@ -0,0 +1,124 @@
+#include "DspTuningTable.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace krkrspeed {
+
+namespace {
+
+bool parseMode(const std::string &token, DspMode &mode) {
+    if (token == "tempo") {
+        mode = DspMode::Tempo;
+        return true;
+    }
+    if (token == "pitch") {
+        mode = DspMode::Pitch;
+        return true;
+    }
+    return false;
+}
+
+bool parseNumber(const std::string &text, float &value) {
+    std::istringstream in(text);
+    in.imbue(std::locale::classic());
+    in >> value;
+    return !in.fail() && in.eof();
+}
+
+bool applyKey(const std::string &key, float value, DspTuningEntry &entry) {
+    auto &cfg = entry.config;
+    if (key == "seq") cfg.sequenceMs = value;
+    else if (key == "seek") cfg.seekWindowMs = value;
+    else if (key == "overlap") cfg.overlapMs = value;
+    else if (key == "quickseek") cfg.quickSeek = value != 0.0f;
+    else if (key == "aa") cfg.antiAlias = value != 0.0f;
+    else if (key == "aa_len") cfg.aaFilterLength = static_cast<std::uint32_t>(value);
+    else if (key == "cpu") entry.cpuMsPerSec = value;
+    else if (key == "lsd") entry.distortionDb = value;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+bool DspTuningTable::load(const std::filesystem::path &path, std::string &error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "Unable to open " + path.u8string();
+        return false;
+    }
+    return parse(in, error);
+}
+
+bool DspTuningTable::parse(std::istream &in, std::string &error) {
+    std::vector<DspTuningEntry> entries;
+    std::string line;
+    std::size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        const auto hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+        std::istringstream fields(line);
+        fields.imbue(std::locale::classic());
+        std::string modeToken;
+        if (!(fields >> modeToken)) {
+            continue; // blank or comment-only
+        }
+        DspTuningEntry entry;
+        if (!parseMode(modeToken, entry.mode) || !(fields >> entry.minSpeed >> entry.maxSpeed) ||
+            entry.maxSpeed <= entry.minSpeed) {
+            error = "Malformed tuning entry on line " + std::to_string(lineNo);
+            return false;
+        }
+        std::string pair;
+        while (fields >> pair) {
+            const auto eq = pair.find('=');
+            float value = 0.0f;
+            if (eq == std::string::npos || !parseNumber(pair.substr(eq + 1), value)) {
+                error = "Malformed value '" + pair + "' on line " + std::to_string(lineNo);
+                return false;
+            }
+            applyKey(pair.substr(0, eq), value, entry);
+        }
+        entries.push_back(entry);
+    }
+    if (entries.empty()) {
+        error = "No tuning entries found";
+        return false;
+    }
+    m_entries = std::move(entries);
+    return true;
+}
+
+std::string DspTuningTable::formatEntry(const DspTuningEntry &entry) {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    const auto &cfg = entry.config;
+    out << (entry.mode == DspMode::Pitch ? "pitch" : "tempo") << ' ' << std::fixed << std::setprecision(3)
+        << entry.minSpeed << ' ' << entry.maxSpeed << std::setprecision(1) << " seq=" << cfg.sequenceMs
+        << " seek=" << cfg.seekWindowMs << " overlap=" << cfg.overlapMs << " quickseek=" << (cfg.quickSeek ? 1 : 0)
+        << " aa=" << (cfg.antiAlias ? 1 : 0) << " aa_len=" << cfg.aaFilterLength << std::setprecision(3)
+        << " cpu=" << entry.cpuMsPerSec << " lsd=" << entry.distortionDb;
+    return out.str();
+}
+
+void DspTuningTable::write(std::ostream &out) const {
+    for (const auto &entry : m_entries) {
+        out << formatEntry(entry) << '\n';
+    }
+}
+
+const DspConfig *DspTuningTable::find(float speed, DspMode mode) const {
+    for (const auto &entry : m_entries) {
+        if (entry.mode == mode && speed >= entry.minSpeed && speed < entry.maxSpeed) {
+            return &entry.config;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace krkrspeed
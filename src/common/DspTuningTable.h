@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "DspPipeline.h"
+
+namespace krkrspeed {
+
+// File the hook looks for in the controller directory (HookDataDirectory); produced by tools/dsp_autotune.
+constexpr wchar_t kDspTuningFileName[] = L"krkr_dsp_tuning.txt";
+
+struct DspTuningEntry {
+    DspMode mode = DspMode::Tempo;
+    float minSpeed = 0.0f; // inclusive
+    float maxSpeed = 0.0f; // exclusive
+    DspConfig config;
+    float cpuMsPerSec = 0.0f;  // DSP milliseconds per second of input audio when it was measured
+    float distortionDb = 0.0f; // band log-spectral distance against the time-mapped input
+};
+
+// Per-speed-band DspConfig picked offline (cheapest setting within a quality margin of the best one).
+// One entry per line:
+//   <tempo|pitch> <minSpeed> <maxSpeed> seq=<ms> seek=<ms> overlap=<ms> quickseek=<0|1> aa=<0|1> aa_len=<n>
+//       [cpu=<ms/s>] [lsd=<dB>]
+// '#' starts a comment; omitted keys keep the DspConfig defaults, unknown keys are ignored.
+class DspTuningTable {
+public:
+    bool load(const std::filesystem::path &path, std::string &error);
+    bool parse(std::istream &in, std::string &error);
+    void write(std::ostream &out) const;
+
+    void add(const DspTuningEntry &entry) { m_entries.push_back(entry); }
+    // Config for `speed` in `mode`, or nullptr when no band covers it.
+    const DspConfig *find(float speed, DspMode mode) const;
+
+    bool empty() const { return m_entries.empty(); }
+    const std::vector<DspTuningEntry> &entries() const { return m_entries; }
+
+    static std::string formatEntry(const DspTuningEntry &entry);
+
+private:
+    std::vector<DspTuningEntry> m_entries;
+};
+
+} // namespace krkrspeed
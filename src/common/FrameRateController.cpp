@@ -0,0 +1,66 @@
+#include "FrameRateController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace krkrspeed {
+
+namespace {
+// Speeds are quantized to 1/kSpeedScale so the ideal total stays an exact rational.
+constexpr std::uint64_t kSpeedScale = 1000;
+constexpr std::uint32_t kMinSpeedMilli = 100;
+constexpr std::uint32_t kMaxSpeedMilli = 100000;
+} // namespace
+
+FrameRateController::FrameRateController(std::uint32_t sampleRate, const FrameRateConfig &config)
+    : m_sampleRate(sampleRate), m_config(config) {}
+
+std::uint32_t FrameRateController::next(std::uint32_t written, float speed) {
+    if (written == 0) return 0;
+    const auto milli = static_cast<std::uint32_t>(std::clamp<long long>(
+        std::llround(static_cast<double>(speed) * kSpeedScale), kMinSpeedMilli, kMaxSpeedMilli));
+    if (milli != m_speedMilli) {
+        // Keep the fractional frame owed across a speed change (rescaled to the new denominator).
+        m_idealRemainder = m_idealRemainder * milli / m_speedMilli;
+        m_speedMilli = milli;
+    }
+    const std::uint64_t num = static_cast<std::uint64_t>(written) * kSpeedScale + m_idealRemainder;
+    const std::uint64_t nominal = num / m_speedMilli;
+    m_idealRemainder = num % m_speedMilli;
+    m_idealFrames += nominal;
+
+    // Drift carried into this release (ideal total before it minus what was emitted).
+    const double drift = static_cast<double>(static_cast<std::int64_t>(m_idealFrames - nominal - m_outFrames));
+    const double maxCorrection =
+        std::max(1.0, static_cast<double>(nominal) * static_cast<double>(m_config.maxCorrectionPct) / 100.0);
+    if (m_config.ki > 0.0f) {
+        const double windup = maxCorrection / m_config.ki;
+        m_integral = std::clamp(m_integral + drift, -windup, windup);
+    }
+    double correction = std::clamp(m_config.kp * drift + m_config.ki * m_integral, -maxCorrection, maxCorrection);
+    const double tolerance = static_cast<double>(m_sampleRate) * m_config.toleranceMs / 1000.0;
+    if (m_sampleRate > 0 && std::fabs(drift - correction) > tolerance) {
+        // Out of tolerance: pull the remaining drift back to the edge within this release.
+        correction = drift - std::clamp(drift - correction, -tolerance, tolerance);
+    }
+
+    const std::int64_t effective = std::clamp<std::int64_t>(
+        static_cast<std::int64_t>(nominal) + std::llround(correction), 1, static_cast<std::int64_t>(written));
+    m_outFrames += static_cast<std::uint64_t>(effective);
+
+    m_telemetry.driftFrames = static_cast<std::int64_t>(m_idealFrames - m_outFrames);
+    m_telemetry.correctionFrames = static_cast<std::int32_t>(effective - static_cast<std::int64_t>(nominal));
+    ++m_telemetry.releases;
+    return static_cast<std::uint32_t>(effective);
+}
+
+void FrameRateController::reset() {
+    m_speedMilli = 1000;
+    m_idealFrames = 0;
+    m_idealRemainder = 0;
+    m_outFrames = 0;
+    m_integral = 0.0;
+    m_telemetry = {};
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+namespace krkrspeed {
+
+struct FrameRateConfig {
+    float toleranceMs = 30.0f;      // |drift| beyond this is corrected within one release
+    float kp = 0.25f;               // proportional gain on drift (frames per frame of drift)
+    float ki = 0.02f;               // integral gain
+    float maxCorrectionPct = 5.0f;  // PI correction limit relative to a release's nominal frames
+};
+
+struct FrameRateTelemetry {
+    std::int64_t driftFrames = 0;      // ideal output minus emitted output after the last release
+    std::int32_t correctionFrames = 0; // last release's frames above (+) or below (-) nominal
+    std::uint64_t releases = 0;
+};
+
+// Drop-mode frame accounting for speedup: decides how many engine frames each release of `written`
+// game frames becomes so that the total tracks sum(written / speed). The ideal total is kept exactly
+// (integer frames plus a remainder over the speed quantized to 1/1000), so hours-long sessions do not
+// lose precision; a PI loop spreads corrections over several releases instead of jumping.
+class FrameRateController {
+public:
+    explicit FrameRateController(std::uint32_t sampleRate = 0, const FrameRateConfig &config = {});
+
+    void setSampleRate(std::uint32_t sampleRate) { m_sampleRate = sampleRate; }
+    void setConfig(const FrameRateConfig &config) { m_config = config; }
+    const FrameRateConfig &config() const { return m_config; }
+
+    // Frames to release for `written` game frames at `speed`; within [1, written] when written > 0.
+    std::uint32_t next(std::uint32_t written, float speed);
+
+    void reset();
+    const FrameRateTelemetry &telemetry() const { return m_telemetry; }
+
+private:
+    std::uint32_t m_sampleRate = 0;
+    FrameRateConfig m_config{};
+    std::uint32_t m_speedMilli = 1000;
+    std::uint64_t m_idealFrames = 0;
+    std::uint64_t m_idealRemainder = 0; // in 1/m_speedMilli frames
+    std::uint64_t m_outFrames = 0;
+    double m_integral = 0.0;
+    FrameRateTelemetry m_telemetry{};
+};
+
+} // namespace krkrspeed
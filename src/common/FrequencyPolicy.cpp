@@ -0,0 +1,100 @@
+#include "FrequencyPolicy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace krkrspeed {
+
+FrequencyPolicy::FrequencyPolicy(std::uint32_t formatRate, bool knownApplied)
+    : m_formatRate(formatRate), m_applied(knownApplied ? formatRate : 0), m_probed(knownApplied) {}
+
+std::uint32_t FrequencyPolicy::gameFrequency() const {
+    return m_game ? m_game : m_formatRate;
+}
+
+std::uint32_t FrequencyPolicy::target(float speed) const {
+    const double scaled = static_cast<double>(gameFrequency()) * static_cast<double>(speed);
+    return static_cast<std::uint32_t>(
+        std::clamp(scaled, static_cast<double>(kMinFrequency), static_cast<double>(kMaxFrequency)));
+}
+
+float FrequencyPolicy::appliedSpeed(float speed) const {
+    const std::uint32_t game = gameFrequency();
+    return game > 0 ? static_cast<float>(target(speed)) / static_cast<float>(game) : speed;
+}
+
+void FrequencyPolicy::onProbed(bool ok, std::uint32_t current) {
+    m_probed = true;
+    if (!ok || current == 0) return;
+    // Whatever the buffer plays at before we first touch it is what the game chose.
+    m_applied = current;
+    m_game = current == m_formatRate ? 0 : current;
+}
+
+void FrequencyPolicy::onGameSet(std::uint32_t requested) {
+    m_game = requested;
+    m_failedTarget = 0;
+}
+
+void FrequencyPolicy::onApplied(float speed, bool ok) {
+    const std::uint32_t frequency = target(speed);
+    if (ok) {
+        m_applied = frequency;
+        m_speed = speed;
+        m_failedTarget = 0;
+    } else {
+        m_failedTarget = frequency;
+    }
+}
+
+bool FrequencyPolicy::needsApply(float speed) const {
+    const std::uint32_t want = target(speed);
+    return want != m_applied && want != m_failedTarget;
+}
+
+bool FrequencyRestore::needsLock(std::uint32_t engagement, std::uintptr_t key) const {
+    if (m_settled.load(std::memory_order_relaxed) == engagement) {
+        return false;
+    }
+    if (m_open.load(std::memory_order_acquire) != engagement || m_pending.load(std::memory_order_relaxed) == 0) {
+        return true; // the list has to be made, or everything was restored and the restore has to be settled
+    }
+    const std::uint32_t listed = m_listed.load(std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < listed; ++i) {
+        if (m_keys[i].load(std::memory_order_relaxed) == key) return true;
+    }
+    return false;
+}
+
+void FrequencyRestore::begin(std::uint32_t engagement, const std::vector<std::uintptr_t> &retuned) {
+    const std::size_t listed = std::min(retuned.size(), kMaxPending);
+    for (std::size_t i = 0; i < kMaxPending; ++i) {
+        m_keys[i].store(i < listed ? retuned[i] : 0, std::memory_order_relaxed);
+    }
+    m_listed.store(static_cast<std::uint32_t>(listed), std::memory_order_relaxed);
+    m_pending.store(static_cast<std::uint32_t>(listed), std::memory_order_relaxed);
+    m_open.store(engagement, std::memory_order_release);
+}
+
+void FrequencyRestore::done(std::uintptr_t key) {
+    if (key == 0) return;
+    const std::uint32_t listed = m_listed.load(std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < listed; ++i) {
+        if (m_keys[i].load(std::memory_order_relaxed) == key) {
+            m_keys[i].store(0, std::memory_order_relaxed);
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+bool FrequencyRestore::settle(std::uint32_t engagement) {
+    if (m_settled.load(std::memory_order_relaxed) == engagement ||
+        m_open.load(std::memory_order_relaxed) != engagement || m_pending.load(std::memory_order_relaxed) > 0) {
+        return false;
+    }
+    m_settled.store(engagement, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace krkrspeed
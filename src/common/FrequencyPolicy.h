@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace krkrspeed {
+
+// Frequency bookkeeping for one DirectSound buffer. The hook intercepts the game's SetFrequency and
+// GetFrequency, so the frequency on the buffer is always known here and the Unlock path only issues a
+// SetFrequency when the target actually changes (new speed, new game frequency, processing toggled).
+// The game keeps seeing its own frequency; speed is applied on top of it.
+class FrequencyPolicy {
+public:
+    static constexpr std::uint32_t kMinFrequency = 100;    // DSBFREQUENCY_MIN
+    static constexpr std::uint32_t kMaxFrequency = 200000; // DSBFREQUENCY_MAX
+
+    // `formatRate` is the buffer's nSamplesPerSec. `knownApplied`: the buffer is fresh from
+    // CreateSoundBuffer, so it plays at the format rate; otherwise the hook should probe once.
+    explicit FrequencyPolicy(std::uint32_t formatRate = 0, bool knownApplied = false);
+
+    // Frequency the game asked for (DSBFREQUENCY_ORIGINAL resolved to the format rate).
+    std::uint32_t gameFrequency() const;
+    // Frequency to run at for `speed` (1.0 = the game's own), clamped to the DirectSound range.
+    std::uint32_t target(float speed) const;
+    // Speed actually achieved by target(speed) after clamping; what the DSP must pitch-correct.
+    float appliedSpeed(float speed) const;
+
+    // True when the hook has never seen the buffer's frequency (tracked after creation).
+    bool needsProbe() const { return m_applied == 0 && !m_probed; }
+    void onProbed(bool ok, std::uint32_t current);
+
+    // The game called SetFrequency(requested). The real call should then get target(speed()) (or
+    // target(1.0) while processing is off); if it fails the caller restores its copy from before.
+    void onGameSet(std::uint32_t requested);
+    // The real SetFrequency(target(speed)) returned; failures are not retried until the target moves.
+    void onApplied(float speed, bool ok);
+    float speed() const { return m_speed; }
+
+    // True when target(speed) differs from what is on the buffer and has not already failed.
+    bool needsApply(float speed) const;
+    // Buffer runs at something other than the game's frequency (processing retuned it).
+    bool retuned() const { return m_applied != 0 && m_applied != gameFrequency(); }
+    std::uint32_t applied() const { return m_applied; }
+
+private:
+    std::uint32_t m_formatRate = 0;
+    std::uint32_t m_game = 0;        // 0 = DSBFREQUENCY_ORIGINAL
+    std::uint32_t m_applied = 0;     // frequency on the buffer, 0 = unknown
+    std::uint32_t m_failedTarget = 0;
+    float m_speed = 1.0f;            // speed the applied frequency was derived from
+    bool m_probed = false;
+};
+
+// Base-frequency restore after processing is switched off. The first Unlock of a disengagement lists, under
+// the hook's mutex, the buffers still retuned; each is set back to the game's frequency on its own next Unlock,
+// however late that comes. Every other Unlock only calls needsLock(), which reads atomics: the settled
+// engagement, then (while buffers are pending) the list. Buffers past kMaxPending are retuned on re-engagement.
+class FrequencyRestore {
+public:
+    static constexpr std::size_t kMaxPending = 32;
+
+    // Lock-free. False when an Unlock of `key` under the disengaged `engagement` has nothing to do.
+    bool needsLock(std::uint32_t engagement, std::uintptr_t key) const;
+
+    // The rest is called under the caller's lock.
+    bool opened(std::uint32_t engagement) const { return m_open.load(std::memory_order_relaxed) == engagement; }
+    // Opens the restore for `engagement` with the buffers in `retuned` (the first kMaxPending of them).
+    void begin(std::uint32_t engagement, const std::vector<std::uintptr_t> &retuned);
+    // `key` needs no restore any more (restored, released, or the game set its own frequency).
+    void done(std::uintptr_t key);
+    // Ends the restore for `engagement` once nothing is pending; true if it ended.
+    bool settle(std::uint32_t engagement);
+    std::uint32_t pending() const { return m_pending.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint32_t> m_settled{0}; // disengagement whose restore has ended
+    std::atomic<std::uint32_t> m_open{0};    // disengagement whose buffers are listed
+    std::atomic<std::uint32_t> m_pending{0};
+    std::atomic<std::uint32_t> m_listed{0}; // slots in use, pending or done
+    std::array<std::atomic<std::uintptr_t>, kMaxPending> m_keys{};
+};
+
+} // namespace krkrspeed
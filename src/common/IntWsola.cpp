@@ -0,0 +1,289 @@
+#include "IntWsola.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KRKR_DSP_SSE2 1
+#endif
+
+namespace krkrspeed {
+
+namespace {
+constexpr std::uint32_t kQ16 = 0x10000;
+constexpr std::size_t kQuickSeekStep = 4;             // coarse stride of the quick seek, refined +-(step-1)
+constexpr std::size_t kCompactFrames = 16384;         // consumed input kept before the FIFO is compacted
+
+std::size_t msToFrames(float ms, std::uint32_t sampleRate) {
+    return static_cast<std::size_t>(std::max(0.0f, ms) * static_cast<float>(sampleRate) / 1000.0f);
+}
+} // namespace
+
+IntWsola::IntWsola(std::uint32_t sampleRate, std::uint32_t channels)
+    : m_sampleRate(sampleRate), m_channels(std::max<std::uint32_t>(1, channels)) {
+    setParameters(35.0f, 10.0f, 25.0f, false);
+}
+
+void IntWsola::setParameters(float sequenceMs, float overlapMs, float seekWindowMs, bool quickSeek) {
+    const std::size_t overlap = std::max<std::size_t>(8, msToFrames(overlapMs, m_sampleRate));
+    const std::size_t sequence = std::max(overlap * 2, msToFrames(sequenceMs, m_sampleRate));
+    const std::size_t seek = std::max<std::size_t>(1, msToFrames(seekWindowMs, m_sampleRate));
+    if (overlap != m_overlap) {
+        m_haveTail = false; // cross-fade length changed; restart from the next segment
+    }
+    m_overlap = overlap;
+    m_sequence = sequence;
+    m_seek = seek;
+    m_quickSeek = quickSeek;
+    // Each pmaddwd pair is shifted before accumulation so one 32-bit lane never overflows.
+    const std::size_t pairsPerLane = m_overlap * m_channels / 8 + 1;
+    m_corrShift = 0;
+    while ((std::size_t{1} << m_corrShift) < pairsPerLane) {
+        ++m_corrShift;
+    }
+}
+
+void IntWsola::setRate(double rate) {
+    const double clamped = std::clamp(rate, 0.01, 4.0);
+    m_rateStep = static_cast<std::uint32_t>(std::lround(clamped * kQ16));
+}
+
+void IntWsola::prepareReference() {
+    // Parabolic window: the middle of the previous tail decides the match, its edges barely count.
+    const std::size_t n = m_overlap;
+    m_reference.resize(n * m_channels);
+    const std::int64_t denom = static_cast<std::int64_t>(n) * static_cast<std::int64_t>(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto w = static_cast<std::int32_t>(4 * static_cast<std::int64_t>(i) * static_cast<std::int64_t>(n - i) *
+                                                 32767 / denom);
+        for (std::uint32_t c = 0; c < m_channels; ++c) {
+            const std::size_t k = i * m_channels + c;
+            m_reference[k] = static_cast<std::int16_t>((static_cast<std::int32_t>(m_tail[k]) * w) >> 15);
+        }
+    }
+}
+
+std::int64_t IntWsola::correlate(const std::int16_t *candidate, std::int64_t &energy) const {
+    const std::size_t n = m_overlap * m_channels;
+    const std::int16_t *ref = m_reference.data();
+    std::int64_t corr = 0;
+    energy = 0;
+    std::size_t i = 0;
+#ifdef KRKR_DSP_SSE2
+    const __m128i shift = _mm_cvtsi32_si128(m_corrShift);
+    __m128i accCorr = _mm_setzero_si128();
+    __m128i accEnergy = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(candidate + i));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ref + i));
+        accCorr = _mm_add_epi32(accCorr, _mm_sra_epi32(_mm_madd_epi16(r, c), shift));
+        const __m128i half = _mm_srai_epi16(c, 1); // -32768^2 pairs would overflow pmaddwd
+        accEnergy = _mm_add_epi32(accEnergy, _mm_sra_epi32(_mm_madd_epi16(half, half), shift));
+    }
+    alignas(16) std::int32_t lanes[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), accCorr);
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes + 4), accEnergy);
+    corr = static_cast<std::int64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    energy = static_cast<std::int64_t>(lanes[4]) + lanes[5] + lanes[6] + lanes[7];
+#endif
+    // Same pairwise shifted sums as pmaddwd, so scalar and SSE2 builds pick identical offsets.
+    for (; i + 1 < n; i += 2) {
+        corr += (ref[i] * candidate[i] + ref[i + 1] * candidate[i + 1]) >> m_corrShift;
+        const int a = candidate[i] >> 1;
+        const int b = candidate[i + 1] >> 1;
+        energy += (a * a + b * b) >> m_corrShift;
+    }
+    if (i < n) {
+        corr += (ref[i] * candidate[i]) >> m_corrShift;
+        const int a = candidate[i] >> 1;
+        energy += (a * a) >> m_corrShift;
+    }
+    return corr;
+}
+
+std::size_t IntWsola::seekBestOffset(const std::int16_t *candidates) const {
+    double bestScore = -std::numeric_limits<double>::infinity();
+    std::size_t best = 0;
+    auto consider = [&](std::size_t offset) {
+        std::int64_t energy = 0;
+        const std::int64_t corr = correlate(candidates + offset * m_channels, energy);
+        const double score = static_cast<double>(corr) / std::sqrt(static_cast<double>(energy) + 1.0);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    };
+    if (!m_quickSeek) {
+        for (std::size_t offset = 0; offset < m_seek; ++offset) consider(offset);
+        return best;
+    }
+    for (std::size_t offset = 0; offset < m_seek; offset += kQuickSeekStep) consider(offset);
+    const std::size_t coarse = best;
+    const std::size_t lo = coarse >= kQuickSeekStep - 1 ? coarse - (kQuickSeekStep - 1) : 0;
+    const std::size_t hi = std::min(m_seek - 1, coarse + kQuickSeekStep - 1);
+    for (std::size_t offset = lo; offset <= hi; ++offset) {
+        if (offset != coarse) consider(offset);
+    }
+    return best;
+}
+
+void IntWsola::overlap(const std::int16_t *candidate, std::vector<std::int16_t> &out) const {
+    const std::size_t n = m_overlap;
+    const std::size_t base = out.size();
+    out.resize(base + n * m_channels);
+    std::int16_t *dst = out.data() + base;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::int32_t in = static_cast<std::int32_t>((static_cast<std::uint32_t>(i) << 15) / n); // Q15
+        const std::int32_t fade = 32768 - in;
+        for (std::uint32_t c = 0; c < m_channels; ++c) {
+            const std::size_t k = i * m_channels + c;
+            dst[k] = static_cast<std::int16_t>((m_tail[k] * fade + candidate[k] * in) >> 15);
+        }
+    }
+}
+
+void IntWsola::stretch(std::vector<std::int16_t> &out) {
+    const std::size_t body = m_sequence - m_overlap;
+    while (true) {
+        const double nominal = m_tempo * static_cast<double>(body) + m_skipFraction;
+        const auto skip = static_cast<std::size_t>(nominal);
+        if (queuedFrames() < std::max(m_sequence + m_seek, skip + 1)) {
+            break;
+        }
+        const std::int16_t *base = m_input.data() + m_inputPos * m_channels;
+        std::size_t offset = 0;
+        if (m_haveTail) {
+            offset = seekBestOffset(base);
+            overlap(base + offset * m_channels, out);
+            const std::int16_t *mid = base + (offset + m_overlap) * m_channels;
+            out.insert(out.end(), mid, mid + (body - m_overlap) * m_channels);
+        } else {
+            out.insert(out.end(), base, base + body * m_channels);
+        }
+        const std::int16_t *tail = base + (offset + body) * m_channels;
+        m_tail.assign(tail, tail + m_overlap * m_channels);
+        prepareReference();
+        m_haveTail = true;
+
+        m_skipFraction = nominal - static_cast<double>(skip);
+        m_inputPos += skip;
+    }
+    if (m_inputPos >= kCompactFrames) {
+        m_input.erase(m_input.begin(), m_input.begin() + static_cast<std::ptrdiff_t>(m_inputPos * m_channels));
+        m_inputPos = 0;
+    }
+}
+
+void IntWsola::transpose(const std::int16_t *input, std::size_t frames, std::vector<std::int16_t> &out) {
+    if (frames == 0) return;
+    if (m_rateLast.size() != m_channels) {
+        m_rateLast.assign(input, input + m_channels);
+        m_ratePhase = 0;
+    }
+    // Position is Q16 over [m_rateLast, input[0], ..., input[frames - 1]].
+    auto at = [&](std::size_t idx, std::uint32_t c) -> std::int32_t {
+        return idx == 0 ? m_rateLast[c] : input[(idx - 1) * m_channels + c];
+    };
+    std::uint64_t pos = m_ratePhase;
+    while ((pos >> 16) + 1 <= frames) {
+        const auto idx = static_cast<std::size_t>(pos >> 16);
+        const auto frac = static_cast<std::int32_t>(pos & 0xFFFF);
+        for (std::uint32_t c = 0; c < m_channels; ++c) {
+            const std::int32_t a = at(idx, c);
+            const std::int32_t b = at(idx + 1, c);
+            out.push_back(static_cast<std::int16_t>(a + (((b - a) * (frac >> 1)) >> 15)));
+        }
+        pos += m_rateStep;
+    }
+    m_ratePhase = static_cast<std::uint32_t>(pos - (static_cast<std::uint64_t>(frames) << 16));
+    std::copy(input + (frames - 1) * m_channels, input + frames * m_channels, m_rateLast.begin());
+}
+
+std::size_t IntWsola::latencyFrames() const {
+    return m_sequence + m_seek; // the first segment is the bank
+}
+
+std::size_t IntWsola::bufferedFrames() const {
+    const double banked = static_cast<double>(m_ready.size() / m_channels) / outputPerInput();
+    return queuedFrames() + static_cast<std::size_t>(banked);
+}
+
+void IntWsola::produce(std::vector<std::int16_t> &out) {
+    if (m_rateStep == kQ16) {
+        stretch(out);
+        return;
+    }
+    m_stretched.clear();
+    stretch(m_stretched);
+    transpose(m_stretched.data(), m_stretched.size() / m_channels, out);
+}
+
+void IntWsola::process(const std::int16_t *input, std::size_t frames, std::vector<std::int16_t> &out) {
+    if (frames > 0) {
+        m_input.insert(m_input.end(), input, input + frames * m_channels);
+    }
+    produce(m_ready);
+    const std::size_t ready = m_ready.size() / m_channels;
+    if (!m_paced) {
+        const double bank = static_cast<double>(m_sequence - m_overlap) * static_cast<double>(kQ16) / m_rateStep;
+        if (static_cast<double>(ready) < bank) {
+            return;
+        }
+        // What is banked now becomes latency; release from the next call on so a whole segment stays
+        // in reserve for the calls that do not complete one.
+        m_paced = true;
+        m_due = 0.0;
+        return;
+    }
+    m_due += static_cast<double>(frames) * outputPerInput();
+    const std::size_t take = std::min(ready, static_cast<std::size_t>(m_due));
+    m_due -= static_cast<double>(take);
+    out.insert(out.end(), m_ready.begin(), m_ready.begin() + static_cast<std::ptrdiff_t>(take * m_channels));
+    m_ready.erase(m_ready.begin(), m_ready.begin() + static_cast<std::ptrdiff_t>(take * m_channels));
+}
+
+void IntWsola::finish(std::vector<std::int16_t> &out) {
+    out.insert(out.end(), m_ready.begin(), m_ready.end());
+    const std::size_t pending = queuedFrames();
+    if (pending > 0 || m_haveTail) {
+        // Push the tail out with silence, then keep only what the pending input is worth.
+        const double due = static_cast<double>(pending) / m_tempo + (m_haveTail ? static_cast<double>(m_overlap) : 0.0);
+        m_input.resize(m_input.size() + (m_sequence + m_seek) * m_channels, 0);
+        m_stretched.clear();
+        stretch(m_stretched);
+        const std::size_t keep = std::min(m_stretched.size() / m_channels, static_cast<std::size_t>(due));
+        m_stretched.resize(keep * m_channels);
+        if (m_rateStep == kQ16) {
+            out.insert(out.end(), m_stretched.begin(), m_stretched.end());
+        } else {
+            transpose(m_stretched.data(), keep, out);
+        }
+    }
+    clear();
+}
+
+void IntWsola::clear() {
+    m_input.clear();
+    m_inputPos = 0;
+    m_skipFraction = 0.0;
+    m_tail.clear();
+    m_reference.clear();
+    m_haveTail = false;
+    m_stretched.clear();
+    m_rateLast.clear();
+    m_ratePhase = 0;
+    m_ready.clear();
+    m_due = 0.0;
+    m_paced = false;
+}
+
+std::size_t IntWsola::memoryFootprint() const {
+    return sizeof(*this) + (m_input.capacity() + m_tail.capacity() + m_reference.capacity() + m_stretched.capacity() +
+                            m_rateLast.capacity() + m_ready.capacity()) *
+                               sizeof(std::int16_t);
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace krkrspeed {
+
+// WSOLA time-stretch that stays on int16 samples end to end: fixed-point cross-fades and an integer
+// (SSE2 pmaddwd where available) correlation search. Used by DspPipeline for 16-bit PCM when
+// DspConfig::integerPath is set, so weak 32-bit machines skip the int16 <-> float round trip and
+// SoundTouch's float WSOLA. Pitch changes are done as stretch + fixed-point linear resample.
+class IntWsola {
+public:
+    IntWsola(std::uint32_t sampleRate, std::uint32_t channels);
+
+    void setParameters(float sequenceMs, float overlapMs, float seekWindowMs, bool quickSeek);
+    // Output/input duration is 1 / (tempo * rate); pitch scales by `rate` (1.0 = unchanged).
+    void setTempo(double tempo) { m_tempo = tempo > 0.01 ? tempo : 0.01; }
+    void setRate(double rate);
+
+    // Append input frames and emit output. WSOLA produces a whole segment every few small calls, so
+    // output is paced: one segment is banked first, then every call releases what its input is worth
+    // (callers treat an empty pitch-mode result as "pass the input through").
+    void process(const std::int16_t *input, std::size_t frames, std::vector<std::int16_t> &out);
+    // Emit the buffered tail (input too short for another segment) and reset.
+    void finish(std::vector<std::int16_t> &out);
+    void clear();
+
+    // Input frames needed before the first output is released.
+    std::size_t latencyFrames() const;
+    // Input frames whose output has not been returned yet (queued input plus banked output).
+    std::size_t bufferedFrames() const;
+    std::size_t memoryFootprint() const;
+
+private:
+    std::size_t queuedFrames() const { return m_input.size() / m_channels - m_inputPos; }
+    double outputPerInput() const { return static_cast<double>(0x10000) / (m_tempo * m_rateStep); }
+    void produce(std::vector<std::int16_t> &out);
+    void stretch(std::vector<std::int16_t> &out);
+    void prepareReference();
+    std::size_t seekBestOffset(const std::int16_t *candidates) const;
+    std::int64_t correlate(const std::int16_t *candidate, std::int64_t &energy) const;
+    void overlap(const std::int16_t *candidate, std::vector<std::int16_t> &out) const;
+    void transpose(const std::int16_t *input, std::size_t frames, std::vector<std::int16_t> &out);
+
+    std::uint32_t m_sampleRate;
+    std::uint32_t m_channels;
+    std::size_t m_sequence = 0; // frames per segment
+    std::size_t m_overlap = 0;  // cross-fade frames
+    std::size_t m_seek = 0;     // search range in frames
+    bool m_quickSeek = false;
+    int m_corrShift = 0;        // right shift applied per pmaddwd pair so sums stay within 32 bits
+    double m_tempo = 1.0;
+    std::uint32_t m_rateStep = 0x10000; // resample step in Q16 (0x10000 = no resampling)
+
+    std::vector<std::int16_t> m_input;     // interleaved input FIFO, consumed from m_inputPos
+    std::size_t m_inputPos = 0;
+    double m_skipFraction = 0.0;
+    std::vector<std::int16_t> m_tail;      // last m_overlap frames of the previous segment
+    std::vector<std::int16_t> m_reference; // m_tail weighted by the correlation window
+    bool m_haveTail = false;
+
+    std::vector<std::int16_t> m_stretched; // stretch output awaiting the resampler
+    std::vector<std::int16_t> m_rateLast;  // previous frame for interpolation across calls
+    std::uint32_t m_ratePhase = 0;         // Q16 position relative to m_rateLast
+
+    std::vector<std::int16_t> m_ready;     // paced output not yet released
+    double m_due = 0.0;                    // output frames owed to callers since pacing started
+    bool m_paced = false;                  // one segment is banked; releasing by input
+};
+
+} // namespace krkrspeed
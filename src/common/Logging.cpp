@@ -1,5 +1,6 @@
 #include "Logging.h"
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
@@ -228,6 +229,10 @@ void SetLoggingEnabled(bool enabled) {
     s.enabled = enabled;
 }
 
+std::wstring GetLogDirectory() {
+    return chooseLogDirectory().wstring();
+}
+
 void SetLogDirectory(const std::wstring &path) {
     auto &s = state();
     if (path.empty()) {
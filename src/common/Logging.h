@@ -6,6 +6,9 @@ namespace krkrspeed {
 
 enum class LogLevel { Debug, Info, Warn, Error };
 
+// Directory the log file is (or would be) written to; other per-install files sit next to it.
+std::wstring GetLogDirectory();
+
 #ifndef KRKR_ENABLE_LOGGING
 #define KRKR_ENABLE_LOGGING 1
 #endif
@@ -0,0 +1,261 @@
+#include "PrerenderPack.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "RenderRecord.h"
+#include "XxHash64.h"
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr std::uint32_t kPackMagic = 0x4B50524Bu; // "KRPK"
+constexpr std::uint32_t kPackVersion = 2; // 2: keys hash the whole first buffer
+constexpr std::uint32_t kMaxEntries = 1u << 24;
+
+struct PackHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t reserved;
+    std::uint64_t indexOffset;
+    std::uint64_t indexHash; // xxh64 of the index
+};
+static_assert(sizeof(PackHeader) == 32, "pack header layout");
+
+struct PackEntry {
+    std::uint64_t keyDigest;
+    std::uint64_t offset;
+    std::uint32_t recordBytes;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(PackEntry) == 24, "pack index layout");
+
+} // namespace
+
+PrerenderPack::PrerenderPack(LoadedFn onLoaded) : m_onLoaded(std::move(onLoaded)) {}
+
+PrerenderPack::~PrerenderPack() { close(); }
+
+bool PrerenderPack::open(const std::filesystem::path &path, std::string &error) {
+    close();
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open pre-render pack";
+        return false;
+    }
+    PackHeader header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != kPackMagic) {
+        error = "not a pre-render pack";
+        return false;
+    }
+    if (header.version != kPackVersion || header.entryCount > kMaxEntries) {
+        error = "unsupported pre-render pack version";
+        return false;
+    }
+    std::vector<PackEntry> packed(header.entryCount);
+    in.seekg(static_cast<std::streamoff>(header.indexOffset));
+    if (!in.read(reinterpret_cast<char *>(packed.data()),
+                 static_cast<std::streamsize>(packed.size() * sizeof(PackEntry))) ||
+        xxh64(packed.data(), packed.size() * sizeof(PackEntry)) != header.indexHash) {
+        error = "pre-render pack index is damaged";
+        return false;
+    }
+    std::vector<Entry> index;
+    index.reserve(packed.size());
+    for (const auto &entry : packed) {
+        if (entry.offset + entry.recordBytes > header.indexOffset) {
+            error = "pre-render pack index is damaged";
+            return false;
+        }
+        index.push_back(Entry{entry.keyDigest, entry.offset, entry.recordBytes});
+    }
+    // The writer sorts; don't rely on it for the binary search.
+    std::sort(index.begin(), index.end(), [](const Entry &a, const Entry &b) { return a.keyDigest < b.keyDigest; });
+
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_file = std::move(in);
+    }
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_index = std::move(index);
+    m_stop = false;
+    m_worker = std::thread([this]() { workerLoop(); });
+    return true;
+}
+
+void PrerenderPack::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.clear();
+        m_index.clear();
+        m_busy = false;
+    }
+    m_idle.notify_all();
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    m_file.close();
+}
+
+std::size_t PrerenderPack::entries() const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_index.size();
+}
+
+bool PrerenderPack::indexed(std::uint64_t digest) const {
+    const auto it = std::lower_bound(m_index.begin(), m_index.end(), digest,
+                                     [](const Entry &e, std::uint64_t d) { return e.keyDigest < d; });
+    return it != m_index.end() && it->keyDigest == digest;
+}
+
+void PrerenderPack::requestAsync(const VoiceRenderKey &key) {
+    // Audio threads never wait: a contended or full queue drops the request. Keys the pack does not hold
+    // are answered from the in-memory index without waking the worker.
+    std::unique_lock<std::mutex> lock(m_queueMutex, std::try_to_lock);
+    if (!lock.owns_lock() || m_stop || m_queue.size() >= kMaxQueued || !indexed(renderRecordDigest(key))) {
+        return;
+    }
+    if (std::find(m_queue.begin(), m_queue.end(), key) != m_queue.end()) {
+        return;
+    }
+    m_queue.push_back(key);
+    lock.unlock();
+    m_wake.notify_one();
+}
+
+void PrerenderPack::drain() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    m_idle.wait(lock, [this]() { return (m_queue.empty() && !m_busy) || m_stop; });
+}
+
+void PrerenderPack::workerLoop() {
+    while (true) {
+        VoiceRenderKey key;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_busy = false;
+            if (m_queue.empty()) {
+                m_idle.notify_all();
+            }
+            m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_stop) {
+                return;
+            }
+            key = m_queue.front();
+            m_queue.pop_front();
+            m_busy = true;
+        }
+        if (auto render = load(key); render && m_onLoaded) {
+            m_onLoaded(key, std::move(render));
+        }
+    }
+}
+
+std::shared_ptr<VoiceRender> PrerenderPack::load(const VoiceRenderKey &key) {
+    const std::uint64_t digest = renderRecordDigest(key);
+    std::vector<Entry> candidates;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        auto it = std::lower_bound(m_index.begin(), m_index.end(), digest,
+                                   [](const Entry &e, std::uint64_t d) { return e.keyDigest < d; });
+        for (; it != m_index.end() && it->keyDigest == digest; ++it) {
+            candidates.push_back(*it);
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    for (const auto &entry : candidates) {
+        std::vector<std::uint8_t> record(entry.recordBytes);
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(entry.offset));
+        if (!m_file.read(reinterpret_cast<char *>(record.data()), static_cast<std::streamsize>(record.size()))) {
+            continue;
+        }
+        if (auto render = decodeRenderRecord(record.data(), record.size(), key)) {
+            return render;
+        }
+    }
+    return nullptr;
+}
+
+bool PrerenderPackWriter::open(const std::filesystem::path &path, std::string &error) {
+    m_path = path;
+    m_tempPath = path;
+    m_tempPath += ".tmp";
+    m_entries.clear();
+    m_digests.clear();
+    m_out.open(m_tempPath, std::ios::binary | std::ios::trunc);
+    if (!m_out) {
+        error = "cannot create " + m_tempPath.string();
+        return false;
+    }
+    const PackHeader placeholder{};
+    m_out.write(reinterpret_cast<const char *>(&placeholder), sizeof(placeholder));
+    m_offset = sizeof(placeholder);
+    return static_cast<bool>(m_out);
+}
+
+bool PrerenderPackWriter::add(const VoiceRenderKey &key, const VoiceRender &render, std::string &error) {
+    if (render.steps.empty()) {
+        return true;
+    }
+    const std::uint64_t digest = renderRecordDigest(key);
+    if (m_digests.count(digest)) {
+        return true;
+    }
+    if (m_entries.size() >= kMaxEntries) {
+        error = "too many pre-render entries";
+        return false;
+    }
+    const auto record = encodeRenderRecord(key, render);
+    m_out.write(reinterpret_cast<const char *>(record.data()), static_cast<std::streamsize>(record.size()));
+    if (!m_out) {
+        error = "write failed: " + m_tempPath.string();
+        return false;
+    }
+    m_entries.push_back(Entry{digest, m_offset, static_cast<std::uint32_t>(record.size())});
+    m_digests.insert(digest);
+    m_offset += record.size();
+    return true;
+}
+
+bool PrerenderPackWriter::finish(std::string &error) {
+    std::sort(m_entries.begin(), m_entries.end(),
+              [](const Entry &a, const Entry &b) { return a.keyDigest < b.keyDigest; });
+    std::vector<PackEntry> packed;
+    packed.reserve(m_entries.size());
+    for (const auto &entry : m_entries) {
+        packed.push_back(PackEntry{entry.keyDigest, entry.offset, entry.recordBytes, 0});
+    }
+    PackHeader header{};
+    header.magic = kPackMagic;
+    header.version = kPackVersion;
+    header.entryCount = static_cast<std::uint32_t>(packed.size());
+    header.indexOffset = m_offset;
+    header.indexHash = xxh64(packed.data(), packed.size() * sizeof(PackEntry));
+    m_out.write(reinterpret_cast<const char *>(packed.data()),
+                static_cast<std::streamsize>(packed.size() * sizeof(PackEntry)));
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_out.close();
+    if (!m_out) {
+        error = "write failed: " + m_tempPath.string();
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(m_tempPath, m_path, ec);
+    if (ec) {
+        error = "cannot replace " + m_path.string() + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "VoiceRenderCache.h"
+
+namespace krkrspeed {
+
+inline constexpr const wchar_t *kPrerenderPackFileName = L"krkr_prerender.pack";
+
+// Read-only pack of voice lines rendered offline (krkr_xp3_prerender), in the same record format as
+// DiskRenderCache and keyed the same way, so a line the game plays with matching format, speed, DSP config
+// and buffer size replays from the pack instead of running the DSP.
+//
+// File: header, records, then an index of (key digest, offset, length) sorted by digest. open() reads the
+// header and the index only; records are read by one worker thread when a memory-cache miss probes a key
+// the index holds, and handed to `onLoaded`.
+class PrerenderPack : public VoiceRenderStore {
+public:
+    using LoadedFn = std::function<void(const VoiceRenderKey &, std::shared_ptr<const VoiceRender>)>;
+
+    explicit PrerenderPack(LoadedFn onLoaded);
+    ~PrerenderPack() override;
+
+    PrerenderPack(const PrerenderPack &) = delete;
+    PrerenderPack &operator=(const PrerenderPack &) = delete;
+
+    bool open(const std::filesystem::path &path, std::string &error);
+    void close();
+    std::size_t entries() const;
+
+    void requestAsync(const VoiceRenderKey &key) override;
+    void storeAsync(const VoiceRenderKey &, std::shared_ptr<const VoiceRender>) override {}
+    void drain();
+
+    // Synchronous read, used by the worker and the tools.
+    std::shared_ptr<VoiceRender> load(const VoiceRenderKey &key);
+
+private:
+    struct Entry {
+        std::uint64_t keyDigest = 0;
+        std::uint64_t offset = 0;
+        std::uint32_t recordBytes = 0;
+    };
+
+    bool indexed(std::uint64_t digest) const;
+    void workerLoop();
+
+    static constexpr std::size_t kMaxQueued = 64;
+
+    LoadedFn m_onLoaded;
+    std::vector<Entry> m_index; // sorted by keyDigest; written only while the worker is stopped
+    std::mutex m_ioMutex;       // guards m_file
+    std::ifstream m_file;
+    mutable std::mutex m_queueMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<VoiceRenderKey> m_queue;
+    bool m_busy = false;
+    bool m_stop = true;
+    std::thread m_worker;
+};
+
+// Builds a pack: records are streamed to a temporary file next to `path`, which replaces `path` on finish().
+class PrerenderPackWriter {
+public:
+    bool open(const std::filesystem::path &path, std::string &error);
+    // A key already in the pack is skipped.
+    bool add(const VoiceRenderKey &key, const VoiceRender &render, std::string &error);
+    bool finish(std::string &error);
+
+    std::size_t entries() const { return m_entries.size(); }
+    std::uint64_t bytes() const { return m_offset; }
+
+private:
+    struct Entry {
+        std::uint64_t keyDigest = 0;
+        std::uint64_t offset = 0;
+        std::uint32_t recordBytes = 0;
+    };
+
+    std::filesystem::path m_path;
+    std::filesystem::path m_tempPath;
+    std::ofstream m_out;
+    std::vector<Entry> m_entries;
+    std::unordered_set<std::uint64_t> m_digests;
+    std::uint64_t m_offset = 0;
+};
+
+} // namespace krkrspeed
@@ -0,0 +1,78 @@
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace krkrspeed {
+
+namespace {
+// A tier that fails again soon after being recovered doubles the quiet stretch needed next time.
+constexpr std::uint32_t kMaxRecoverBackoff = 16;
+} // namespace
+
+QualityGovernor::QualityGovernor(const QualityConfig &config, Clock clock)
+    : m_config(config), m_clock(std::move(clock)) {}
+
+std::chrono::steady_clock::time_point QualityGovernor::now() const {
+    return m_clock ? m_clock() : std::chrono::steady_clock::now();
+}
+
+QualityTier QualityGovernor::record(std::chrono::steady_clock::time_point start, double playbackSec) {
+    if (playbackSec <= 0.0) {
+        return m_tier;
+    }
+    const double spent = std::chrono::duration<double>(now() - start).count();
+    const double load = std::max(0.0, spent) / playbackSec;
+    m_load = m_haveLoad ? m_load + (load - m_load) * m_config.smoothing : load;
+    m_haveLoad = true;
+    if (m_cooldown > 0) {
+        --m_cooldown;
+    }
+    if (m_sinceStepUp < UINT32_MAX) {
+        ++m_sinceStepUp;
+    }
+    const std::uint32_t recoverCalls = m_config.recoverCalls * m_backoff;
+    if (m_sinceStepUp >= recoverCalls * 2) {
+        m_backoff = 1; // the recovered tier has held
+    }
+
+    const auto level = static_cast<std::uint32_t>(m_tier);
+    const auto lowest = static_cast<std::uint32_t>(QualityTier::RateOnly);
+    const bool overrun = load >= m_config.overrunLoad;
+    if (level < lowest && (overrun || (m_cooldown == 0 && m_load >= m_config.degradeLoad))) {
+        if (m_sinceStepUp < recoverCalls) {
+            m_backoff = std::min(m_backoff * 2, kMaxRecoverBackoff);
+        }
+        m_tier = static_cast<QualityTier>(level + 1);
+        m_cooldown = m_config.cooldownCalls;
+        m_quietCalls = 0;
+        // The cheaper tier's cost is unknown; let it build its own average.
+        m_haveLoad = false;
+        return m_tier;
+    }
+
+    if (m_load <= m_config.recoverLoad && !overrun) {
+        if (++m_quietCalls >= recoverCalls && level > 0) {
+            m_tier = static_cast<QualityTier>(level - 1);
+            m_cooldown = m_config.cooldownCalls;
+            m_quietCalls = 0;
+            m_sinceStepUp = 0;
+            m_haveLoad = false;
+        }
+    } else {
+        m_quietCalls = 0;
+    }
+    return m_tier;
+}
+
+void QualityGovernor::reset() {
+    m_tier = QualityTier::Full;
+    m_load = 0.0;
+    m_haveLoad = false;
+    m_cooldown = 0;
+    m_quietCalls = 0;
+    m_sinceStepUp = UINT32_MAX;
+    m_backoff = 1;
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "DspPipeline.h"
+
+namespace krkrspeed {
+
+struct QualityConfig {
+    float degradeLoad = 0.5f;       // smoothed DSP time / playback time that steps one tier down
+    float overrunLoad = 1.0f;       // a single call this slow steps down immediately (it would underrun)
+    float recoverLoad = 0.15f;      // smoothed load below which a tier may step back up...
+    std::uint32_t recoverCalls = 200; // ...once it has stayed there for this many calls
+    std::uint32_t cooldownCalls = 16; // calls after a step before the next step down is considered
+    float smoothing = 0.2f;         // EMA weight of the newest call
+};
+
+// Per-stream deadline tracking: each DSP call is timed against the playback duration of the audio it
+// produced. A stream whose DSP keeps eating a large share of that duration (or blows through it once)
+// steps down QualityTier by one; it steps back up only after a long quiet stretch, and a tier that
+// fails again right after recovering waits twice as long next time, so tiers do not flap. The clock
+// is injectable so the policy can be driven deterministically.
+class QualityGovernor {
+public:
+    using Clock = std::function<std::chrono::steady_clock::time_point()>;
+
+    explicit QualityGovernor(const QualityConfig &config = {}, Clock clock = {});
+
+    std::chrono::steady_clock::time_point now() const;
+
+    // One DSP call that started at `start` (from now()) and covers `playbackSec` of output.
+    // Returns the tier to use from the next call on.
+    QualityTier record(std::chrono::steady_clock::time_point start, double playbackSec);
+
+    QualityTier tier() const { return m_tier; }
+    float load() const { return static_cast<float>(m_load); } // smoothed DSP time / playback time
+    void reset();
+
+private:
+    QualityConfig m_config;
+    Clock m_clock;
+    QualityTier m_tier = QualityTier::Full;
+    double m_load = 0.0;
+    bool m_haveLoad = false;
+    std::uint32_t m_cooldown = 0;
+    std::uint32_t m_quietCalls = 0;
+    std::uint32_t m_sinceStepUp = UINT32_MAX; // calls since the last step up
+    std::uint32_t m_backoff = 1;              // multiplier on recoverCalls
+};
+
+} // namespace krkrspeed
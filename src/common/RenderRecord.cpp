@@ -0,0 +1,169 @@
+#include "RenderRecord.h"
+
+#include <cstring>
+
+#include "XxHash64.h"
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr std::uint32_t kRecordMagic = 0x5243524Bu; // "KRCR"
+
+// Everything VoiceRenderKey holds, with floats as their bit patterns.
+struct PackedKey {
+    std::uint64_t headHash;
+    std::uint32_t firstBytes;
+    std::uint32_t sampleRate;
+    std::uint32_t channels;
+    std::uint32_t blockAlign;
+    std::uint32_t speed;
+    std::uint32_t sequenceMs;
+    std::uint32_t overlapMs;
+    std::uint32_t seekWindowMs;
+    std::uint32_t aaFilterLength;
+    std::uint32_t flags;
+    std::uint32_t tier;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(PackedKey) == 56, "packed key layout");
+
+struct RecordHeader {
+    std::uint32_t magic;
+    std::uint32_t recordBytes;
+    std::uint64_t keyDigest;
+    std::uint64_t payloadHash; // xxh64 of everything after the header
+    std::uint32_t stepCount;
+    std::uint32_t outputBytes;
+    PackedKey key;
+};
+static_assert(sizeof(RecordHeader) == 88, "record header layout");
+
+struct PackedStep {
+    std::uint64_t inputHash;
+    std::uint32_t inputBytes;
+    std::uint32_t outputOffset;
+    std::uint32_t outputBytes;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(PackedStep) == 24, "record step layout");
+
+std::uint32_t floatBits(float value) {
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(std::uint32_t bits) {
+    float value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+PackedKey packKey(const VoiceRenderKey &key) {
+    PackedKey packed{};
+    packed.headHash = key.headHash;
+    packed.firstBytes = key.firstBytes;
+    packed.sampleRate = key.sampleRate;
+    packed.channels = key.channels;
+    packed.blockAlign = key.blockAlign;
+    packed.speed = floatBits(key.speed);
+    packed.sequenceMs = floatBits(key.config.sequenceMs);
+    packed.overlapMs = floatBits(key.config.overlapMs);
+    packed.seekWindowMs = floatBits(key.config.seekWindowMs);
+    packed.aaFilterLength = key.config.aaFilterLength;
+    packed.flags = (key.config.voiceGate ? 1u : 0u) | (key.config.quickSeek ? 2u : 0u) |
+                   (key.config.antiAlias ? 4u : 0u) | (key.config.integerPath ? 8u : 0u);
+    packed.tier = static_cast<std::uint32_t>(key.tier);
+    return packed;
+}
+
+VoiceRenderKey unpackKey(const PackedKey &packed) {
+    VoiceRenderKey key;
+    key.headHash = packed.headHash;
+    key.firstBytes = packed.firstBytes;
+    key.sampleRate = packed.sampleRate;
+    key.channels = packed.channels;
+    key.blockAlign = packed.blockAlign;
+    key.speed = bitsFloat(packed.speed);
+    key.config.sequenceMs = bitsFloat(packed.sequenceMs);
+    key.config.overlapMs = bitsFloat(packed.overlapMs);
+    key.config.seekWindowMs = bitsFloat(packed.seekWindowMs);
+    key.config.aaFilterLength = packed.aaFilterLength;
+    key.config.voiceGate = (packed.flags & 1u) != 0;
+    key.config.quickSeek = (packed.flags & 2u) != 0;
+    key.config.antiAlias = (packed.flags & 4u) != 0;
+    key.config.integerPath = (packed.flags & 8u) != 0;
+    key.tier = static_cast<QualityTier>(packed.tier);
+    return key;
+}
+
+std::uint64_t packedDigest(const PackedKey &packed) {
+    const std::uint64_t digest = xxh64(&packed, sizeof(packed));
+    return digest ? digest : 1;
+}
+
+} // namespace
+
+std::uint64_t renderRecordDigest(const VoiceRenderKey &key) { return packedDigest(packKey(key)); }
+
+std::vector<std::uint8_t> encodeRenderRecord(const VoiceRenderKey &key, const VoiceRender &render) {
+    const std::size_t payloadBytes = render.steps.size() * sizeof(PackedStep) + render.output.size();
+    const std::size_t recordBytes = (sizeof(RecordHeader) + payloadBytes + 7) & ~std::size_t{7};
+    std::vector<std::uint8_t> record(recordBytes, 0);
+
+    RecordHeader header{};
+    header.magic = kRecordMagic;
+    header.recordBytes = static_cast<std::uint32_t>(recordBytes);
+    header.key = packKey(key);
+    header.keyDigest = packedDigest(header.key);
+    header.stepCount = static_cast<std::uint32_t>(render.steps.size());
+    header.outputBytes = static_cast<std::uint32_t>(render.output.size());
+    std::uint8_t *payload = record.data() + sizeof(RecordHeader);
+    for (std::size_t s = 0; s < render.steps.size(); ++s) {
+        const auto &src = render.steps[s];
+        const PackedStep step{src.inputHash, src.inputBytes, src.outputOffset, src.outputBytes, 0};
+        std::memcpy(payload + s * sizeof(PackedStep), &step, sizeof(step));
+    }
+    if (!render.output.empty()) {
+        std::memcpy(payload + render.steps.size() * sizeof(PackedStep), render.output.data(), render.output.size());
+    }
+    header.payloadHash = xxh64(payload, recordBytes - sizeof(RecordHeader));
+    std::memcpy(record.data(), &header, sizeof(header));
+    return record;
+}
+
+std::shared_ptr<VoiceRender> decodeRenderRecord(const std::uint8_t *record, std::size_t bytes,
+                                                const VoiceRenderKey &key) {
+    if (!record || bytes < sizeof(RecordHeader)) {
+        return nullptr;
+    }
+    RecordHeader header{};
+    std::memcpy(&header, record, sizeof(header));
+    const std::size_t payloadBytes = bytes - sizeof(RecordHeader);
+    const std::uint64_t used = static_cast<std::uint64_t>(header.stepCount) * sizeof(PackedStep) + header.outputBytes;
+    if (header.magic != kRecordMagic || header.recordBytes != bytes || header.stepCount == 0 || used > payloadBytes ||
+        header.keyDigest != renderRecordDigest(key) || !(unpackKey(header.key) == key)) {
+        return nullptr;
+    }
+    const std::uint8_t *payload = record + sizeof(RecordHeader);
+    if (xxh64(payload, payloadBytes) != header.payloadHash) {
+        return nullptr;
+    }
+
+    auto render = std::make_shared<VoiceRender>();
+    render->steps.resize(header.stepCount);
+    for (std::uint32_t s = 0; s < header.stepCount; ++s) {
+        PackedStep step{};
+        std::memcpy(&step, payload + static_cast<std::size_t>(s) * sizeof(PackedStep), sizeof(step));
+        if (static_cast<std::uint64_t>(step.outputOffset) + step.outputBytes > header.outputBytes) {
+            return nullptr;
+        }
+        render->steps[s] = VoiceRender::Step{step.inputHash, step.inputBytes, step.outputOffset, step.outputBytes};
+    }
+    const std::uint8_t *output = payload + static_cast<std::size_t>(header.stepCount) * sizeof(PackedStep);
+    render->output.assign(output, output + header.outputBytes);
+    return render;
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "VoiceRenderCache.h"
+
+namespace krkrspeed {
+
+// On-disk form of one VoiceRender, shared by DiskRenderCache and PrerenderPack: a fixed header carrying the
+// full key and an XXH64 of the payload, then the steps and the output. Records are padded to 8 bytes.
+
+// Digest of the whole key (content hash and every processing parameter); never 0.
+std::uint64_t renderRecordDigest(const VoiceRenderKey &key);
+
+std::vector<std::uint8_t> encodeRenderRecord(const VoiceRenderKey &key, const VoiceRender &render);
+
+// Null unless `record` is an intact record for exactly `key`.
+std::shared_ptr<VoiceRender> decodeRenderRecord(const std::uint8_t *record, std::size_t bytes,
+                                                const VoiceRenderKey &key);
+
+} // namespace krkrspeed
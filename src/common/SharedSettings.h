@@ -14,6 +14,8 @@ struct SharedSettings {
     std::uint32_t processAllAudio = 0;
     float bgmSecondsGate = 60.0f;
     std::uint32_t stereoBgmMode = 1; // 0=aggressive,1=hybrid(default),2=none
+    std::uint32_t dspPreset = 0;     // DspPreset: 0=balanced(default),1=low-power,2=quality
+    std::uint32_t version = 0;       // bumped by the controller on every write
 };
 
 inline std::wstring BuildSharedSettingsName(std::uint32_t pid) {
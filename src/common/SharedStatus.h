@@ -14,6 +14,20 @@ enum class AudioBackend : std::uint32_t {
 struct SharedStatus {
     std::uint32_t activeBackend = 0;
     std::uint64_t lastUpdateMs = 0;
+    // WASAPI drop mode (FrameRateController), refreshed at most every 250 ms.
+    std::int64_t wasapiDriftFrames = 0;      // ideal minus released frames
+    std::int32_t wasapiCorrectionFrames = 0; // last release relative to nominal
+    std::uint32_t wasapiSampleRate = 0;
+    // DSP cost tier (QualityTier: 0 full, 1 quick seek, 2 rate only): worst across streams over the
+    // last second, with that stream's smoothed DSP time / playback time.
+    std::uint32_t dspQualityTier = 0;
+    float dspLoad = 0.0f;
+    // VoiceRenderCache (DirectSound voice lines replayed without the DSP), refreshed at most every 250 ms.
+    std::uint64_t renderCacheHits = 0;
+    std::uint64_t renderCacheMisses = 0;
+    std::uint64_t renderCacheBytesSaved = 0;
+    std::uint64_t renderCacheBytes = 0;
+    std::uint32_t renderCacheEntries = 0;
 };
 
 inline std::wstring BuildSharedStatusName(std::uint32_t pid) {
@@ -0,0 +1,237 @@
+#include "SpeechMusicClassifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KRKR_CLASSIFIER_SSE2 1
+#endif
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr float kInvPcm16 = 1.0f / 32768.0f;
+constexpr float kInvPcm32 = 1.0f / 2147483648.0f;
+constexpr float kActiveEnergy = 1e-5f; // -50 dBFS RMS, the isVoiceActive floor
+constexpr float kFloorEnergy = 1e-6f;  // level envelope floor, -60 dB
+constexpr float kTiny = 1e-12f;
+constexpr std::size_t kMinActiveFrames = 5;
+// One-pole smoothers on the 50 Hz frame envelope; their difference is a 2-8 Hz band-pass.
+constexpr float kFastAlpha = 0.63f; // ~8 Hz
+constexpr float kSlowAlpha = 0.22f; // ~2 Hz
+// Score = weighted log distances of each feature from its speech/music boundary. Fitted on the
+// synthetic clips of krkr_content_classifier_bench; flux is weighted low because percussion makes it
+// noisy, and pauses weigh most because sustained music almost never drops below the activity floor.
+constexpr float kModulationMid = 8.0f; // dB^2
+constexpr float kModulationWeight = 0.5f;
+constexpr float kZcrVarianceMid = 1e-4f;
+constexpr float kZcrVarianceWeight = 0.25f;
+constexpr float kFluxMid = 1.4f; // dB
+constexpr float kFluxWeight = 0.25f;
+constexpr float kPauseWeight = 6.0f;
+constexpr float kFlipMargin = 0.5f;
+
+struct FrameSums {
+    float energy = 0.0f;  // sum x^2
+    float diff1 = 0.0f;   // sum (x[n] - x[n-1])^2
+    float diff2 = 0.0f;   // sum of squared second differences
+    std::size_t crossings = 0;
+};
+
+void accumulateScalar(FrameSums &sums, const float *x, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+        const float d = x[i] - x[i - 1];
+        const float dd = d - (x[i - 1] - x[i - 2]);
+        sums.energy += x[i] * x[i];
+        sums.diff1 += d * d;
+        sums.diff2 += dd * dd;
+        if (std::signbit(x[i]) != std::signbit(x[i - 1])) ++sums.crossings;
+    }
+}
+
+FrameSums frameSums(const float *x, std::size_t n) {
+    FrameSums sums;
+    std::size_t i = 2;
+#ifdef KRKR_CLASSIFIER_SSE2
+    __m128 e = _mm_setzero_ps();
+    __m128 d1 = _mm_setzero_ps();
+    __m128 d2 = _mm_setzero_ps();
+    std::size_t crossings = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_loadu_ps(x + i);
+        const __m128 p1 = _mm_loadu_ps(x + i - 1);
+        const __m128 p2 = _mm_loadu_ps(x + i - 2);
+        const __m128 d = _mm_sub_ps(v, p1);
+        const __m128 dd = _mm_sub_ps(d, _mm_sub_ps(p1, p2));
+        e = _mm_add_ps(e, _mm_mul_ps(v, v));
+        d1 = _mm_add_ps(d1, _mm_mul_ps(d, d));
+        d2 = _mm_add_ps(d2, _mm_mul_ps(dd, dd));
+        const int signs = _mm_movemask_ps(_mm_xor_ps(v, p1));
+        crossings += static_cast<std::size_t>((signs & 1) + ((signs >> 1) & 1) + ((signs >> 2) & 1) + ((signs >> 3) & 1));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, e);
+    sums.energy = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_store_ps(lanes, d1);
+    sums.diff1 = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_store_ps(lanes, d2);
+    sums.diff2 = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    sums.crossings = crossings;
+#endif
+    accumulateScalar(sums, x, i, n);
+    return sums;
+}
+
+float toDb(float energy) { return 10.0f * std::log10(energy + kTiny); }
+
+template <typename T> float toUnit(T v);
+template <> float toUnit<std::int16_t>(std::int16_t v) { return static_cast<float>(v) * kInvPcm16; }
+template <> float toUnit<std::int32_t>(std::int32_t v) { return static_cast<float>(v) * kInvPcm32; }
+template <> float toUnit<float>(float v) { return std::isfinite(v) ? v : 0.0f; }
+
+} // namespace
+
+const char *audioContentName(AudioContent content) {
+    switch (content) {
+    case AudioContent::Speech: return "speech";
+    case AudioContent::Music: return "music";
+    default: return "unknown";
+    }
+}
+
+SpeechMusicClassifier::SpeechMusicClassifier(std::uint32_t sampleRate, std::uint32_t channels)
+    : m_channels(std::max<std::uint32_t>(1, channels)),
+      m_frameLength(std::max<std::size_t>(16, static_cast<std::size_t>(sampleRate) * kFrameMs / 1000)),
+      m_mono(m_frameLength) {}
+
+void SpeechMusicClassifier::reset() {
+    m_fill = 0;
+    m_pending = 0;
+    m_pendingSum = 0.0f;
+    m_frames = 0;
+    m_envFast = 0.0f;
+    m_envSlow = 0.0f;
+    m_flipRun = 0;
+    m_heldFrames = 0;
+    m_features = ContentFeatures{};
+    m_verdict = AudioContent::Unknown;
+}
+
+AudioContent SpeechMusicClassifier::feedPcm16(const std::int16_t *samples, std::size_t count) {
+    return feed(samples, count);
+}
+
+AudioContent SpeechMusicClassifier::feedPcm32(const std::int32_t *samples, std::size_t count) {
+    return feed(samples, count);
+}
+
+AudioContent SpeechMusicClassifier::feedFloat32(const float *samples, std::size_t count) {
+    return feed(samples, count);
+}
+
+template <typename T> AudioContent SpeechMusicClassifier::feed(const T *samples, std::size_t count) {
+    if (!samples) {
+        return m_verdict;
+    }
+    const float scale = 1.0f / static_cast<float>(m_channels);
+    for (std::size_t i = 0; i < count; ++i) {
+        m_pendingSum += toUnit<T>(samples[i]);
+        if (++m_pending < m_channels) {
+            continue;
+        }
+        m_mono[m_fill++] = m_pendingSum * scale;
+        m_pending = 0;
+        m_pendingSum = 0.0f;
+        if (m_fill == m_frameLength) {
+            analyzeFrame();
+            m_fill = 0;
+        }
+    }
+    return m_verdict;
+}
+
+void SpeechMusicClassifier::analyzeFrame() {
+    const FrameSums sums = frameSums(m_mono.data(), m_frameLength);
+    const float n = static_cast<float>(m_frameLength - 2);
+    const float energy = sums.energy / n;
+    Frame frame;
+    frame.active = energy > kActiveEnergy;
+    if (m_frames == 0 && !frame.active) {
+        return; // leading silence: the decision window starts at the first audible frame
+    }
+    frame.levelDb = toDb(std::max(energy, kFloorEnergy));
+    frame.tilt1 = toDb(sums.diff1 / n) - toDb(energy);
+    frame.tilt2 = toDb(sums.diff2 / n) - toDb(sums.diff1 / n);
+    frame.zcr = static_cast<float>(sums.crossings) / n;
+    if (m_frames == 0) {
+        m_envFast = m_envSlow = frame.levelDb;
+    }
+    m_envFast += kFastAlpha * (frame.levelDb - m_envFast);
+    m_envSlow += kSlowAlpha * (frame.levelDb - m_envSlow);
+    frame.band = m_envFast - m_envSlow;
+    m_ring[m_frames % kWindowFrames] = frame;
+    ++m_frames;
+    if (m_frames >= kWindowFrames) {
+        decide();
+    }
+}
+
+void SpeechMusicClassifier::decide() {
+    float modulation = 0.0f;
+    float zcrSum = 0.0f;
+    float zcrSquares = 0.0f;
+    float flux = 0.0f;
+    std::size_t active = 0;
+    std::size_t fluxPairs = 0;
+    const Frame *previous = nullptr;
+    // Oldest to newest.
+    for (std::size_t k = 0; k < kWindowFrames; ++k) {
+        const Frame &f = m_ring[(m_frames + k) % kWindowFrames];
+        modulation += f.band * f.band;
+        if (f.active) {
+            ++active;
+            zcrSum += f.zcr;
+            zcrSquares += f.zcr * f.zcr;
+            if (previous && previous->active) {
+                flux += std::fabs(f.tilt1 - previous->tilt1) + std::fabs(f.tilt2 - previous->tilt2);
+                ++fluxPairs;
+            }
+        }
+        previous = &f;
+    }
+    ContentFeatures features;
+    features.modulation = modulation / static_cast<float>(kWindowFrames);
+    features.pauseRatio = static_cast<float>(kWindowFrames - active) / static_cast<float>(kWindowFrames);
+    if (active >= kMinActiveFrames) {
+        const float mean = zcrSum / static_cast<float>(active);
+        features.zcrVariance = std::max(0.0f, zcrSquares / static_cast<float>(active) - mean * mean);
+    }
+    features.flux = fluxPairs ? flux / static_cast<float>(fluxPairs) : 0.0f;
+    // Log-ratio distance of each feature from its boundary value; pauses only ever add to the speech side.
+    features.score = kModulationWeight * std::log2((features.modulation + 0.1f) / kModulationMid) +
+                     kZcrVarianceWeight * std::log2((features.zcrVariance + 1e-6f) / kZcrVarianceMid) +
+                     kFluxWeight * std::log2((features.flux + 0.01f) / kFluxMid) +
+                     kPauseWeight * features.pauseRatio;
+    m_features = features;
+
+    if (active < kMinActiveFrames) {
+        return; // too little audible signal to judge; keep whatever was decided
+    }
+    const AudioContent lean = features.score > 0.0f ? AudioContent::Speech : AudioContent::Music;
+    if (m_verdict == AudioContent::Unknown) {
+        m_verdict = lean;
+        return;
+    }
+    const bool across = m_verdict == AudioContent::Speech ? features.score < -kFlipMargin
+                                                           : features.score > kFlipMargin;
+    m_flipRun = across ? m_flipRun + 1 : 0;
+    m_heldFrames = across ? 0 : std::min(m_heldFrames + 1, kSettleFrames);
+    if (m_flipRun >= kFlipFrames) {
+        m_verdict = m_verdict == AudioContent::Speech ? AudioContent::Music : AudioContent::Speech;
+        m_flipRun = 0;
+    }
+}
+
+} // namespace krkrspeed
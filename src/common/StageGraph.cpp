@@ -0,0 +1,212 @@
+#include "StageGraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace krkrspeed {
+
+std::size_t sampleBytes(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Pcm16:
+        return sizeof(std::int16_t);
+    case SampleFormat::Pcm32:
+        return sizeof(std::int32_t);
+    case SampleFormat::Float32:
+        return sizeof(float);
+    }
+    return 0;
+}
+
+const char *sampleFormatName(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Pcm16:
+        return "pcm16";
+    case SampleFormat::Pcm32:
+        return "pcm32";
+    case SampleFormat::Float32:
+        return "float32";
+    }
+    return "?";
+}
+
+StageGraph &StageGraph::add(std::unique_ptr<Stage> stage) {
+    if (stage) {
+        m_stages.push_back(std::move(stage));
+        m_compiled = false;
+    }
+    return *this;
+}
+
+bool StageGraph::compile(const StreamFormat &input, std::size_t maxFrames, std::string &error) {
+    m_compiled = false;
+    m_nodes.clear();
+    if (input.channels == 0 || input.sampleRate == 0 || maxFrames == 0) {
+        error = "Invalid stage graph input format";
+        return false;
+    }
+
+    StreamFormat format = input;
+    std::size_t frames = maxFrames;
+    std::size_t scratchFrames = 0;
+    std::size_t scratchFrameBytes = 0;
+    for (const auto &stage : m_stages) {
+        if (!stage->accepts(format)) {
+            error = std::string("Stage '") + stage->name() + "' does not accept " + sampleFormatName(format.sample) +
+                    " x" + std::to_string(format.channels) + " @" + std::to_string(format.sampleRate);
+            return false;
+        }
+        if (stage->isIdentity(format)) {
+            continue;
+        }
+        Node node;
+        node.stage = stage.get();
+        node.in = format;
+        node.out = stage->outputFormat(format);
+        node.timing.name = stage->name();
+        m_nodes.push_back(node);
+        frames = stage->maxOutputFrames(format, frames);
+        scratchFrames = std::max(scratchFrames, frames);
+        scratchFrameBytes = std::max(scratchFrameBytes, node.out.frameBytes());
+        format = node.out;
+    }
+    m_input = input;
+    m_output = format;
+    m_maxFrames = maxFrames;
+
+    // Storage: once every remaining stage can work in place, write straight into the destination;
+    // before that, alternate between the two scratch buffers. The source is never written, except
+    // through the destination when the caller passes the same buffer for both.
+    bool useA = false;
+    bool useB = false;
+    Slot current = Slot::Src;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        auto &node = m_nodes[i];
+        node.inSlot = current;
+        const StageIo io = node.stage->io(node.in);
+        if (io == StageIo::Observe) {
+            node.outSlot = current;
+            continue;
+        }
+        bool tailInPlace = node.out.frameBytes() <= m_output.frameBytes();
+        for (std::size_t j = i + 1; j < m_nodes.size() && tailInPlace; ++j) {
+            tailInPlace = m_nodes[j].stage->io(m_nodes[j].in) != StageIo::Separate;
+        }
+        if (tailInPlace && (io == StageIo::InPlace || (current != Slot::Src && current != Slot::Dst))) {
+            node.outSlot = Slot::Dst;
+        } else if (io == StageIo::InPlace && (current == Slot::ScratchA || current == Slot::ScratchB)) {
+            node.outSlot = current;
+        } else {
+            node.outSlot = current == Slot::ScratchA ? Slot::ScratchB : Slot::ScratchA;
+        }
+        useA = useA || node.outSlot == Slot::ScratchA;
+        useB = useB || node.outSlot == Slot::ScratchB;
+        current = node.outSlot;
+    }
+
+    m_scratchFrames = scratchFrames;
+    const std::size_t scratchBytes = scratchFrames * scratchFrameBytes;
+    m_scratchA.assign(useA ? scratchBytes : 0, 0);
+    m_scratchB.assign(useB ? scratchBytes : 0, 0);
+    m_scratchA.shrink_to_fit();
+    m_scratchB.shrink_to_fit();
+    m_compiled = true;
+    return true;
+}
+
+std::size_t StageGraph::run(const void *src, std::size_t frames, void *dst, std::size_t dstFrames,
+                            StageContext &ctx) {
+    if (!m_compiled || !src || !dst) {
+        return 0;
+    }
+    frames = std::min(frames, m_maxFrames);
+    const std::size_t dstBytes = dstFrames * m_output.frameBytes();
+    auto slotData = [&](Slot slot) -> std::uint8_t * {
+        switch (slot) {
+        case Slot::Src:
+            return static_cast<std::uint8_t *>(const_cast<void *>(src));
+        case Slot::Dst:
+            return static_cast<std::uint8_t *>(dst);
+        case Slot::ScratchA:
+            return m_scratchA.data();
+        case Slot::ScratchB:
+            return m_scratchB.data();
+        }
+        return nullptr;
+    };
+    auto slotBytes = [&](Slot slot) -> std::size_t {
+        switch (slot) {
+        case Slot::Src:
+            return frames * m_input.frameBytes();
+        case Slot::Dst:
+            return dstBytes;
+        case Slot::ScratchA:
+            return m_scratchA.size();
+        case Slot::ScratchB:
+            return m_scratchB.size();
+        }
+        return 0;
+    };
+
+    Slot current = Slot::Src;
+    for (auto &node : m_nodes) {
+        AudioSpan in{slotData(node.inSlot), frames, node.in};
+        AudioSpan out{slotData(node.outSlot), slotBytes(node.outSlot) / node.out.frameBytes(), node.out};
+        const auto start = Clock::now();
+        frames = std::min(node.stage->process(in, out, ctx), out.frames);
+        const auto ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        ++node.timing.calls;
+        node.timing.totalNs += ns;
+        node.timing.maxNs = std::max(node.timing.maxNs, ns);
+        current = node.outSlot;
+    }
+
+    if (current != Slot::Dst) {
+        frames = std::min(frames, dstFrames);
+        const auto *from = slotData(current);
+        if (from != dst) {
+            std::memmove(dst, from, frames * m_output.frameBytes());
+        }
+    }
+    return frames;
+}
+
+void StageGraph::reset() {
+    for (const auto &stage : m_stages) {
+        stage->reset();
+    }
+}
+
+std::vector<StageTiming> StageGraph::timings() const {
+    std::vector<StageTiming> out;
+    out.reserve(m_nodes.size());
+    for (const auto &node : m_nodes) {
+        out.push_back(node.timing);
+    }
+    return out;
+}
+
+std::string StageGraph::timingSummary() const {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    bool first = true;
+    for (const auto &node : m_nodes) {
+        const auto &t = node.timing;
+        const double avgUs = t.calls ? static_cast<double>(t.totalNs) / static_cast<double>(t.calls) / 1000.0 : 0.0;
+        out << (first ? "" : " ") << t.name << "=" << static_cast<std::uint64_t>(avgUs + 0.5) << "/"
+            << (t.maxNs + 500) / 1000 << "us";
+        first = false;
+    }
+    return out.str();
+}
+
+void StageGraph::resetTimings() {
+    for (auto &node : m_nodes) {
+        node.timing.calls = 0;
+        node.timing.totalNs = 0;
+        node.timing.maxNs = 0;
+    }
+}
+
+} // namespace krkrspeed
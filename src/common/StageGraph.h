@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace krkrspeed {
+
+enum class SampleFormat : std::uint32_t { Pcm16, Pcm32, Float32 };
+
+std::size_t sampleBytes(SampleFormat format);
+const char *sampleFormatName(SampleFormat format);
+
+struct StreamFormat {
+    SampleFormat sample = SampleFormat::Pcm16;
+    std::uint32_t channels = 0;
+    std::uint32_t sampleRate = 0;
+
+    std::size_t frameBytes() const { return sampleBytes(sample) * channels; }
+};
+
+inline bool operator==(const StreamFormat &a, const StreamFormat &b) {
+    return a.sample == b.sample && a.channels == b.channels && a.sampleRate == b.sampleRate;
+}
+inline bool operator!=(const StreamFormat &a, const StreamFormat &b) { return !(a == b); }
+
+// Non-owning view of interleaved frames. For a stage's output, `frames` is the capacity.
+struct AudioSpan {
+    void *data = nullptr;
+    std::size_t frames = 0;
+    StreamFormat format;
+
+    template <typename T> T *as() const { return static_cast<T *>(data); }
+    std::size_t bytes() const { return frames * format.frameBytes(); }
+};
+
+// Per-call parameters and results shared by the stages of one run.
+struct StageContext {
+    float speed = 1.0f;
+    std::size_t targetFrames = 0; // frames the caller wants out (stretch, fit-to-size)
+    std::uintptr_t key = 0;       // stream key for logging
+    // Filled in by stages.
+    float peak = 0.0f;
+    bool silent = false;
+    bool voiced = true;
+    std::size_t backlogBytes = 0; // stretch: processed audio still queued in the stream
+};
+
+// How a stage uses its buffers; the graph assigns storage accordingly.
+enum class StageIo {
+    Observe,  // reads only; its output is its input
+    InPlace,  // may write over its input (reads everything it needs first)
+    Separate  // needs output storage distinct from its input
+};
+
+class Stage {
+public:
+    virtual ~Stage() = default;
+
+    virtual const char *name() const = 0;
+    virtual StageIo io(const StreamFormat &in) const = 0;
+    virtual bool accepts(const StreamFormat &in) const = 0;
+    virtual StreamFormat outputFormat(const StreamFormat &in) const { return in; }
+    // Stages that would not change `in` (a conversion to the same format) are dropped at compile time.
+    virtual bool isIdentity(const StreamFormat &in) const { (void)in; return false; }
+    virtual std::size_t maxOutputFrames(const StreamFormat &in, std::size_t inFrames) const {
+        (void)in;
+        return inFrames;
+    }
+
+    // Returns frames written to `out` (at most out.frames). Observe stages get out.data == in.data.
+    virtual std::size_t process(const AudioSpan &in, const AudioSpan &out, StageContext &ctx) = 0;
+    virtual void reset() {}
+};
+
+struct StageTiming {
+    const char *name = "";
+    std::uint64_t calls = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+};
+
+// A fixed chain of stages compiled once per stream format. compile() checks every stage accepts the
+// format the previous one produces, drops identity stages and sizes two scratch buffers for the
+// largest call, so run() allocates nothing: buffers move between stages as spans, and the last
+// stages write straight into the caller's destination (which may alias the source).
+class StageGraph {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StageGraph &add(std::unique_ptr<Stage> stage);
+    template <typename S, typename... Args> StageGraph &emplace(Args &&...args) {
+        return add(std::make_unique<S>(std::forward<Args>(args)...));
+    }
+
+    bool compile(const StreamFormat &input, std::size_t maxFrames, std::string &error);
+    bool compiled() const { return m_compiled; }
+    const StreamFormat &inputFormat() const { return m_input; }
+    const StreamFormat &outputFormat() const { return m_output; }
+    std::size_t maxFrames() const { return m_maxFrames; }
+    // Scratch storage compile() reserved; 0 when every stage writes into the destination.
+    std::size_t scratchBytes() const { return m_scratchA.size() + m_scratchB.size(); }
+
+    // Runs `frames` input frames (at most maxFrames()) from `src` into `dst`, which holds `dstFrames`
+    // frames of outputFormat(). Returns the frames written to `dst`; 0 when not compiled.
+    std::size_t run(const void *src, std::size_t frames, void *dst, std::size_t dstFrames, StageContext &ctx);
+    void reset();
+
+    std::vector<StageTiming> timings() const;
+    std::string timingSummary() const;
+    void resetTimings();
+
+private:
+    enum class Slot : std::uint8_t { Src, Dst, ScratchA, ScratchB };
+
+    struct Node {
+        Stage *stage = nullptr;
+        StreamFormat in;
+        StreamFormat out;
+        Slot inSlot = Slot::Src;
+        Slot outSlot = Slot::Src;
+        StageTiming timing;
+    };
+
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    std::vector<Node> m_nodes;
+    StreamFormat m_input;
+    StreamFormat m_output;
+    std::size_t m_maxFrames = 0;
+    std::size_t m_scratchFrames = 0;
+    std::vector<std::uint8_t> m_scratchA;
+    std::vector<std::uint8_t> m_scratchB;
+    bool m_compiled = false;
+};
+
+} // namespace krkrspeed
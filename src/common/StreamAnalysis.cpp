@@ -0,0 +1,457 @@
+#include "StreamAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KRKR_ANALYSIS_SSE2 1
+#endif
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr float kInvPcm16 = 1.0f / 32768.0f;
+constexpr float kInvPcm32 = 1.0f / 2147483648.0f;
+// Vector iterations between folding lane accumulators into the 64-bit/double totals; keeps the
+// 16-bit counters and float sums well inside their range/precision.
+constexpr std::size_t kFoldIterations = 1024;
+
+constexpr double kVoicedRms = 0.00316;    // -50 dBFS
+constexpr double kFricativeRms = 0.00079; // -62 dBFS
+constexpr double kFricativeZcr = 0.3;
+
+// Format guessing. A float reading is taken when nearly every word is a finite value within +-2; one with
+// a word beyond 8.0 or 5% NaN/Inf cannot be float audio, and the integer readings decide. An integer
+// reading needs a mean level above 100 LSB at 16 bits and some smooth steps to count as audio at all.
+constexpr double kFloatWithin2Pct = 90.0;
+constexpr double kFloatMaxPeak = 2.5;
+constexpr double kNotFloatPeak = 8.0;
+constexpr double kNotFloatNanInfPct = 5.0;
+constexpr double kPcmMinMeanAbs = 100.0 / 32768.0;
+constexpr double kPcmMinSmoothPct = 12.0;
+constexpr double kPcm32SmoothGapPct = 25.0;
+
+enum class Format { Pcm16, Pcm32, Float32 };
+
+template <Format F, typename T> float toUnit(T v) {
+    if constexpr (F == Format::Pcm16) {
+        return static_cast<float>(v) * kInvPcm16;
+    } else if constexpr (F == Format::Pcm32) {
+        return static_cast<float>(v) * kInvPcm32;
+    } else {
+        return v;
+    }
+}
+
+template <typename T> bool signBit(T v) {
+    if constexpr (std::is_same_v<T, float>) {
+        return std::signbit(v);
+    } else {
+        return v < 0;
+    }
+}
+
+// Reference implementation; also handles the head (no previous frame) and tail of the SIMD paths.
+template <Format F, typename T>
+void accumulateScalar(StreamStats &st, const T *s, std::size_t begin, std::size_t end, std::size_t channels) {
+    for (std::size_t i = begin; i < end; ++i) {
+        const T raw = s[i];
+        bool finite = true;
+        if constexpr (F == Format::Float32) {
+            std::uint32_t bits = 0;
+            std::memcpy(&bits, &raw, sizeof(bits));
+            const std::uint32_t exp = (bits >> 23) & 0xFFu;
+            if (exp == 0xFFu) {
+                ++st.nanInf;
+                finite = false;
+            } else if (exp == 0) {
+                ++st.denormal;
+            }
+        }
+        const float v = toUnit<F>(raw);
+        if (finite) {
+            const float av = std::fabs(v);
+            ++st.finite;
+            st.peak = std::max(st.peak, av);
+            st.sumAbs += av;
+            st.sumSquares += static_cast<double>(av) * av;
+            if (av <= 2.0f) ++st.within2;
+        }
+        if (i >= channels) {
+            const T prevRaw = s[i - channels];
+            ++st.pairs;
+            if (std::fabs(v - toUnit<F>(prevRaw)) < StreamStats::kSmoothStep) ++st.smooth;
+            if (signBit(raw) != signBit(prevRaw)) ++st.zeroCrossings;
+        }
+    }
+}
+
+#ifdef KRKR_ANALYSIS_SSE2
+std::uint32_t sumLanes32(__m128i v) {
+    alignas(16) std::uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+std::uint64_t sumLanes64(__m128i v) {
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+    return lanes[0] + lanes[1];
+}
+
+std::uint32_t sumLanes16(__m128i v) {
+    return sumLanes32(_mm_madd_epi16(v, _mm_set1_epi16(1)));
+}
+
+float maxLanes(__m128 v) {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, v);
+    return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+double sumLanesPs(__m128 v) {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, v);
+    return static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Returns the first sample index not consumed.
+std::size_t accumulatePcm16Sse2(StreamStats &st, const std::int16_t *s, std::size_t count, std::size_t channels) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i smoothStep = _mm_set1_epi16(2000);
+    __m128i hi = zero;
+    __m128i lo = zero;
+    std::size_t i = channels;
+    while (i + 8 <= count) {
+        __m128i absSum = zero;   // 4 x int32, <= 2 * 32767 per iteration
+        __m128i sqSum = zero;    // 2 x uint64
+        __m128i smoothCnt = zero;
+        __m128i crossCnt = zero;
+        std::size_t iter = 0;
+        for (; iter < kFoldIterations && i + 8 <= count; ++iter, i += 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i - channels));
+            hi = _mm_max_epi16(hi, v);
+            lo = _mm_min_epi16(lo, v);
+            // |-32768| saturates to 32767 here; peak is tracked exactly through hi/lo.
+            const __m128i av = _mm_max_epi16(v, _mm_subs_epi16(zero, v));
+            absSum = _mm_add_epi32(absSum, _mm_madd_epi16(av, ones));
+            const __m128i sq = _mm_madd_epi16(v, v); // pairs of squares, fits uint32
+            sqSum = _mm_add_epi64(sqSum, _mm_unpacklo_epi32(sq, zero));
+            sqSum = _mm_add_epi64(sqSum, _mm_unpackhi_epi32(sq, zero));
+            const __m128i d = _mm_subs_epi16(v, p);
+            const __m128i ad = _mm_max_epi16(d, _mm_subs_epi16(zero, d));
+            smoothCnt = _mm_sub_epi16(smoothCnt, _mm_cmplt_epi16(ad, smoothStep));
+            crossCnt = _mm_sub_epi16(crossCnt, _mm_cmplt_epi16(_mm_xor_si128(v, p), zero));
+        }
+        st.sumAbs += static_cast<double>(sumLanes32(absSum)) * kInvPcm16;
+        st.sumSquares += static_cast<double>(sumLanes64(sqSum)) * kInvPcm16 * kInvPcm16;
+        st.smooth += sumLanes16(smoothCnt);
+        st.zeroCrossings += sumLanes16(crossCnt);
+        st.finite += iter * 8;
+        st.within2 += iter * 8;
+        st.pairs += iter * 8;
+    }
+    alignas(16) std::int16_t hiLanes[8];
+    alignas(16) std::int16_t loLanes[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(hiLanes), hi);
+    _mm_store_si128(reinterpret_cast<__m128i *>(loLanes), lo);
+    const int peak16 = std::max<int>(*std::max_element(hiLanes, hiLanes + 8), -*std::min_element(loLanes, loLanes + 8));
+    st.peak = std::max(st.peak, static_cast<float>(peak16) * kInvPcm16);
+    return i;
+}
+
+template <Format F, typename T>
+std::size_t accumulateFloatSse2(StreamStats &st, const T *s, std::size_t count, std::size_t channels) {
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 smoothStep = _mm_set1_ps(StreamStats::kSmoothStep);
+    const __m128 scale = _mm_set1_ps(F == Format::Pcm32 ? kInvPcm32 : 1.0f);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i expMax = _mm_set1_epi32(0xFF);
+    __m128 peak = _mm_setzero_ps();
+    auto toFloat = [&](__m128i raw) -> __m128 {
+        if constexpr (F == Format::Pcm32) {
+            return _mm_mul_ps(_mm_cvtepi32_ps(raw), scale);
+        } else {
+            return _mm_castsi128_ps(raw);
+        }
+    };
+    std::size_t i = channels;
+    while (i + 4 <= count) {
+        __m128 absSum = _mm_setzero_ps();
+        __m128 sqSum = _mm_setzero_ps();
+        __m128i finiteCnt = zero;
+        __m128i nanCnt = zero;
+        __m128i denCnt = zero;
+        __m128i withinCnt = zero;
+        __m128i smoothCnt = zero;
+        __m128i crossCnt = zero;
+        std::size_t iter = 0;
+        for (; iter < kFoldIterations && i + 4 <= count; ++iter, i += 4) {
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i - channels));
+            const __m128 v = toFloat(vb);
+            const __m128 p = toFloat(pb);
+            __m128 finite = _mm_castsi128_ps(_mm_cmpeq_epi32(zero, zero));
+            if constexpr (F == Format::Float32) {
+                const __m128i exp = _mm_and_si128(_mm_srli_epi32(vb, 23), expMax);
+                const __m128i nan = _mm_cmpeq_epi32(exp, expMax);
+                nanCnt = _mm_sub_epi32(nanCnt, nan);
+                denCnt = _mm_sub_epi32(denCnt, _mm_cmpeq_epi32(exp, zero));
+                finite = _mm_castsi128_ps(_mm_xor_si128(nan, _mm_cmpeq_epi32(zero, zero)));
+            }
+            const __m128 av = _mm_and_ps(_mm_and_ps(v, signMask), finite);
+            peak = _mm_max_ps(peak, av);
+            absSum = _mm_add_ps(absSum, av);
+            sqSum = _mm_add_ps(sqSum, _mm_mul_ps(av, av));
+            finiteCnt = _mm_sub_epi32(finiteCnt, _mm_castps_si128(finite));
+            withinCnt = _mm_sub_epi32(withinCnt, _mm_castps_si128(_mm_and_ps(_mm_cmple_ps(av, two), finite)));
+            const __m128 step = _mm_and_ps(_mm_sub_ps(v, p), signMask);
+            smoothCnt = _mm_sub_epi32(smoothCnt, _mm_castps_si128(_mm_cmplt_ps(step, smoothStep)));
+            crossCnt = _mm_sub_epi32(crossCnt, _mm_cmplt_epi32(_mm_xor_si128(vb, pb), zero));
+        }
+        st.sumAbs += sumLanesPs(absSum);
+        st.sumSquares += sumLanesPs(sqSum);
+        st.finite += sumLanes32(finiteCnt);
+        st.nanInf += sumLanes32(nanCnt);
+        st.denormal += sumLanes32(denCnt);
+        st.within2 += sumLanes32(withinCnt);
+        st.smooth += sumLanes32(smoothCnt);
+        st.zeroCrossings += sumLanes32(crossCnt);
+        st.pairs += iter * 4;
+    }
+    st.peak = std::max(st.peak, maxLanes(peak));
+    return i;
+}
+#endif
+
+template <Format F, typename T> StreamStats analyze(const T *s, std::size_t count, std::size_t channels) {
+    StreamStats st;
+    if (!s || count == 0) return st;
+    channels = std::max<std::size_t>(1, channels);
+    st.samples = count;
+    const std::size_t head = std::min(channels, count);
+    accumulateScalar<F>(st, s, 0, head, channels);
+    std::size_t next = head;
+#ifdef KRKR_ANALYSIS_SSE2
+    if (count > channels) {
+        if constexpr (F == Format::Pcm16) {
+            next = accumulatePcm16Sse2(st, s, count, channels);
+        } else {
+            next = accumulateFloatSse2<F>(st, s, count, channels);
+        }
+    }
+#endif
+    accumulateScalar<F>(st, s, next, count, channels);
+    return st;
+}
+
+// reachesLevel(): integer samples compare against a threshold in their own units; floats compare the bits of
+// |x|, which order like the values and put NaN/Inf above every finite level.
+constexpr std::size_t kLevelBlock = 64;
+
+std::int32_t levelThreshold(float level, double fullScale) {
+    const double t = std::ceil(static_cast<double>(std::max(level, 0.0f)) * fullScale);
+    return static_cast<std::int32_t>(std::clamp(t, 1.0, fullScale) - 1.0); // loud when |x| > this
+}
+
+template <typename T> bool exceedsScalar(const T *s, std::size_t begin, std::size_t end, std::int32_t limit) {
+    for (std::size_t i = begin; i < end; ++i) {
+        std::int32_t v = 0;
+        if constexpr (std::is_same_v<T, float>) {
+            std::uint32_t bits = 0;
+            std::memcpy(&bits, &s[i], sizeof(bits));
+            v = static_cast<std::int32_t>(bits & 0x7FFFFFFFu);
+        } else {
+            v = s[i];
+        }
+        if (v > limit || v < -limit) return true;
+    }
+    return false;
+}
+
+template <typename T> bool exceeds(const T *s, std::size_t count, std::int32_t limit) {
+    if (!s) return false;
+    std::size_t i = 0;
+#ifdef KRKR_ANALYSIS_SSE2
+    constexpr std::size_t kLanes = 16 / sizeof(T);
+    for (; i + kLevelBlock <= count; i += kLevelBlock) {
+        __m128i any = _mm_setzero_si128();
+        for (std::size_t j = 0; j < kLevelBlock; j += kLanes) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + j));
+            if constexpr (sizeof(T) == 2) {
+                const __m128i hi = _mm_set1_epi16(static_cast<short>(limit));
+                const __m128i lo = _mm_set1_epi16(static_cast<short>(-limit));
+                any = _mm_or_si128(any, _mm_or_si128(_mm_cmpgt_epi16(v, hi), _mm_cmplt_epi16(v, lo)));
+            } else {
+                if constexpr (std::is_same_v<T, float>) v = _mm_and_si128(v, _mm_set1_epi32(0x7FFFFFFF));
+                const __m128i hi = _mm_set1_epi32(limit);
+                const __m128i lo = _mm_set1_epi32(-limit);
+                any = _mm_or_si128(any, _mm_or_si128(_mm_cmpgt_epi32(v, hi), _mm_cmplt_epi32(v, lo)));
+            }
+        }
+        if (_mm_movemask_epi8(any) != 0) return true;
+    }
+#endif
+    return exceedsScalar(s, i, count, limit);
+}
+
+template <typename T> bool identicalChannels(const T *data, std::size_t frames, std::size_t channels) {
+    std::size_t frame = 0;
+#ifdef KRKR_ANALYSIS_SSE2
+    if (channels == 2) {
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+        const std::size_t framesPerVec = 16 / (2 * sizeof(T));
+        for (; frame + framesPerVec <= frames; frame += framesPerVec) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + frame * 2 * sizeof(T)));
+            __m128i eq;
+            if constexpr (sizeof(T) == 2) {
+                const __m128i swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+                eq = _mm_cmpeq_epi16(v, swapped);
+            } else {
+                static_assert(sizeof(T) == 4, "16-bit or 32-bit samples expected");
+                eq = _mm_cmpeq_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+            }
+            if (_mm_movemask_epi8(eq) != 0xFFFF) return false;
+        }
+    }
+#endif
+    for (; frame < frames; ++frame) {
+        const T *f = data + frame * channels;
+        for (std::size_t c = 1; c < channels; ++c) {
+            if (std::memcmp(&f[c], &f[0], sizeof(T)) != 0) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+double StreamStats::rms() const {
+    return finite ? std::sqrt(sumSquares / static_cast<double>(finite)) : 0.0;
+}
+
+bool isVoiceActive(const StreamStats &stats) {
+    const double rms = stats.rms();
+    return rms >= kVoicedRms || (rms >= kFricativeRms && stats.zeroCrossingRate() >= kFricativeZcr);
+}
+
+StreamStats analyzePcm16(const std::int16_t *samples, std::size_t count, std::size_t channels) {
+    return analyze<Format::Pcm16>(samples, count, channels);
+}
+
+StreamStats analyzePcm32(const std::int32_t *samples, std::size_t count, std::size_t channels) {
+    return analyze<Format::Pcm32>(samples, count, channels);
+}
+
+StreamStats analyzeFloat32(const float *samples, std::size_t count, std::size_t channels) {
+    return analyze<Format::Float32>(samples, count, channels);
+}
+
+bool reachesLevel(const std::int16_t *samples, std::size_t count, float level) {
+    return exceeds(samples, count, levelThreshold(level, 32768.0));
+}
+
+bool reachesLevel(const std::int32_t *samples, std::size_t count, float level) {
+    return exceeds(samples, count, levelThreshold(level, 2147483648.0));
+}
+
+bool reachesLevel(const float *samples, std::size_t count, float level) {
+    std::uint32_t bits = 0;
+    const float positive = std::max(level, 0.0f);
+    std::memcpy(&bits, &positive, sizeof(bits));
+    return exceeds(samples, count, static_cast<std::int32_t>(bits) - 1);
+}
+
+bool guessSampleFormat(const void *buffer, std::size_t bytes, std::size_t channels, SampleFormat &format) {
+    const std::size_t words = bytes / sizeof(float);
+    if (!buffer || channels == 0 || words < 4) return false;
+    const auto floats = analyzeFloat32(static_cast<const float *>(buffer), words, channels);
+    if (floats.finite == 0) return false;
+    // Essentially silent as float (zeros read as zeros in every layout): wait for real audio.
+    if (floats.meanAbs() < 1e-5 && floats.peak < 1e-4) return false;
+    const double nanInfPct = static_cast<double>(floats.nanInf) * 100.0 / static_cast<double>(floats.samples);
+    if (floats.within2Pct() >= kFloatWithin2Pct && nanInfPct < 1.0 && floats.peak <= kFloatMaxPeak) {
+        format = SampleFormat::Float32;
+        return true;
+    }
+    if (floats.peak <= kNotFloatPeak && nanInfPct < kNotFloatNanInfPct) return false;
+    const auto pcm16 = analyzePcm16(static_cast<const std::int16_t *>(buffer), words * 2, channels);
+    const auto pcm32 = analyzePcm32(static_cast<const std::int32_t *>(buffer), words, channels);
+    // Read at 16 bits, PCM32 interleaves its noisy low halves with the signal and loses about half its smooth
+    // steps; PCM16 read at 32 bits stays about as smooth as it is at 16, so only a large gap means PCM32.
+    const bool split = pcm32.smoothPct() - pcm16.smoothPct() >= kPcm32SmoothGapPct;
+    if (!split && pcm16.meanAbs() > kPcmMinMeanAbs && pcm16.smoothPct() > kPcmMinSmoothPct) {
+        format = SampleFormat::Pcm16;
+        return true;
+    }
+    if (split && pcm32.meanAbs() > kPcmMinMeanAbs) {
+        format = SampleFormat::Pcm32;
+        return true;
+    }
+    return false;
+}
+
+bool channelsIdentical(const std::int16_t *samples, std::size_t frames, std::size_t channels) {
+    return identicalChannels(samples, frames, channels);
+}
+
+bool channelsIdentical(const float *samples, std::size_t frames, std::size_t channels) {
+    return identicalChannels(samples, frames, channels);
+}
+
+std::uint32_t loudChannels(const std::int16_t *samples, std::size_t frames, std::size_t channels, int level) {
+    if (channels == 0 || channels > 32 || !samples) return 0;
+    const std::uint32_t all = channels == 32 ? 0xFFFFFFFFu : (1u << channels) - 1u;
+    const std::size_t count = frames * channels;
+    std::uint32_t loud = 0;
+    std::size_t i = 0;
+#ifdef KRKR_ANALYSIS_SSE2
+    // Lane l of vector p holds channel (p * 8 + l) % channels; the mapping repeats every `period` vectors.
+    const std::size_t period = channels / std::gcd(channels, std::size_t{8});
+    const std::size_t stride = period * 8;
+    if (count >= stride) {
+        constexpr std::size_t kFoldInterval = 32; // strides between early-exit checks after the first
+        __m128i acc[32];
+        for (std::size_t p = 0; p < period; ++p) acc[p] = _mm_setzero_si128();
+        const __m128i hi = _mm_set1_epi16(static_cast<short>(level));
+        const __m128i lo = _mm_set1_epi16(static_cast<short>(-level));
+        auto fold = [&]() {
+            for (std::size_t p = 0; p < period; ++p) {
+                const int bits = _mm_movemask_epi8(acc[p]);
+                for (std::size_t l = 0; l < 8; ++l) {
+                    if (bits & (3 << (2 * l))) loud |= 1u << ((p * 8 + l) % channels);
+                }
+            }
+        };
+        std::size_t sinceFold = kFoldInterval - 1; // check once after the first stride: busy mixes end there
+        for (; i + stride <= count; i += stride) {
+            for (std::size_t p = 0; p < period; ++p) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + p * 8));
+                acc[p] = _mm_or_si128(acc[p], _mm_or_si128(_mm_cmpgt_epi16(v, hi), _mm_cmplt_epi16(v, lo)));
+            }
+            if (++sinceFold == kFoldInterval) {
+                sinceFold = 0;
+                fold();
+                if (loud == all) return all;
+            }
+        }
+        fold();
+    }
+#endif
+    // i is a whole number of frames here.
+    for (; i < count && loud != all; ++i) {
+        const int v = samples[i];
+        if (v > level || v < -level) loud |= 1u << (i % channels);
+    }
+    return loud;
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "StageGraph.h"
+
+namespace krkrspeed {
+
+// One-pass statistics over an interleaved sample buffer. Levels are normalized to full scale = 1.0
+// regardless of the source format. Step-based measures (smoothness, zero crossings) compare each
+// sample with the previous sample of the same channel.
+struct StreamStats {
+    std::size_t samples = 0;
+    std::size_t finite = 0;        // samples that are not NaN/Inf (all of them for integer formats)
+    std::size_t nanInf = 0;        // float only
+    std::size_t denormal = 0;      // float only: exponent field 0, zeros included
+    std::size_t within2 = 0;       // finite samples with |x| <= 2.0
+    std::size_t pairs = 0;         // same-channel neighbour pairs examined
+    std::size_t smooth = 0;        // pairs whose step is below kSmoothStep
+    std::size_t zeroCrossings = 0; // pairs whose sign bit differs
+    float peak = 0.0f;             // max |x| over finite samples
+    double sumAbs = 0.0;
+    double sumSquares = 0.0;
+
+    // Step treated as "smooth" when guessing formats (2000 LSB at 16-bit).
+    static constexpr float kSmoothStep = 2000.0f / 32768.0f;
+
+    double meanAbs() const { return finite ? sumAbs / static_cast<double>(finite) : 0.0; }
+    double rms() const;
+    double zeroCrossingRate() const {
+        return pairs ? static_cast<double>(zeroCrossings) / static_cast<double>(pairs) : 0.0;
+    }
+    double smoothPct() const { return pairs ? static_cast<double>(smooth) * 100.0 / static_cast<double>(pairs) : 0.0; }
+    double within2Pct() const {
+        return finite ? static_cast<double>(within2) * 100.0 / static_cast<double>(finite) : 0.0;
+    }
+};
+
+// SSE2 kernels when available, scalar otherwise. `count` is in samples, `channels` >= 1.
+StreamStats analyzePcm16(const std::int16_t *samples, std::size_t count, std::size_t channels);
+StreamStats analyzePcm32(const std::int32_t *samples, std::size_t count, std::size_t channels);
+StreamStats analyzeFloat32(const float *samples, std::size_t count, std::size_t channels);
+
+// True when some sample's magnitude reaches `level` (full scale = 1.0; NaN/Inf count as loud). Stops at the
+// first 64-sample block that does, so an audible buffer costs a few vector compares where analyze*() reads
+// it all; the silence gates use this.
+bool reachesLevel(const std::int16_t *samples, std::size_t count, float level);
+bool reachesLevel(const std::int32_t *samples, std::size_t count, float level);
+bool reachesLevel(const float *samples, std::size_t count, float level);
+
+// Sample layout of a stream whose format is unknown, guessed from `bytes` of its interleaved audio (read as
+// PCM16, PCM32 and float32, so pass no more than frames x channels x 2 bytes, the size every candidate covers).
+// Float wins when the words read as normalized audio; otherwise PCM16 and PCM32 are told apart by which
+// reading is smoother sample-to-sample (the low half of a 32-bit sample reads as noise at 16 bits). Returns
+// false while the buffer is too quiet or ambiguous to decide.
+bool guessSampleFormat(const void *buffer, std::size_t bytes, std::size_t channels, SampleFormat &format);
+
+// Voice activity of one ~10 ms block: active above -50 dBFS RMS, or above -62 dBFS when the
+// zero-crossing rate looks like a fricative. Shared by the DspPipeline voice gate and VadStage.
+bool isVoiceActive(const StreamStats &stats);
+
+// Bit-exact check that every channel of every frame carries the same sample (compared as bit patterns, so
+// -0.0 and +0.0 differ). DspPipeline runs such buffers through its mono engine.
+bool channelsIdentical(const std::int16_t *samples, std::size_t frames, std::size_t channels);
+bool channelsIdentical(const float *samples, std::size_t frames, std::size_t channels);
+
+// Bit c set when channel c has a sample with |x| > level anywhere in the buffer (channels <= 32, else 0).
+// One SSE2 pass in memory order; stops early once every channel has shown signal.
+std::uint32_t loudChannels(const std::int16_t *samples, std::size_t frames, std::size_t channels, int level);
+
+} // namespace krkrspeed
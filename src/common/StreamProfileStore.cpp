@@ -0,0 +1,329 @@
+#include "StreamProfileStore.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#include "XxHash64.h"
+
+namespace krkrspeed {
+
+namespace {
+
+constexpr std::uint32_t kProfileMagic = 0x5053524Bu; // "KRSP"
+constexpr std::uint32_t kProfileVersion = 1;
+constexpr std::size_t kMaxFileBytes = 4u * 1024 * 1024;
+// A running mean over this many recent buffers.
+constexpr std::uint32_t kMeanWindow = 16;
+
+struct FileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t profileCount;
+    std::uint32_t observationCount;
+    std::uint64_t payloadHash; // xxh64 of everything after the header
+    std::uint64_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32, "stream profile header layout");
+
+struct FileProfile {
+    std::uint64_t exe;
+    std::uint64_t lastUsed;
+    std::uint16_t observationCount;
+    std::uint16_t flags; // bit 0: mono seen, bit 1: stereo seen
+    std::uint32_t reserved;
+};
+static_assert(sizeof(FileProfile) == 24, "stream profile record layout");
+
+struct FileObservation {
+    std::uint32_t sampleRate;
+    std::uint32_t bufferBytes;
+    std::uint16_t channels;
+    std::uint16_t bitsPerSample;
+    std::uint16_t voiceCount;
+    std::uint16_t bgmCount;
+    std::uint32_t meanLifetimeMs;
+    std::uint32_t meanPlayedMs;
+};
+static_assert(sizeof(FileObservation) == 24, "stream observation layout");
+
+constexpr std::uint16_t kFlagMono = 1;
+constexpr std::uint16_t kFlagStereo = 2;
+
+std::uint32_t updateMean(std::uint32_t mean, std::uint32_t sample, std::uint32_t count) {
+    const std::uint32_t n = std::min(count, kMeanWindow);
+    const auto delta = static_cast<std::int64_t>(sample) - static_cast<std::int64_t>(mean);
+    return static_cast<std::uint32_t>(static_cast<std::int64_t>(mean) + delta / static_cast<std::int64_t>(n));
+}
+
+template <typename T> void append(std::vector<std::uint8_t> &out, const T &value) {
+    const auto *p = reinterpret_cast<const std::uint8_t *>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+} // namespace
+
+const char *streamClassName(StreamClass cls) {
+    switch (cls) {
+    case StreamClass::Voice: return "voice";
+    case StreamClass::Bgm: return "bgm";
+    default: return "unknown";
+    }
+}
+
+void StreamProfile::record(const StreamSignature &signature, bool bgm, std::uint32_t lifetimeMs,
+                           std::uint32_t playedMs) {
+    auto it = std::find_if(m_observations.begin(), m_observations.end(),
+                           [&](const StreamObservation &o) { return o.signature == signature; });
+    if (it == m_observations.end()) {
+        if (m_observations.size() >= kMaxSignatures) {
+            // Forget the signature with the least evidence.
+            const auto weakest = std::min_element(
+                m_observations.begin(), m_observations.end(), [](const StreamObservation &a, const StreamObservation &b) {
+                    return a.voiceCount + a.bgmCount < b.voiceCount + b.bgmCount;
+                });
+            m_observations.erase(weakest);
+        }
+        StreamObservation fresh;
+        fresh.signature = signature;
+        fresh.meanLifetimeMs = lifetimeMs;
+        fresh.meanPlayedMs = playedMs;
+        m_observations.push_back(fresh);
+        it = std::prev(m_observations.end());
+    }
+    auto &o = *it;
+    (bgm ? o.bgmCount : o.voiceCount)++;
+    const std::uint32_t total = o.voiceCount + o.bgmCount;
+    o.meanLifetimeMs = updateMean(o.meanLifetimeMs, lifetimeMs, total);
+    o.meanPlayedMs = updateMean(o.meanPlayedMs, playedMs, total);
+    if (total > kMaxCount) {
+        o.voiceCount = (o.voiceCount + 1) / 2;
+        o.bgmCount = (o.bgmCount + 1) / 2;
+    }
+}
+
+StreamClass StreamProfile::classify(const StreamSignature &signature) const {
+    const StreamObservation *o = find(signature);
+    if (!o) {
+        return StreamClass::Unknown;
+    }
+    const std::uint32_t total = o->voiceCount + o->bgmCount;
+    if (total < kMinObservations) {
+        return StreamClass::Unknown;
+    }
+    // 90% agreement: a size the game uses for both kinds of stream stays with the runtime heuristics.
+    if (o->bgmCount * 10 >= total * 9) {
+        return StreamClass::Bgm;
+    }
+    if (o->voiceCount * 10 >= total * 9) {
+        return StreamClass::Voice;
+    }
+    return StreamClass::Unknown;
+}
+
+const StreamObservation *StreamProfile::find(const StreamSignature &signature) const {
+    for (const auto &o : m_observations) {
+        if (o.signature == signature) {
+            return &o;
+        }
+    }
+    return nullptr;
+}
+
+bool StreamProfile::noteChannels(std::uint32_t channels) {
+    bool &seen = channels == 1 ? m_seenMono : m_seenStereo;
+    if (channels == 0 || seen) {
+        return false;
+    }
+    seen = true;
+    return true;
+}
+
+std::uint64_t StreamProfileStore::executableDigest(const std::string &exePathUtf8) {
+    std::string folded(exePathUtf8);
+    std::transform(folded.begin(), folded.end(), folded.begin(), [](unsigned char c) {
+        return static_cast<char>(c < 0x80 ? std::tolower(c) : c);
+    });
+    std::replace(folded.begin(), folded.end(), '\\', '/');
+    return xxh64(folded.data(), folded.size());
+}
+
+bool StreamProfileStore::load(const std::filesystem::path &path, std::string &error) {
+    m_profiles.clear();
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return true;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path.u8string();
+        return false;
+    }
+    std::vector<std::uint8_t> bytes;
+    in.seekg(0, std::ios::end);
+    const auto size = static_cast<std::size_t>(std::max<std::streamoff>(0, in.tellg()));
+    if (size > kMaxFileBytes) {
+        error = "stream profile file too large";
+        return false;
+    }
+    bytes.resize(size);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+        error = "cannot read " + path.u8string();
+        return false;
+    }
+    return parse(bytes, error);
+}
+
+bool StreamProfileStore::save(const std::filesystem::path &path, std::string &error) const {
+    const auto bytes = serialize();
+    auto temp = path;
+    temp += ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        out.close();
+        if (!out) {
+            error = "cannot write " + temp.u8string();
+            std::error_code ignored;
+            std::filesystem::remove(temp, ignored);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        error = "cannot replace " + path.u8string() + ": " + ec.message();
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool StreamProfileStore::parse(const std::vector<std::uint8_t> &bytes, std::string &error) {
+    m_profiles.clear();
+    FileHeader header{};
+    if (bytes.size() < sizeof(header)) {
+        error = "stream profile file truncated";
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kProfileMagic || header.version != kProfileVersion) {
+        error = "not a stream profile file";
+        return false;
+    }
+    const std::size_t expected =
+        sizeof(FileHeader) + std::size_t{header.profileCount} * sizeof(FileProfile) +
+        std::size_t{header.observationCount} * sizeof(FileObservation);
+    if (header.profileCount > kMaxProfiles ||
+        header.observationCount > kMaxProfiles * StreamProfile::kMaxSignatures || bytes.size() != expected ||
+        xxh64(bytes.data() + sizeof(header), bytes.size() - sizeof(header)) != header.payloadHash) {
+        error = "stream profile file is damaged";
+        return false;
+    }
+    std::vector<Stored> profiles;
+    std::size_t pos = sizeof(header);
+    std::uint32_t observationsLeft = header.observationCount;
+    for (std::uint32_t i = 0; i < header.profileCount; ++i) {
+        FileProfile record{};
+        std::memcpy(&record, bytes.data() + pos, sizeof(record));
+        pos += sizeof(record);
+        if (record.observationCount > observationsLeft ||
+            record.observationCount > StreamProfile::kMaxSignatures) {
+            error = "stream profile file is damaged";
+            return false;
+        }
+        observationsLeft -= record.observationCount;
+        Stored stored;
+        stored.exe = record.exe;
+        stored.lastUsed = record.lastUsed;
+        stored.profile.m_seenMono = (record.flags & kFlagMono) != 0;
+        stored.profile.m_seenStereo = (record.flags & kFlagStereo) != 0;
+        for (std::uint16_t j = 0; j < record.observationCount; ++j) {
+            FileObservation packed{};
+            std::memcpy(&packed, bytes.data() + pos, sizeof(packed));
+            pos += sizeof(packed);
+            StreamObservation o;
+            o.signature.sampleRate = packed.sampleRate;
+            o.signature.bufferBytes = packed.bufferBytes;
+            o.signature.channels = packed.channels;
+            o.signature.bitsPerSample = packed.bitsPerSample;
+            o.voiceCount = packed.voiceCount;
+            o.bgmCount = packed.bgmCount;
+            o.meanLifetimeMs = packed.meanLifetimeMs;
+            o.meanPlayedMs = packed.meanPlayedMs;
+            stored.profile.m_observations.push_back(o);
+        }
+        profiles.push_back(std::move(stored));
+    }
+    if (observationsLeft != 0) {
+        error = "stream profile file is damaged";
+        return false;
+    }
+    m_profiles = std::move(profiles);
+    return true;
+}
+
+std::vector<std::uint8_t> StreamProfileStore::serialize() const {
+    std::vector<std::uint8_t> out(sizeof(FileHeader));
+    std::uint32_t observations = 0;
+    for (const auto &stored : m_profiles) {
+        const auto &profile = stored.profile;
+        FileProfile record{};
+        record.exe = stored.exe;
+        record.lastUsed = stored.lastUsed;
+        record.observationCount = static_cast<std::uint16_t>(profile.m_observations.size());
+        record.flags = static_cast<std::uint16_t>((profile.m_seenMono ? kFlagMono : 0) |
+                                                  (profile.m_seenStereo ? kFlagStereo : 0));
+        append(out, record);
+        for (const auto &o : profile.m_observations) {
+            FileObservation packed{};
+            packed.sampleRate = o.signature.sampleRate;
+            packed.bufferBytes = o.signature.bufferBytes;
+            packed.channels = o.signature.channels;
+            packed.bitsPerSample = o.signature.bitsPerSample;
+            packed.voiceCount = static_cast<std::uint16_t>(o.voiceCount);
+            packed.bgmCount = static_cast<std::uint16_t>(o.bgmCount);
+            packed.meanLifetimeMs = o.meanLifetimeMs;
+            packed.meanPlayedMs = o.meanPlayedMs;
+            append(out, packed);
+        }
+        observations += record.observationCount;
+    }
+    FileHeader header{};
+    header.magic = kProfileMagic;
+    header.version = kProfileVersion;
+    header.profileCount = static_cast<std::uint32_t>(m_profiles.size());
+    header.observationCount = observations;
+    header.payloadHash = xxh64(out.data() + sizeof(header), out.size() - sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+    return out;
+}
+
+StreamProfile StreamProfileStore::profile(std::uint64_t exe) const {
+    for (const auto &stored : m_profiles) {
+        if (stored.exe == exe) {
+            return stored.profile;
+        }
+    }
+    return {};
+}
+
+void StreamProfileStore::update(std::uint64_t exe, const StreamProfile &profile, std::uint64_t nowSeconds) {
+    auto it = std::find_if(m_profiles.begin(), m_profiles.end(), [&](const Stored &s) { return s.exe == exe; });
+    if (it == m_profiles.end()) {
+        if (m_profiles.size() >= kMaxProfiles) {
+            m_profiles.erase(std::min_element(m_profiles.begin(), m_profiles.end(),
+                                              [](const Stored &a, const Stored &b) { return a.lastUsed < b.lastUsed; }));
+        }
+        m_profiles.push_back(Stored{exe, 0, {}});
+        it = std::prev(m_profiles.end());
+    }
+    it->lastUsed = nowSeconds;
+    it->profile = profile;
+}
+
+} // namespace krkrspeed
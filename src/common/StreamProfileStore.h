@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace krkrspeed {
+
+// File the DirectSound hook keeps next to krkr_speed_config.yaml (the controller directory).
+inline constexpr const wchar_t *kStreamProfileFileName = L"krkr_stream_profiles.bin";
+
+// What a sound buffer looks like at CreateSoundBuffer time.
+struct StreamSignature {
+    std::uint32_t sampleRate = 0;
+    std::uint32_t bufferBytes = 0;
+    std::uint16_t channels = 0;
+    std::uint16_t bitsPerSample = 0;
+
+    bool operator==(const StreamSignature &other) const {
+        return sampleRate == other.sampleRate && bufferBytes == other.bufferBytes && channels == other.channels &&
+               bitsPerSample == other.bitsPerSample;
+    }
+};
+
+enum class StreamClass : std::uint8_t { Unknown, Voice, Bgm };
+
+const char *streamClassName(StreamClass cls);
+
+// How buffers with one signature ended up being classified, and how long they lived.
+struct StreamObservation {
+    StreamSignature signature;
+    std::uint32_t voiceCount = 0;
+    std::uint32_t bgmCount = 0;
+    std::uint32_t meanLifetimeMs = 0; // CreateSoundBuffer to last Release
+    std::uint32_t meanPlayedMs = 0;   // audio fed through Unlock
+};
+
+// One executable's learned streams. record() takes the outcome the hook's own heuristics reached for a
+// buffer (length gate, buffer length, BGM buffer reuse); classify() answers from those outcomes once a
+// signature has been seen often enough and almost always went the same way. Counts are halved past a cap
+// so a game whose behaviour changes (patch, different route) is relearned.
+class StreamProfile {
+public:
+    static constexpr std::uint32_t kMinObservations = 3;
+    static constexpr std::uint32_t kMaxCount = 64;
+    static constexpr std::size_t kMaxSignatures = 64;
+
+    void record(const StreamSignature &signature, bool bgm, std::uint32_t lifetimeMs, std::uint32_t playedMs);
+    StreamClass classify(const StreamSignature &signature) const;
+    const StreamObservation *find(const StreamSignature &signature) const;
+
+    // Mono/stereo buffers seen in any run; returns true when this changed what is known.
+    bool noteChannels(std::uint32_t channels);
+    bool seenMono() const { return m_seenMono; }
+    bool seenStereo() const { return m_seenStereo; }
+
+    bool empty() const { return m_observations.empty() && !m_seenMono && !m_seenStereo; }
+    const std::vector<StreamObservation> &observations() const { return m_observations; }
+
+private:
+    friend class StreamProfileStore;
+
+    std::vector<StreamObservation> m_observations;
+    bool m_seenMono = false;
+    bool m_seenStereo = false;
+};
+
+// Profiles of every executable the hook has run in, keyed by a digest of the executable path, in one
+// compact binary file (32-byte header, then per executable a 24-byte record followed by its 24-byte
+// observations; the payload is covered by an xxh64). Several games may share the file: save() is meant
+// to be called on a freshly loaded store with only the caller's profile updated, and replaces the file
+// through a temporary so a reader never sees a torn one.
+class StreamProfileStore {
+public:
+    static constexpr std::size_t kMaxProfiles = 256;
+
+    // Case-insensitive (ASCII) digest of the executable path.
+    static std::uint64_t executableDigest(const std::string &exePathUtf8);
+
+    // A missing file loads as an empty store.
+    bool load(const std::filesystem::path &path, std::string &error);
+    bool save(const std::filesystem::path &path, std::string &error) const;
+
+    bool parse(const std::vector<std::uint8_t> &bytes, std::string &error);
+    std::vector<std::uint8_t> serialize() const;
+
+    StreamProfile profile(std::uint64_t exe) const;
+    // Inserts or replaces `exe`'s profile; the least recently used one goes when the store is full.
+    void update(std::uint64_t exe, const StreamProfile &profile, std::uint64_t nowSeconds);
+    std::size_t profiles() const { return m_profiles.size(); }
+
+private:
+    struct Stored {
+        std::uint64_t exe = 0;
+        std::uint64_t lastUsed = 0; // seconds since the epoch
+        StreamProfile profile;
+    };
+
+    std::vector<Stored> m_profiles;
+};
+
+} // namespace krkrspeed
@@ -39,6 +39,7 @@ const KeyEntry kEntries[] = {
     {UiTextId::LabelAutoHook, "label.auto_hook", L""},
     {UiTextId::LabelAutoHookDelay, "label.auto_hook_delay", L""},
     {UiTextId::LabelHotkey, "label.hotkey", L""},
+    {UiTextId::LabelDspPreset, "label.dsp_preset", L""},
     {UiTextId::LinkMarkup, "link.markup", L""},
     {UiTextId::LinkPlain, "link.plain", L""},
     {UiTextId::TooltipProcessCombo, "tooltip.process_combo", L""},
@@ -49,7 +50,8 @@ const KeyEntry kEntries[] = {
     {UiTextId::TooltipProcessBgmWasapi, "tooltip.process_bgm_wasapi", L""},
     {UiTextId::TooltipAutoHook, "tooltip.auto_hook", L""},
     {UiTextId::TooltipAutoHookDelay, "tooltip.auto_hook_delay", L""},
-    {UiTextId::TooltipHotkey, "tooltip.hotkey", L""}
+    {UiTextId::TooltipHotkey, "tooltip.hotkey", L""},
+    {UiTextId::TooltipDspPreset, "tooltip.dsp_preset", L""}
 };
 
 std::unordered_map<std::wstring, UiTextPack> g_packs;
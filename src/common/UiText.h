@@ -15,6 +15,7 @@ enum class UiTextId {
     LabelAutoHook,
     LabelAutoHookDelay,
     LabelHotkey,
+    LabelDspPreset,
     LinkMarkup,
     LinkPlain,
     TooltipProcessCombo,
@@ -25,7 +26,8 @@ enum class UiTextId {
     TooltipProcessBgmWasapi,
     TooltipAutoHook,
     TooltipAutoHookDelay,
-    TooltipHotkey
+    TooltipHotkey,
+    TooltipDspPreset
 };
 
 bool LoadUiTextPacks(const std::filesystem::path &path, std::wstring &error);
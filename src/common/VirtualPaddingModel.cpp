@@ -0,0 +1,48 @@
+#include "VirtualPaddingModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace krkrspeed {
+
+namespace {
+// Engine buffers are well under a second; history beyond this many engine frames (several seconds
+// even at 96 kHz) can never be covered by GetCurrentPadding and is dropped.
+constexpr std::uint64_t kMaxHistoryFrames = 1u << 19;
+// Below this fraction of the buffer the engine's real padding is reported as-is. A game only ever fills
+// what it sees as free, so a padding mapped up to the full buffer would hold the endpoint at about
+// bufferFrames/speed; reporting the real value there lets the game refill it, and the virtual value
+// above the floor keeps its writes at their natural size.
+constexpr double kRealFillFloor = 0.5;
+} // namespace
+
+void VirtualPaddingModel::onRelease(std::uint32_t written, std::uint32_t released) {
+    if (released == 0) return;
+    m_releases.push_back({written, released});
+    m_releasedTotal += released;
+    while (m_releases.size() > 1 && m_releasedTotal - m_releases.front().released >= kMaxHistoryFrames) {
+        m_releasedTotal -= m_releases.front().released;
+        m_releases.pop_front();
+    }
+}
+
+std::uint32_t VirtualPaddingModel::virtualPadding(std::uint32_t realPadding, std::uint32_t bufferFrames) const {
+    if (bufferFrames && realPadding < kRealFillFloor * bufferFrames) return realPadding;
+    double remaining = realPadding;
+    double padding = 0.0;
+    for (auto it = m_releases.rbegin(); it != m_releases.rend() && remaining > 0.0; ++it) {
+        const double covered = std::min<double>(remaining, it->released);
+        padding += covered * static_cast<double>(it->written) / static_cast<double>(it->released);
+        remaining -= covered;
+    }
+    padding += remaining;
+    const double capped = bufferFrames ? std::min<double>(padding, bufferFrames) : padding;
+    return static_cast<std::uint32_t>(std::llround(capped));
+}
+
+void VirtualPaddingModel::reset() {
+    m_releases.clear();
+    m_releasedTotal = 0;
+}
+
+} // namespace krkrspeed
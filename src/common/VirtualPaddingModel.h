@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+namespace krkrspeed {
+
+// Maps an audio engine's real queued frames (GetCurrentPadding) back into the game's time domain when
+// releases are shortened for speedup. Every release is remembered as (frames the game wrote, frames
+// the engine received); the newest releases cover the engine's padding, so the game sees its own
+// writes still queued and keeps writing at its natural cadence instead of topping up a buffer that
+// looks permanently under-filled.
+class VirtualPaddingModel {
+public:
+    // Record one ReleaseBuffer: `written` frames produced by the game, `released` handed to the engine.
+    void onRelease(std::uint32_t written, std::uint32_t released);
+
+    // Padding to report for the engine's `realPadding`, capped at the game's `bufferFrames`
+    // (0 = no cap). Engine frames older than the recorded releases map 1:1. While the engine holds less
+    // than half of `bufferFrames` the real padding is returned, so the endpoint is refilled before it
+    // can run dry.
+    std::uint32_t virtualPadding(std::uint32_t realPadding, std::uint32_t bufferFrames) const;
+
+    void reset();
+
+private:
+    struct Release {
+        std::uint32_t written = 0;
+        std::uint32_t released = 0;
+    };
+    std::deque<Release> m_releases; // newest at the back
+    std::uint64_t m_releasedTotal = 0; // sum of `released` over m_releases
+};
+
+} // namespace krkrspeed
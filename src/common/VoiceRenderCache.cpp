@@ -0,0 +1,181 @@
+#include "VoiceRenderCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "XxHash64.h"
+
+namespace krkrspeed {
+
+VoiceRenderCache &VoiceRenderCache::instance() {
+    static VoiceRenderCache cache;
+    return cache;
+}
+
+void VoiceRenderCache::setBudget(std::size_t bytes) {
+    m_budget.store(bytes);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    evictLocked(bytes);
+}
+
+VoiceRenderKey VoiceRenderCache::makeKey(const std::uint8_t *firstBuffer, std::size_t bytes, std::uint32_t sampleRate,
+                                         std::uint32_t channels, std::uint32_t blockAlign, float speed,
+                                         const DspConfig &config, QualityTier tier) {
+    VoiceRenderKey key;
+    key.headHash = xxh64(firstBuffer, bytes);
+    key.firstBytes = static_cast<std::uint32_t>(bytes);
+    key.sampleRate = sampleRate;
+    key.channels = channels;
+    key.blockAlign = blockAlign;
+    key.speed = speed;
+    key.config = config;
+    key.tier = tier;
+    return key;
+}
+
+std::uint64_t VoiceRenderCache::digest(const VoiceRenderKey &key) {
+    // DspConfig is compared field by field in operator==; the bucket only needs the cheap part.
+    std::uint32_t speedBits = 0;
+    std::memcpy(&speedBits, &key.speed, sizeof(speedBits));
+    const std::uint64_t fields[] = {key.headHash, key.firstBytes, key.sampleRate, key.channels, key.blockAlign,
+                                    speedBits, static_cast<std::uint64_t>(key.tier)};
+    return xxh64(fields, sizeof(fields));
+}
+
+VoiceRenderCache::List::const_iterator VoiceRenderCache::findLocked(const VoiceRenderKey &key) const {
+    const auto range = m_index.equal_range(digest(key));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key == key) {
+            return it->second;
+        }
+    }
+    return m_lru.end();
+}
+
+std::shared_ptr<const VoiceRender> VoiceRenderCache::find(const VoiceRenderKey &key) {
+    if (!enabled()) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = findLocked(key);
+        if (it != m_lru.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it);
+            m_hits.fetch_add(1);
+            return it->render;
+        }
+    }
+    m_misses.fetch_add(1);
+    if (const auto backing = stores()) {
+        for (const auto &store : *backing) {
+            store->requestAsync(key);
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const VoiceRender> VoiceRenderCache::peek(const VoiceRenderKey &key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = findLocked(key);
+    return it != m_lru.end() ? it->render : nullptr;
+}
+
+void VoiceRenderCache::insert(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render, bool replace) {
+    if (!render || render->steps.empty()) {
+        return;
+    }
+    const std::size_t bytes = render->footprint() + sizeof(Entry);
+    if (bytes > maxEntryBytes()) {
+        return;
+    }
+    bool added = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        added = addLocked(key, render, bytes, replace);
+    }
+    if (const auto backing = stores(); backing && added) {
+        for (const auto &store : *backing) {
+            store->storeAsync(key, render);
+        }
+    }
+}
+
+void VoiceRenderCache::adopt(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render) {
+    if (!render || render->steps.empty() || !enabled()) {
+        return;
+    }
+    const std::size_t bytes = render->footprint() + sizeof(Entry);
+    if (bytes > maxEntryBytes()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    addLocked(key, std::move(render), bytes);
+}
+
+void VoiceRenderCache::addStore(std::shared_ptr<VoiceRenderStore> store) {
+    std::lock_guard<std::mutex> lock(m_storeMutex);
+    auto next = m_stores ? std::make_shared<Stores>(*m_stores) : std::make_shared<Stores>();
+    next->push_back(std::move(store));
+    m_stores = std::move(next);
+}
+
+std::shared_ptr<const VoiceRenderCache::Stores> VoiceRenderCache::stores() const {
+    std::lock_guard<std::mutex> lock(m_storeMutex);
+    return m_stores;
+}
+
+bool VoiceRenderCache::addLocked(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render,
+                                 std::size_t bytes, bool replace) {
+    if (const auto it = findLocked(key); it != m_lru.end()) {
+        if (!replace) {
+            return false; // another stream rendered (or a store loaded) the same line first
+        }
+        eraseLocked(m_lru.erase(it, it)); // const_iterator -> iterator
+    }
+    const std::uint64_t hash = digest(key);
+    m_lru.push_front(Entry{key, std::move(render), bytes});
+    m_index.emplace(hash, m_lru.begin());
+    m_bytes += bytes;
+    evictLocked(m_budget.load());
+    return true;
+}
+
+void VoiceRenderCache::eraseLocked(List::iterator entry) {
+    const auto range = m_index.equal_range(digest(entry->key));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entry) {
+            m_index.erase(it);
+            break;
+        }
+    }
+    m_bytes -= entry->bytes;
+    m_lru.erase(entry);
+}
+
+void VoiceRenderCache::evictLocked(std::size_t budget) {
+    while (m_bytes > budget && !m_lru.empty()) {
+        eraseLocked(std::prev(m_lru.end()));
+        ++m_evictions;
+    }
+}
+
+void VoiceRenderCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
+
+VoiceRenderCacheStats VoiceRenderCache::stats() const {
+    VoiceRenderCacheStats out;
+    out.hits = m_hits.load();
+    out.misses = m_misses.load();
+    out.bytesSaved = m_bytesSaved.load();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.evictions = m_evictions;
+    out.bytes = m_bytes;
+    out.entries = static_cast<std::uint32_t>(m_lru.size());
+    return out;
+}
+
+} // namespace krkrspeed
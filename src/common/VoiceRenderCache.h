@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "DspPipeline.h"
+#include "QualityGovernor.h"
+
+namespace krkrspeed {
+
+// Identifies a rendered voice line: XXH64 of its whole first buffer plus everything that changes the DSP
+// output for the same input. Hashing only a lead-in would give lines that share one (leading silence, a
+// common breath) the same key.
+struct VoiceRenderKey {
+    std::uint64_t headHash = 0;
+    std::uint32_t firstBytes = 0;
+    std::uint32_t sampleRate = 0;
+    std::uint32_t channels = 0;
+    std::uint32_t blockAlign = 0;
+    float speed = 1.0f;
+    DspConfig config{};
+    QualityTier tier = QualityTier::Full;
+
+    bool operator==(const VoiceRenderKey &other) const {
+        return headHash == other.headHash && firstBytes == other.firstBytes && sampleRate == other.sampleRate &&
+               channels == other.channels && blockAlign == other.blockAlign && speed == other.speed &&
+               config == other.config && tier == other.tier;
+    }
+};
+
+// Output of one line as the sequence of process() calls that produced it. A replay is served step by step
+// only while every incoming buffer matches the recorded one (length and full XXH64).
+struct VoiceRender {
+    struct Step {
+        std::uint64_t inputHash = 0;
+        std::uint32_t inputBytes = 0;
+        std::uint32_t outputOffset = 0;
+        std::uint32_t outputBytes = 0;
+    };
+    std::vector<Step> steps;
+    std::vector<std::uint8_t> output;
+
+    std::size_t footprint() const { return output.capacity() + steps.capacity() * sizeof(Step) + sizeof(*this); }
+};
+
+// Second-level store behind VoiceRenderCache (DiskRenderCache, PrerenderPack). Both calls come from audio
+// threads and must return without blocking; the store hands loaded lines back through
+// VoiceRenderCache::adopt().
+class VoiceRenderStore {
+public:
+    virtual ~VoiceRenderStore() = default;
+    virtual void requestAsync(const VoiceRenderKey &key) = 0;
+    virtual void storeAsync(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render) = 0;
+};
+
+struct VoiceRenderCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t bytesSaved = 0; // output bytes served without running the DSP
+    std::uint64_t evictions = 0;
+    std::uint64_t bytes = 0;      // current footprint
+    std::uint32_t entries = 0;
+};
+
+// Process-wide LRU of rendered voice lines with a byte budget. Entries are shared_ptr so a stream can
+// finish replaying a line that was evicted meanwhile.
+class VoiceRenderCache {
+public:
+    static VoiceRenderCache &instance();
+
+    // 0 disables the cache and drops everything. Lines larger than a quarter of the budget are not kept.
+    void setBudget(std::size_t bytes);
+    std::size_t budget() const { return m_budget.load(); }
+    bool enabled() const { return m_budget.load() > 0; }
+    std::size_t maxEntryBytes() const { return m_budget.load() / 4; }
+
+    static VoiceRenderKey makeKey(const std::uint8_t *firstBuffer, std::size_t bytes, std::uint32_t sampleRate,
+                                  std::uint32_t channels, std::uint32_t blockAlign, float speed,
+                                  const DspConfig &config, QualityTier tier);
+
+    // Counts a hit or miss; a miss is forwarded to the stores, which may fill it later.
+    std::shared_ptr<const VoiceRender> find(const VoiceRenderKey &key);
+    // Lookup without counting or forwarding (a stream checking whether its line arrived meanwhile).
+    std::shared_ptr<const VoiceRender> peek(const VoiceRenderKey &key) const;
+    // A freshly rendered line: cached and passed on to the stores. `replace`: the line diverged from the one
+    // cached under the same key (same first buffer, different continuation) and supersedes it.
+    void insert(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render, bool replace = false);
+    // A line loaded from a store: cached only.
+    void adopt(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render);
+    void addStore(std::shared_ptr<VoiceRenderStore> store);
+    void noteServed(std::size_t bytes) { m_bytesSaved.fetch_add(bytes); }
+    void clear();
+
+    VoiceRenderCacheStats stats() const;
+
+private:
+    VoiceRenderCache() = default;
+
+    struct Entry {
+        VoiceRenderKey key;
+        std::shared_ptr<const VoiceRender> render;
+        std::size_t bytes = 0;
+    };
+    using List = std::list<Entry>;
+    using Stores = std::vector<std::shared_ptr<VoiceRenderStore>>;
+
+    static std::uint64_t digest(const VoiceRenderKey &key);
+    List::const_iterator findLocked(const VoiceRenderKey &key) const;
+    bool addLocked(const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render, std::size_t bytes,
+                   bool replace = false);
+    void eraseLocked(List::iterator it);
+    void evictLocked(std::size_t budget);
+    std::shared_ptr<const Stores> stores() const;
+
+    static constexpr std::size_t kDefaultBudget = 32u * 1024u * 1024u;
+
+    mutable std::mutex m_mutex;
+    List m_lru; // most recently used first
+    std::unordered_multimap<std::uint64_t, List::iterator> m_index;
+    std::size_t m_bytes = 0;
+    std::atomic<std::size_t> m_budget{kDefaultBudget};
+    std::atomic<std::uint64_t> m_hits{0};
+    std::atomic<std::uint64_t> m_misses{0};
+    std::atomic<std::uint64_t> m_bytesSaved{0};
+    std::uint64_t m_evictions = 0;
+    mutable std::mutex m_storeMutex;
+    std::shared_ptr<const Stores> m_stores; // replaced, never modified, so readers copy one pointer
+};
+
+} // namespace krkrspeed
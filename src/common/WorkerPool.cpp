@@ -0,0 +1,98 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+namespace krkrspeed {
+
+namespace {
+// Leave a core for the game's own threads; more than this rarely helps a single clip.
+constexpr unsigned kMaxWorkers = 7;
+
+std::atomic<int> g_requestedWorkers{-1};
+} // namespace
+
+WorkerPool &WorkerPool::instance() {
+    // Leaked like DspPipelinePool: workers must not be joined from a DLL detach.
+    static WorkerPool *pool = [] {
+        const int requested = g_requestedWorkers.load();
+        const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        return new WorkerPool(requested >= 0 ? static_cast<unsigned>(requested) : std::min(kMaxWorkers, hw - 1));
+    }();
+    return *pool;
+}
+
+void WorkerPool::setWorkerCount(unsigned workers) {
+    g_requestedWorkers.store(static_cast<int>(std::min(workers, kMaxWorkers)));
+}
+
+WorkerPool::WorkerPool(unsigned workers) {
+    for (unsigned i = 0; i < workers; ++i) {
+        m_threads.emplace_back([this]() { workerLoop(); });
+        m_threads.back().detach();
+    }
+}
+
+void WorkerPool::runItems(Job &job) {
+    while (true) {
+        const std::size_t idx = job.next.fetch_add(1);
+        if (idx >= job.count) break;
+        try {
+            (*job.fn)(idx);
+        } catch (...) {
+            // Workers must not unwind out of their loop, and the caller must not unwind while workers
+            // still use the Job on its stack: keep the error for parallelFor() to rethrow.
+            std::lock_guard<std::mutex> lock(job.errorMutex);
+            if (!job.error) job.error = std::current_exception();
+        }
+        job.done.fetch_add(1);
+    }
+}
+
+void WorkerPool::workerLoop() {
+    std::uint64_t seen = 0;
+    while (true) {
+        Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_job != nullptr && m_generation != seen; });
+            seen = m_generation;
+            job = m_job;
+            ++m_active;
+        }
+        runItems(*job);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active;
+        }
+        m_finished.notify_all();
+    }
+}
+
+void WorkerPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn) {
+    if (count == 0) return;
+    std::unique_lock<std::mutex> exclusive(m_jobMutex, std::try_to_lock);
+    Job job;
+    job.fn = &fn;
+    job.count = count;
+    if (!exclusive.owns_lock() || m_threads.empty() || count == 1) {
+        // Same contract as the fan-out: every item runs, the first exception surfaces afterwards.
+        runItems(job);
+        if (job.error) std::rethrow_exception(job.error);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        ++m_generation;
+    }
+    m_wake.notify_all();
+    runItems(job);
+    // The job lives on this stack frame: wait until no worker still references it.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [&]() { return job.done.load() == count && m_active == 0; });
+    m_job = nullptr;
+    lock.unlock();
+    if (job.error) std::rethrow_exception(job.error);
+}
+
+} // namespace krkrspeed
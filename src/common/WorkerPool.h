@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace krkrspeed {
+
+// Small process-wide pool for fan-out work on the audio path (e.g. splitting a long voice clip into
+// segments). Workers and the calling thread pull item indices from one shared atomic counter, so
+// uneven items balance themselves without per-thread queues.
+class WorkerPool {
+public:
+    static WorkerPool &instance();
+    // Worker threads for the pool instance() creates (default: hardware threads - 1, capped). Only takes
+    // effect before the first instance() call; tests and benchmark tools use it to pin the fan-out.
+    static void setWorkerCount(unsigned workers);
+
+    // Threads that can run items concurrently, including the caller.
+    std::size_t concurrency() const { return m_threads.size() + 1; }
+
+    // Runs fn(0..count-1) and returns when all items finished. If another job is already in flight
+    // the items run inline on the caller instead of waiting for the pool. An exception thrown by an item
+    // does not stop the others; the first one is rethrown on the caller once every item has finished.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn);
+
+private:
+    struct Job {
+        const std::function<void(std::size_t)> *fn = nullptr;
+        std::size_t count = 0;
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> done{0};
+        std::mutex errorMutex;
+        std::exception_ptr error; // first exception thrown by an item
+    };
+
+    explicit WorkerPool(unsigned workers);
+    void workerLoop();
+    static void runItems(Job &job);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_jobMutex; // one job at a time
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_finished;
+    Job *m_job = nullptr;       // guarded by m_mutex
+    std::size_t m_active = 0;   // workers currently holding m_job
+    std::uint64_t m_generation = 0;
+};
+
+} // namespace krkrspeed
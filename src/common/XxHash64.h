@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace krkrspeed {
+
+// XXH64 (xxHash 64-bit, little-endian input). Fast enough to fingerprint whole PCM buffers on the
+// audio thread; not a cryptographic hash.
+std::uint64_t xxh64(const void *data, std::size_t bytes, std::uint64_t seed = 0);
+
+} // namespace krkrspeed
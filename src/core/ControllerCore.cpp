@@ -207,6 +207,7 @@ std::unordered_map<DWORD, HANDLE> g_sharedMappings;
 std::mutex g_sharedMutex;
 std::vector<AutoHookEntry> g_autoHookEntries;
 std::vector<AutoHookEntry> g_processBgmEntries;
+std::uint32_t g_dspPreset = 0;
 std::mutex g_autoHookMutex;
 std::unordered_set<std::wstring> g_processBlacklist;
 std::filesystem::file_time_type g_processBlacklistStamp{};
@@ -216,6 +217,8 @@ bool g_loggedBlacklistMissing = false;
 
 constexpr wchar_t kAutoHookConfigName[] = L"krkr_speed_config.yaml";
 constexpr wchar_t kProcessBlacklistName[] = L"process_blacklist.txt";
+// Indexed by SharedConfig::dspPreset; the same names --dsp-preset accepts.
+constexpr const char *kDspPresetNames[] = {"balanced", "low-power", "quality"};
 
 std::string toUtf8(const std::wstring &wstr) {
     if (wstr.empty()) return {};
@@ -382,6 +385,7 @@ bool saveAutoHookConfig(std::wstring &error) {
         error = L"Unable to write config: " + path.wstring();
         return false;
     }
+    out << "dsp_preset: " << kDspPresetNames[g_dspPreset] << "\n";
     out << "auto_hook:\n";
     for (const auto &entry : g_autoHookEntries) {
         out << "  - name: \"" << escapeYamlString(entry.exeName) << "\"\n";
@@ -425,6 +429,7 @@ void loadAutoHookConfig() {
     std::lock_guard<std::mutex> lock(g_autoHookMutex);
     g_autoHookEntries.clear();
     g_processBgmEntries.clear();
+    g_dspPreset = 0;
     const auto path = autoHookConfigPath();
     if (path.empty() || !std::filesystem::exists(path)) {
         return;
@@ -466,6 +471,15 @@ void loadAutoHookConfig() {
             activeList = &g_processBgmEntries;
             continue;
         }
+        if (trimmed.rfind("dsp_preset:", 0) == 0) {
+            flush();
+            activeList = nullptr;
+            const std::string value = trimCopy(trimmed.substr(11));
+            for (std::uint32_t i = 0; i < std::size(kDspPresetNames); ++i) {
+                if (value == kDspPresetNames[i]) g_dspPreset = i;
+            }
+            continue;
+        }
         if (!activeList) continue;
         if (trimmed[0] == '-') {
             flush();
@@ -617,6 +631,21 @@ std::size_t processBgmEntryCount() {
     return g_processBgmEntries.size();
 }
 
+std::uint32_t savedDspPreset() {
+    std::lock_guard<std::mutex> lock(g_autoHookMutex);
+    return g_dspPreset;
+}
+
+bool saveDspPreset(std::uint32_t preset, std::wstring &error) {
+    if (preset >= std::size(kDspPresetNames)) {
+        error = L"Invalid DSP preset.";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(g_autoHookMutex);
+    g_dspPreset = preset;
+    return saveAutoHookConfig(error);
+}
+
 float clampSpeed(float speed) {
     return std::clamp(speed, 0.5f, 10.0f);
 }
@@ -1026,6 +1055,8 @@ bool writeSharedSettingsForPid(DWORD pid, const SharedConfig &config, std::wstri
     settings.processAllAudio = config.processAllAudio ? 1u : 0u;
     settings.bgmSecondsGate = std::clamp(config.bgmSeconds, 0.1f, 600.0f);
     settings.stereoBgmMode = config.stereoBgmMode;
+    settings.dspPreset = config.dspPreset;
+    settings.version = view->version + 1;
     *view = settings;
 
     UnmapViewOfFile(view);
@@ -29,6 +29,7 @@ struct SharedConfig {
     bool enableLog = false;
     bool processAllAudio = false;
     std::uint32_t stereoBgmMode = 1;
+    std::uint32_t dspPreset = 0; // DspPreset: 0=balanced,1=low-power,2=quality
 };
 
 struct AutoHookEntry {
@@ -77,6 +78,8 @@ bool setAutoHookDelay(const std::wstring &exePath, const std::wstring &exeName,
 bool isProcessBgmEnabled(const std::wstring &exePath, const std::wstring &exeName);
 bool setProcessBgmEnabled(const std::wstring &exePath, const std::wstring &exeName, bool enabled, std::wstring &error);
 std::size_t processBgmEntryCount();
+std::uint32_t savedDspPreset();
+bool saveDspPreset(std::uint32_t preset, std::wstring &error);
 
 float clampSpeed(float speed);
 float roundSpeed(float speed);
@@ -14,6 +14,8 @@ struct CliOptions {
     float bgmSeconds = 60.0f;
     std::filesystem::path launchPath;
     std::uint32_t stereoBgmMode = 1;
+    std::uint32_t dspPreset = 0;
+    bool hasDspPreset = false;
     std::wstring searchTerm;
 };
 
@@ -54,6 +56,15 @@ CliOptions parseArgs() {
                 else if (_wcsicmp(v.c_str(), L"hybrid") == 0) opts.stereoBgmMode = 1;
                 else if (_wcsicmp(v.c_str(), L"none") == 0) opts.stereoBgmMode = 2;
             }
+        } else if (arg == L"--dsp-preset") {
+            std::wstring v;
+            if (next(v)) {
+                opts.hasDspPreset = true;
+                if (_wcsicmp(v.c_str(), L"balanced") == 0) opts.dspPreset = 0;
+                else if (_wcsicmp(v.c_str(), L"low-power") == 0) opts.dspPreset = 1;
+                else if (_wcsicmp(v.c_str(), L"quality") == 0) opts.dspPreset = 2;
+                else opts.hasDspPreset = false;
+            }
         } else if (arg == L"--launch" || arg == L"-l") {
             std::wstring v;
             if (next(v)) {
@@ -91,6 +102,8 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR, int nCmdShow) {
     controllerOpts.bgmSeconds = opts.bgmSeconds;
     controllerOpts.launchPath = opts.launchPath.wstring();
     controllerOpts.stereoBgmMode = opts.stereoBgmMode;
+    // --dsp-preset overrides the preset saved from the UI for this session only.
+    controllerOpts.dspPreset = opts.hasDspPreset ? opts.dspPreset : krkrspeed::controller::savedDspPreset();
     controllerOpts.searchTerm = opts.searchTerm;
     krkrspeed::ui::setInitialOptions(controllerOpts);
     krkrspeed::SetLoggingEnabled(opts.enableLog);
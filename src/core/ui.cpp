@@ -36,6 +36,7 @@ constexpr int kAutoHookLabelId = 1012;
 constexpr int kLanguageComboId = 1013;
 constexpr int kAutoHookDelayCheckId = 1014;
 constexpr int kAutoHookDelayLabelId = 1015;
+constexpr int kDspPresetComboId = 1016;
 constexpr UINT kAutoHookTimerId = 3001;
 constexpr UINT kAutoHookIntervalMs = 3000;
 constexpr UINT kMsgAutoSelectPid = WM_APP + 2;
@@ -133,6 +134,7 @@ struct AppState {
     bool processAllAudio = false;
     float bgmSeconds = 60.0f; // also used as length gate seconds
     std::uint32_t stereoBgmMode = 1;
+    std::uint32_t dspPreset = 0;
     std::wstring searchTerm;
 };
 
@@ -153,6 +155,8 @@ static HWND g_autoHookDelayCheck = nullptr;
 static HWND g_autoHookDelayLabel = nullptr;
 static HWND g_ignoreBgmLabel = nullptr;
 static HWND g_languageCombo = nullptr;
+static HWND g_dspPresetLabel = nullptr;
+static HWND g_dspPresetCombo = nullptr;
 static HWND g_hotkeyLabel = nullptr;
 static HWND g_tooltip = nullptr;
 static std::unordered_map<std::uintptr_t, UiTextId> g_tooltipById;
@@ -230,6 +234,9 @@ void refreshUiText(HWND hwnd) {
     if (g_hotkeyLabel) {
         SetWindowTextW(g_hotkeyLabel, ui_text::UiText(UiTextId::LabelHotkey).c_str());
     }
+    if (g_dspPresetLabel) {
+        SetWindowTextW(g_dspPresetLabel, ui_text::UiText(UiTextId::LabelDspPreset).c_str());
+    }
     if (g_link) {
         const auto &linkText = g_linkIsSysLink ? ui_text::UiText(UiTextId::LinkMarkup)
                                                : ui_text::UiText(UiTextId::LinkPlain);
@@ -775,6 +782,22 @@ void handleProcessBgmToggle(HWND hwnd) {
     setStatus(statusLabel, msg);
 }
 
+void handleDspPresetChange(HWND hwnd) {
+    if (!g_dspPresetCombo) return;
+    const int sel = static_cast<int>(SendMessageW(g_dspPresetCombo, CB_GETCURSEL, 0, 0));
+    if (sel < 0) return;
+    HWND statusLabel = GetDlgItem(hwnd, kStatusLabelId);
+    g_state.dspPreset = static_cast<std::uint32_t>(sel);
+    std::wstring error;
+    if (!controller::saveDspPreset(g_state.dspPreset, error)) {
+        setStatus(statusLabel, error);
+    }
+    wchar_t name[32] = {};
+    SendMessageW(g_dspPresetCombo, CB_GETLBTEXT, sel, reinterpret_cast<LPARAM>(name));
+    setStatus(statusLabel, std::wstring(L"DSP preset: ") + name);
+    applySettingsToSelectedIfHooked(hwnd);
+}
+
 controller::SharedConfig buildSharedConfig(float speed) {
     controller::SharedConfig cfg{};
     cfg.speed = speed;
@@ -782,6 +805,7 @@ controller::SharedConfig buildSharedConfig(float speed) {
     cfg.enableLog = g_state.enableLog;
     cfg.processAllAudio = g_state.processAllAudio;
     cfg.stereoBgmMode = g_state.stereoBgmMode;
+    cfg.dspPreset = g_state.dspPreset;
     cfg.bgmSeconds = g_state.bgmSeconds;
     return cfg;
 }
@@ -1030,6 +1054,14 @@ void layoutControls(HWND hwnd) {
     }
     // Hook + Apply button removed; "Hook" button handles injection.
 
+    y += rowHeight;
+    if (g_dspPresetLabel) {
+        SetWindowPos(g_dspPresetLabel, nullptr, x, y + 2, labelWidth, comboHeight, SWP_NOZORDER);
+    }
+    if (g_dspPresetCombo) {
+        SetWindowPos(g_dspPresetCombo, nullptr, x + labelWidth, y, buttonWidth, comboHeight * 4, SWP_NOZORDER);
+    }
+
     y += rowHeight;
     SetWindowPos(GetDlgItem(hwnd, kStatusLabelId), nullptr, x, y, rc.right - padding * 2, statusHeight, SWP_NOZORDER);
 
@@ -1339,6 +1371,21 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPara
         if (ignoreBgm) {
             SendMessageW(ignoreBgm, BM_SETCHECK, g_state.processAllAudio ? BST_CHECKED : BST_UNCHECKED, 0);
         }
+        g_dspPresetLabel = CreateWindowExW(0, L"STATIC", ui_text::UiText(UiTextId::LabelDspPreset).c_str(),
+                                           WS_CHILD | WS_VISIBLE | SS_NOTIFY, 12, 96, 100, 20, hwnd, nullptr, nullptr,
+                                           nullptr);
+        // Items follow SharedConfig::dspPreset order (0=balanced, 1=low-power, 2=quality).
+        g_dspPresetCombo = CreateWindowExW(WS_EX_CLIENTEDGE, L"COMBOBOX", nullptr,
+                                           WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST,
+                                           107, 94, 120, 200,
+                                           hwnd, reinterpret_cast<HMENU>(static_cast<INT_PTR>(kDspPresetComboId)),
+                                           nullptr, nullptr);
+        if (g_dspPresetCombo) {
+            SendMessageW(g_dspPresetCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(L"Balanced"));
+            SendMessageW(g_dspPresetCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(L"Low-power"));
+            SendMessageW(g_dspPresetCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(L"Quality"));
+            SendMessageW(g_dspPresetCombo, CB_SETCURSEL, g_state.dspPreset <= 2 ? g_state.dspPreset : 0, 0);
+        }
         // Hook + Apply button removed; "Hook" button handles injection.
 
         HWND statusEdit = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", L"",
@@ -1408,6 +1455,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPara
         addTooltip(g_tooltip, g_autoHookDelayCheck, UiTextId::TooltipAutoHookDelay);
         addTooltip(g_tooltip, g_autoHookDelayLabel, UiTextId::TooltipAutoHookDelay);
         addTooltip(g_tooltip, g_hotkeyLabel, UiTextId::TooltipHotkey);
+        addTooltip(g_tooltip, g_dspPresetCombo, UiTextId::TooltipDspPreset);
+        addTooltip(g_tooltip, g_dspPresetLabel, UiTextId::TooltipDspPreset);
         // Hook + Apply tooltip removed with button.
 
         refreshUiText(hwnd);
@@ -1493,6 +1542,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPara
             handleAutoHookToggle(hwnd);
         } else if (id == kAutoHookDelayCheckId && HIWORD(wParam) == BN_CLICKED) {
             handleAutoHookDelayToggle(hwnd);
+        } else if (id == kDspPresetComboId && HIWORD(wParam) == CBN_SELCHANGE) {
+            handleDspPresetChange(hwnd);
         } else if (id == kLinkId && HIWORD(wParam) == STN_CLICKED) {
             ShellExecuteW(hwnd, L"open", L"https://github.com/caca2331/kirikiri-speed-controller", nullptr, nullptr, SW_SHOWNORMAL);
         }
@@ -1622,6 +1673,7 @@ void setInitialOptions(const ControllerOptions &opts) {
     g_state.bgmSeconds = opts.bgmSeconds;
     g_state.launchPath = opts.launchPath.empty() ? std::filesystem::path{} : std::filesystem::path(opts.launchPath);
     g_state.stereoBgmMode = opts.stereoBgmMode;
+    g_state.dspPreset = opts.dspPreset;
     g_state.searchTerm = opts.searchTerm;
 }
 
@@ -1648,7 +1700,7 @@ int runController(HINSTANCE hInstance, int nCmdShow) {
     const auto &title = ui_text::UiText(UiTextId::WindowTitle);
     HWND hwnd = CreateWindowExW(0, CLASS_NAME, title.c_str(),
                                 WS_OVERLAPPEDWINDOW & ~WS_THICKFRAME & ~WS_MAXIMIZEBOX,
-                                CW_USEDEFAULT, CW_USEDEFAULT, 620, 240,
+                                CW_USEDEFAULT, CW_USEDEFAULT, 620, 268,
                                 nullptr, nullptr, hInstance, nullptr);
     if (!hwnd) {
         KRKR_LOG_ERROR("Failed to create main window");
@@ -15,6 +15,7 @@ struct ControllerOptions {
     float bgmSeconds = 60.0f;
     std::wstring launchPath;
     std::uint32_t stereoBgmMode = 1;
+    std::uint32_t dspPreset = 0;
     std::wstring searchTerm;
 };
 
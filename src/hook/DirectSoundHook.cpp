@@ -4,6 +4,8 @@
 #include "SharedStatusManager.h"
 #include "../common/Logging.h"
 #include "../common/AudioStreamProcessor.h"
+#include "../common/DspPipelinePool.h"
+#include "../common/VoiceRenderCache.h"
 
 #include <initguid.h>
 #include <algorithm>
@@ -13,10 +15,36 @@
 #include <memory>
 #include <cmath>
 #include <thread>
+#include <ctime>
 #include <Psapi.h>
 
 namespace krkrspeed {
 
+namespace {
+// Streams idle longer than this drop their DSP state; the next Unlock rebuilds it lazily.
+constexpr auto kStreamIdleRelease = std::chrono::seconds(5);
+// Global cap on DSP/carry memory across all tracked buffers and the pool's parked pipelines; least-recently-used
+// streams go first.
+constexpr std::size_t kStreamMemoryCap = 24u * 1024u * 1024u;
+constexpr auto kStreamTrimInterval = std::chrono::milliseconds(500);
+static_assert(FrequencyPolicy::kMinFrequency == DSBFREQUENCY_MIN && FrequencyPolicy::kMaxFrequency == DSBFREQUENCY_MAX,
+              "FrequencyPolicy clamps must match the DirectSound frequency range");
+// How often learned stream outcomes are merged into krkr_stream_profiles.bin.
+constexpr auto kProfileSaveInterval = std::chrono::seconds(30);
+// A buffer silent for longer than this is being reused for a new sound: its content verdict starts over.
+constexpr auto kContentRearm = std::chrono::seconds(1);
+
+StreamSignature signatureOf(std::uint32_t sampleRate, std::uint32_t channels, std::uint16_t bitsPerSample,
+                            std::uint32_t bufferBytes) {
+    StreamSignature sig;
+    sig.sampleRate = sampleRate;
+    sig.bufferBytes = bufferBytes;
+    sig.channels = static_cast<std::uint16_t>(channels);
+    sig.bitsPerSample = bitsPerSample;
+    return sig;
+}
+} // namespace
+
 DirectSoundHook &DirectSoundHook::instance() {
     static DirectSoundHook hook;
     return hook;
@@ -64,6 +92,86 @@ void DirectSoundHook::applySharedSettingsFallback() {
     CloseHandle(mapping);
 }
 
+void DirectSoundHook::loadStreamProfile(HMODULE hookModule) {
+    wchar_t exe[MAX_PATH] = {};
+    const auto dir = HookDataDirectory(hookModule);
+    if (dir.empty() || GetModuleFileNameW(nullptr, exe, MAX_PATH) == 0) {
+        return;
+    }
+    const auto path = dir / kStreamProfileFileName;
+    const std::uint64_t exeDigest = StreamProfileStore::executableDigest(std::filesystem::path(exe).u8string());
+    StreamProfileStore store;
+    std::string error;
+    if (!store.load(path, error)) {
+        KRKR_LOG_WARN("Stream profile ignored: " + error);
+    }
+    StreamProfile profile = store.profile(exeDigest);
+    KRKR_LOG_INFO("Stream profile: " + std::to_string(profile.observations().size()) +
+                  " buffer signatures learned for this executable" + (profile.seenMono() ? " (mono seen)" : ""));
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_profile = std::move(profile);
+        m_profilePath = path;
+        m_profileExe = exeDigest;
+    }
+    if (!m_profileSaverStarted.exchange(true)) {
+        SharedSettingsManager::instance().addPeriodicTask(kProfileSaveInterval, [this]() { saveProfile(); });
+    }
+}
+
+void DirectSoundHook::recordProfileLocked(BufferInfo &info, std::chrono::steady_clock::time_point now) {
+    // With BGM detection off the length gate never fires, so outcomes would all read as voice.
+    if (info.profileRecorded || info.unlockCount == 0 || m_disableBgm || m_profileExe == 0) {
+        return;
+    }
+    info.profileRecorded = true;
+    // Only the slow evidence (length gate, buffer size, BGM buffer reuse) is learned. The stereo rule is
+    // already immediate once m_seenMono is known, and depends on stereoBgmMode.
+    const bool bgm = info.isLikelyBgm;
+    const auto lifetimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - info.created).count();
+    const std::uint64_t playedMs = info.processedFrames * 1000u / std::max<std::uint32_t>(1, info.sampleRate);
+    m_profile.record(signatureOf(info.sampleRate, info.channels, info.bitsPerSample, info.bufferBytes), bgm,
+                     static_cast<std::uint32_t>(std::min<std::int64_t>(std::max<std::int64_t>(0, lifetimeMs), UINT32_MAX)),
+                     static_cast<std::uint32_t>(std::min<std::uint64_t>(playedMs, UINT32_MAX)));
+    m_profileDirty = true;
+}
+
+void DirectSoundHook::saveProfile() {
+    StreamProfile snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // BGM streams often live for the whole session and are never released; count them once the
+        // heuristics have called them BGM.
+        const auto now = std::chrono::steady_clock::now();
+        for (auto &entry : m_buffers) {
+            if (entry.second.isLikelyBgm) {
+                recordProfileLocked(entry.second, now);
+            }
+        }
+        if (!m_profileDirty) {
+            return;
+        }
+        m_profileDirty = false;
+        snapshot = m_profile;
+    }
+    // Merge into the file as it is now: other games may have saved their profiles since this one loaded.
+    StreamProfileStore store;
+    std::string error;
+    if (!store.load(m_profilePath, error)) {
+        KRKR_LOG_WARN("Stream profile file unreadable, rewriting it: " + error);
+        store = StreamProfileStore{};
+    }
+    store.update(m_profileExe, snapshot, static_cast<std::uint64_t>(std::time(nullptr)));
+    if (!store.save(m_profilePath, error)) {
+        if (!m_profileSaveFailed) {
+            KRKR_LOG_WARN("Stream profile not saved: " + error);
+            m_profileSaveFailed = true;
+        }
+    } else {
+        m_profileSaveFailed = false;
+    }
+}
+
 void DirectSoundHook::initialize() {
     m_bgmSecondsGate = m_config.bgmGateSeconds;
     m_disableBgm = m_config.disableBgm;
@@ -80,6 +188,16 @@ void DirectSoundHook::initialize() {
     } else {
         m_seenMono.store(true); // aggressive/none treat as seen to keep logic simple
     }
+    {
+        // Earlier runs of this game already met both kinds: the hybrid stereo rule applies from the first buffer.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_profile.seenMono()) {
+            m_seenMono.store(true);
+        }
+        if (m_profile.seenStereo()) {
+            m_seenStereo.store(true);
+        }
+    }
     KRKR_LOG_INFO("DirectSound hook initialization started");
     applySharedSettingsFallback();
     hookEntryPoints();
@@ -257,26 +375,37 @@ HRESULT WINAPI DirectSoundHook::CreateSoundBufferHook(IDirectSound8 *self, LPDIR
     info.channels = fmt->nChannels;
     info.bitsPerSample = fmt->wBitsPerSample;
     info.formatTag = fmt->wFormatTag;
-    info.baseFrequency = fmt->nSamplesPerSec;
+    info.frequency = FrequencyPolicy(fmt->nSamplesPerSec, true);
     info.bufferBytes = pcDSBufferDesc->dwBufferBytes;
     info.blockAlign = blockAlign;
     info.approxSeconds = approxSeconds;
     info.isLikelyBgm = likelyBgm;
     info.isPcm16 = isPcm16;
-    DspConfig cfg{};
-    info.stream = std::make_unique<AudioStreamProcessor>(info.sampleRate, info.channels, info.blockAlign, cfg);
     auto key = reinterpret_cast<std::uintptr_t>(*ppDSBuffer);
-    // If this buffer pointer was recently a BGM buffer and reused quickly, mark again.
     auto now = std::chrono::steady_clock::now();
+    info.created = now;
+    info.profileClass = hook.m_profile.classify(
+        signatureOf(info.sampleRate, info.channels, info.bitsPerSample, info.bufferBytes));
+    if (info.profileClass != StreamClass::Unknown) {
+        KRKR_LOG_INFO(std::string("DS: buffer pre-classified from stream profile as ") +
+                      streamClassName(info.profileClass) + " buf=" + std::to_string(key));
+    }
+    // If this buffer pointer was recently a BGM buffer and reused quickly, mark again (unless this
+    // signature has always been voice).
     auto reuse = hook.m_bgmReleaseTimes.find(key);
     if (reuse != hook.m_bgmReleaseTimes.end()) {
         auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - reuse->second).count();
-        if (diff <= 5000) {
+        if (diff <= 5000 && info.profileClass != StreamClass::Voice) {
             info.isLikelyBgm = true;
             KRKR_LOG_INFO("DS: buffer reused soon after BGM release; marking BGM buf=" + std::to_string(key));
         }
         hook.m_bgmReleaseTimes.erase(reuse);
     }
+    if (!info.isLikelyBgm && info.profileClass != StreamClass::Bgm) {
+        // Warm a pipeline for this format so the first voice Unlock does not construct SoundTouch.
+        DspPipelinePool::instance().prewarmAsync(info.sampleRate, info.channels,
+                                                 SharedSettingsManager::instance().dspConfig(DspMode::Pitch));
+    }
     hook.m_buffers[key] = std::move(info);
 
     return hr;
@@ -288,6 +417,17 @@ HRESULT WINAPI DirectSoundHook::UnlockHook(IDirectSoundBuffer *self, LPVOID pAud
     if (!hook.m_origUnlock) {
         return DSERR_GENERIC;
     }
+    // Speed at 1.0: straight to the original after two relaxed loads once the base-frequency restore has settled;
+    // before that only buffers it still lists take the lock. Per-buffer state is brought up to date lazily on
+    // the first Unlock after re-engagement.
+    const std::uint32_t engagement = SharedSettingsManager::instance().engagement();
+    if (!SharedSettingsManager::isEngaged(engagement)) {
+        if (hook.m_frequencyRestore.needsLock(engagement, reinterpret_cast<std::uintptr_t>(self)) &&
+            !hook.m_disableAfterFault.load()) {
+            hook.restoreBaseFrequency(self, engagement);
+        }
+        return hook.m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
+    }
     if (hook.m_disableAfterFault.load()) {
         return hook.m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
     }
@@ -323,12 +463,17 @@ ULONG __stdcall DirectSoundHook::ReleaseHook(IDirectSoundBuffer *self) {
         auto now = std::chrono::steady_clock::now();
         {
             std::lock_guard<std::mutex> lock(hook.m_mutex);
+            auto it = hook.m_buffers.find(key);
+            if (it != hook.m_buffers.end()) {
+                hook.recordProfileLocked(it->second, now);
+            }
             if (wasBgm) {
                 hook.m_bgmReleaseTimes[key] = now;
             } else {
                 hook.m_bgmReleaseTimes.erase(key);
             }
             hook.m_buffers.erase(key);
+            hook.m_frequencyRestore.done(key);
         }
         {
             std::lock_guard<std::mutex> lock(hook.m_vtableMutex);
@@ -341,10 +486,12 @@ ULONG __stdcall DirectSoundHook::ReleaseHook(IDirectSoundBuffer *self) {
                     std::lock_guard<std::mutex> lock(hook.m_mutex);
                     auto reuse = hook.m_buffers.find(key);
                     if (reuse != hook.m_buffers.end()) {
-                        reuse->second.isLikelyBgm = true;
                         hook.m_bgmReleaseTimes.erase(key);
-                        KRKR_LOG_INFO("DS: buffer reused soon after BGM release; re-marked as BGM buf=" +
-                                      std::to_string(key));
+                        if (reuse->second.profileClass != StreamClass::Voice) {
+                            reuse->second.isLikelyBgm = true;
+                            KRKR_LOG_INFO("DS: buffer reused soon after BGM release; re-marked as BGM buf=" +
+                                          std::to_string(key));
+                        }
                         return;
                     }
                     auto ts = hook.m_bgmReleaseTimes.find(key);
@@ -368,6 +515,54 @@ ULONG __stdcall DirectSoundHook::ReleaseHook(IDirectSoundBuffer *self) {
     return remaining;
 }
 
+HRESULT __stdcall DirectSoundHook::SetFrequencyHook(IDirectSoundBuffer *self, DWORD dwFrequency) {
+    auto &hook = DirectSoundHook::instance();
+    if (!hook.m_origSetFrequency) {
+        return DSERR_GENERIC;
+    }
+    std::lock_guard<std::mutex> lock(hook.m_mutex);
+    auto it = hook.m_buffers.find(reinterpret_cast<std::uintptr_t>(self));
+    if (it == hook.m_buffers.end() || hook.m_disableAfterFault.load()) {
+        return hook.m_origSetFrequency(self, dwFrequency);
+    }
+    // The game's frequency becomes the new base; keep whatever speed the buffer currently runs at on top.
+    auto &policy = it->second.frequency;
+    const FrequencyPolicy before = policy;
+    const float speed =
+        SharedSettingsManager::isEngaged(SharedSettingsManager::instance().engagement()) ? policy.speed() : 1.0f;
+    policy.onGameSet(dwFrequency);
+    const DWORD forwarded = policy.target(speed);
+    const HRESULT hr = hook.m_origSetFrequency(self, forwarded);
+    if (FAILED(hr)) {
+        policy = before;
+        return hr;
+    }
+    policy.onApplied(speed, true);
+    if (!policy.retuned()) {
+        hook.m_frequencyRestore.done(reinterpret_cast<std::uintptr_t>(self)); // nothing left to restore
+    }
+    KRKR_LOG_DEBUG("DS: game SetFrequency buf=" + std::to_string(reinterpret_cast<std::uintptr_t>(self)) +
+                   " requested=" + std::to_string(dwFrequency) + " forwarded=" + std::to_string(forwarded));
+    return hr;
+}
+
+HRESULT __stdcall DirectSoundHook::GetFrequencyHook(IDirectSoundBuffer *self, LPDWORD pdwFrequency) {
+    auto &hook = DirectSoundHook::instance();
+    if (!hook.m_origGetFrequency) {
+        return DSERR_GENERIC;
+    }
+    if (pdwFrequency) {
+        // While retuned, report the game's own frequency so it never sees (and re-applies) the speedup.
+        std::lock_guard<std::mutex> lock(hook.m_mutex);
+        auto it = hook.m_buffers.find(reinterpret_cast<std::uintptr_t>(self));
+        if (it != hook.m_buffers.end() && it->second.frequency.retuned()) {
+            *pdwFrequency = it->second.frequency.gameFrequency();
+            return DS_OK;
+        }
+    }
+    return hook.m_origGetFrequency(self, pdwFrequency);
+}
+
 HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr1, DWORD dwAudioBytes1,
                                       LPVOID pAudioPtr2, DWORD dwAudioBytes2) {
     if (!m_loggedUnlockOnce.exchange(true)) {
@@ -395,30 +590,23 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
         return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
     }
 
-    std::vector<std::uint8_t> combined;
-    combined.reserve(dwAudioBytes1 + dwAudioBytes2);
-    if (pAudioPtr1 && dwAudioBytes1) {
-        auto *ptr = reinterpret_cast<std::uint8_t *>(pAudioPtr1);
-        combined.insert(combined.end(), ptr, ptr + dwAudioBytes1);
-    }
-    if (pAudioPtr2 && dwAudioBytes2) {
-        auto *ptr = reinterpret_cast<std::uint8_t *>(pAudioPtr2);
-        combined.insert(combined.end(), ptr, ptr + dwAudioBytes2);
-    }
-
-    if (combined.empty()) {
+    const std::size_t bytes1 = (pAudioPtr1 && dwAudioBytes1) ? dwAudioBytes1 : 0;
+    const std::size_t bytes2 = (pAudioPtr2 && dwAudioBytes2) ? dwAudioBytes2 : 0;
+    const std::size_t totalBytes = bytes1 + bytes2;
+    if (totalBytes == 0) {
         KRKR_LOG_DEBUG("DS Unlock: combined buffer empty");
         return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
     }
+    // Gathered copy of both regions; only built for the regular (non in-place) DSP path.
+    std::vector<std::uint8_t> combined;
 
     BufferInfo *processedInfo = nullptr;
-    float processedDurationSec = 0.0f;
     float lastAppliedSpeedForPlay = 1.0f;
 
     for (int attempt = 0; attempt < 2; ++attempt) {
         std::lock_guard<std::mutex> lock(m_mutex);
         auto it = m_buffers.find(reinterpret_cast<std::uintptr_t>(self));
-        if (it != m_buffers.end() && it->second.stream) {
+        if (it != m_buffers.end()) {
             if (!it->second.isPcm16) {
                 if (!it->second.loggedFormat) {
                     KRKR_LOG_WARN("DirectSound buffer format not PCM16; skipping DSP. fmt=" +
@@ -434,28 +622,63 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
             const bool gate = SharedSettingsManager::instance().isLengthGateEnabled();
             const float gateSeconds = SharedSettingsManager::instance().lengthGateSeconds();
             auto &info = it->second;
+            const std::uint32_t engagement = SharedSettingsManager::instance().engagement();
+            if (info.engagement != engagement) {
+                // First Unlock since (re-)engagement: the stream's carry buffers are stale.
+                info.engagement = engagement;
+                if (info.stream) info.stream->releaseDsp();
+            }
             info.unlockCount++;
             if (info.channels == 1) {
                 m_seenMono.store(true);
             } else if (info.channels > 1) {
                 m_seenStereo.store(true);
             }
+            if (m_profile.noteChannels(info.channels)) {
+                m_profileDirty = true;
+            }
             if (!m_loggedMonoStereo.load() && m_seenMono.load() && m_seenStereo.load()) {
                 KRKR_LOG_INFO("DS: detected both mono and stereo buffers");
                 m_loggedMonoStereo.store(true);
             }
 
-            const std::size_t frames = (combined.size() / sizeof(std::int16_t)) /
+            const std::size_t frames = (totalBytes / sizeof(std::int16_t)) /
                                        std::max<std::uint32_t>(1, info.channels);
             const float durationSec =
                 static_cast<float>(frames) / static_cast<float>(std::max<std::uint32_t>(1, info.sampleRate));
             const float totalSec =
                 static_cast<float>(info.processedFrames + frames) / static_cast<float>(std::max<std::uint32_t>(1, info.sampleRate));
             processedInfo = &info;
-            processedDurationSec = durationSec;
             const bool shouldLog = info.unlockCount <= 5 || (info.unlockCount % 50 == 0);
             // Reset stream if idle gap exceeded.
             const auto now = std::chrono::steady_clock::now();
+            const bool passLengthGate = totalSec > m_bgmSecondsGate;
+            // The verdict only matters while nothing else has routed the buffer: BGM by length, profile or the
+            // all-stereo rule, or too long for the DSP length gate, never consults it. A settled verdict is kept
+            // until the buffer is reused for a new sound.
+            const bool routed = info.isLikelyBgm || passLengthGate || info.profileClass == StreamClass::Bgm ||
+                                (info.channels > 1 && m_config.stereoBgmMode == 0) ||
+                                (gate && totalSec > gateSeconds && !m_forceApply);
+            if (info.content && now - info.lastUse > kContentRearm) {
+                info.content->reset();
+            }
+            if (!m_disableBgm && !routed && !(info.content && info.content->settled())) {
+                if (!info.content) {
+                    info.content = std::make_unique<SpeechMusicClassifier>(info.sampleRate, info.channels);
+                }
+                const AudioContent before = info.content->verdict();
+                info.content->feedPcm16(static_cast<const std::int16_t *>(pAudioPtr1), bytes1 / sizeof(std::int16_t));
+                const AudioContent after =
+                    info.content->feedPcm16(static_cast<const std::int16_t *>(pAudioPtr2), bytes2 / sizeof(std::int16_t));
+                if (after != before) {
+                    KRKR_LOG_INFO(std::string("DS content: buf=") + std::to_string(reinterpret_cast<std::uintptr_t>(self)) +
+                                  " " + audioContentName(before) + " -> " + audioContentName(after) +
+                                  " score=" + std::to_string(info.content->features().score));
+                }
+            }
+            const AudioContent content = info.content ? info.content->verdict() : AudioContent::Unknown;
+            info.lastUse = now;
+            trimStreamsLocked(now, it->first);
             if (info.stream) {
                 info.stream->resetIfIdle(now, std::chrono::milliseconds(200), shouldLog,
                                          reinterpret_cast<std::uintptr_t>(self));
@@ -466,9 +689,10 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
                     KRKR_LOG_INFO("DS: detected non-fragmented audio (>1s chunk); disabling tiny-chunk skip");
                 }
             }
+            // Hybrid mode's stereo rule is a guess; a speech verdict on the buffer itself overrides it.
             const bool stereoIsBgm = (m_config.stereoBgmMode == 0) ||
-                                     (m_config.stereoBgmMode == 1 && m_seenMono.load());
-            const bool passLengthGate = totalSec > m_bgmSecondsGate;
+                                     (m_config.stereoBgmMode == 1 && m_seenMono.load() &&
+                                      content != AudioContent::Speech);
             if (!info.isLikelyBgm && !m_disableBgm && passLengthGate) {
                 info.isLikelyBgm = true;
                 if (shouldLog) {
@@ -477,7 +701,9 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
                                   " totalSec=" + std::to_string(totalSec));
                 }
             }
-            const bool isBgm = ((((info.channels > 1) && stereoIsBgm) || info.isLikelyBgm) && !m_disableBgm);
+            const bool isBgm = ((((info.channels > 1) && stereoIsBgm) || info.isLikelyBgm ||
+                                 info.profileClass == StreamClass::Bgm || content == AudioContent::Music) &&
+                                !m_disableBgm);
             const bool treatAsBgm = isBgm;
 
             bool doDsp = false;
@@ -491,58 +717,87 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
             }
             if (shouldLog) {
                 KRKR_LOG_DEBUG("DS Unlock: buf=" + std::to_string(reinterpret_cast<std::uintptr_t>(self)) +
-                               " bytes=" + std::to_string(combined.size()) +
+                               " bytes=" + std::to_string(totalBytes) +
                                " ch=" + std::to_string(info.channels) +
                                " sr=" + std::to_string(info.sampleRate) +
                                " dur=" + std::to_string(durationSec) +
                                " total=" + std::to_string(totalSec) +
                                " bgm=" + (isBgm ? "1" : "0") +
+                               " content=" + audioContentName(content) +
                                " apply=" + (doDsp ? "1" : "0") +
                                " speed=" + std::to_string(userSpeed));
             }
+            if (info.frequency.needsProbe()) {
+                // Tracked after creation: learn the frequency the game left on the buffer once.
+                DWORD current = 0;
+                const bool ok = m_origGetFrequency && SUCCEEDED(m_origGetFrequency(self, &current));
+                info.frequency.onProbed(ok, current);
+            }
+            const float targetSpeed = doDsp ? userSpeed : 1.0f;
             if (doDsp) {
-                // Cap SetFrequency so target Hz never exceeds DSBFREQUENCY_MAX; use applied speed for pitch restore.
-                const DWORD base = info.baseFrequency ? info.baseFrequency : info.sampleRate;
-                const double scaled = static_cast<double>(base) * static_cast<double>(userSpeed);
-                double clampedD = scaled;
-                if (clampedD < static_cast<double>(DSBFREQUENCY_MIN)) clampedD = static_cast<double>(DSBFREQUENCY_MIN);
-                if (clampedD > static_cast<double>(DSBFREQUENCY_MAX)) clampedD = static_cast<double>(DSBFREQUENCY_MAX);
-                const DWORD clamped = static_cast<DWORD>(clampedD);
-                appliedSpeed = base > 0 ? static_cast<float>(clampedD) / static_cast<float>(base) : userSpeed;
+                // Target Hz is clamped to the DirectSound range; the DSP restores pitch by the speed achieved.
+                appliedSpeed = info.frequency.appliedSpeed(userSpeed);
+                // The settings are only re-read when they changed, not on every Unlock.
+                const std::uint32_t dspVersion = SharedSettingsManager::instance().dspConfigVersion();
+                if (!info.stream || dspVersion != info.dspVersion) {
+                    const DspConfig dspCfg = SharedSettingsManager::instance().dspConfig(DspMode::Pitch);
+                    if (!info.stream) {
+                        info.stream = std::make_unique<AudioStreamProcessor>(info.sampleRate, info.channels,
+                                                                             info.blockAlign, dspCfg);
+                    } else {
+                        info.stream->setDspConfig(dspCfg); // preset changed at runtime: retune in place
+                    }
+                    info.dspVersion = dspVersion;
+                }
+                // processAllAudio on music: QuickSeek is transparent enough and leaves headroom for voices.
+                info.stream->setTierFloor(content == AudioContent::Music ? QualityTier::QuickSeek
+                                                                         : QualityTier::Full);
                 if (info.stream) {
-                    auto res = info.stream->process(combined.data(), combined.size(), appliedSpeed, shouldLog,
-                                                    reinterpret_cast<std::uintptr_t>(self));
-                    if (!res.output.empty()) {
-                        combined.swap(res.output);
+                    AudioProcessResult res;
+                    if (info.stream->prefersInPlace(totalBytes)) {
+                        // Huge one-shot buffer: stream it through fixed-size chunks straight into the lock regions.
+                        res = info.stream->processInPlace(static_cast<std::uint8_t *>(pAudioPtr1), bytes1,
+                                                          static_cast<std::uint8_t *>(pAudioPtr2), bytes2,
+                                                          appliedSpeed, shouldLog,
+                                                          reinterpret_cast<std::uintptr_t>(self));
+                    } else {
+                        combined.reserve(totalBytes);
+                        if (bytes1) {
+                            auto *ptr = static_cast<std::uint8_t *>(pAudioPtr1);
+                            combined.insert(combined.end(), ptr, ptr + bytes1);
+                        }
+                        if (bytes2) {
+                            auto *ptr = static_cast<std::uint8_t *>(pAudioPtr2);
+                            combined.insert(combined.end(), ptr, ptr + bytes2);
+                        }
+                        res = info.stream->process(combined.data(), combined.size(), appliedSpeed, shouldLog,
+                                                   reinterpret_cast<std::uintptr_t>(self));
+                        if (!res.output.empty()) {
+                            combined.swap(res.output);
+                        }
                     }
+                    SharedStatusManager::instance().setDspQuality(info.stream->qualityTier(DspMode::Pitch),
+                                                                  info.stream->dspLoad());
+                    SharedStatusManager::instance().setRenderCacheStats(VoiceRenderCache::instance().stats());
                     if (shouldLog) {
-                        KRKR_LOG_DEBUG("DS SetFrequency applied: base=" + std::to_string(base) +
-                                       " target=" + std::to_string(clamped) +
+                        KRKR_LOG_DEBUG("DS SetFrequency applied: base=" + std::to_string(info.frequency.gameFrequency()) +
+                                       " target=" + std::to_string(info.frequency.target(userSpeed)) +
                                        " appliedSpeed=" + std::to_string(appliedSpeed) +
-                                       " cbuf=" + std::to_string(res.cbufferSize));
+                                       " cbuf=" + std::to_string(res.cbufferSize) +
+                                       " backlogMs=" + std::to_string(res.backlogMs));
                     }
                 }
                 lastAppliedSpeedForPlay = appliedSpeed;
             }
 
-            // Enforce desired frequency each unlock to override game changes.
-            const DWORD desiredFreq = [&]() {
-                if (doDsp) {
-                    const DWORD base = info.baseFrequency ? info.baseFrequency : info.sampleRate;
-                    const double scaled = static_cast<double>(base) * static_cast<double>(userSpeed);
-                    double clampedD = std::clamp(scaled, static_cast<double>(DSBFREQUENCY_MIN),
-                                                 static_cast<double>(DSBFREQUENCY_MAX));
-                    return static_cast<DWORD>(clampedD);
-                }
-                return static_cast<DWORD>(info.baseFrequency ? info.baseFrequency : info.sampleRate);
-            }();
-            DWORD currentFreq = 0;
-            bool freqMismatch = true;
-            if (SUCCEEDED(self->GetFrequency(&currentFreq))) {
-                freqMismatch = (currentFreq != desiredFreq);
-            }
-            if (freqMismatch) {
-                if (FAILED(self->SetFrequency(desiredFreq))) {
+            // Re-assert the frequency only when the target moved (speed, processing decision or the game's
+            // own SetFrequency, which goes through SetFrequencyHook): no COM round trip otherwise.
+            if (info.frequency.needsApply(targetSpeed)) {
+                const DWORD desiredFreq = info.frequency.target(targetSpeed);
+                const DWORD prevFreq = info.frequency.applied();
+                const bool setOk = m_origSetFrequency && SUCCEEDED(m_origSetFrequency(self, desiredFreq));
+                info.frequency.onApplied(targetSpeed, setOk);
+                if (!setOk) {
                     KRKR_LOG_WARN("DS: SetFrequency failed buf=" +
                                   std::to_string(reinterpret_cast<std::uintptr_t>(self)) +
                                   " desired=" + std::to_string(desiredFreq));
@@ -550,10 +805,14 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
                     KRKR_LOG_DEBUG("DS: enforced frequency buf=" +
                                    std::to_string(reinterpret_cast<std::uintptr_t>(self)) +
                                    " desired=" + std::to_string(desiredFreq) +
-                                   " prev=" + std::to_string(currentFreq));
+                                   " prev=" + std::to_string(prevFreq));
                 }
             }
             info.processedFrames += frames;
+            // Track expected playback end time for stream reset heuristic.
+            if (info.stream) {
+                info.stream->recordPlaybackEnd(durationSec, lastAppliedSpeedForPlay > 0.01f ? lastAppliedSpeedForPlay : 1.0f);
+            }
             break; // processed successfully
         } else {
             // Unknown buffer: try to discover format and start tracking, then loop to process.
@@ -568,7 +827,7 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
                     info.channels = fx->nChannels;
                     info.bitsPerSample = fx->wBitsPerSample;
                     info.formatTag = fx->wFormatTag;
-                    info.baseFrequency = fx->nSamplesPerSec;
+                    info.frequency = FrequencyPolicy(fx->nSamplesPerSec);
                     info.blockAlign = fx->nBlockAlign ? fx->nBlockAlign : (fx->nChannels * fx->wBitsPerSample / 8);
                     // Estimate duration from buffer caps if available.
                     DSBCAPS caps{};
@@ -585,14 +844,15 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
                     }
                     info.isPcm16 = (fx->wFormatTag == WAVE_FORMAT_PCM && fx->wBitsPerSample == 16);
                     info.loggedFormat = false;
-                    DspConfig cfg{};
-                    info.stream = std::make_unique<AudioStreamProcessor>(info.sampleRate, info.channels, info.blockAlign, cfg);
                     auto key = reinterpret_cast<std::uintptr_t>(self);
                     auto now = std::chrono::steady_clock::now();
+                    info.created = now;
+                    info.profileClass = m_profile.classify(
+                        signatureOf(info.sampleRate, info.channels, info.bitsPerSample, info.bufferBytes));
                     auto reuse = m_bgmReleaseTimes.find(key);
                     if (reuse != m_bgmReleaseTimes.end()) {
                         auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - reuse->second).count();
-                        if (diff <= 5000) {
+                        if (diff <= 5000 && info.profileClass != StreamClass::Voice) {
                             info.isLikelyBgm = true;
                             KRKR_LOG_INFO("DS: buffer reused soon after BGM release; marking BGM buf=" + std::to_string(key));
                         }
@@ -616,7 +876,7 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
                 return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
             }
             auto it2 = m_buffers.find(reinterpret_cast<std::uintptr_t>(self));
-            if (it2 == m_buffers.end() || !it2->second.stream) {
+            if (it2 == m_buffers.end()) {
                 KRKR_LOG_WARN("DS Unlock: tracking failed; passthrough");
                 return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
             }
@@ -633,27 +893,97 @@ HRESULT DirectSoundHook::handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr
         }
     }
 
-    if (!processedInfo) {
+    if (!processedInfo || combined.empty()) {
         return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
     }
 
     // Write combined buffer back into the two regions.
     std::size_t cursor = 0;
-    if (pAudioPtr1 && dwAudioBytes1) {
-        std::memcpy(pAudioPtr1, combined.data(), dwAudioBytes1);
-        cursor += dwAudioBytes1;
+    if (bytes1) {
+        std::memcpy(pAudioPtr1, combined.data(), std::min(bytes1, combined.size()));
+        cursor += bytes1;
     }
-    if (pAudioPtr2 && dwAudioBytes2) {
-        std::memcpy(pAudioPtr2, combined.data() + cursor, dwAudioBytes2);
+    if (bytes2 && combined.size() > cursor) {
+        std::memcpy(pAudioPtr2, combined.data() + cursor, std::min(bytes2, combined.size() - cursor));
     }
 
-    // Track expected playback end time for stream reset heuristic.
-    const float applied = lastAppliedSpeedForPlay > 0.01f ? lastAppliedSpeedForPlay : 1.0f;
-    if (processedInfo->stream) {
-        processedInfo->stream->recordPlaybackEnd(processedDurationSec, applied);
+    return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
+}
+
+void DirectSoundHook::restoreBaseFrequency(IDirectSoundBuffer *self, std::uint32_t engagement) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto key = reinterpret_cast<std::uintptr_t>(self);
+    if (!m_frequencyRestore.opened(engagement)) {
+        std::vector<std::uintptr_t> retuned;
+        for (const auto &entry : m_buffers) {
+            if (entry.second.frequency.retuned()) retuned.push_back(entry.first);
+        }
+        m_frequencyRestore.begin(engagement, retuned);
+        if (retuned.size() > FrequencyRestore::kMaxPending) {
+            KRKR_LOG_DEBUG("DS: " + std::to_string(retuned.size()) + " retuned buffers; restoring the first " +
+                           std::to_string(FrequencyRestore::kMaxPending));
+        }
+    }
+    auto it = m_buffers.find(key);
+    if (it != m_buffers.end() && it->second.frequency.retuned()) {
+        auto &policy = it->second.frequency;
+        const bool ok = m_origSetFrequency && SUCCEEDED(m_origSetFrequency(self, policy.target(1.0f)));
+        policy.onApplied(1.0f, ok);
     }
+    m_frequencyRestore.done(key);
+    if (m_frequencyRestore.settle(engagement)) {
+        KRKR_LOG_DEBUG("DS: base frequency restore complete");
+    }
+}
 
-    return m_origUnlock(self, pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
+void DirectSoundHook::trimStreamsLocked(std::chrono::steady_clock::time_point now, std::uintptr_t activeKey) {
+    if (m_lastStreamTrim.time_since_epoch().count() != 0 && now - m_lastStreamTrim < kStreamTrimInterval) {
+        return;
+    }
+    m_lastStreamTrim = now;
+
+    std::size_t liveBytes = 0;
+    std::size_t released = 0;
+    std::vector<std::pair<std::chrono::steady_clock::time_point, BufferInfo *>> live;
+    for (auto &[key, info] : m_buffers) {
+        if (!info.stream || !info.stream->hasDsp()) continue;
+        if (key != activeKey && now - info.lastUse > kStreamIdleRelease) {
+            // Keep the processor (idle thresholds, governor, render state); only its DSP and carry buffers go.
+            info.stream->releaseDsp();
+            released++;
+            continue;
+        }
+        liveBytes += info.stream->memoryFootprint();
+        if (key != activeKey) {
+            live.emplace_back(info.lastUse, &info);
+        }
+    }
+
+    std::size_t evicted = 0;
+    if (liveBytes > kStreamMemoryCap) {
+        std::sort(live.begin(), live.end(),
+                  [](const auto &a, const auto &b) { return a.first < b.first; });
+        for (auto &entry : live) {
+            if (liveBytes <= kStreamMemoryCap) break;
+            const std::size_t bytes = entry.second->stream->memoryFootprint();
+            entry.second->stream->releaseDsp();
+            liveBytes -= std::min(liveBytes, bytes);
+            evicted++;
+        }
+    }
+
+    // Released streams park their pipelines in the pool, so the spares there share the same cap.
+    const std::size_t poolFreed =
+        DspPipelinePool::instance().trim(kStreamMemoryCap - std::min(liveBytes, kStreamMemoryCap));
+
+    if (released > 0 || evicted > 0 || poolFreed > 0) {
+        m_streamsEvicted += released + evicted;
+        KRKR_LOG_DEBUG("DS streams trimmed: idleReleased=" + std::to_string(released) +
+                       " lruEvicted=" + std::to_string(evicted) +
+                       " liveBytes=" + std::to_string(liveBytes) +
+                       " poolFreed=" + std::to_string(poolFreed) +
+                       " totalFreed=" + std::to_string(m_streamsEvicted));
+    }
 }
 
 void DirectSoundHook::patchDeviceVtable(IDirectSound8 *ds8) {
@@ -698,12 +1028,20 @@ void DirectSoundHook::patchBufferVtable(IDirectSoundBuffer *buf) {
     if (!m_origRelease) {
         m_origRelease = reinterpret_cast<PFN_Release>(origVtbl[2]);
     }
+    if (!m_origGetFrequency) {
+        m_origGetFrequency = reinterpret_cast<PFN_GetFrequency>(origVtbl[8]);
+    }
+    if (!m_origSetFrequency) {
+        m_origSetFrequency = reinterpret_cast<PFN_SetFrequency>(origVtbl[17]);
+    }
     shadow[19] = reinterpret_cast<void *>(&DirectSoundHook::UnlockHook);
     shadow[2] = reinterpret_cast<void *>(&DirectSoundHook::ReleaseHook);
+    shadow[8] = reinterpret_cast<void *>(&DirectSoundHook::GetFrequencyHook);
+    shadow[17] = reinterpret_cast<void *>(&DirectSoundHook::SetFrequencyHook);
 
     *reinterpret_cast<void ***>(buf) = shadow.data();
     m_bufferVtables[buf] = std::move(shadow);
-    KRKR_LOG_INFO("Applied shadow vtable for IDirectSoundBuffer instance (Release, Unlock)");
+    KRKR_LOG_INFO("Applied shadow vtable for IDirectSoundBuffer instance (Release, Unlock, Get/SetFrequency)");
 }
 
 void DirectSoundHook::installGlobalUnlockHook() {
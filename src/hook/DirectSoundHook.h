@@ -9,7 +9,11 @@
 #include <string>
 #include <unordered_map>
 #include <chrono>
+#include <filesystem>
 #include "../common/AudioStreamProcessor.h"
+#include "../common/FrequencyPolicy.h"
+#include "../common/SpeechMusicClassifier.h"
+#include "../common/StreamProfileStore.h"
 
 namespace krkrspeed {
 
@@ -26,6 +30,9 @@ public:
     void configure(const Config &cfg);
 
     void applySharedSettingsFallback();
+    // Learned per-executable stream profile (krkr_stream_profiles.bin next to the controller config);
+    // call before initialize() so the first buffers are pre-classified.
+    void loadStreamProfile(HMODULE hookModule);
 
     // Allow late binding when DirectSoundCreate8 is resolved dynamically.
     void setOriginalCreate8(void *fn);
@@ -46,6 +53,8 @@ public:
     static HRESULT WINAPI UnlockHook(IDirectSoundBuffer *self, LPVOID pAudioPtr1, DWORD dwAudioBytes1, LPVOID pAudioPtr2,
                                      DWORD dwAudioBytes2);
     static ULONG __stdcall ReleaseHook(IDirectSoundBuffer *self);
+    static HRESULT __stdcall SetFrequencyHook(IDirectSoundBuffer *self, DWORD dwFrequency);
+    static HRESULT __stdcall GetFrequencyHook(IDirectSoundBuffer *self, LPDWORD pdwFrequency);
 
     __declspec(noinline) HRESULT handleUnlock(IDirectSoundBuffer *self, LPVOID pAudioPtr1, DWORD dwAudioBytes1,
                                               LPVOID pAudioPtr2, DWORD dwAudioBytes2);
@@ -53,18 +62,25 @@ public:
 private:
     DirectSoundHook() = default;
     void hookEntryPoints();
+    void trimStreamsLocked(std::chrono::steady_clock::time_point now, std::uintptr_t activeKey);
+    // Disengaged passthrough: put `self` back on its base frequency if processing had retuned it.
+    void restoreBaseFrequency(IDirectSoundBuffer *self, std::uint32_t engagement);
 
     using PFN_DirectSoundCreate8 = HRESULT(WINAPI *)(LPCGUID, LPDIRECTSOUND8 *, LPUNKNOWN);
     using PFN_DirectSoundCreate = HRESULT(WINAPI *)(LPCGUID, LPDIRECTSOUND *, LPUNKNOWN);
     using PFN_CreateSoundBuffer = HRESULT(__stdcall *)(IDirectSound8 *, LPDIRECTSOUNDBUFFER *, LPCDSBUFFERDESC);
     using PFN_Unlock = HRESULT(__stdcall *)(IDirectSoundBuffer *, LPVOID, DWORD, LPVOID, DWORD);
     using PFN_Release = ULONG(__stdcall *)(IDirectSoundBuffer *);
+    using PFN_SetFrequency = HRESULT(__stdcall *)(IDirectSoundBuffer *, DWORD);
+    using PFN_GetFrequency = HRESULT(__stdcall *)(IDirectSoundBuffer *, LPDWORD);
 
     PFN_DirectSoundCreate8 m_origCreate8 = nullptr;
     PFN_DirectSoundCreate m_origCreate = nullptr;
     PFN_CreateSoundBuffer m_origCreateBuffer = nullptr;
     PFN_Unlock m_origUnlock = nullptr;
     PFN_Release m_origRelease = nullptr;
+    PFN_SetFrequency m_origSetFrequency = nullptr;
+    PFN_GetFrequency m_origGetFrequency = nullptr;
 
     struct BufferInfo {
         std::uint32_t sampleRate = 0;
@@ -72,7 +88,6 @@ private:
         std::uint16_t bitsPerSample = 16;
         bool isPcm16 = true;
         std::uint16_t formatTag = WAVE_FORMAT_PCM;
-        std::uint32_t baseFrequency = 0;
         std::uint32_t bufferBytes = 0;
         std::uint32_t blockAlign = 0;
         float approxSeconds = 0.0f;
@@ -80,8 +95,21 @@ private:
         bool loggedFormat = false;
         std::uint64_t unlockCount = 0;
         std::uint64_t processedFrames = 0;
-        std::unique_ptr<AudioStreamProcessor> stream;
+        std::chrono::steady_clock::time_point lastUse{};
+        FrequencyPolicy frequency; // game's frequency vs. what is on the buffer; see SetFrequencyHook
+        std::unique_ptr<AudioStreamProcessor> stream; // created on the first Unlock that needs DSP
+        std::uint32_t dspVersion = 0; // SharedSettingsManager::dspConfigVersion() `stream` was configured for
+        std::uint32_t engagement = 0; // SharedSettingsManager::engagement() this state was last used under
+        StreamClass profileClass = StreamClass::Unknown; // what earlier runs learned for this signature
+        bool profileRecorded = false;
+        std::chrono::steady_clock::time_point created{};
+        std::unique_ptr<SpeechMusicClassifier> content; // speech/music verdict on what plays through it
     };
+    // Feed the heuristics' verdict on `info` into the stream profile once; caller holds m_mutex.
+    void recordProfileLocked(BufferInfo &info, std::chrono::steady_clock::time_point now);
+    // Merges the learned profile into m_profilePath if it changed; runs on the settings watcher thread.
+    void saveProfile();
+
     std::map<std::uintptr_t, BufferInfo> m_buffers;
     std::set<std::string> m_loggedFormats;
     std::mutex m_mutex;
@@ -101,6 +129,15 @@ private:
     std::atomic<bool> m_loggedFragmentedClear{false};
     std::atomic<bool> m_loggedMonoStereo{false};
     std::unordered_map<std::uintptr_t, std::chrono::steady_clock::time_point> m_bgmReleaseTimes;
+    std::chrono::steady_clock::time_point m_lastStreamTrim{};
+    std::uint64_t m_streamsEvicted = 0;
+    FrequencyRestore m_frequencyRestore; // retuned buffers still to be restored after a disengage
+    StreamProfile m_profile; // guarded by m_mutex
+    bool m_profileDirty = false;
+    std::filesystem::path m_profilePath;
+    std::uint64_t m_profileExe = 0;
+    std::atomic<bool> m_profileSaverStarted{false};
+    bool m_profileSaveFailed = false; // saveProfile() only, so the failure is logged once
 };
 
 } // namespace krkrspeed
@@ -21,6 +21,19 @@ bool patchThunk(void *address, void *replacement, void **original) {
 }
 } // namespace
 
+std::filesystem::path HookDataDirectory(HMODULE hookModule) {
+    wchar_t buffer[MAX_PATH] = {};
+    if (!hookModule || GetModuleFileNameW(hookModule, buffer, MAX_PATH) == 0) {
+        return {};
+    }
+    auto dir = std::filesystem::path(buffer).parent_path();
+    const auto leaf = dir.filename().wstring();
+    if (_wcsicmp(leaf.c_str(), L"x86") == 0 || _wcsicmp(leaf.c_str(), L"x64") == 0) {
+        dir = dir.parent_path();
+    }
+    return dir;
+}
+
 bool PatchImportInModule(HMODULE module, const char *importModule, const char *functionName, void *replacement,
                          void **original) {
     if (!module || !importModule || !functionName || !replacement) {
@@ -2,6 +2,7 @@
 
 #include <Windows.h>
 #include <cstddef>
+#include <filesystem>
 
 namespace krkrspeed {
 
@@ -12,6 +13,11 @@ bool PatchImport(const char *importModule, const char *functionName, void *repla
 bool PatchImportInModule(HMODULE module, const char *importModule, const char *functionName, void *replacement,
                          void **original);
 
+// Directory the hook reads and writes its data files in (stream profiles, tuning table, pre-render pack): the
+// controller's directory, which holds krkr_speed_config.yaml. Per-arch hook builds sit one level below it in
+// x86/x64; a hook DLL anywhere else uses its own directory. Empty if the module path is unavailable.
+std::filesystem::path HookDataDirectory(HMODULE hookModule);
+
 // Replace a vtable slot with a new function and return the old value.
 template <typename T>
 bool PatchVtableEntry(void **vtable, std::size_t index, T replacement, T &original) {
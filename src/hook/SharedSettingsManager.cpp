@@ -1,17 +1,27 @@
 #include "SharedSettingsManager.h"
+#include "HookUtils.h"
 #include "../common/Logging.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <filesystem>
+#include <thread>
 
 namespace krkrspeed {
 
+namespace {
+constexpr float kEngageEpsilon = 0.001f;
+constexpr auto kWatchInterval = std::chrono::milliseconds(50);
+} // namespace
+
 SharedSettingsManager &SharedSettingsManager::instance() {
     static SharedSettingsManager mgr;
     return mgr;
 }
 
 void SharedSettingsManager::attachSharedSettings() {
+    std::lock_guard<std::mutex> attachLock(m_attachMutex);
     if (m_sharedView) {
         return;
     }
@@ -42,14 +52,32 @@ void SharedSettingsManager::applySharedSettings(const SharedSettings &settings)
     const bool gateChanged =
         gateEnabled != m_lengthGateEnabled || std::fabs(newGateSeconds - m_lengthGateSeconds) > 0.001f;
 
+    const auto newPreset = settings.dspPreset <= static_cast<std::uint32_t>(DspPreset::Quality)
+                               ? static_cast<DspPreset>(settings.dspPreset)
+                               : DspPreset::Balanced;
+    const bool presetChanged = newPreset != m_dspPreset;
+
     m_userSpeed = newSpeed;
     m_lengthGateEnabled = gateEnabled;
     m_lengthGateSeconds = newGateSeconds;
+    m_dspPreset = newPreset;
 
+    if (speedChanged || presetChanged) {
+        m_dspConfigVersion.fetch_add(1, std::memory_order_release);
+    }
     if (speedChanged) {
         m_speedChangeCounter.fetch_add(1);
         KRKR_LOG_INFO("Shared speed updated to " + std::to_string(m_userSpeed) + "x");
     }
+    if (presetChanged) {
+        KRKR_LOG_INFO(std::string("Shared DSP preset ") + dspPresetName(m_dspPreset));
+    }
+    const bool engage = std::fabs(m_userSpeed - 1.0f) > kEngageEpsilon;
+    const std::uint32_t engagement = m_engagement.load(std::memory_order_relaxed);
+    if (engage != isEngaged(engagement)) {
+        m_engagement.store(engagement + 1, std::memory_order_relaxed);
+        KRKR_LOG_INFO(std::string("Speed processing ") + (engage ? "engaged" : "disengaged; hooks pass through"));
+    }
     if (gateChanged) {
         KRKR_LOG_INFO(std::string("Shared length gate ") + (m_lengthGateEnabled ? "enabled" : "disabled") +
                       " @ " + std::to_string(m_lengthGateSeconds) + "s");
@@ -67,6 +95,61 @@ void SharedSettingsManager::pollSharedSettings() {
     applySharedSettings(snapshot);
 }
 
+void SharedSettingsManager::startWatcher() {
+    if (m_watcherStarted.exchange(true)) {
+        return;
+    }
+    std::thread([this]() { watchLoop(); }).detach();
+}
+
+void SharedSettingsManager::addPeriodicTask(std::chrono::milliseconds interval, std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(m_taskMutex);
+    m_tasks.push_back(PeriodicTask{interval, std::chrono::steady_clock::now() + interval, std::move(task)});
+}
+
+void SharedSettingsManager::runDueTasks() {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::function<void()>> due;
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        for (auto &task : m_tasks) {
+            if (now < task.due) continue;
+            task.due = now + task.interval;
+            due.push_back(task.run);
+        }
+    }
+    for (const auto &run : due) {
+        try {
+            run();
+        } catch (...) {
+            KRKR_LOG_WARN("Periodic hook task threw; it will run again next interval");
+        }
+    }
+}
+
+void SharedSettingsManager::watchLoop() {
+    bool haveVersion = false;
+    std::uint32_t lastVersion = 0;
+    for (;;) {
+        std::this_thread::sleep_for(kWatchInterval);
+        runDueTasks();
+        if (!m_sharedView) {
+            attachSharedSettings();
+            if (!m_sharedView) {
+                continue;
+            }
+        }
+        const std::uint32_t version = static_cast<volatile const SharedSettings *>(m_sharedView)->version;
+        if (haveVersion && version == lastVersion) {
+            continue;
+        }
+        haveVersion = true;
+        lastVersion = version;
+        SharedSettings snapshot = *m_sharedView;
+        applySharedSettings(snapshot);
+    }
+}
+
 float SharedSettingsManager::getUserSpeed() const {
     std::lock_guard<std::mutex> lock(m_mutex);
     return m_userSpeed;
@@ -82,4 +165,36 @@ float SharedSettingsManager::lengthGateSeconds() const {
     return m_lengthGateSeconds;
 }
 
+void SharedSettingsManager::loadTuningTable(HMODULE hookModule) {
+    const auto dir = HookDataDirectory(hookModule);
+    if (dir.empty()) {
+        return;
+    }
+    const auto path = dir / kDspTuningFileName;
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return;
+    }
+    DspTuningTable table;
+    std::string error;
+    if (!table.load(path, error)) {
+        KRKR_LOG_WARN("DSP tuning table ignored: " + error);
+        return;
+    }
+    KRKR_LOG_INFO("Loaded DSP tuning table with " + std::to_string(table.entries().size()) + " bands");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tuning = std::move(table);
+    m_dspConfigVersion.fetch_add(1, std::memory_order_release);
+}
+
+DspConfig SharedSettingsManager::dspConfig(DspMode mode) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_dspPreset == DspPreset::Balanced) {
+        if (const DspConfig *tuned = m_tuning.find(m_userSpeed, mode)) {
+            return *tuned;
+        }
+    }
+    return dspPresetConfig(m_dspPreset);
+}
+
 } // namespace krkrspeed
@@ -1,9 +1,14 @@
 #pragma once
 
 #include "../common/SharedSettings.h"
+#include "../common/DspPipeline.h"
+#include "../common/DspTuningTable.h"
 #include <Windows.h>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <mutex>
+#include <vector>
 
 namespace krkrspeed {
 
@@ -14,24 +19,59 @@ public:
     void attachSharedSettings();
     void pollSharedSettings();
     void applySharedSettings(const SharedSettings &settings);
+    // Starts the background thread that re-applies the shared settings whenever their version changes,
+    // so the engagement state stays current while the hooks sit on their passthrough fast path.
+    void startWatcher();
+    // Runs `task` on the watcher thread every `interval`, between settings checks. For slow housekeeping that
+    // would otherwise need a thread of its own: hook threads cannot be joined from a DLL detach, so they are
+    // never joined, and this one already exists.
+    void addPeriodicTask(std::chrono::milliseconds interval, std::function<void()> task);
+    // Loads krkr_dsp_tuning.txt from HookDataDirectory() if present (see tools/dsp_autotune).
+    void loadTuningTable(HMODULE hookModule);
+
+    // Odd while speed processing is engaged (speed away from 1.0); bumped on every engage/disengage
+    // transition so hooks can tell that per-stream state predates the current engagement.
+    std::uint32_t engagement() const { return m_engagement.load(std::memory_order_relaxed); }
+    static bool isEngaged(std::uint32_t engagement) { return (engagement & 1u) != 0; }
 
     float getUserSpeed() const;
     bool isLengthGateEnabled() const;
     float lengthGateSeconds() const;
+    // Preset config; under the default (balanced) preset a loaded tuning table overrides it per speed band.
+    DspConfig dspConfig(DspMode mode) const;
+    // Bumped whenever dspConfig() may answer differently (speed, preset, tuning table); starts at 1, so a
+    // cached 0 always refreshes. Lets the render paths keep their config without taking m_mutex per buffer.
+    std::uint32_t dspConfigVersion() const { return m_dspConfigVersion.load(std::memory_order_acquire); }
     std::uint64_t speedChangeCounter() const { return m_speedChangeCounter.load(); }
 
 private:
     SharedSettingsManager() = default;
+    void watchLoop();
+    void runDueTasks();
+
+    struct PeriodicTask {
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point due;
+        std::function<void()> run;
+    };
 
     mutable std::mutex m_mutex;
     float m_userSpeed = 1.5f;
     bool m_lengthGateEnabled = true;
     float m_lengthGateSeconds = 60.0f;
+    DspPreset m_dspPreset = DspPreset::Balanced;
+    DspTuningTable m_tuning;
 
     HANDLE m_sharedMapping = nullptr;
     SharedSettings *m_sharedView = nullptr;
     std::atomic<std::uint64_t> m_speedChangeCounter{0};
+    std::atomic<std::uint32_t> m_dspConfigVersion{1};
     std::atomic<bool> m_warnedMissingMap{false};
+    std::mutex m_attachMutex;
+    std::atomic<std::uint32_t> m_engagement{1}; // default speed (1.5x) starts engaged
+    std::atomic<bool> m_watcherStarted{false};
+    std::mutex m_taskMutex;
+    std::vector<PeriodicTask> m_tasks; // guarded by m_taskMutex
 };
 
 } // namespace krkrspeed
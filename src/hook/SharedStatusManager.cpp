@@ -48,4 +48,63 @@ void SharedStatusManager::setActiveBackend(AudioBackend backend) {
     m_lastBackend = backend;
 }
 
+void SharedStatusManager::setFrameRateTelemetry(std::int64_t driftFrames, std::int32_t correctionFrames,
+                                                std::uint32_t sampleRate) {
+    const std::uint64_t now = GetTickCount64();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_lastTelemetryMs != 0 && now - m_lastTelemetryMs < 250) {
+        return;
+    }
+    m_lastTelemetryMs = now;
+    ensureMapping();
+    if (!m_view) {
+        return;
+    }
+    m_view->wasapiDriftFrames = driftFrames;
+    m_view->wasapiCorrectionFrames = correctionFrames;
+    m_view->wasapiSampleRate = sampleRate;
+    m_view->lastUpdateMs = now;
+}
+
+void SharedStatusManager::setDspQuality(QualityTier tier, float load) {
+    const std::uint64_t now = GetTickCount64();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (tier < m_qualityTier && now - m_qualityTierMs < 1000) {
+        return; // another stream is degraded further
+    }
+    const bool changed = tier != m_qualityTier;
+    m_qualityTier = tier;
+    m_qualityTierMs = now;
+    if (!changed && now - m_lastQualityWriteMs < 250) {
+        return;
+    }
+    m_lastQualityWriteMs = now;
+    ensureMapping();
+    if (!m_view) {
+        return;
+    }
+    m_view->dspQualityTier = static_cast<std::uint32_t>(tier);
+    m_view->dspLoad = load;
+    m_view->lastUpdateMs = now;
+}
+
+void SharedStatusManager::setRenderCacheStats(const VoiceRenderCacheStats &stats) {
+    const std::uint64_t now = GetTickCount64();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (now - m_lastCacheWriteMs < 250) {
+        return;
+    }
+    m_lastCacheWriteMs = now;
+    ensureMapping();
+    if (!m_view) {
+        return;
+    }
+    m_view->renderCacheHits = stats.hits;
+    m_view->renderCacheMisses = stats.misses;
+    m_view->renderCacheBytesSaved = stats.bytesSaved;
+    m_view->renderCacheBytes = stats.bytes;
+    m_view->renderCacheEntries = stats.entries;
+    m_view->lastUpdateMs = now;
+}
+
 } // namespace krkrspeed
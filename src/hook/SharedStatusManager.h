@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../common/SharedStatus.h"
+#include "../common/DspPipeline.h"
+#include "../common/VoiceRenderCache.h"
 #include <Windows.h>
 #include <atomic>
 #include <mutex>
@@ -12,6 +14,12 @@ public:
     static SharedStatusManager &instance();
 
     void setActiveBackend(AudioBackend backend);
+    // Throttled; drop-mode drift/correction for the status UI and diagnostics.
+    void setFrameRateTelemetry(std::int64_t driftFrames, std::int32_t correctionFrames, std::uint32_t sampleRate);
+    // Per DSP call; publishes the worst tier reported within the last second (writes throttled).
+    void setDspQuality(QualityTier tier, float load);
+    // Throttled; VoiceRenderCache counters.
+    void setRenderCacheStats(const VoiceRenderCacheStats &stats);
 
 private:
     SharedStatusManager() = default;
@@ -21,6 +29,11 @@ private:
     HANDLE m_mapping = nullptr;
     SharedStatus *m_view = nullptr;
     AudioBackend m_lastBackend = AudioBackend::Unknown;
+    std::uint64_t m_lastTelemetryMs = 0;
+    QualityTier m_qualityTier = QualityTier::Full;
+    std::uint64_t m_qualityTierMs = 0;
+    std::uint64_t m_lastQualityWriteMs = 0;
+    std::uint64_t m_lastCacheWriteMs = 0;
     std::atomic<bool> m_warned{false};
 };
 
@@ -4,7 +4,13 @@
 #include "SharedSettingsManager.h"
 #include "SharedStatusManager.h"
 #include "../common/Logging.h"
+#include "../common/AudioStages.h"
 #include "../common/AudioStreamProcessor.h"
+#include "../common/DspPipelinePool.h"
+#include "../common/FrameRateController.h"
+#include "../common/SpeechMusicClassifier.h"
+#include "../common/StreamAnalysis.h"
+#include "../common/VirtualPaddingModel.h"
 
 #include <mmdeviceapi.h>
 #include <audioclient.h>
@@ -45,6 +51,7 @@ std::atomic<bool> g_bootstrapDone{false};
 std::atomic<bool> g_loggedDefaultFormat{false};
 std::atomic<bool> g_loggedSilenceGate{false};
 std::atomic<bool> g_loggedFirstNonSilentDrop{false};
+std::atomic<bool> g_loggedVirtualPadding{false};
 std::atomic<void *> g_bootstrapAudioClient{nullptr};
 
 const GUID kClsidMMDeviceEnumerator = {0xbcde0395, 0xe52f, 0x467c, {0x8e, 0x3d, 0xc4, 0x57, 0x92, 0x91, 0x69, 0x2e}};
@@ -85,16 +92,31 @@ struct StreamContext {
     bool isFloat32 = false;
     bool formatGuessed = false;
     std::unique_ptr<AudioStreamProcessor> stream;
+    // What `stream` was last configured with: SharedSettingsManager::dspConfigVersion() (0 = never, so a new
+    // stream is always configured once) and the voice gate, so ReleaseBuffer only re-reads the settings when
+    // they change.
+    std::uint32_t dspVersion = 0;
+    bool voiceGate = false;
     std::mutex mutex;
-    double targetFrames = 0.0;
-    std::uint64_t outFrames = 0;
-    std::int64_t lastEffective = 0;
+    FrameRateController rate; // drop mode: frames released per ReleaseBuffer
+    // GetCurrentPadding virtualization: releases as (game frames, engine frames) and the buffer size the
+    // game was given (cached after Initialize, so GetCurrentPadding never calls into the client under `mutex`).
+    VirtualPaddingModel padding;
+    std::atomic<std::uint32_t> bufferFrames{0};
+    std::uint32_t engagement = 0; // SharedSettingsManager::engagement() the state above belongs to
+    // Render path: native format -> pcm16 -> stretch -> fit -> native, compiled for `renderStream`.
+    StageGraph render;
+    AudioStreamProcessor *renderStream = nullptr;
+    std::chrono::steady_clock::time_point lastTimingLog{};
+    // Runs for the stream's whole life (its verdict follows the content); built for the final format.
+    std::unique_ptr<SpeechMusicClassifier> content;
 };
 
 struct RenderState {
     std::shared_ptr<StreamContext> ctx;
     BYTE *lastBuffer = nullptr;
     UINT32 lastFrames = 0;
+    std::uint32_t engagement = 0; // engagement the lastBuffer was recorded under
     bool seenNonSilent = false;
     bool droppedFirstNonSilent = false;
 };
@@ -119,11 +141,58 @@ std::mutex g_formatMutex;
 DefaultFormat g_defaultFormat;
 bool g_haveDefaultFormat = false;
 
+void createStream(StreamContext &ctx, const DspConfig &cfg) {
+    ctx.stream = std::make_unique<AudioStreamProcessor>(ctx.sampleRate, ctx.channels, ctx.dspBlockAlign, cfg);
+    ctx.dspVersion = 0;
+}
+
 void ensureStream(StreamContext &ctx) {
     if (!ctx.stream && ctx.sampleRate > 0 && ctx.channels > 0 && ctx.dspBlockAlign > 0) {
-        DspConfig cfg{};
-        ctx.stream = std::make_unique<AudioStreamProcessor>(ctx.sampleRate, ctx.channels, ctx.dspBlockAlign, cfg);
+        createStream(ctx, SharedSettingsManager::instance().dspConfig(DspMode::Tempo));
+    }
+}
+
+StreamFormat streamFormat(const StreamContext &ctx) {
+    StreamFormat fmt;
+    fmt.sample = ctx.isFloat32 ? SampleFormat::Float32 : (ctx.isPcm32 ? SampleFormat::Pcm32 : SampleFormat::Pcm16);
+    fmt.channels = ctx.channels;
+    fmt.sampleRate = ctx.sampleRate;
+    return fmt;
+}
+
+// (Re)compiles the render graph when the format, stream or largest buffer changes; steady-state
+// ReleaseBuffer calls reuse it without allocating.
+bool ensureRenderGraph(StreamContext &ctx, std::size_t frames) {
+    const StreamFormat fmt = streamFormat(ctx);
+    if (ctx.render.compiled() && ctx.renderStream == ctx.stream.get() && ctx.render.inputFormat() == fmt &&
+        frames <= ctx.render.maxFrames()) {
+        return true;
     }
+    StageGraph graph;
+    graph.emplace<ConvertStage>(SampleFormat::Pcm16)
+        .emplace<StretchStage>(*ctx.stream)
+        .emplace<FitToSizeStage>()
+        .emplace<ConvertStage>(fmt.sample);
+    const std::size_t maxFrames = std::max<std::size_t>({frames, ctx.bufferFrames.load(), ctx.render.maxFrames()});
+    std::string error;
+    if (!graph.compile(fmt, maxFrames, error)) {
+        KRKR_LOG_WARN("WASAPI render graph: " + error);
+        return false;
+    }
+    ctx.render = std::move(graph);
+    ctx.renderStream = ctx.stream.get();
+    return true;
+}
+
+void logRenderTimings(StreamContext &ctx, std::chrono::steady_clock::time_point now, std::uintptr_t key) {
+    if (now - ctx.lastTimingLog < std::chrono::seconds(30)) {
+        return;
+    }
+    if (ctx.lastTimingLog.time_since_epoch().count() != 0) {
+        KRKR_LOG_DEBUG("WASAPI stage timings avg/max key=" + std::to_string(key) + " " + ctx.render.timingSummary());
+        ctx.render.resetTimings();
+    }
+    ctx.lastTimingLog = now;
 }
 
 void parseFormatFlags(const WAVEFORMATEX *format, bool &pcm16, bool &pcm32, bool &float32) {
@@ -297,8 +366,7 @@ std::shared_ptr<StreamContext> createContextFromDefault() {
         ctx->dspBlockAlign = ctx->channels * sizeof(std::int16_t);
     }
     if (ctx->isPcm16 || ctx->isPcm32 || ctx->isFloat32) {
-        DspConfig cfg{};
-        ctx->stream = std::make_unique<AudioStreamProcessor>(ctx->sampleRate, ctx->channels, ctx->dspBlockAlign, cfg);
+        createStream(*ctx, SharedSettingsManager::instance().dspConfig(DspMode::Tempo));
     }
     return ctx;
 }
@@ -308,173 +376,36 @@ void finalizeContextFormat(StreamContext &ctx, bool pcm16, bool pcm32, bool floa
     ctx.isPcm32 = pcm32;
     ctx.isFloat32 = float32;
     ctx.formatGuessed = false;
+    ctx.content.reset();
     if (ctx.channels > 0) {
         ctx.blockAlign = ctx.channels * (float32 ? sizeof(float) : (pcm32 ? sizeof(std::int32_t) : sizeof(std::int16_t)));
         ctx.dspBlockAlign = ctx.channels * sizeof(std::int16_t);
     }
     if (pcm16 || pcm32 || float32) {
         if (!ctx.stream) {
-            DspConfig cfg{};
-            ctx.stream = std::make_unique<AudioStreamProcessor>(ctx.sampleRate, ctx.channels,
-                                                                 ctx.dspBlockAlign, cfg);
-        }
-    }
-}
-
-bool looksLikePcm16(const BYTE *buffer, std::size_t bytes) {
-    if (!buffer || bytes < sizeof(std::int16_t) * 8) {
-        return false;
-    }
-    const std::size_t count = bytes / sizeof(std::int16_t);
-    const auto *samples = reinterpret_cast<const std::int16_t *>(buffer);
-    std::size_t smooth = 0;
-    std::int64_t sumAbs = 0;
-    for (std::size_t i = 1; i < count; ++i) {
-        const std::int32_t cur = samples[i];
-        const std::int32_t prev = samples[i - 1];
-        sumAbs += std::abs(cur);
-        if (std::abs(cur - prev) < 2000) {
-            smooth++;
+            createStream(ctx, SharedSettingsManager::instance().dspConfig(DspMode::Tempo));
         }
     }
-    const double avgAbs = static_cast<double>(sumAbs) / static_cast<double>(count);
-    const double smoothPct = (count > 1) ? (static_cast<double>(smooth) * 100.0 / static_cast<double>(count - 1)) : 0.0;
-    return (avgAbs > 100.0 && smoothPct > 12.0);
 }
 
 bool isBufferSilent(const StreamContext &ctx, const BYTE *buffer, UINT32 frames) {
-    if (!buffer || frames == 0 || ctx.channels == 0) {
-        return true;
-    }
-    const std::size_t maxSamples = std::min<std::size_t>(static_cast<std::size_t>(frames) * ctx.channels, 256);
-    if (maxSamples == 0) {
-        return true;
-    }
-    if (ctx.isFloat32) {
-        const float *samples = reinterpret_cast<const float *>(buffer);
-        float maxAbs = 0.0f;
-        for (std::size_t i = 0; i < maxSamples; ++i) {
-            const float v = samples[i];
-            if (!std::isfinite(v)) {
-                return false;
-            }
-            const float av = std::fabs(v);
-            if (av > maxAbs) {
-                maxAbs = av;
-                if (maxAbs >= 1e-4f) {
-                    return false;
-                }
-            }
-        }
-        return true;
-    }
-    if (ctx.isPcm32) {
-        const std::int32_t *samples = reinterpret_cast<const std::int32_t *>(buffer);
-        std::int32_t maxAbs = 0;
-        for (std::size_t i = 0; i < maxSamples; ++i) {
-            const std::int32_t v = samples[i];
-            const std::int32_t av = (v == std::numeric_limits<std::int32_t>::min())
-                ? std::numeric_limits<std::int32_t>::max()
-                : std::abs(v);
-            if (av > maxAbs) {
-                maxAbs = av;
-                if (maxAbs >= (32 << 16)) {
-                    return false;
-                }
-            }
-        }
-        return true;
-    }
-    const std::int16_t *samples = reinterpret_cast<const std::int16_t *>(buffer);
-    std::int16_t maxAbs = 0;
-    for (std::size_t i = 0; i < maxSamples; ++i) {
-        const std::int16_t v = samples[i];
-        const std::int16_t av = (v == std::numeric_limits<std::int16_t>::min())
-            ? std::numeric_limits<std::int16_t>::max()
-            : static_cast<std::int16_t>(std::abs(v));
-        if (av > maxAbs) {
-            maxAbs = av;
-            if (maxAbs >= 8) {
-                return false;
-            }
-        }
-    }
-    return true;
+    return isSpanSilent(AudioSpan{const_cast<BYTE *>(buffer), frames, streamFormat(ctx)});
 }
 
 void maybeAdjustGuessedFormat(StreamContext &ctx, const BYTE *buffer, UINT32 frames) {
-    if (!ctx.formatGuessed || !buffer || frames == 0) {
+    if (!ctx.formatGuessed || !buffer || frames == 0 || ctx.channels == 0) {
         return;
     }
-    const std::size_t maxBytes = std::min<std::size_t>(512, static_cast<std::size_t>(frames) * ctx.channels * 4);
-    if (maxBytes < 8) {
+    // The real layout is unknown here; PCM16 is the smallest candidate, so this many bytes are always valid.
+    const std::size_t bytes = static_cast<std::size_t>(frames) * ctx.channels * sizeof(std::int16_t);
+    SampleFormat format = SampleFormat::Float32;
+    // Silent or ambiguous buffers keep the current guess (likely float32 from the mix format).
+    if (!guessSampleFormat(buffer, bytes, ctx.channels, format)) {
         return;
     }
-    const std::size_t wordBytes = maxBytes & ~static_cast<std::size_t>(3);
-    const std::size_t wordCount = wordBytes / sizeof(std::uint32_t);
-    if (wordCount == 0) {
-        return;
-    }
-    const std::uint32_t *words = reinterpret_cast<const std::uint32_t *>(buffer);
-    std::size_t normalCount = 0;
-    std::size_t denormCount = 0;
-    std::size_t nanInfCount = 0;
-    std::size_t finiteCount = 0;
-    std::size_t within2Count = 0;
-    double maxAbs = 0.0;
-    double sumAbs = 0.0;
-    for (std::size_t i = 0; i < wordCount; ++i) {
-        const std::uint32_t u = words[i];
-        const std::uint32_t exp = (u >> 23) & 0xFFu;
-        if (exp == 0) {
-            denormCount++;
-        } else if (exp == 0xFFu) {
-            nanInfCount++;
-        } else {
-            normalCount++;
-        }
-        const float v = *reinterpret_cast<const float *>(&u);
-        if (std::isfinite(v)) {
-            const double av = std::fabs(static_cast<double>(v));
-            sumAbs += av;
-            finiteCount++;
-            if (av <= 2.0) {
-                within2Count++;
-            }
-            if (av > maxAbs) {
-                maxAbs = av;
-            }
-        }
-    }
-    const std::size_t total = normalCount + denormCount + nanInfCount;
-    if (total == 0 || finiteCount == 0) {
-        return;
-    }
-    const double avgAbs = sumAbs / static_cast<double>(finiteCount);
-    const double within2Pct = static_cast<double>(within2Count) * 100.0 / static_cast<double>(finiteCount);
-
-    // If buffer is essentially silent, defer decision until we see real audio.
-    if (avgAbs < 1e-5 && maxAbs < 1e-4) {
-        return;
-    }
-
-    // Prefer float if values look like normalized audio.
-    if (within2Pct >= 90.0 && nanInfCount * 100 < total * 1 && maxAbs <= 2.5) {
-        finalizeContextFormat(ctx, false, false, true);
-        KRKR_LOG_INFO("WASAPI guessed stream format: float32");
-        return;
-    }
-    // If float interpretation is clearly invalid, fall back to PCM formats.
-    if (maxAbs > 8.0 || nanInfCount * 100 >= total * 5) {
-        if (looksLikePcm16(buffer, wordBytes)) {
-            finalizeContextFormat(ctx, true, false, false);
-            KRKR_LOG_INFO("WASAPI guessed stream format: pcm16");
-        } else {
-            // Keep current guess if we cannot validate PCM16.
-        }
-        return;
-    }
-    // If unsure, keep current guessed format (likely float32 from mix).
+    finalizeContextFormat(ctx, format == SampleFormat::Pcm16, format == SampleFormat::Pcm32,
+                          format == SampleFormat::Float32);
+    KRKR_LOG_INFO(std::string("WASAPI guessed stream format: ") + sampleFormatName(format));
 }
 
 std::shared_ptr<StreamContext> ensureRenderContextLocked(IAudioRenderClient *client) {
@@ -485,6 +416,11 @@ std::shared_ptr<StreamContext> ensureRenderContextLocked(IAudioRenderClient *cli
     return entry.ctx;
 }
 
+void publishRateTelemetry(const StreamContext &ctx) {
+    const auto &t = ctx.rate.telemetry();
+    SharedStatusManager::instance().setFrameRateTelemetry(t.driftFrames, t.correctionFrames, ctx.sampleRate);
+}
+
 void PollSharedSettingsThrottled() {
     static std::chrono::steady_clock::time_point lastPoll{};
     const auto now = std::chrono::steady_clock::now();
@@ -504,12 +440,15 @@ void bootstrapWasapiVtables();
 HRESULT STDMETHODCALLTYPE RenderClientGetBufferHook(IAudioRenderClient *client, UINT32 numFramesRequested,
                                                      BYTE **ppData) {
     const HRESULT hr = g_origRenderGetBuffer ? g_origRenderGetBuffer(client, numFramesRequested, ppData) : E_FAIL;
+    const std::uint32_t engagement = SharedSettingsManager::instance().engagement();
+    if (!SharedSettingsManager::isEngaged(engagement)) return hr;
     if (SUCCEEDED(hr) && ppData) {
         std::shared_ptr<StreamContext> ctx;
         std::lock_guard<std::mutex> lock(g_ctxMutex);
         auto &entry = g_renderClients[client];
         entry.lastBuffer = *ppData;
         entry.lastFrames = numFramesRequested;
+        entry.engagement = engagement;
         ctx = entry.ctx ? entry.ctx : ensureRenderContextLocked(client);
     }
     return hr;
@@ -517,6 +456,12 @@ HRESULT STDMETHODCALLTYPE RenderClientGetBufferHook(IAudioRenderClient *client,
 
 HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *client, UINT32 numFramesWritten, DWORD flags) {
     if (!g_origRenderReleaseBuffer) return E_FAIL;
+    // Speed at 1.0: straight to the original after one relaxed load; the GetBuffer hook records nothing
+    // either, so neither path touches g_ctxMutex.
+    const std::uint32_t engagement = SharedSettingsManager::instance().engagement();
+    if (!SharedSettingsManager::isEngaged(engagement)) {
+        return g_origRenderReleaseBuffer(client, numFramesWritten, flags);
+    }
     RenderState state;
     {
         std::lock_guard<std::mutex> lock(g_ctxMutex);
@@ -535,7 +480,22 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
             state = entry;
         }
     }
+    if (state.engagement != engagement) {
+        // Recorded before a passthrough period (or never): the pointer may be stale.
+        state.lastBuffer = nullptr;
+        state.lastFrames = 0;
+    }
     if (state.ctx) {
+        {
+            std::lock_guard<std::mutex> lock(state.ctx->mutex);
+            if (state.ctx->engagement != engagement) {
+                // First release since (re-)engagement: drop rate, padding and carry state from before.
+                state.ctx->engagement = engagement;
+                state.ctx->rate.reset();
+                state.ctx->padding.reset();
+                if (state.ctx->stream) state.ctx->stream->releaseDsp();
+            }
+        }
         tryResolveChannelCountFromRenderClient(client, *state.ctx);
         if (!tryResolveFormatFromRenderClient(client, *state.ctx)) {
             if (!(flags & AUDCLNT_BUFFERFLAGS_SILENT)) {
@@ -547,9 +507,8 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
     if (DirectSoundHook::instance().isActive()) {
         if (state.ctx) {
             std::lock_guard<std::mutex> lock(state.ctx->mutex);
-            state.ctx->targetFrames = 0.0;
-            state.ctx->outFrames = 0;
-            state.ctx->lastEffective = 0;
+            state.ctx->rate.reset();
+            state.ctx->padding.onRelease(numFramesWritten, numFramesWritten);
         }
         if (!g_loggedDsFallback.exchange(true)) {
             KRKR_LOG_INFO("WASAPI fallback disabled: DirectSound activity detected");
@@ -569,43 +528,18 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
 
     if (!speedupActive) {
         if (ctx) {
-            ctx->targetFrames = 0.0;
-            ctx->outFrames = 0;
-            ctx->lastEffective = 0;
+            ctx->rate.reset();
+            ctx->padding.onRelease(numFramesWritten, numFramesWritten);
         }
         if (ctxLock.owns_lock()) ctxLock.unlock();
         return g_origRenderReleaseBuffer(client, numFramesWritten, flags);
     }
 
     if (ctx && numFramesWritten > 0) {
-        const double add = static_cast<double>(numFramesWritten) / static_cast<double>(std::max(0.01f, speed));
-        ctx->targetFrames += add;
-        const std::int64_t desiredTotal = static_cast<std::int64_t>(std::llround(ctx->targetFrames));
-        std::int64_t eff = desiredTotal - static_cast<std::int64_t>(ctx->outFrames);
-        const std::int64_t minFrames = 1;
-        const std::int64_t maxFrames = static_cast<std::int64_t>(numFramesWritten);
-
-        if (ctx->sampleRate > 0) {
-            const std::int64_t maxDrift =
-                static_cast<std::int64_t>(std::llround(static_cast<double>(ctx->sampleRate) * 0.03));
-            if (maxDrift > 0) {
-                const double minEffD = ctx->targetFrames - static_cast<double>(maxDrift) -
-                                       static_cast<double>(ctx->outFrames);
-                const double maxEffD = ctx->targetFrames + static_cast<double>(maxDrift) -
-                                       static_cast<double>(ctx->outFrames);
-                const std::int64_t minEff = static_cast<std::int64_t>(std::floor(minEffD));
-                const std::int64_t maxEff = static_cast<std::int64_t>(std::ceil(maxEffD));
-                eff = std::max(eff, minEff);
-                eff = std::min(eff, maxEff);
-            }
-        }
-
-        eff = std::max(eff, minFrames);
-        eff = std::min(eff, maxFrames);
-
-        effectiveFrames = static_cast<UINT32>(eff);
+        ctx->rate.setSampleRate(ctx->sampleRate);
+        effectiveFrames = ctx->rate.next(numFramesWritten, speed);
         dropFrames = (effectiveFrames < numFramesWritten);
-        ctx->lastEffective = eff;
+        publishRateTelemetry(*ctx);
     }
 
     if (dropFrames && !g_loggedSpeedup.exchange(true)) {
@@ -618,7 +552,7 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
     }
 
     if (!state.lastBuffer || state.lastFrames == 0) {
-        ctx->outFrames += effectiveFrames;
+        ctx->padding.onRelease(numFramesWritten, effectiveFrames);
         if (ctxLock.owns_lock()) ctxLock.unlock();
         return g_origRenderReleaseBuffer(client, effectiveFrames, flags);
     }
@@ -630,7 +564,7 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
             KRKR_LOG_INFO("WASAPI initial silence gate: zeroing buffer until first non-silent audio");
         }
         std::memset(state.lastBuffer, 0, static_cast<std::size_t>(numFramesWritten) * ctx->blockAlign);
-        ctx->outFrames += effectiveFrames;
+        ctx->padding.onRelease(numFramesWritten, effectiveFrames);
         if (ctxLock.owns_lock()) ctxLock.unlock();
         {
             std::lock_guard<std::mutex> lock(g_ctxMutex);
@@ -651,7 +585,7 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
                 KRKR_LOG_INFO("WASAPI dropping first non-silent buffer to avoid startup click");
             }
             std::memset(state.lastBuffer, 0, static_cast<std::size_t>(numFramesWritten) * ctx->blockAlign);
-            ctx->outFrames += effectiveFrames;
+            ctx->padding.onRelease(numFramesWritten, effectiveFrames);
             if (ctxLock.owns_lock()) ctxLock.unlock();
             {
                 std::lock_guard<std::mutex> lock(g_ctxMutex);
@@ -669,26 +603,24 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
     }
 
     if (flaggedSilent) {
-        ctx->outFrames += effectiveFrames;
+        ctx->padding.onRelease(numFramesWritten, effectiveFrames);
         if (ctxLock.owns_lock()) ctxLock.unlock();
         return g_origRenderReleaseBuffer(client, effectiveFrames, flags);
     }
 
     if ((!ctx->isPcm16 && !ctx->isPcm32 && !ctx->isFloat32) || ctx->blockAlign == 0) {
-        ctx->outFrames += effectiveFrames;
+        ctx->padding.onRelease(numFramesWritten, effectiveFrames);
         if (ctxLock.owns_lock()) ctxLock.unlock();
         return g_origRenderReleaseBuffer(client, effectiveFrames, flags);
     }
 
     ensureStream(*ctx);
-    if (!ctx->stream) {
-        ctx->outFrames += effectiveFrames;
+    if (!ctx->stream || !ensureRenderGraph(*ctx, numFramesWritten)) {
+        ctx->padding.onRelease(numFramesWritten, effectiveFrames);
         if (ctxLock.owns_lock()) ctxLock.unlock();
         return g_origRenderReleaseBuffer(client, effectiveFrames, flags);
     }
 
-    const std::size_t inputBytes = static_cast<std::size_t>(numFramesWritten) * ctx->blockAlign;
-    const std::size_t outputBytes = static_cast<std::size_t>(effectiveFrames) * ctx->blockAlign;
     const float durationSec = (ctx->sampleRate > 0)
         ? static_cast<float>(numFramesWritten) / static_cast<float>(ctx->sampleRate)
         : 0.0f;
@@ -696,64 +628,50 @@ HRESULT STDMETHODCALLTYPE RenderClientReleaseBufferHook(IAudioRenderClient *clie
     const auto now = std::chrono::steady_clock::now();
     ctx->stream->resetIfIdle(now, std::chrono::milliseconds(200), false,
                              reinterpret_cast<std::uintptr_t>(client));
-    std::size_t cbufSize = 0;
+    // Classified on the game's own samples, before the render graph rewrites them in place. A shared-mode
+    // stream is usually the game's whole mix, so music never bypasses the DSP here (that would drop the
+    // voices over it); it only caps the stream at the cheaper QuickSeek tier.
+    if (!ctx->content) {
+        ctx->content = std::make_unique<SpeechMusicClassifier>(ctx->sampleRate, ctx->channels);
+    }
+    const std::size_t samples = static_cast<std::size_t>(numFramesWritten) * ctx->channels;
+    const AudioContent before = ctx->content->verdict();
+    AudioContent content = before;
     if (ctx->isFloat32) {
-        const std::size_t inSamples = static_cast<std::size_t>(numFramesWritten) * ctx->channels;
-        const std::size_t outSamples = static_cast<std::size_t>(effectiveFrames) * ctx->channels;
-        std::vector<std::int16_t> tempIn(inSamples);
-        const float *src = reinterpret_cast<const float *>(state.lastBuffer);
-        for (std::size_t i = 0; i < inSamples; ++i) {
-            float s = src ? src[i] : 0.0f;
-            s = std::clamp(s, -1.0f, 1.0f);
-            tempIn[i] = static_cast<std::int16_t>(std::lround(s * 32767.0f));
-        }
-        const std::size_t inputBytes16 = inSamples * sizeof(std::int16_t);
-        const std::size_t outputBytes16 = outSamples * sizeof(std::int16_t);
-        auto res = ctx->stream->processTempoToSize(reinterpret_cast<const std::uint8_t *>(tempIn.data()),
-                                                   inputBytes16, outputBytes16, speed, false,
-                                                   reinterpret_cast<std::uintptr_t>(client));
-        cbufSize = res.cbufferSize;
-        const std::size_t resSamples = res.output.size() / sizeof(std::int16_t);
-        const auto *out16 = reinterpret_cast<const std::int16_t *>(res.output.data());
-        float *dst = reinterpret_cast<float *>(state.lastBuffer);
-        for (std::size_t i = 0; i < outSamples; ++i) {
-            const std::int16_t v = (i < resSamples) ? out16[i] : 0;
-            dst[i] = static_cast<float>(v) / 32768.0f;
-        }
+        content = ctx->content->feedFloat32(reinterpret_cast<const float *>(state.lastBuffer), samples);
     } else if (ctx->isPcm32) {
-        const std::size_t inSamples = static_cast<std::size_t>(numFramesWritten) * ctx->channels;
-        const std::size_t outSamples = static_cast<std::size_t>(effectiveFrames) * ctx->channels;
-        std::vector<std::int16_t> tempIn(inSamples);
-        const std::int32_t *src = reinterpret_cast<const std::int32_t *>(state.lastBuffer);
-        for (std::size_t i = 0; i < inSamples; ++i) {
-            const std::int32_t s = src ? src[i] : 0;
-            tempIn[i] = static_cast<std::int16_t>(s >> 16);
-        }
-        const std::size_t inputBytes16 = inSamples * sizeof(std::int16_t);
-        const std::size_t outputBytes16 = outSamples * sizeof(std::int16_t);
-        auto res = ctx->stream->processTempoToSize(reinterpret_cast<const std::uint8_t *>(tempIn.data()),
-                                                   inputBytes16, outputBytes16, speed, false,
-                                                   reinterpret_cast<std::uintptr_t>(client));
-        cbufSize = res.cbufferSize;
-        const std::size_t resSamples = res.output.size() / sizeof(std::int16_t);
-        const auto *out16 = reinterpret_cast<const std::int16_t *>(res.output.data());
-        std::int32_t *dst = reinterpret_cast<std::int32_t *>(state.lastBuffer);
-        for (std::size_t i = 0; i < outSamples; ++i) {
-            const std::int16_t v = (i < resSamples) ? out16[i] : 0;
-            dst[i] = static_cast<std::int32_t>(v) << 16;
-        }
+        content = ctx->content->feedPcm32(reinterpret_cast<const std::int32_t *>(state.lastBuffer), samples);
     } else {
-        auto res = ctx->stream->processTempoToSize(reinterpret_cast<const std::uint8_t *>(state.lastBuffer),
-                                                   inputBytes, outputBytes, speed, false,
-                                                   reinterpret_cast<std::uintptr_t>(client));
-        cbufSize = res.cbufferSize;
-        if (!res.output.empty()) {
-            const std::size_t copyBytes = std::min(res.output.size(), inputBytes);
-            std::memcpy(state.lastBuffer, res.output.data(), copyBytes);
-        }
-    }
+        content = ctx->content->feedPcm16(reinterpret_cast<const std::int16_t *>(state.lastBuffer), samples);
+    }
+    if (content != before) {
+        KRKR_LOG_INFO(std::string("WASAPI content: client=") +
+                      std::to_string(reinterpret_cast<std::uintptr_t>(client)) + " " + audioContentName(before) +
+                      " -> " + audioContentName(content) + " score=" +
+                      std::to_string(ctx->content->features().score));
+    }
+    ctx->stream->setTierFloor(content == AudioContent::Music ? QualityTier::QuickSeek : QualityTier::Full);
+    // The voice gate shortens whatever its VAD calls silence, which includes quiet music, so it only runs
+    // once the mix is classified as speech.
+    const std::uint32_t dspVersion = SharedSettingsManager::instance().dspConfigVersion();
+    const bool voiceGate = content == AudioContent::Speech;
+    if (dspVersion != ctx->dspVersion || voiceGate != ctx->voiceGate) {
+        DspConfig dspConfig = SharedSettingsManager::instance().dspConfig(DspMode::Tempo);
+        dspConfig.voiceGate = voiceGate;
+        ctx->stream->setDspConfig(dspConfig);
+        ctx->dspVersion = dspVersion;
+        ctx->voiceGate = voiceGate;
+    }
+    StageContext stage;
+    stage.speed = speed;
+    stage.targetFrames = effectiveFrames;
+    stage.key = reinterpret_cast<std::uintptr_t>(client);
+    ctx->render.run(state.lastBuffer, numFramesWritten, state.lastBuffer, effectiveFrames, stage);
+    const std::size_t cbufSize = stage.backlogBytes;
+    logRenderTimings(*ctx, now, stage.key);
     ctx->stream->recordPlaybackEnd(durationSec, speed);
-    ctx->outFrames += effectiveFrames;
+    ctx->padding.onRelease(numFramesWritten, effectiveFrames);
+    SharedStatusManager::instance().setDspQuality(ctx->stream->qualityTier(DspMode::Tempo), ctx->stream->dspLoad());
 
     if (!g_loggedTempo.exchange(true)) {
         KRKR_LOG_INFO("WASAPI tempo speedup active speed=" + std::to_string(speed) +
@@ -790,6 +708,36 @@ HRESULT STDMETHODCALLTYPE AudioClientGetServiceHook(IAudioClient *client, REFIID
 HRESULT STDMETHODCALLTYPE AudioClientGetCurrentPaddingHook(IAudioClient *client, UINT32 *padding) {
     const HRESULT hr =
         g_origAudioClientGetCurrentPadding ? g_origAudioClientGetCurrentPadding(client, padding) : E_FAIL;
+    if (FAILED(hr) || !padding) return hr;
+    const std::uint32_t engagement = SharedSettingsManager::instance().engagement();
+    if (!SharedSettingsManager::isEngaged(engagement)) return hr;
+    std::shared_ptr<StreamContext> ctx;
+    {
+        std::lock_guard<std::mutex> lock(g_ctxMutex);
+        auto it = g_audioClients.find(client);
+        if (it != g_audioClients.end()) ctx = it->second;
+    }
+    if (!ctx) return hr;
+    // Report queued audio in the game's time domain: frames released shortened by the speedup count
+    // as the frames the game originally wrote, so the free space it sees matches its natural cadence.
+    // Initialize caches the size; a client initialised before the hook was installed is queried once here,
+    // before taking the stream lock.
+    std::uint32_t bufferFrames = ctx->bufferFrames.load(std::memory_order_relaxed);
+    if (bufferFrames == 0) {
+        UINT32 frames = 0;
+        if (SUCCEEDED(client->GetBufferSize(&frames))) {
+            bufferFrames = frames;
+            ctx->bufferFrames.store(frames, std::memory_order_relaxed);
+        }
+    }
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    if (ctx->engagement != engagement) return hr; // no releases recorded since re-engagement yet
+    const UINT32 real = *padding;
+    *padding = ctx->padding.virtualPadding(real, bufferFrames);
+    if (*padding != real && !g_loggedVirtualPadding.exchange(true)) {
+        KRKR_LOG_INFO("WASAPI GetCurrentPadding virtualized: real=" + std::to_string(real) +
+                      " reported=" + std::to_string(*padding) + " buffer=" + std::to_string(bufferFrames));
+    }
     return hr;
 }
 
@@ -824,8 +772,14 @@ HRESULT STDMETHODCALLTYPE AudioClientInitializeHook(IAudioClient *client, AUDCLN
         }
         KRKR_LOG_INFO(msg);
     }
+    const HRESULT hr = g_origAudioClientInitialize ? g_origAudioClientInitialize(client, shareMode, streamFlags,
+                                                                                hnsBufferDuration, hnsPeriodicity,
+                                                                                format, sessionGuid)
+                                                   : E_FAIL;
     if (format) {
         auto ctx = std::make_shared<StreamContext>();
+        UINT32 bufferFrames = 0;
+        if (SUCCEEDED(hr) && SUCCEEDED(client->GetBufferSize(&bufferFrames))) ctx->bufferFrames = bufferFrames;
         ctx->sampleRate = format->nSamplesPerSec;
         ctx->channels = format->nChannels;
         ctx->blockAlign = format->nBlockAlign ? format->nBlockAlign : (format->nChannels * format->wBitsPerSample / 8);
@@ -842,9 +796,9 @@ HRESULT STDMETHODCALLTYPE AudioClientInitializeHook(IAudioClient *client, AUDCLN
         maybeSetDefaultFormat(format);
         if (pcm16 || pcm32 || float32) {
             ctx->dspBlockAlign = ctx->channels * sizeof(std::int16_t);
-            DspConfig cfg{};
-            ctx->stream = std::make_unique<AudioStreamProcessor>(ctx->sampleRate, ctx->channels,
-                                                                 ctx->dspBlockAlign, cfg);
+            const DspConfig cfg = SharedSettingsManager::instance().dspConfig(DspMode::Tempo);
+            createStream(*ctx, cfg);
+            DspPipelinePool::instance().prewarmAsync(ctx->sampleRate, ctx->channels, cfg);
         }
         {
             std::lock_guard<std::mutex> lock(g_ctxMutex);
@@ -854,9 +808,7 @@ HRESULT STDMETHODCALLTYPE AudioClientInitializeHook(IAudioClient *client, AUDCLN
             KRKR_LOG_WARN("WASAPI format not PCM16/PCM32/Float32; processing disabled for this stream");
         }
     }
-    return g_origAudioClientInitialize ? g_origAudioClientInitialize(client, shareMode, streamFlags, hnsBufferDuration,
-                                                                      hnsPeriodicity, format, sessionGuid)
-                                       : E_FAIL;
+    return hr;
 }
 
 HRESULT STDMETHODCALLTYPE AudioClientStartHook(IAudioClient *client) {
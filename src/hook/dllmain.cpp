@@ -2,7 +2,9 @@
 #include "WasapiHook.h"
 #include "SharedSettingsManager.h"
 #include "HookUtils.h"
+#include "../common/DiskRenderCache.h"
 #include "../common/Logging.h"
+#include "../common/PrerenderPack.h"
 #include "../common/SharedSettings.h"
 #include <thread>
 #include <Windows.h>
@@ -185,6 +187,47 @@ namespace {
         return h;
     }
 
+    void AdoptLoadedRender(const krkrspeed::VoiceRenderKey &key, std::shared_ptr<const krkrspeed::VoiceRender> render) {
+        krkrspeed::VoiceRenderCache::instance().adopt(key, std::move(render));
+    }
+
+    // Persistent render cache next to the log. Leaked like WorkerPool: its worker must not be joined from a
+    // DLL detach.
+    void OpenDiskRenderCache() {
+        auto *disk = new std::shared_ptr<krkrspeed::DiskRenderCache>(
+            std::make_shared<krkrspeed::DiskRenderCache>(&AdoptLoadedRender));
+        std::string error;
+        const std::filesystem::path dir(krkrspeed::GetLogDirectory());
+        if (!(*disk)->open(dir, krkrspeed::DiskRenderCacheOptions{}, error)) {
+            KRKR_LOG_WARN("Disk render cache disabled: " + error);
+            return;
+        }
+        krkrspeed::VoiceRenderCache::instance().addStore(*disk);
+        KRKR_LOG_INFO("Disk render cache opened next to the log");
+    }
+
+    // Optional krkr_prerender.pack (krkr_xp3_prerender output) in HookDataDirectory(); leaked like the disk cache.
+    void OpenPrerenderPack(HMODULE hookModule) {
+        const auto dir = krkrspeed::HookDataDirectory(hookModule);
+        if (dir.empty()) {
+            return;
+        }
+        const auto path = dir / krkrspeed::kPrerenderPackFileName;
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) {
+            return;
+        }
+        auto *pack = new std::shared_ptr<krkrspeed::PrerenderPack>(
+            std::make_shared<krkrspeed::PrerenderPack>(&AdoptLoadedRender));
+        std::string error;
+        if (!(*pack)->open(path, error)) {
+            KRKR_LOG_WARN("Pre-render pack ignored: " + error);
+            return;
+        }
+        krkrspeed::VoiceRenderCache::instance().addStore(*pack);
+        KRKR_LOG_INFO("Loaded pre-render pack with " + std::to_string((*pack)->entries()) + " lines");
+    }
+
     // ntdll!LdrRegisterDllNotification types
     typedef VOID(WINAPI *PFN_LdrDllNotification)(ULONG, const KRKR_LDR_DLL_NOTIFICATION_DATA *, PVOID);
     typedef NTSTATUS(WINAPI *PFN_LdrRegisterDllNotification)(ULONG, PFN_LdrDllNotification, PVOID, PVOID *);
@@ -200,7 +243,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID) {
         }
 
         DisableThreadLibraryCalls(hModule);
-        std::thread([] {
+        std::thread([hModule] {
             std::string stage = "start";
             auto logStageFail = [&stage]() {
                 KRKR_LOG_ERROR("Hook initialization thread crashed at stage: " + stage);
@@ -232,6 +275,11 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID) {
                 if (haveShared) {
                     krkrspeed::SharedSettingsManager::instance().applySharedSettings(shared);
                 }
+                krkrspeed::SharedSettingsManager::instance().loadTuningTable(hModule);
+                stage = "disk render cache";
+                OpenDiskRenderCache();
+                OpenPrerenderPack(hModule);
+                krkrspeed::SharedSettingsManager::instance().startWatcher();
                 stage = "patch GetProcAddress";
                 if (krkrspeed::PatchImport("kernel32.dll", "GetProcAddress",
                                            reinterpret_cast<void *>(&GetProcAddressHook),
@@ -318,6 +366,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID) {
                 dsCfg.bgmGateSeconds = haveShared ? shared.bgmSecondsGate : 60.0f;
                 dsCfg.stereoBgmMode = haveShared ? shared.stereoBgmMode : 1u;
                 krkrspeed::DirectSoundHook::instance().configure(dsCfg);
+                krkrspeed::DirectSoundHook::instance().loadStreamProfile(hModule);
 
                 KRKR_LOG_INFO("Init: starting DirectSoundHook::initialize");
                 try {
@@ -0,0 +1,120 @@
+#pragma once
+
+// Minimal harness for the ctest targets: every test is its own executable, KRKR_CHECK records a failure
+// and carries on, and main() returns krkrtest::finish() so ctest sees a non-zero exit on any failure.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace krkrtest {
+
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void fail(const char *file, int line, const std::string &what) {
+    std::printf("FAIL %s:%d: %s\n", file, line, what.c_str());
+    ++failures();
+}
+
+inline int finish(const char *name) {
+    std::printf("%s: %s (%d failed checks)\n", name, failures() ? "FAILED" : "passed", failures());
+    return failures() ? 1 : 0;
+}
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Interleaved PCM16 sine on every channel.
+inline std::vector<std::int16_t> sine(std::uint32_t rate, std::uint32_t channels, double seconds, double hz,
+                                      double amplitude = 0.5) {
+    const std::size_t frames = static_cast<std::size_t>(seconds * rate);
+    std::vector<std::int16_t> pcm(frames * channels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const auto v = static_cast<std::int16_t>(std::lround(amplitude * 32767.0 * std::sin(2.0 * kPi * hz * f / rate)));
+        for (std::uint32_t c = 0; c < channels; ++c) pcm[f * channels + c] = v;
+    }
+    return pcm;
+}
+
+// Dialogue-like mono signal copied to every channel: harmonic "syllables" with a 4 Hz envelope, separated
+// by pauses of digital silence. `voicedShare` is the fraction of time spent in phrases.
+inline std::vector<std::int16_t> dialogue(std::uint32_t rate, std::uint32_t channels, double seconds,
+                                          double voicedShare = 0.6, std::uint32_t seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> pitch(110.0, 240.0);
+    const std::size_t frames = static_cast<std::size_t>(seconds * rate);
+    std::vector<std::int16_t> pcm(frames * channels, 0);
+    const double phraseSec = 1.2;
+    const double pauseSec = phraseSec * (1.0 - voicedShare) / std::max(0.05, voicedShare);
+    std::size_t f = 0;
+    while (f < frames) {
+        const double f0 = pitch(rng);
+        const std::size_t phrase = std::min(frames - f, static_cast<std::size_t>(phraseSec * rate));
+        for (std::size_t i = 0; i < phrase; ++i) {
+            const double t = static_cast<double>(i) / rate;
+            const double env = 0.5 - 0.5 * std::cos(2.0 * kPi * 4.0 * t);
+            double v = 0.0;
+            for (int h = 1; h <= 6; ++h) v += std::sin(2.0 * kPi * f0 * h * t) / h;
+            const auto s = static_cast<std::int16_t>(std::lround(0.25 * 32767.0 * env * v / 2.45));
+            for (std::uint32_t c = 0; c < channels; ++c) pcm[(f + i) * channels + c] = s;
+        }
+        f += phrase + static_cast<std::size_t>(pauseSec * rate);
+    }
+    return pcm;
+}
+
+inline const std::uint8_t *bytesOf(const std::vector<std::int16_t> &pcm) {
+    return reinterpret_cast<const std::uint8_t *>(pcm.data());
+}
+
+inline std::vector<std::int16_t> samplesOf(const std::vector<std::uint8_t> &bytes) {
+    std::vector<std::int16_t> pcm(bytes.size() / sizeof(std::int16_t));
+    if (!pcm.empty()) std::memcpy(pcm.data(), bytes.data(), pcm.size() * sizeof(std::int16_t));
+    return pcm;
+}
+
+// Resident set size of this process, 0 where it cannot be read.
+inline std::size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int read = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    return read == 2 ? static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+} // namespace krkrtest
+
+#define KRKR_CHECK(cond)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) ::krkrtest::fail(__FILE__, __LINE__, #cond);                                                  \
+    } while (0)
+
+#define KRKR_CHECK_MSG(cond, msg)                                                                                  \
+    do {                                                                                                           \
+        if (!(cond)) ::krkrtest::fail(__FILE__, __LINE__, std::string(#cond) + " -- " + (msg));                    \
+    } while (0)
@@ -0,0 +1,82 @@
+// Backlog soak: simulated hours of WASAPI-style callbacks in which the engine asks for the game's buffer
+// size while the DSP produces more (speed below 1), so Cbuffer would grow without bound if the cap did not
+// hold. Each BacklogPolicy must keep the backlog at its limit and the stream's memory flat.
+//
+//   backlog_soak_test [hours per policy, default 1]
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 16000;
+constexpr std::uint32_t kChannels = 1;
+constexpr std::uint32_t kBufferMs = 40;
+constexpr float kCapMs = 250.0f;
+
+const char *policyName(BacklogPolicy policy) {
+    switch (policy) {
+    case BacklogPolicy::DropOldest: return "drop-oldest";
+    case BacklogPolicy::Compress: return "compress";
+    default: return "accelerate";
+    }
+}
+
+void soak(BacklogPolicy policy, double hours, const std::vector<std::int16_t> &loop) {
+    AudioStreamProcessor stream(kRate, kChannels, kChannels * sizeof(std::int16_t), DspConfig{});
+    stream.setBacklogConfig(BacklogConfig{kCapMs, policy});
+    const std::size_t bufferBytes = kRate * kBufferMs / 1000 * kChannels * sizeof(std::int16_t);
+    const std::size_t loopBytes = loop.size() * sizeof(std::int16_t) / bufferBytes * bufferBytes;
+    const std::size_t calls = static_cast<std::size_t>(hours * 3600.0 * 1000.0 / kBufferMs);
+    const std::size_t warmCalls = std::min<std::size_t>(calls / 6, 10u * 60u * 1000u / kBufferMs);
+    // Accelerate only drops past twice the cap; one buffer of slack covers the call that crossed it.
+    const float limitMs = (policy == BacklogPolicy::Accelerate ? 2.0f * kCapMs : kCapMs) + kBufferMs;
+
+    float maxBacklog = 0.0f;
+    std::size_t warmFootprint = 0;
+    std::size_t lateFootprint = 0;
+    std::size_t warmRss = 0;
+    std::size_t pos = 0;
+    for (std::size_t i = 0; i < calls; ++i) {
+        // Slow speeds overproduce; a short stretch at 1.25x every few minutes lets the backlog drain too.
+        const float speed = (i / 1500) % 4 == 3 ? 1.25f : ((i / 300) % 2 ? 0.6f : 0.8f);
+        const auto *data = krkrtest::bytesOf(loop) + pos;
+        const auto res = stream.processTempoToSize(data, bufferBytes, bufferBytes, speed, false, 1);
+        pos = (pos + bufferBytes) % loopBytes;
+        KRKR_CHECK(res.output.size() == bufferBytes);
+        maxBacklog = std::max(maxBacklog, res.backlogMs);
+        const std::size_t footprint = stream.memoryFootprint();
+        if (i < warmCalls) {
+            warmFootprint = std::max(warmFootprint, footprint);
+        } else {
+            lateFootprint = std::max(lateFootprint, footprint);
+        }
+        if (i + 1 == warmCalls) warmRss = krkrtest::residentBytes();
+    }
+    const std::size_t endRss = krkrtest::residentBytes();
+    std::printf("%-12s %.1f h: max backlog %.1f ms (limit %.0f), footprint %zu -> %zu bytes, rss %zu -> %zu KB\n",
+                policyName(policy), hours, maxBacklog, limitMs, warmFootprint, lateFootprint, warmRss / 1024,
+                endRss / 1024);
+    KRKR_CHECK_MSG(maxBacklog <= limitMs, policyName(policy));
+    // Carry buffers may round up to the next allocation size once; nothing may keep growing after that.
+    KRKR_CHECK_MSG(lateFootprint <= warmFootprint + 64 * 1024, policyName(policy));
+    if (warmRss > 0 && endRss > 0) {
+        KRKR_CHECK_MSG(endRss <= warmRss + 4 * 1024 * 1024, policyName(policy));
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const double hours = argc > 1 ? std::max(0.01, std::atof(argv[1])) : 1.0;
+    const auto loop = krkrtest::dialogue(kRate, kChannels, 60.0, 0.8);
+    for (const auto policy : {BacklogPolicy::DropOldest, BacklogPolicy::Compress, BacklogPolicy::Accelerate}) {
+        soak(policy, hours, loop);
+    }
+    return krkrtest::finish("backlog_soak_test");
+}
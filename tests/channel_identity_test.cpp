@@ -0,0 +1,74 @@
+// channelsIdentical() decides when DspPipeline may run a stream through its mono engine, so it must be
+// bit-exact: any single-bit difference in any channel of any frame, in the SSE2 body or the scalar tail,
+// has to be seen, and float samples compare as bit patterns (-0.0 differs from +0.0, equal NaNs match).
+
+#include "TestSupport.h"
+#include "common/StreamAnalysis.h"
+
+#include <cstring>
+#include <limits>
+
+using namespace krkrspeed;
+
+namespace {
+
+template <typename T> std::vector<T> identical(std::size_t frames, std::size_t channels, T (*make)(std::size_t)) {
+    std::vector<T> data(frames * channels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        for (std::size_t c = 0; c < channels; ++c) data[f * channels + c] = make(f);
+    }
+    return data;
+}
+
+std::int16_t pcm16At(std::size_t f) { return static_cast<std::int16_t>((f * 7919u) & 0xFFFFu); }
+float floatAt(std::size_t f) { return std::sin(static_cast<float>(f) * 0.37f) * 0.8f; }
+
+template <typename T>
+void flipEveryBit(const std::vector<T> &base, std::size_t frames, std::size_t channels, const char *what) {
+    KRKR_CHECK_MSG(channelsIdentical(base.data(), frames, channels), what);
+    std::size_t missed = 0;
+    for (std::size_t i = 0; i < base.size(); ++i) {
+        for (std::size_t bit = 0; bit < sizeof(T) * 8; ++bit) {
+            auto data = base;
+            auto *bytes = reinterpret_cast<std::uint8_t *>(&data[i]);
+            bytes[bit / 8] ^= static_cast<std::uint8_t>(1u << (bit % 8));
+            if (channelsIdentical(data.data(), frames, channels)) missed++;
+        }
+    }
+    KRKR_CHECK_MSG(missed == 0, std::string(what) + ": " + std::to_string(missed) + " single-bit changes missed");
+}
+
+} // namespace
+
+int main() {
+    // Frame counts straddle the 4-frame (int16) and 2-frame (float) SSE2 steps so the scalar tail is covered.
+    for (const std::size_t frames : {1u, 3u, 4u, 7u, 33u}) {
+        for (const std::size_t channels : {2u, 3u, 6u}) {
+            const std::string label = std::to_string(frames) + " frames x" + std::to_string(channels);
+            flipEveryBit(identical<std::int16_t>(frames, channels, pcm16At), frames, channels,
+                                ("int16 " + label).c_str());
+            flipEveryBit(identical<float>(frames, channels, floatAt), frames, channels,
+                                ("float " + label).c_str());
+        }
+    }
+
+    // A single channel is trivially identical; so is an empty buffer.
+    const auto mono = identical<std::int16_t>(9, 1, pcm16At);
+    KRKR_CHECK(channelsIdentical(mono.data(), 9, 1));
+    KRKR_CHECK(channelsIdentical(mono.data(), 0, 2));
+
+    // Signed zeros differ bitwise; identical NaN payloads match.
+    std::vector<float> zeros = {0.0f, -0.0f, 0.0f, 0.0f};
+    KRKR_CHECK(!channelsIdentical(zeros.data(), 2, 2));
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<float> nans = {nan, nan, 1.0f, 1.0f, nan, nan};
+    KRKR_CHECK(channelsIdentical(nans.data(), 3, 2));
+
+    // Long buffers: a difference in the very last sample of a 10 s stereo buffer.
+    auto longPcm = identical<std::int16_t>(441000, 2, pcm16At);
+    KRKR_CHECK(channelsIdentical(longPcm.data(), 441000, 2));
+    longPcm.back() ^= 1;
+    KRKR_CHECK(!channelsIdentical(longPcm.data(), 441000, 2));
+
+    return krkrtest::finish("channel_identity_test");
+}
@@ -0,0 +1,99 @@
+// Channel elision on an 8-channel WASAPI-style stream: the surround channels drop out after 500 ms of silence
+// and come back a couple of seconds later, rebuilding the pipeline each time. Every rebuild must hand the old
+// pipeline's latency tail to Cbuffer (not drop it) and must not replay it from the rebuilt pipeline, so the
+// audio produced over the run stays input/speed long. Returning channels must come back without a jump.
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 8;
+constexpr std::uint32_t kBufferMs = 10;
+constexpr double kSeconds = 24.0;
+constexpr double kToggleSec = 2.0;
+constexpr float kSpeed = 1.5f;
+
+// Front pair: continuous dialogue. Channels 2-7: a tone per channel, on for kToggleSec, off for kToggleSec.
+std::vector<std::int16_t> surroundMix() {
+    const auto front = krkrtest::dialogue(kRate, 1, kSeconds, 0.9);
+    std::vector<std::int16_t> pcm(front.size() * kChannels, 0);
+    for (std::size_t f = 0; f < front.size(); ++f) {
+        pcm[f * kChannels] = front[f];
+        pcm[f * kChannels + 1] = front[f];
+        const double t = static_cast<double>(f) / kRate;
+        if (static_cast<int>(t / kToggleSec) % 2 == 0) {
+            for (std::uint32_t c = 2; c < kChannels; ++c) {
+                pcm[f * kChannels + c] =
+                    static_cast<std::int16_t>(std::lround(4000.0 * std::sin(2.0 * krkrtest::kPi * 110.0 * c * t)));
+            }
+        }
+    }
+    return pcm;
+}
+
+} // namespace
+
+int main() {
+    const auto pcm = surroundMix();
+    const std::uint32_t blockAlign = kChannels * sizeof(std::int16_t);
+    AudioStreamProcessor stream(kRate, kChannels, blockAlign, DspConfig{});
+    stream.setBacklogConfig(BacklogConfig{1e9f, BacklogPolicy::DropOldest}); // keep everything in Cbuffer
+    const std::size_t bufferBytes = kRate * kBufferMs / 1000 * blockAlign;
+    // Ask for a little less than the DSP makes, so Cbuffer never runs dry (no zero padding) once started and
+    // every output frame is real, contiguous audio.
+    const std::size_t askBytes = static_cast<std::size_t>(bufferBytes / kSpeed * 0.95) / blockAlign * blockAlign;
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    std::size_t produced = 0;
+    std::size_t padded = 0;
+    std::size_t calls = 0;
+    bool started = false;
+    std::size_t switches = 0;
+    int surroundStep = 0;
+    std::vector<std::int16_t> last(kChannels, 0);
+    std::uint32_t mask = stream.activeChannelMask();
+    for (std::size_t pos = 0; pos + bufferBytes <= total; pos += bufferBytes) {
+        const auto res = stream.processTempoToSize(krkrtest::bytesOf(pcm) + pos, bufferBytes, askBytes, kSpeed,
+                                                   false, 1);
+        produced += res.output.size();
+        const auto out = krkrtest::samplesOf(res.output);
+        ++calls;
+        // Until the stream's start cushion has built up the output is padding.
+        if (!started && std::all_of(out.begin(), out.end(), [](std::int16_t v) { return v == 0; })) {
+            padded += res.output.size();
+        } else {
+            started = true;
+            KRKR_CHECK_MSG(res.cbufferSize > 0, "Cbuffer ran dry at call " + std::to_string(calls));
+        }
+        for (std::size_t i = 0; i + kChannels <= out.size(); i += kChannels) {
+            for (std::uint32_t c = 2; c < kChannels; ++c) {
+                surroundStep = std::max(surroundStep, std::abs(out[i + c] - last[c]));
+                last[c] = out[i + c];
+            }
+        }
+        if (stream.activeChannelMask() != mask) {
+            mask = stream.activeChannelMask();
+            ++switches;
+        }
+        if (pos + 2 * bufferBytes > total) produced += res.cbufferSize;
+    }
+    const double producedFrames = static_cast<double>((produced - padded) / blockAlign);
+    const double expected = static_cast<double>(total / bufferBytes * bufferBytes / blockAlign) / kSpeed;
+    std::printf("%zu mask switches: produced %.0f frames, expected %.0f (%+.1f ms), surround max step %d\n",
+                switches, producedFrames, expected, 1000.0 * (producedFrames - expected) / kRate, surroundStep);
+    KRKR_CHECK(switches >= 8);
+    // The live pipeline keeps its own latency at the end of the run; anything short of that was dropped at a
+    // switch, anything over was played twice.
+    KRKR_CHECK(producedFrames >= expected - 0.2 * kRate);
+    KRKR_CHECK(producedFrames <= expected + 0.02 * kRate);
+    // The fastest surround tone (770 Hz at 4000) moves ~440 LSB per input frame (more once sped up); a channel
+    // switched back on mid-waveform would jump by up to its full amplitude.
+    KRKR_CHECK(surroundStep < 1500);
+    return krkrtest::finish("channel_mask_test");
+}
@@ -0,0 +1,276 @@
+// DiskRenderCache across restarts and crashes. store() advances the head, writes the record, then publishes
+// its index slot under a checksum; each crash point is reproduced by editing the closed cache files into the
+// state a process killed there (or a lost writeback) would leave, then reopening. Whatever was interrupted
+// must read as a miss and nothing else may be lost. Also covers ring wrap-around, a torn index header,
+// the exclusive lock and the async request/store path.
+
+#include "TestSupport.h"
+#include "common/DiskRenderCache.h"
+#include "common/RenderRecord.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace krkrspeed;
+
+namespace {
+
+// Index layout (DiskRenderCache.cpp): a 64-byte header, then 32-byte slots.
+constexpr std::uint64_t kHeaderBytes = 64;
+constexpr std::uint64_t kSlotBytes = 32;
+constexpr std::uint64_t kHeaderCapacity = 16;
+constexpr std::uint64_t kSlotOffset = 8;
+constexpr std::uint64_t kSlotCheck = 24;
+
+const std::filesystem::path &dir() {
+    static const auto path = std::filesystem::temp_directory_path() / "krkr_disk_render_cache_test";
+    return path;
+}
+
+std::filesystem::path indexPath() { return dir() / kRenderCacheIndexName; }
+std::filesystem::path dataPath() { return dir() / kRenderCacheDataName; }
+
+DiskRenderCacheOptions options() {
+    DiskRenderCacheOptions opts;
+    opts.dataBytes = 1u << 20;
+    opts.slots = 64;
+    return opts;
+}
+
+VoiceRenderKey key(std::uint64_t id) {
+    VoiceRenderKey k;
+    k.headHash = 0x9e3779b97f4a7c15ull * (id + 1);
+    k.firstBytes = 17640;
+    k.sampleRate = 44100;
+    k.channels = 2;
+    k.blockAlign = 4;
+    k.speed = 1.5f;
+    return k;
+}
+
+// `steps` Unlocks of `stepBytes` output each, content derived from `seed`.
+VoiceRender render(std::uint32_t seed, std::size_t steps, std::size_t stepBytes) {
+    std::mt19937 rng(seed);
+    VoiceRender r;
+    for (std::size_t i = 0; i < steps; ++i) {
+        VoiceRender::Step step;
+        step.inputHash = (static_cast<std::uint64_t>(rng()) << 32) | rng();
+        step.inputBytes = static_cast<std::uint32_t>(stepBytes * 3 / 2);
+        step.outputOffset = static_cast<std::uint32_t>(r.output.size());
+        step.outputBytes = static_cast<std::uint32_t>(stepBytes);
+        r.steps.push_back(step);
+        for (std::size_t b = 0; b < stepBytes; ++b) r.output.push_back(static_cast<std::uint8_t>(rng()));
+    }
+    return r;
+}
+
+bool same(const VoiceRender *a, const VoiceRender &b) {
+    if (!a || a->output != b.output || a->steps.size() != b.steps.size()) return false;
+    for (std::size_t i = 0; i < b.steps.size(); ++i) {
+        const auto &x = a->steps[i];
+        const auto &y = b.steps[i];
+        if (x.inputHash != y.inputHash || x.inputBytes != y.inputBytes || x.outputOffset != y.outputOffset ||
+            x.outputBytes != y.outputBytes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T> T readField(const std::filesystem::path &path, std::uint64_t offset) {
+    T value{};
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+}
+
+template <typename T> void writeField(const std::filesystem::path &path, std::uint64_t offset, T value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// File offset of the slot `k` was published in (the index is opened with options().slots).
+std::uint64_t slotOf(const VoiceRenderKey &k) {
+    const std::uint64_t digest = renderRecordDigest(k);
+    for (std::uint32_t i = 0; i < options().slots; ++i) {
+        const std::uint64_t at = kHeaderBytes + ((digest + i) % options().slots) * kSlotBytes;
+        if (readField<std::uint64_t>(indexPath(), at) == digest) return at;
+    }
+    return 0;
+}
+
+std::uint64_t capacity() { return readField<std::uint64_t>(indexPath(), kHeaderCapacity); }
+
+struct Session {
+    DiskRenderCache cache{nullptr};
+    bool ok = false;
+    std::string error;
+
+    Session() { ok = cache.open(dir(), options(), error); }
+};
+
+void reset() {
+    std::filesystem::remove_all(dir());
+    std::filesystem::create_directories(dir());
+}
+
+void checkReopen() {
+    reset();
+    const VoiceRender a = render(1, 20, 4000);
+    const VoiceRender b = render(2, 5, 9000);
+    {
+        Session s;
+        KRKR_CHECK_MSG(s.ok, s.error);
+        KRKR_CHECK(s.cache.store(key(1), a) && s.cache.store(key(2), b));
+        KRKR_CHECK(same(s.cache.load(key(1)).get(), a));
+    }
+    Session s;
+    KRKR_CHECK_MSG(s.ok, s.error);
+    KRKR_CHECK(same(s.cache.load(key(1)).get(), a));
+    KRKR_CHECK(same(s.cache.load(key(2)).get(), b));
+    KRKR_CHECK(s.cache.load(key(3)) == nullptr);
+    // The same key at another speed or config is another line.
+    VoiceRenderKey other = key(1);
+    other.speed = 2.0f;
+    KRKR_CHECK(s.cache.load(other) == nullptr);
+    // Storing a key again replaces its record.
+    const VoiceRender a2 = render(3, 10, 4000);
+    KRKR_CHECK(s.cache.store(key(1), a2));
+    KRKR_CHECK(same(s.cache.load(key(1)).get(), a2));
+    KRKR_CHECK(s.cache.stats().corrupt == 0);
+}
+
+// Each crash point of store(key(2)) after key(1) was stored cleanly.
+void checkCrashPoints() {
+    const VoiceRender a = render(1, 20, 4000);
+    const VoiceRender b = render(2, 5, 9000);
+    enum Crash { BeforePublish, TornSlot, TornRecord, LostRecordBytes, LostFileSize };
+    const char *names[] = {"killed before the slot was published", "slot half written",
+                           "record half written", "record never reached the disk", "data file size lost"};
+    for (int crash = BeforePublish; crash <= LostFileSize; ++crash) {
+        reset();
+        {
+            Session s;
+            KRKR_CHECK(s.cache.store(key(1), a) && s.cache.store(key(2), b));
+        }
+        const std::uint64_t slot = slotOf(key(2));
+        KRKR_CHECK_MSG(slot != 0, names[crash]);
+        const std::uint64_t offset = readField<std::uint64_t>(indexPath(), slot + kSlotOffset) % capacity();
+        switch (crash) {
+        case BeforePublish: // the check is cleared before the fields are written
+            writeField<std::uint64_t>(indexPath(), slot + kSlotCheck, 0);
+            break;
+        case TornSlot: // new fields, stale check
+            writeField<std::uint64_t>(indexPath(), slot + kSlotOffset, offset + 8);
+            break;
+        case TornRecord:
+            for (std::uint64_t i = 0; i < 4096; i += 8) writeField<std::uint64_t>(dataPath(), offset + 2048 + i, 0);
+            break;
+        case LostRecordBytes:
+            for (std::uint64_t i = 0; i < 64; i += 8) writeField<std::uint64_t>(dataPath(), offset + i, 0);
+            break;
+        case LostFileSize:
+            std::filesystem::resize_file(dataPath(), offset + 1000);
+            break;
+        }
+        Session s;
+        KRKR_CHECK_MSG(s.ok, s.error);
+        KRKR_CHECK_MSG(s.cache.load(key(2)) == nullptr, names[crash]);
+        KRKR_CHECK_MSG(same(s.cache.load(key(1)).get(), a), names[crash]);
+        // An unpublished slot is simply empty; a published one over bad bytes is counted as corrupt.
+        const bool published = crash != BeforePublish && crash != TornSlot;
+        KRKR_CHECK_MSG(s.cache.stats().corrupt == (published ? 1u : 0u), names[crash]);
+        // The line can be stored again and is served from then on.
+        KRKR_CHECK_MSG(s.cache.store(key(2), b), names[crash]);
+        KRKR_CHECK_MSG(same(s.cache.load(key(2)).get(), b), names[crash]);
+    }
+}
+
+void checkWrap() {
+    reset();
+    Session s;
+    KRKR_CHECK_MSG(s.ok, s.error);
+    // 40 records of ~120 KB lap the 1 MB ring several times; records never straddle its end.
+    std::vector<VoiceRender> renders;
+    for (std::uint32_t i = 0; i < 40; ++i) {
+        renders.push_back(render(100 + i, 12, 10000));
+        KRKR_CHECK(s.cache.store(key(100 + i), renders.back()));
+    }
+    std::size_t kept = 0;
+    for (std::uint32_t i = 0; i < 40; ++i) {
+        if (auto loaded = s.cache.load(key(100 + i))) {
+            KRKR_CHECK(same(loaded.get(), renders[i]));
+            KRKR_CHECK_MSG(i >= 30, "record " + std::to_string(i) + " survived being lapped");
+            ++kept;
+        }
+    }
+    std::printf("ring wrap: %zu of the last 40 records still live in a %llu-byte ring\n", kept,
+                static_cast<unsigned long long>(capacity()));
+    KRKR_CHECK(kept >= 7);
+    KRKR_CHECK(same(s.cache.load(key(139)).get(), renders.back()));
+    // Overwritten records are dead, not corrupt.
+    KRKR_CHECK(s.cache.stats().corrupt == 0);
+    // A line over a quarter of the ring is not stored.
+    KRKR_CHECK(!s.cache.store(key(200), render(200, 30, 10000)));
+    KRKR_CHECK(std::filesystem::file_size(dataPath()) <= capacity());
+}
+
+void checkTornHeader() {
+    reset();
+    {
+        Session s;
+        KRKR_CHECK(s.cache.store(key(1), render(1, 20, 4000)));
+    }
+    writeField<std::uint64_t>(indexPath(), kHeaderCapacity, capacity() * 2);
+    Session s;
+    KRKR_CHECK_MSG(s.ok, s.error);
+    KRKR_CHECK(s.cache.load(key(1)) == nullptr);
+    KRKR_CHECK(capacity() == options().dataBytes);
+    const VoiceRender b = render(2, 5, 9000);
+    KRKR_CHECK(s.cache.store(key(2), b));
+    KRKR_CHECK(same(s.cache.load(key(2)).get(), b));
+}
+
+void checkLock() {
+    reset();
+    Session first;
+    KRKR_CHECK_MSG(first.ok, first.error);
+    Session second;
+    KRKR_CHECK_MSG(!second.ok && second.error.find("in use") != std::string::npos, second.error);
+}
+
+void checkAsync() {
+    reset();
+    std::mutex mutex;
+    std::vector<std::pair<VoiceRenderKey, std::shared_ptr<const VoiceRender>>> loaded;
+    DiskRenderCache cache([&](const VoiceRenderKey &k, std::shared_ptr<const VoiceRender> r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.emplace_back(k, std::move(r));
+    });
+    std::string error;
+    KRKR_CHECK_MSG(cache.open(dir(), options(), error), error);
+    const auto a = std::make_shared<const VoiceRender>(render(1, 20, 4000));
+    cache.storeAsync(key(1), a);
+    cache.drain();
+    cache.requestAsync(key(1));
+    cache.requestAsync(key(2));
+    cache.drain();
+    KRKR_CHECK(loaded.size() == 1 && loaded[0].first == key(1) && same(loaded[0].second.get(), *a));
+    const auto stats = cache.stats();
+    KRKR_CHECK(stats.stored == 1 && stats.loaded == 1 && stats.lookups == 2);
+}
+
+} // namespace
+
+int main() {
+    checkReopen();
+    checkCrashPoints();
+    checkWrap();
+    checkTornHeader();
+    checkLock();
+    checkAsync();
+    std::filesystem::remove_all(dir());
+    return krkrtest::finish("disk_render_cache_test");
+}
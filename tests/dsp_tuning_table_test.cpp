@@ -0,0 +1,134 @@
+// DspTuningTable as the hook loads it: a table written by krkr_dsp_autotune (header and Pareto-front comments,
+// one band per speed and mode) is parsed, looked up at and between band edges, written back and re-read
+// unchanged, and saved to disk and loaded by path. Malformed entries must reject the whole file so the hook
+// falls back to the preset instead of running half a table.
+
+#include "TestSupport.h"
+#include "common/DspTuningTable.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace krkrspeed;
+
+namespace {
+
+// krkr_dsp_autotune --synth-clips 2 --repeat 1 (default speeds, both modes), verbatim.
+const char *const kGenerated = R"(# krkr_dsp_autotune: 2 synthetic clips, lsd margin 0.5 dB
+# tempo @1.25x Pareto front:
+#   tempo 0.000 1.375 seq=30.0 seek=30.0 overlap=8.0 quickseek=1 aa=1 aa_len=64 cpu=0.801 lsd=12.155
+# tempo @1.5x Pareto front:
+#   tempo 1.375 1.750 seq=20.0 seek=20.0 overlap=12.0 quickseek=1 aa=1 aa_len=64 cpu=0.715 lsd=16.811
+# tempo @2x Pareto front:
+#   tempo 1.750 2.500 seq=40.0 seek=25.0 overlap=8.0 quickseek=1 aa=1 aa_len=64 cpu=0.536 lsd=21.914
+# tempo @3x Pareto front:
+#   tempo 2.500 100.000 seq=20.0 seek=15.0 overlap=6.0 quickseek=0 aa=1 aa_len=64 cpu=0.418 lsd=29.297
+# pitch @1.25x Pareto front:
+#   pitch 0.000 1.375 seq=30.0 seek=10.0 overlap=8.0 quickseek=1 aa=1 aa_len=64 cpu=1.043 lsd=11.830
+# pitch @1.5x Pareto front:
+#   pitch 1.375 1.750 seq=35.0 seek=10.0 overlap=12.0 quickseek=0 aa=1 aa_len=128 cpu=0.858 lsd=14.461
+# pitch @2x Pareto front:
+#   pitch 1.750 2.500 seq=50.0 seek=20.0 overlap=8.0 quickseek=0 aa=1 aa_len=128 cpu=0.855 lsd=19.298
+# pitch @3x Pareto front:
+#   pitch 2.500 100.000 seq=35.0 seek=25.0 overlap=12.0 quickseek=0 aa=1 aa_len=32 cpu=0.882 lsd=23.663
+tempo 0.000 1.375 seq=30.0 seek=30.0 overlap=8.0 quickseek=1 aa=1 aa_len=64 cpu=0.801 lsd=12.155
+tempo 1.375 1.750 seq=20.0 seek=20.0 overlap=12.0 quickseek=1 aa=1 aa_len=64 cpu=0.715 lsd=16.811
+tempo 1.750 2.500 seq=40.0 seek=25.0 overlap=8.0 quickseek=1 aa=1 aa_len=64 cpu=0.536 lsd=21.914
+tempo 2.500 100.000 seq=20.0 seek=15.0 overlap=6.0 quickseek=0 aa=1 aa_len=64 cpu=0.418 lsd=29.297
+pitch 0.000 1.375 seq=30.0 seek=10.0 overlap=8.0 quickseek=1 aa=1 aa_len=64 cpu=1.043 lsd=11.830
+pitch 1.375 1.750 seq=35.0 seek=10.0 overlap=12.0 quickseek=0 aa=1 aa_len=128 cpu=0.858 lsd=14.461
+pitch 1.750 2.500 seq=50.0 seek=20.0 overlap=8.0 quickseek=0 aa=1 aa_len=128 cpu=0.855 lsd=19.298
+pitch 2.500 100.000 seq=35.0 seek=25.0 overlap=12.0 quickseek=0 aa=1 aa_len=32 cpu=0.882 lsd=23.663
+)";
+
+bool parse(const std::string &text, DspTuningTable &table, std::string &error) {
+    std::istringstream in(text);
+    return table.parse(in, error);
+}
+
+void checkLookup(const DspTuningTable &table) {
+    KRKR_CHECK(table.entries().size() == 8);
+    const DspConfig *tempo = table.find(1.5f, DspMode::Tempo);
+    KRKR_CHECK(tempo && tempo->sequenceMs == 20.0f && tempo->seekWindowMs == 20.0f && tempo->overlapMs == 12.0f &&
+               tempo->quickSeek);
+    // Bands are [min, max): the edge belongs to the faster band.
+    const DspConfig *edge = table.find(1.75f, DspMode::Tempo);
+    KRKR_CHECK(edge && edge->sequenceMs == 40.0f);
+    const DspConfig *pitch = table.find(2.0f, DspMode::Pitch);
+    KRKR_CHECK(pitch && pitch->sequenceMs == 50.0f && pitch->overlapMs == 8.0f && pitch->aaFilterLength == 128);
+    const DspConfig *fast = table.find(8.0f, DspMode::Pitch);
+    KRKR_CHECK(fast && fast->aaFilterLength == 32 && !fast->quickSeek);
+    KRKR_CHECK(table.find(100.0f, DspMode::Pitch) == nullptr);
+    // Keys the table does not carry keep the DspConfig defaults.
+    KRKR_CHECK(!tempo->voiceGate && !tempo->integerPath);
+    const auto &slow = table.entries()[4];
+    KRKR_CHECK(slow.mode == DspMode::Pitch && std::abs(slow.cpuMsPerSec - 1.043f) < 1e-4f &&
+               std::abs(slow.distortionDb - 11.83f) < 1e-4f);
+}
+
+void checkRoundTrip(const DspTuningTable &table) {
+    std::ostringstream out;
+    table.write(out);
+    DspTuningTable again;
+    std::string error;
+    KRKR_CHECK_MSG(parse(out.str(), again, error), error);
+    KRKR_CHECK(again.entries().size() == table.entries().size());
+    for (std::size_t i = 0; i < std::min(again.entries().size(), table.entries().size()); ++i) {
+        const auto &a = table.entries()[i];
+        const auto &b = again.entries()[i];
+        KRKR_CHECK_MSG(a.mode == b.mode && a.minSpeed == b.minSpeed && a.maxSpeed == b.maxSpeed && a.config == b.config,
+                       DspTuningTable::formatEntry(b));
+        KRKR_CHECK(std::abs(a.cpuMsPerSec - b.cpuMsPerSec) < 1e-3f && std::abs(a.distortionDb - b.distortionDb) < 1e-3f);
+    }
+
+    const auto path = std::filesystem::temp_directory_path() / "krkr_dsp_tuning_test.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "# written by dsp_tuning_table_test\n";
+        table.write(file);
+    }
+    DspTuningTable loaded;
+    KRKR_CHECK_MSG(loaded.load(path, error), error);
+    KRKR_CHECK(loaded.entries().size() == table.entries().size());
+    std::filesystem::remove(path);
+    KRKR_CHECK(!loaded.load(path, error));
+}
+
+void checkRejects() {
+    const struct {
+        const char *text;
+        const char *expect;
+    } cases[] = {
+        {"", "No tuning entries"},
+        {"# only comments\n\n", "No tuning entries"},
+        {"tempo 1.5 1.0 seq=40\n", "line 1"},
+        {"speed 0 2 seq=40\n", "line 1"},
+        {"tempo 0 2 seq=40\npitch 0 2 seq=forty\n", "line 2"},
+        {"tempo 0 2 seq\n", "line 1"},
+    };
+    for (const auto &c : cases) {
+        DspTuningTable table;
+        std::string error;
+        KRKR_CHECK_MSG(!parse(c.text, table, error) && error.find(c.expect) != std::string::npos,
+                       std::string(c.text) + " -> " + error);
+    }
+    // A failed parse leaves the previous table in place.
+    DspTuningTable table;
+    std::string error;
+    KRKR_CHECK(parse("tempo 0 2 seq=40 future_key=1\n", table, error));
+    KRKR_CHECK(!parse("tempo 0 2 seq=oops\n", table, error));
+    KRKR_CHECK(table.entries().size() == 1 && table.entries()[0].config.sequenceMs == 40.0f);
+}
+
+} // namespace
+
+int main() {
+    DspTuningTable table;
+    std::string error;
+    KRKR_CHECK_MSG(parse(kGenerated, table, error), error);
+    checkLookup(table);
+    checkRoundTrip(table);
+    checkRejects();
+    return krkrtest::finish("dsp_tuning_table_test");
+}
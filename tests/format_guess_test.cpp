@@ -0,0 +1,108 @@
+// guessSampleFormat on WASAPI-sized (10 ms) buffers of synthetic speech and music delivered as PCM16, 24-bit
+// PCM in 32-bit words and float32, mono to 5.1. Only frames x channels x 2 bytes are examined, as the hook
+// does before it knows the layout. Quiet buffers may stay undecided, audible ones must be decided, and a
+// decided buffer must name the right format.
+
+#include "TestSupport.h"
+#include "ContentSynth.h"
+#include "common/StreamAnalysis.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 48000;
+constexpr std::size_t kBufferFrames = kRate / 100;
+
+// Buffers whose 16-bit source averages this far above silence (about -42 dBFS) must be decided.
+constexpr double kAudibleMeanAbs = 256.0 / 32768.0;
+
+struct Tally {
+    std::size_t audible = 0;
+    std::size_t audibleRight = 0;
+    std::size_t right = 0;
+    std::size_t wrong = 0;
+    std::size_t undecided = 0;
+};
+
+// Interleaved int16 of `channels` channels: the clip's left/right pair spread over the layout at falling gains.
+std::vector<std::int16_t> layout(const WavClip &clip, std::uint32_t channels) {
+    const std::size_t frames = clip.samples.size() / clip.channels;
+    std::vector<std::int16_t> pcm(frames * channels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        for (std::uint32_t c = 0; c < channels; ++c) {
+            const double gain = 1.0 / (1.0 + 0.5 * (c / 2));
+            pcm[f * channels + c] = static_cast<std::int16_t>(
+                std::lround(gain * clip.samples[f * clip.channels + c % clip.channels]));
+        }
+    }
+    return pcm;
+}
+
+std::vector<std::uint8_t> encode(const std::vector<std::int16_t> &pcm, SampleFormat format, std::mt19937 &rng) {
+    std::vector<std::uint8_t> bytes(pcm.size() * sampleBytes(format));
+    std::uniform_int_distribution<int> dither(0, 255);
+    for (std::size_t i = 0; i < pcm.size(); ++i) {
+        if (format == SampleFormat::Pcm16) {
+            std::memcpy(bytes.data() + i * 2, &pcm[i], 2);
+        } else if (format == SampleFormat::Pcm32) {
+            // 24-bit source: the byte below the 16-bit sample carries detail, the lowest byte is zero.
+            const std::int32_t v = static_cast<std::int32_t>(static_cast<std::uint32_t>(pcm[i]) << 16) |
+                                   (dither(rng) << 8);
+            std::memcpy(bytes.data() + i * 4, &v, 4);
+        } else {
+            const float v = pcm[i] / 32768.0f;
+            std::memcpy(bytes.data() + i * 4, &v, 4);
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+int main() {
+    ContentSynth synth(kRate, 7);
+    std::vector<WavClip> clips;
+    for (int i = 0; i < 6; ++i) {
+        const bool speech = i % 2 == 0;
+        clips.push_back(toClip(speech ? synth.speech(4.0) : synth.music(4.0), kRate, 2, speech ? "speech" : "music",
+                               synth));
+    }
+    std::mt19937 rng(3);
+    for (const SampleFormat format : {SampleFormat::Pcm16, SampleFormat::Pcm32, SampleFormat::Float32}) {
+        Tally tally;
+        for (const std::uint32_t channels : {1u, 2u, 6u}) {
+            for (const auto &clip : clips) {
+                const auto pcm = layout(clip, channels);
+                const auto bytes = encode(pcm, format, rng);
+                const std::size_t bufferSamples = kBufferFrames * channels;
+                for (std::size_t pos = 0; pos + bufferSamples <= pcm.size(); pos += bufferSamples) {
+                    // The part the guess reads: all of a PCM16 buffer, the first half of a 32-bit one.
+                    const std::size_t examined = bufferSamples * 2 / sampleBytes(format);
+                    const bool audible =
+                        analyzePcm16(pcm.data() + pos, examined, channels).meanAbs() >= kAudibleMeanAbs;
+                    SampleFormat guess = SampleFormat::Pcm16;
+                    const bool decided = guessSampleFormat(bytes.data() + pos * sampleBytes(format),
+                                                           bufferSamples * 2, channels, guess);
+                    tally.audible += audible;
+                    if (!decided) {
+                        ++tally.undecided;
+                    } else if (guess == format) {
+                        ++tally.right;
+                        tally.audibleRight += audible;
+                    } else {
+                        ++tally.wrong;
+                    }
+                }
+            }
+        }
+        const std::size_t total = tally.right + tally.wrong + tally.undecided;
+        const double audiblePct = 100.0 * tally.audibleRight / std::max<std::size_t>(1, tally.audible);
+        std::printf("%-7s %zu buffers: %.1f%% right, %.2f%% wrong, %.1f%% undecided; %zu audible: %.1f%% right\n",
+                    sampleFormatName(format), total, 100.0 * tally.right / total, 100.0 * tally.wrong / total,
+                    100.0 * tally.undecided / total, tally.audible, audiblePct);
+        KRKR_CHECK_MSG(audiblePct >= 99.0, sampleFormatName(format));
+        KRKR_CHECK_MSG(tally.wrong == 0, sampleFormatName(format));
+    }
+    return krkrtest::finish("format_guess_test");
+}
@@ -0,0 +1,213 @@
+// FrequencyPolicy as the DirectSound hook drives it: a simulated buffer that counts real SetFrequency calls
+// over a session of Unlocks with speed changes, game SetFrequency calls and processing toggles, plus the edge
+// cases on their own: DirectSound range clamping, probing a buffer first seen at Unlock, failed targets that
+// must not be retried until they move, and GetFrequency reporting the game's own frequency. FrequencyRestore
+// then has to restore retuned buffers after a disengagement while every other Unlock skips the hook's lock.
+
+#include "TestSupport.h"
+#include "common/FrequencyPolicy.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+// The real buffer behind the hook: what SetFrequency was last given and how often it was called.
+struct FakeBuffer {
+    std::uint32_t frequency = 0;
+    std::size_t setCalls = 0;
+    bool fail = false;
+
+    bool set(std::uint32_t value) {
+        ++setCalls;
+        if (fail) return false;
+        frequency = value;
+        return true;
+    }
+};
+
+// The Unlock path: retune only when the policy says the target moved.
+void unlock(FrequencyPolicy &policy, FakeBuffer &buffer, float speed) {
+    if (!policy.needsApply(speed)) return;
+    policy.onApplied(speed, buffer.set(policy.target(speed)));
+}
+
+// The SetFrequency hook: forward the game's frequency scaled by the current speed, restore on failure.
+void gameSet(FrequencyPolicy &policy, FakeBuffer &buffer, std::uint32_t requested) {
+    const FrequencyPolicy before = policy;
+    policy.onGameSet(requested);
+    const float speed = policy.speed();
+    if (buffer.set(policy.target(speed))) {
+        policy.onApplied(speed, true);
+    } else {
+        policy = before;
+    }
+}
+
+void checkSession() {
+    FrequencyPolicy policy(44100, true);
+    FakeBuffer buffer{44100};
+    std::mt19937 rng(40);
+    std::uniform_int_distribution<int> event(0, 999);
+    const float speeds[] = {1.0f, 1.5f, 2.0f};
+    float speed = 1.0f;
+    bool processing = true;
+    std::size_t unlocks = 0;
+    std::size_t targetChanges = 0;
+    std::size_t gameSets = 0;
+    std::uint32_t lastTarget = buffer.frequency;
+    for (int i = 0; i < 100000; ++i) {
+        const int e = event(rng);
+        if (e < 3) {
+            speed = speeds[e];
+        } else if (e == 3) {
+            processing = !processing;
+        } else if (e == 4) {
+            gameSet(policy, buffer, rng() % 2 ? 22050 : 44100);
+            ++gameSets;
+            KRKR_CHECK(buffer.frequency == policy.target(policy.speed()));
+        }
+        const float want = processing ? speed : 1.0f;
+        unlock(policy, buffer, want);
+        ++unlocks;
+        KRKR_CHECK(buffer.frequency == policy.target(want));
+        KRKR_CHECK(policy.applied() == buffer.frequency);
+        if (buffer.frequency != lastTarget) {
+            ++targetChanges;
+            lastTarget = buffer.frequency;
+        }
+    }
+    std::printf("%zu unlocks: %zu SetFrequency calls for %zu target changes and %zu game SetFrequency calls\n",
+                unlocks, buffer.setCalls, targetChanges, gameSets);
+    // Every real call either moved the frequency or forwarded a game SetFrequency.
+    KRKR_CHECK(buffer.setCalls <= targetChanges + gameSets);
+    KRKR_CHECK(buffer.setCalls < unlocks / 50);
+}
+
+void checkClamp() {
+    FrequencyPolicy policy(48000, true);
+    KRKR_CHECK(policy.target(1.0f) == 48000);
+    KRKR_CHECK(policy.target(1.5f) == 72000);
+    KRKR_CHECK(policy.target(5.0f) == FrequencyPolicy::kMaxFrequency);
+    KRKR_CHECK(std::abs(policy.appliedSpeed(5.0f) - 200000.0f / 48000.0f) < 1e-4f);
+    KRKR_CHECK(std::abs(policy.appliedSpeed(2.0f) - 2.0f) < 1e-6f);
+    policy.onGameSet(50);
+    KRKR_CHECK(policy.target(1.0f) == FrequencyPolicy::kMinFrequency);
+    FrequencyPolicy unknown;
+    KRKR_CHECK(unknown.appliedSpeed(1.7f) == 1.7f);
+}
+
+void checkProbe() {
+    FrequencyPolicy fresh(44100, true);
+    KRKR_CHECK(!fresh.needsProbe());
+    KRKR_CHECK(!fresh.needsApply(1.0f));
+
+    // First seen at Unlock, already running at a game-chosen 22050.
+    FrequencyPolicy seen(44100, false);
+    KRKR_CHECK(seen.needsProbe());
+    seen.onProbed(true, 22050);
+    KRKR_CHECK(!seen.needsProbe());
+    KRKR_CHECK(seen.gameFrequency() == 22050);
+    KRKR_CHECK(!seen.needsApply(1.0f));
+    KRKR_CHECK(seen.target(2.0f) == 44100);
+
+    // A failed probe is not repeated; the first apply then sets the frequency outright.
+    FrequencyPolicy failed(44100, false);
+    failed.onProbed(false, 0);
+    KRKR_CHECK(!failed.needsProbe());
+    KRKR_CHECK(failed.needsApply(1.0f));
+    failed.onApplied(1.0f, true);
+    KRKR_CHECK(!failed.needsApply(1.0f));
+}
+
+void checkFailedTarget() {
+    FrequencyPolicy policy(44100, true);
+    FakeBuffer buffer{44100};
+    buffer.fail = true;
+    for (int i = 0; i < 10; ++i) unlock(policy, buffer, 1.5f);
+    KRKR_CHECK_MSG(buffer.setCalls == 1, std::to_string(buffer.setCalls));
+    KRKR_CHECK(policy.applied() == 44100);
+    KRKR_CHECK(!policy.retuned());
+    // A new target is tried again, as is the old one once the game resets its frequency.
+    unlock(policy, buffer, 2.0f);
+    KRKR_CHECK(buffer.setCalls == 2);
+    policy.onGameSet(44100);
+    buffer.fail = false;
+    unlock(policy, buffer, 1.5f);
+    KRKR_CHECK(buffer.setCalls == 3);
+    KRKR_CHECK(buffer.frequency == 66150);
+    KRKR_CHECK(policy.retuned());
+    // GetFrequency reports the game's frequency, not the retuned one.
+    KRKR_CHECK(policy.gameFrequency() == 44100);
+    unlock(policy, buffer, 1.0f);
+    KRKR_CHECK(!policy.retuned());
+}
+
+// The hook's disengaged Unlock: lock-free check, then under the lock list the retuned buffers (first Unlock of
+// the disengagement), restore this one and try to settle. Returns whether the lock was taken.
+bool disengagedUnlock(FrequencyRestore &restore, std::vector<FrequencyPolicy> &policies,
+                      std::vector<FakeBuffer> &buffers, std::size_t index, std::uint32_t engagement) {
+    const auto key = static_cast<std::uintptr_t>(index + 1);
+    if (!restore.needsLock(engagement, key)) return false;
+    if (!restore.opened(engagement)) {
+        std::vector<std::uintptr_t> retuned;
+        for (std::size_t i = 0; i < policies.size(); ++i) {
+            if (policies[i].retuned()) retuned.push_back(i + 1);
+        }
+        restore.begin(engagement, retuned);
+    }
+    if (policies[index].retuned()) unlock(policies[index], buffers[index], 1.0f);
+    restore.done(key);
+    restore.settle(engagement);
+    return true;
+}
+
+void checkRestore() {
+    // 8 buffers, 3 of them left retuned by processing (one of those stays silent), 1000 disengaged Unlocks.
+    std::vector<FrequencyPolicy> policies(8, FrequencyPolicy(44100, true));
+    std::vector<FakeBuffer> buffers(8, FakeBuffer{44100});
+    for (std::size_t i : {1, 4, 6}) unlock(policies[i], buffers[i], 1.5f);
+    FrequencyRestore restore;
+    std::size_t locked = 0;
+    for (int n = 0; n < 1000; ++n) {
+        const std::size_t index = static_cast<std::size_t>(n) % 6; // buffers 6 and 7 are silent
+        locked += disengagedUnlock(restore, policies, buffers, index, 2);
+    }
+    std::printf("restore: %zu of 1000 disengaged Unlocks took the lock, %u buffer still pending\n", locked,
+                restore.pending());
+    // The first Unlock (buffer 0) lists the retuned buffers; buffers 1 and 4 restore on their own first Unlock.
+    KRKR_CHECK(locked == 3);
+    KRKR_CHECK(!policies[1].retuned() && !policies[4].retuned() && policies[6].retuned());
+    KRKR_CHECK(restore.pending() == 1 && !restore.settle(2));
+    // The silent buffer plays again much later and is still restored; that settles the restore for everyone.
+    KRKR_CHECK(disengagedUnlock(restore, policies, buffers, 6, 2));
+    KRKR_CHECK(!policies[6].retuned() && buffers[6].frequency == 44100 && restore.pending() == 0);
+    KRKR_CHECK(!restore.needsLock(2, 1) && !restore.needsLock(2, 7));
+
+    // Next disengagement: a listed buffer that is released instead (or re-based by the game) is done as well.
+    unlock(policies[1], buffers[1], 1.5f);
+    unlock(policies[6], buffers[6], 1.5f);
+    KRKR_CHECK(disengagedUnlock(restore, policies, buffers, 0, 4));
+    KRKR_CHECK(restore.pending() == 2 && restore.needsLock(4, 2) && !restore.needsLock(4, 3));
+    restore.done(2);
+    restore.done(7);
+    KRKR_CHECK(restore.pending() == 0 && restore.needsLock(4, 3)); // one more lock, to settle
+    KRKR_CHECK(restore.settle(4) && !restore.needsLock(4, 3));
+
+    // More retuned buffers than kMaxPending: the rest never take the lock.
+    std::vector<std::uintptr_t> many;
+    for (std::uintptr_t key = 100; key < 100 + FrequencyRestore::kMaxPending + 8; ++key) many.push_back(key);
+    restore.begin(6, many);
+    KRKR_CHECK(restore.pending() == FrequencyRestore::kMaxPending);
+    KRKR_CHECK(restore.needsLock(6, 100) && !restore.needsLock(6, many.back()));
+}
+
+} // namespace
+
+int main() {
+    checkSession();
+    checkClamp();
+    checkProbe();
+    checkFailedTarget();
+    checkRestore();
+    return krkrtest::finish("frequency_policy_test");
+}
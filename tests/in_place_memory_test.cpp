@@ -0,0 +1,84 @@
+// Working memory of AudioStreamProcessor::processInPlace on full-track DirectSound buffers (12 s to 96 s of
+// stereo dialogue, split over two lock regions like a wrapped Lock). A sampler thread tracks resident memory
+// during each call; the peak above the resident size before the call must stay flat as the buffer grows.
+// process(), which copies the whole buffer, runs last for contrast and to show the sampler sees growth.
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/VoiceRenderCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr float kSpeed = 1.5f;
+
+// Peak resident bytes above the level before `run`, sampled every millisecond while it runs.
+template <typename Run> std::size_t peakGrowth(Run run) {
+    const std::size_t before = krkrtest::residentBytes();
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> peak{before};
+    std::thread sampler([&]() {
+        while (!done.load()) {
+            peak = std::max(peak.load(), krkrtest::residentBytes());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    run();
+    peak = std::max(peak.load(), krkrtest::residentBytes());
+    done = true;
+    sampler.join();
+    return peak.load() - before;
+}
+
+} // namespace
+
+int main() {
+    if (krkrtest::residentBytes() == 0) {
+        std::printf("resident memory is not readable on this platform; skipped\n");
+        return krkrtest::finish("in_place_memory_test");
+    }
+    VoiceRenderCache::instance().setBudget(0);
+    const std::uint32_t blockAlign = kChannels * sizeof(std::int16_t);
+    std::vector<std::size_t> growth;
+    std::vector<double> seconds;
+    for (const double sec : {12.0, 24.0, 48.0, 96.0}) {
+        auto pcm = krkrtest::dialogue(kRate, kChannels, sec, 0.8, 5);
+        auto *bytes = reinterpret_cast<std::uint8_t *>(pcm.data());
+        const std::size_t total = pcm.size() * sizeof(std::int16_t);
+        const std::size_t split = total * 7 / 10 / blockAlign * blockAlign;
+        AudioStreamProcessor stream(kRate, kChannels, blockAlign, DspConfig{});
+        AudioProcessResult res;
+        const std::size_t grew = peakGrowth([&]() {
+            res = stream.processInPlace(bytes, split, bytes + split, total - split, kSpeed, false, 1);
+        });
+        std::size_t nonZero = 0;
+        for (const std::int16_t v : pcm) nonZero += v != 0;
+        std::printf("in place %5.0f s (%6.1f MB): peak +%.2f MB resident, %.0f%% samples non-zero\n", sec,
+                    total / 1048576.0, grew / 1048576.0, 100.0 * nonZero / pcm.size());
+        KRKR_CHECK(res.output.empty());
+        KRKR_CHECK(nonZero > pcm.size() / 2);
+        growth.push_back(grew);
+        seconds.push_back(sec);
+    }
+    // 96 s of audio is 16 MB; a per-byte copy anywhere would show up as several MB of growth.
+    KRKR_CHECK_MSG(growth.back() <= growth.front() + 2 * 1024 * 1024,
+                   std::to_string(growth.front()) + " -> " + std::to_string(growth.back()));
+    KRKR_CHECK(growth.back() <= 8 * 1024 * 1024);
+
+    const auto pcm = krkrtest::dialogue(kRate, kChannels, seconds.back(), 0.8, 5);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    AudioStreamProcessor stream(kRate, kChannels, blockAlign, DspConfig{});
+    const std::size_t copied =
+        peakGrowth([&]() { stream.process(krkrtest::bytesOf(pcm), total, kSpeed, false, 1); });
+    std::printf("copying  %5.0f s (%6.1f MB): peak +%.2f MB resident\n", seconds.back(), total / 1048576.0,
+                copied / 1048576.0);
+    KRKR_CHECK_MSG(copied >= total / 2, "sampler missed the copying path's growth");
+    return krkrtest::finish("in_place_memory_test");
+}
@@ -0,0 +1,104 @@
+// DspPipeline's mono engine: built only when a stream first goes mono, and switching engines in either
+// direction must neither drop audio nor leave a gap. A stereo sine whose right channel is phase-shifted
+// for a stretch (forcing mono -> full -> mono) must come out of tempo mode with every channel bit-identical
+// while the input is, no near-silent hole, no step larger than the sine itself can make, and the expected
+// total length.
+
+#include "TestSupport.h"
+#include "common/DspPipeline.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr double kHz = 220.0;
+constexpr double kAmplitude = 0.5;
+constexpr std::size_t kBufferFrames = kRate / 50; // 20 ms callbacks
+
+// Seconds [1, 2) carry a quarter-period phase shift on the right channel.
+std::vector<std::int16_t> signal(double seconds) {
+    auto pcm = krkrtest::sine(kRate, kChannels, seconds, kHz, kAmplitude);
+    for (std::size_t f = kRate; f < std::min<std::size_t>(2 * kRate, pcm.size() / kChannels); ++f) {
+        pcm[f * kChannels + 1] = static_cast<std::int16_t>(
+            std::lround(kAmplitude * 32767.0 * std::cos(2.0 * krkrtest::kPi * kHz * f / kRate)));
+    }
+    return pcm;
+}
+
+} // namespace
+
+int main() {
+    const float speed = 1.5f;
+    DspConfig cfg{};
+    cfg.voiceGate = false;
+
+    // Lazy construction: a pipeline that never sees identical channels carries no mono engine.
+    {
+        DspPipeline divergent(kRate, kChannels, cfg);
+        DspPipeline identical(kRate, kChannels, cfg);
+        const auto stereo = signal(2.0);
+        const auto same = krkrtest::sine(kRate, kChannels, 1.0, kHz, kAmplitude);
+        const std::size_t bytes = kBufferFrames * kChannels * sizeof(std::int16_t);
+        for (std::size_t pos = kRate * kChannels; pos + kBufferFrames * kChannels <= stereo.size();
+             pos += kBufferFrames * kChannels) {
+            divergent.process(krkrtest::bytesOf(stereo) + pos * sizeof(std::int16_t), bytes, speed);
+        }
+        for (std::size_t pos = 0; pos + kBufferFrames * kChannels <= same.size(); pos += kBufferFrames * kChannels) {
+            identical.process(krkrtest::bytesOf(same) + pos * sizeof(std::int16_t), bytes, speed);
+        }
+        std::printf("footprint: divergent %zu bytes, identical %zu bytes\n", divergent.memoryFootprint(),
+                    identical.memoryFootprint());
+        KRKR_CHECK(identical.memoryFootprint() > divergent.memoryFootprint());
+    }
+
+    DspPipeline dsp(kRate, kChannels, cfg);
+    const double seconds = 4.0;
+    const auto pcm = signal(seconds);
+    std::vector<std::int16_t> out;
+    std::vector<std::size_t> bufferStart; // output frame where each callback's output begins
+    for (std::size_t pos = 0; pos + kBufferFrames * kChannels <= pcm.size(); pos += kBufferFrames * kChannels) {
+        bufferStart.push_back(out.size() / kChannels);
+        const auto res = dsp.process(krkrtest::bytesOf(pcm) + pos * sizeof(std::int16_t),
+                                     kBufferFrames * kChannels * sizeof(std::int16_t), speed);
+        const auto samples = krkrtest::samplesOf(res);
+        out.insert(out.end(), samples.begin(), samples.end());
+    }
+    const auto tail = krkrtest::samplesOf(dsp.finish());
+    out.insert(out.end(), tail.begin(), tail.end());
+
+    const std::size_t frames = out.size() / kChannels;
+    const double expected = pcm.size() / kChannels / speed;
+    std::printf("output %zu frames, expected %.0f\n", frames, expected);
+    KRKR_CHECK(std::fabs(frames - expected) <= kRate * 0.05);
+
+    // Output of input that had identical channels (the first and last second, allowing for latency) must be
+    // bit-identical across channels.
+    const std::size_t firstEnd = static_cast<std::size_t>(kRate * 0.8 / speed);
+    const std::size_t lastBegin = static_cast<std::size_t>(kRate * 2.6 / speed);
+    std::size_t mismatched = 0;
+    for (std::size_t f = 0; f < frames; ++f) {
+        if ((f < firstEnd || f >= lastBegin) && out[f * kChannels] != out[f * kChannels + 1]) mismatched++;
+    }
+    KRKR_CHECK_MSG(mismatched == 0, std::to_string(mismatched) + " frames differ across channels");
+
+    // Left channel: no hole (>= 3 ms below 2% of the amplitude) and no step beyond twice the sine's own.
+    const double maxStep = 2.0 * krkrtest::kPi * kHz / kRate * kAmplitude * 32767.0;
+    const std::size_t holeFrames = kRate * 3 / 1000;
+    const std::size_t settle = static_cast<std::size_t>(kRate * 0.1);
+    std::size_t quietRun = 0;
+    std::size_t holes = 0;
+    std::size_t jumps = 0;
+    for (std::size_t f = settle; f + settle < frames; ++f) {
+        const int s = out[f * kChannels];
+        quietRun = std::abs(s) < 0.02 * kAmplitude * 32767.0 ? quietRun + 1 : 0;
+        if (quietRun == holeFrames) holes++;
+        if (std::abs(s - out[(f - 1) * kChannels]) > 2.0 * maxStep) jumps++;
+    }
+    std::printf("holes %zu, jumps %zu\n", holes, jumps);
+    KRKR_CHECK(holes == 0);
+    KRKR_CHECK(jumps == 0);
+
+    return krkrtest::finish("mono_engine_test");
+}
@@ -0,0 +1,195 @@
+// DspPipeline::prime() pre-rolls the engine with silence. None of that silence may reach the output: a tone
+// burst at the very start of a stream must come out at once and whole, in Tempo mode the stream must stay
+// input/tempo long, and in Pitch mode it trails the input by the lead prime() reports. AudioStreamProcessor
+// then has to return a fixed size per call: on the pitch path (DirectSound Unlocks), the in-place path (one
+// huge buffer rewritten chunk by chunk) and the tempo-to-size path (WASAPI, a prefill and then 10 ms periods) a
+// line must start on its first frame and never fall silent while the engine makes up its latency.
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/DspPipeline.h"
+#include "common/VoiceRenderCache.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::size_t kBufferFrames = kRate / 50;
+constexpr float kSpeed = 1.5f;
+constexpr double kBurstAmplitude = 16000.0;
+
+// 5 ms 1 kHz burst at frame 0, then silence.
+std::vector<std::int16_t> burst(double seconds) {
+    std::vector<std::int16_t> pcm(static_cast<std::size_t>(seconds * kRate) * kChannels, 0);
+    for (std::size_t f = 0; f < kRate / 200; ++f) {
+        const auto v = static_cast<std::int16_t>(
+            std::lround(kBurstAmplitude * std::sin(2.0 * krkrtest::kPi * 1000.0 * static_cast<double>(f) / kRate)));
+        pcm[f * kChannels] = v;
+        pcm[f * kChannels + 1] = v;
+    }
+    return pcm;
+}
+
+struct Onset {
+    std::size_t firstLoud = 0; // first frame above a quarter of the burst amplitude
+    int peak = 0;
+    std::size_t frames = 0;
+};
+
+Onset render(const DspConfig &cfg, DspMode mode, std::size_t &lead) {
+    const auto pcm = burst(1.0);
+    DspPipeline dsp(kRate, kChannels, cfg);
+    const float ratio = mode == DspMode::Tempo ? kSpeed : 1.0f / kSpeed;
+    lead = dsp.prime(ratio, mode);
+    std::vector<std::uint8_t> out;
+    const std::size_t bufferBytes = kBufferFrames * kChannels * sizeof(std::int16_t);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    for (std::size_t pos = 0; pos < total; pos += bufferBytes) {
+        const auto chunk = dsp.process(krkrtest::bytesOf(pcm) + pos, std::min(bufferBytes, total - pos), ratio, mode);
+        out.insert(out.end(), chunk.begin(), chunk.end());
+    }
+    if (mode == DspMode::Tempo) {
+        const auto tail = dsp.finish();
+        out.insert(out.end(), tail.begin(), tail.end());
+    }
+    const auto samples = krkrtest::samplesOf(out);
+    Onset onset;
+    onset.frames = samples.size() / kChannels;
+    onset.firstLoud = onset.frames;
+    for (std::size_t f = 0; f < onset.frames; ++f) {
+        const int v = std::abs(static_cast<int>(samples[f * kChannels]));
+        onset.peak = std::max(onset.peak, v);
+        if (onset.firstLoud == onset.frames && v > kBurstAmplitude / 4) onset.firstLoud = f;
+    }
+    return onset;
+}
+
+void check(const char *engine, const DspConfig &cfg) {
+    std::size_t lead = 0;
+    const Onset tempo = render(cfg, DspMode::Tempo, lead);
+    const double tempoMs = 1000.0 * static_cast<double>(tempo.firstLoud) / kRate;
+    const double expected = static_cast<double>(kRate) / kSpeed;
+    std::printf("%s tempo %.1fx: prime lead %zu frames, burst at %.1f ms, peak %d, %zu frames (expected %.0f)\n",
+                engine, kSpeed, lead, tempoMs, tempo.peak, tempo.frames, expected);
+    KRKR_CHECK_MSG(lead > 0, engine);
+    KRKR_CHECK_MSG(tempoMs <= 5.0, std::string(engine) + ": tempo output starts with primed silence");
+    KRKR_CHECK_MSG(tempo.peak > kBurstAmplitude / 2, std::string(engine) + ": burst lost");
+    KRKR_CHECK_MSG(std::abs(static_cast<double>(tempo.frames) - expected) < 0.01 * expected, engine);
+
+    const Onset pitch = render(cfg, DspMode::Pitch, lead);
+    const double pitchMs = 1000.0 * static_cast<double>(pitch.firstLoud) / kRate;
+    std::printf("%s pitch 1/%.1f: prime lead %zu frames, burst at %.1f ms, peak %d, %zu frames\n", engine, kSpeed,
+                lead, pitchMs, pitch.peak, pitch.frames);
+    KRKR_CHECK_MSG(pitchMs <= 5.0, std::string(engine) + ": pitch output starts with primed silence");
+    KRKR_CHECK_MSG(pitch.peak > kBurstAmplitude / 2, std::string(engine) + ": burst lost");
+    // Without finish() (its flush pads past the input) the stream is the input minus at most the lead and an
+    // overlap the engine still holds; anything longer would be pre-roll that got through.
+    KRKR_CHECK_MSG(pitch.frames <= kRate && pitch.frames + lead + kRate / 50 >= kRate, engine);
+}
+
+// A line at full level from its first frame: cosine left, sine right, so no frame is all zero.
+std::vector<std::int16_t> line(double seconds) {
+    std::vector<std::int16_t> pcm(static_cast<std::size_t>(seconds * kRate) * kChannels);
+    for (std::size_t f = 0; f < pcm.size() / kChannels; ++f) {
+        const double phase = 2.0 * krkrtest::kPi * 440.0 * static_cast<double>(f) / kRate;
+        pcm[f * kChannels] = static_cast<std::int16_t>(std::lround(8000.0 * std::cos(phase)));
+        pcm[f * kChannels + 1] = static_cast<std::int16_t>(std::lround(8000.0 * std::sin(phase)));
+    }
+    return pcm;
+}
+
+struct Silence {
+    std::size_t leading = 0; // all-zero frames before the first audible one
+    std::size_t gaps = 0;    // all-zero frames after it
+};
+
+Silence silence(const std::vector<std::int16_t> &out) {
+    Silence s;
+    bool started = false;
+    for (std::size_t f = 0; f < out.size() / kChannels; ++f) {
+        const bool zero = out[f * kChannels] == 0 && out[f * kChannels + 1] == 0;
+        if (!started && zero) {
+            ++s.leading;
+        } else if (zero) {
+            ++s.gaps;
+        } else {
+            started = true;
+        }
+    }
+    return s;
+}
+
+void checkStreams(const char *engine, const DspConfig &cfg) {
+    const auto pcm = line(1.0);
+    const std::size_t blockAlign = kChannels * sizeof(std::int16_t);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+
+    // Pitch path: 250 ms Unlocks, each answered with exactly its own size.
+    AudioStreamProcessor pitchStream(kRate, kChannels, blockAlign, cfg);
+    std::vector<std::int16_t> out;
+    const std::size_t unlockBytes = kRate / 4 * blockAlign;
+    for (std::size_t pos = 0; pos + unlockBytes <= total; pos += unlockBytes) {
+        const auto res = pitchStream.process(krkrtest::bytesOf(pcm) + pos, unlockBytes, kSpeed, false, 1);
+        KRKR_CHECK_MSG(res.output.size() == unlockBytes, engine);
+        const auto samples = krkrtest::samplesOf(res.output);
+        out.insert(out.end(), samples.begin(), samples.end());
+    }
+    const Silence pitch = silence(out);
+    std::printf("%s pitch path: %zu leading zero frames, %zu silent frames after\n", engine, pitch.leading,
+                pitch.gaps);
+    KRKR_CHECK_MSG(pitch.leading == 0, std::string(engine) + ": pitch path starts with padding");
+    KRKR_CHECK_MSG(pitch.gaps == 0, std::string(engine) + ": pitch path falls silent after the start");
+
+    // In-place path (a one-shot buffer too big to copy): the line is rewritten in its lock regions, primed like
+    // the pitch path. Unprocessed input must not stand in for a chunk the engine has not released yet.
+    auto buffer = pcm;
+    const std::size_t split = total * 7 / 10 / blockAlign * blockAlign;
+    auto *region = reinterpret_cast<std::uint8_t *>(buffer.data());
+    AudioStreamProcessor inPlaceStream(kRate, kChannels, blockAlign, cfg);
+    inPlaceStream.processInPlace(region, split, region + split, total - split, kSpeed, false, 1);
+    const Silence inPlace = silence(buffer);
+    std::size_t raw = 0;
+    for (std::size_t i = 0; i < buffer.size(); ++i) raw += buffer[i] == pcm[i];
+    std::printf("%s in-place path: %zu leading zero frames, %zu silent frames after, %.1f%% samples unchanged\n",
+                engine, inPlace.leading, inPlace.gaps, 100.0 * static_cast<double>(raw) / buffer.size());
+    KRKR_CHECK_MSG(inPlace.leading == 0, std::string(engine) + ": in-place path starts with padding");
+    KRKR_CHECK_MSG(inPlace.gaps == 0, std::string(engine) + ": in-place path falls silent after the start");
+    KRKR_CHECK_MSG(raw < buffer.size() / 20, std::string(engine) + ": in-place path wrote input back unprocessed");
+
+    // Tempo-to-size path: a 200 ms prefill, then 10 ms periods, each asked for its input/speed.
+    AudioStreamProcessor tempoStream(kRate, kChannels, blockAlign, cfg);
+    tempoStream.setBacklogConfig(BacklogConfig{1e9f, BacklogPolicy::DropOldest});
+    out.clear();
+    std::size_t pos = 0;
+    std::size_t periodBytes = kRate / 5 * blockAlign;
+    while (pos + periodBytes <= total) {
+        const std::size_t askBytes = static_cast<std::size_t>(periodBytes / blockAlign / kSpeed) * blockAlign;
+        const auto res =
+            tempoStream.processTempoToSize(krkrtest::bytesOf(pcm) + pos, periodBytes, askBytes, kSpeed, false, 1);
+        KRKR_CHECK_MSG(res.output.size() == askBytes, engine);
+        const auto samples = krkrtest::samplesOf(res.output);
+        out.insert(out.end(), samples.begin(), samples.end());
+        pos += periodBytes;
+        periodBytes = kRate / 100 * blockAlign;
+    }
+    const Silence tempo = silence(out);
+    std::printf("%s tempo-to-size path: %zu leading zero frames, %zu silent frames after\n", engine, tempo.leading,
+                tempo.gaps);
+    KRKR_CHECK_MSG(tempo.leading == 0, std::string(engine) + ": tempo path starts with padding");
+    KRKR_CHECK_MSG(tempo.gaps == 0, std::string(engine) + ": tempo path falls silent after the start");
+}
+
+} // namespace
+
+int main() {
+    VoiceRenderCache::instance().setBudget(0);
+    check("int-wsola", dspPresetConfig(DspPreset::LowPower));
+    checkStreams("int-wsola", dspPresetConfig(DspPreset::LowPower));
+#ifdef USE_SOUNDTOUCH
+    check("soundtouch", DspConfig{});
+    checkStreams("soundtouch", DspConfig{});
+#endif
+    return krkrtest::finish("prime_impulse_test");
+}
@@ -0,0 +1,109 @@
+// QualityGovernor on an injected clock: each simulated DSP call advances a fake steady_clock by its cost, so a
+// slow machine is reproduced exactly. A stream that overruns once, then keeps a high load, must step down to
+// RateOnly; a moderate load must not bring it back (hysteresis), a quiet one must after exactly recoverCalls,
+// and a tier that fails right after recovering must wait twice as long the next time.
+
+#include "TestSupport.h"
+#include "common/QualityGovernor.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr double kPlaybackSec = 0.01; // every call covers 10 ms of output
+
+struct SlowClock {
+    std::chrono::steady_clock::time_point t{};
+};
+
+// One DSP call that takes `load` times its playback duration on `clock`.
+QualityTier call(QualityGovernor &governor, SlowClock &clock, double load) {
+    const auto start = governor.now();
+    clock.t += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(load * kPlaybackSec));
+    return governor.record(start, kPlaybackSec);
+}
+
+// Calls at `load` until the tier changes (or `limit` calls): how many it took, 0 if it never changed.
+std::uint32_t callsUntilChange(QualityGovernor &governor, SlowClock &clock, double load, std::uint32_t limit) {
+    const QualityTier before = governor.tier();
+    for (std::uint32_t i = 1; i <= limit; ++i) {
+        if (call(governor, clock, load) != before) return i;
+    }
+    return 0;
+}
+
+const char *name(QualityTier tier) {
+    switch (tier) {
+    case QualityTier::Full:
+        return "Full";
+    case QualityTier::QuickSeek:
+        return "QuickSeek";
+    case QualityTier::RateOnly:
+        return "RateOnly";
+    }
+    return "?";
+}
+
+} // namespace
+
+int main() {
+    const QualityConfig config;
+    SlowClock clock;
+    QualityGovernor governor(config, [&clock]() { return clock.t; });
+
+    // A comfortable load never moves the tier.
+    KRKR_CHECK(callsUntilChange(governor, clock, 0.1, 1000) == 0);
+    KRKR_CHECK(governor.tier() == QualityTier::Full);
+    KRKR_CHECK(std::fabs(governor.load() - 0.1f) < 1e-3f);
+
+    // One call slower than real time steps down at once.
+    KRKR_CHECK(call(governor, clock, 1.2) == QualityTier::QuickSeek);
+    std::printf("overrun: Full -> %s\n", name(governor.tier()));
+
+    // A sustained load over degradeLoad steps down again once the cooldown has passed, and RateOnly is the floor.
+    const std::uint32_t toRateOnly = callsUntilChange(governor, clock, 0.6, 1000);
+    std::printf("load 0.6: QuickSeek -> %s after %u calls\n", name(governor.tier()), toRateOnly);
+    KRKR_CHECK(governor.tier() == QualityTier::RateOnly);
+    KRKR_CHECK(toRateOnly == config.cooldownCalls);
+    KRKR_CHECK(callsUntilChange(governor, clock, 2.0, 1000) == 0);
+    KRKR_CHECK(governor.tier() == QualityTier::RateOnly);
+
+    // Hysteresis: a load between recoverLoad and degradeLoad holds the tier in both directions.
+    KRKR_CHECK(callsUntilChange(governor, clock, 0.3, 5 * config.recoverCalls) == 0);
+    KRKR_CHECK(governor.tier() == QualityTier::RateOnly);
+
+    // A quiet load steps back up one tier per recoverCalls quiet calls. Coming from 0.3 the smoothed load first
+    // needs 4 calls at 0.05 to reach recoverLoad (0.05 + 0.25 * 0.8^n <= 0.15 at n = 5); after a step it restarts
+    // from the newest call, so the next tier takes exactly recoverCalls.
+    const std::uint32_t toQuickSeek = callsUntilChange(governor, clock, 0.05, 1000);
+    const std::uint32_t toFull = callsUntilChange(governor, clock, 0.05, 1000);
+    std::printf("load 0.05: RateOnly -> QuickSeek after %u calls, -> Full after %u more\n", toQuickSeek, toFull);
+    KRKR_CHECK(toQuickSeek == config.recoverCalls + 4 && toFull == config.recoverCalls);
+    KRKR_CHECK(governor.tier() == QualityTier::Full);
+
+    // A failed step-up: overrunning right after recovering doubles the quiet stretch needed, and again.
+    std::uint32_t expected = config.recoverCalls;
+    for (int round = 0; round < 3; ++round) {
+        KRKR_CHECK(call(governor, clock, 1.5) == QualityTier::QuickSeek);
+        expected *= 2;
+        const std::uint32_t quiet = callsUntilChange(governor, clock, 0.05, 10000);
+        std::printf("failed step-up %d: back to %s after %u quiet calls\n", round + 1, name(governor.tier()), quiet);
+        KRKR_CHECK(quiet == expected);
+        KRKR_CHECK(governor.tier() == QualityTier::Full);
+    }
+
+    // Once the recovered tier has held for twice its quiet stretch the backoff is forgotten.
+    KRKR_CHECK(callsUntilChange(governor, clock, 0.05, 2 * expected) == 0);
+    KRKR_CHECK(call(governor, clock, 1.5) == QualityTier::QuickSeek);
+    KRKR_CHECK(callsUntilChange(governor, clock, 0.05, 10000) == config.recoverCalls);
+
+    // reset() is a new stream: Full, no history, no backoff.
+    KRKR_CHECK(call(governor, clock, 1.5) == QualityTier::QuickSeek);
+    governor.reset();
+    KRKR_CHECK(governor.tier() == QualityTier::Full && governor.load() == 0.0f);
+    KRKR_CHECK(call(governor, clock, 1.5) == QualityTier::QuickSeek);
+    KRKR_CHECK(callsUntilChange(governor, clock, 0.05, 10000) == config.recoverCalls);
+
+    return krkrtest::finish("quality_governor_test");
+}
@@ -0,0 +1,82 @@
+// RateOnly in Pitch mode: the cheapest tier has no pitch-preserving equivalent for the DirectSound path, so a
+// pipeline put there must keep correcting pitch (at QuickSeek settings) instead of passing the sped-up buffer
+// through, and a stream's governor must not pick RateOnly for pitch-mode work at all. Runs on the fixed-point
+// engine, which needs no SoundTouch.
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/VoiceRenderCache.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr double kHz = 440.0;
+constexpr float kSpeed = 1.5f;
+
+// Tone frequency of the left channel from its rising zero crossings, skipping the first `skip` frames.
+double toneHz(const std::vector<std::int16_t> &pcm, std::size_t skip) {
+    const std::size_t frames = pcm.size() / kChannels;
+    std::size_t first = 0;
+    std::size_t last = 0;
+    std::size_t crossings = 0;
+    for (std::size_t f = skip + 1; f < frames; ++f) {
+        if (pcm[(f - 1) * kChannels] < 0 && pcm[f * kChannels] >= 0) {
+            if (crossings++ == 0) first = f;
+            last = f;
+        }
+    }
+    return crossings > 1 ? static_cast<double>(crossings - 1) * kRate / static_cast<double>(last - first) : 0.0;
+}
+
+void checkPipeline() {
+    const auto pcm = krkrtest::sine(kRate, kChannels, 2.0, kHz, 0.5);
+    DspPipeline dsp(kRate, kChannels, dspPresetConfig(DspPreset::LowPower));
+    dsp.setQualityTier(QualityTier::RateOnly);
+    const std::size_t bufferBytes = kRate / 50 * kChannels * sizeof(std::int16_t);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    std::vector<std::uint8_t> out;
+    for (std::size_t pos = 0; pos + bufferBytes <= total; pos += bufferBytes) {
+        const auto chunk = dsp.process(krkrtest::bytesOf(pcm) + pos, bufferBytes, 1.0f / kSpeed, DspMode::Pitch);
+        out.insert(out.end(), chunk.begin(), chunk.end());
+    }
+    const double hz = toneHz(krkrtest::samplesOf(out), kRate / 5);
+    // Pitch mode keeps the length: everything but the engine's latency comes out.
+    const double shortMs = out.size() <= total ? 20.0 * static_cast<double>(total - out.size()) / bufferBytes : -1.0;
+    std::printf("pipeline at RateOnly, pitch 1/%.1f: %.1f Hz (input %.0f Hz), %.0f ms short\n", kSpeed, hz, kHz,
+                shortMs);
+    KRKR_CHECK_MSG(std::abs(hz - kHz / kSpeed) < 0.03 * kHz / kSpeed, "pitch not corrected: " + std::to_string(hz));
+    KRKR_CHECK(shortMs >= 0.0 && shortMs < 150.0);
+}
+
+void checkStream() {
+    AudioStreamProcessor stream(kRate, kChannels, kChannels * sizeof(std::int16_t),
+                                dspPresetConfig(DspPreset::LowPower));
+    stream.setTierFloor(QualityTier::RateOnly);
+    KRKR_CHECK(stream.qualityTier(DspMode::Tempo) == QualityTier::RateOnly);
+    KRKR_CHECK(stream.qualityTier(DspMode::Pitch) == QualityTier::QuickSeek);
+
+    const auto pcm = krkrtest::sine(kRate, kChannels, 2.0, kHz, 0.5);
+    const std::size_t bufferBytes = kRate / 50 * kChannels * sizeof(std::int16_t);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    std::vector<std::uint8_t> out;
+    for (std::size_t pos = 0; pos + bufferBytes <= total; pos += bufferBytes) {
+        const auto res = stream.process(krkrtest::bytesOf(pcm) + pos, bufferBytes, kSpeed, false, 1);
+        KRKR_CHECK(res.output.size() == bufferBytes);
+        out.insert(out.end(), res.output.begin(), res.output.end());
+    }
+    const double hz = toneHz(krkrtest::samplesOf(out), kRate / 5);
+    std::printf("stream with a RateOnly floor at %.1fx: %.1f Hz\n", kSpeed, hz);
+    KRKR_CHECK_MSG(std::abs(hz - kHz / kSpeed) < 0.03 * kHz / kSpeed, "pitch not corrected: " + std::to_string(hz));
+}
+
+} // namespace
+
+int main() {
+    VoiceRenderCache::instance().setBudget(0);
+    checkPipeline();
+    checkStream();
+    return krkrtest::finish("rate_only_pitch_test");
+}
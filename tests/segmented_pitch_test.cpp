@@ -0,0 +1,83 @@
+// Segmented pitch path (AudioStreamProcessor::processPitchSegmented): a long one-shot buffer is stretched in
+// parallel segments and stitched. On a steady tone the stitched output and the join into the following
+// serial calls must show no level dip or bump and no step larger than the tone can make, the whole run must
+// reach the quality governor, and each call must still return exactly its input size.
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/VoiceRenderCache.h"
+#include "common/WorkerPool.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr double kHz = 220.0;
+constexpr double kAmplitude = 0.5;
+
+} // namespace
+
+int main() {
+    VoiceRenderCache::instance().setBudget(0);
+    WorkerPool::setWorkerCount(3); // the segmented path needs concurrency() >= 2, even on a single-core machine
+    KRKR_CHECK(WorkerPool::instance().concurrency() == 4);
+
+    const float speed = 1.5f;
+    const double longSec = 6.0;
+    const double followSec = 2.0;
+    const auto pcm = krkrtest::sine(kRate, kChannels, longSec + followSec, kHz, kAmplitude);
+    const std::size_t blockAlign = kChannels * sizeof(std::int16_t);
+    const std::size_t longBytes = static_cast<std::size_t>(longSec * kRate) * blockAlign;
+    const std::size_t chunkBytes = kRate / 10 * blockAlign; // 100 ms serial calls afterwards
+
+    AudioStreamProcessor stream(kRate, kChannels, blockAlign, DspConfig{});
+    std::vector<std::int16_t> out;
+    auto res = stream.process(krkrtest::bytesOf(pcm), longBytes, speed, false, 1);
+    KRKR_CHECK(res.output.size() == longBytes);
+    std::printf("after segmented call: dsp load %.3f, tier %u\n", stream.dspLoad(),
+                static_cast<unsigned>(stream.qualityTier(DspMode::Pitch)));
+    KRKR_CHECK_MSG(stream.dspLoad() > 0.0f, "segmented run did not reach the quality governor");
+    auto samples = krkrtest::samplesOf(res.output);
+    out.insert(out.end(), samples.begin(), samples.end());
+    const std::size_t totalBytes = pcm.size() * sizeof(std::int16_t);
+    for (std::size_t pos = longBytes; pos + chunkBytes <= totalBytes; pos += chunkBytes) {
+        res = stream.process(krkrtest::bytesOf(pcm) + pos, chunkBytes, speed, false, 1);
+        KRKR_CHECK(res.output.size() == chunkBytes);
+        samples = krkrtest::samplesOf(res.output);
+        out.insert(out.end(), samples.begin(), samples.end());
+    }
+
+    // Skip the stream's start-up latency (front padding), then check 5 ms windows and sample steps on the left
+    // channel up to the last 100 ms.
+    const std::size_t frames = out.size() / kChannels;
+    std::size_t begin = 0;
+    while (begin < frames && out[begin * kChannels] == 0) ++begin;
+    begin += kRate / 100;
+    const std::size_t end = frames - kRate / 10;
+    const std::size_t window = kRate / 200;
+    const double nominal = kAmplitude * 32767.0 / std::sqrt(2.0);
+    double minRms = 1e9;
+    double maxRms = 0.0;
+    for (std::size_t w = begin; w + window <= end; w += window) {
+        double sum = 0.0;
+        for (std::size_t f = w; f < w + window; ++f) sum += static_cast<double>(out[f * kChannels]) * out[f * kChannels];
+        const double rms = std::sqrt(sum / window);
+        minRms = std::min(minRms, rms);
+        maxRms = std::max(maxRms, rms);
+    }
+    // The tone's own steepest step at the highest frequency the pitch shift can produce.
+    const double maxStep = 2.0 * krkrtest::kPi * kHz * speed / kRate * kAmplitude * 32767.0;
+    std::size_t jumps = 0;
+    for (std::size_t f = begin + 1; f < end; ++f) {
+        if (std::abs(out[f * kChannels] - out[(f - 1) * kChannels]) > 1.5 * maxStep) jumps++;
+    }
+    std::printf("latency %zu frames, window rms %.0f..%.0f (nominal %.0f), jumps %zu\n", begin - kRate / 100, minRms,
+                maxRms, nominal, jumps);
+    KRKR_CHECK(minRms >= 0.8 * nominal);
+    KRKR_CHECK(maxRms <= 1.2 * nominal);
+    KRKR_CHECK(jumps == 0);
+
+    return krkrtest::finish("segmented_pitch_test");
+}
@@ -0,0 +1,76 @@
+// SpeechMusicClassifier accuracy on the benchmark's labelled synthetic speech and music (stereo, 20 ms buffers
+// as DirectSound Unlocks deliver them), and the settle point after which the DirectSound hook stops feeding it.
+
+#include "TestSupport.h"
+#include "ContentSynth.h"
+#include "common/SpeechMusicClassifier.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::size_t kClipsPerClass = 50;
+constexpr std::size_t kBufferSamples = kRate / 50 * kChannels;
+
+void checkAccuracy() {
+    ContentSynth synth(kRate, 1);
+    std::size_t firstOk = 0;
+    std::size_t lastOk = 0;
+    std::size_t slowest = 0;
+    for (std::size_t i = 0; i < kClipsPerClass * 2; ++i) {
+        const AudioContent label = i % 2 ? AudioContent::Music : AudioContent::Speech;
+        const auto clip = toClip(label == AudioContent::Speech ? synth.speech(3.0) : synth.music(3.0), kRate,
+                                 kChannels, audioContentName(label), synth);
+        SpeechMusicClassifier classifier(kRate, kChannels);
+        AudioContent first = AudioContent::Unknown;
+        for (std::size_t pos = 0; pos < clip.samples.size(); pos += kBufferSamples) {
+            const std::size_t n = std::min(kBufferSamples, clip.samples.size() - pos);
+            const AudioContent verdict = classifier.feedPcm16(clip.samples.data() + pos, n);
+            if (first == AudioContent::Unknown && verdict != AudioContent::Unknown) {
+                first = verdict;
+                slowest = std::max(slowest, (pos + n) / kChannels);
+            }
+        }
+        firstOk += first == label;
+        lastOk += classifier.verdict() == label;
+    }
+    const double firstPct = 100.0 * firstOk / (kClipsPerClass * 2);
+    const double lastPct = 100.0 * lastOk / (kClipsPerClass * 2);
+    const double slowestMs = 1000.0 * slowest / kRate;
+    std::printf("%zu clips per class: first verdict %.1f%%, end of clip %.1f%%, slowest decision %.0f ms\n",
+                kClipsPerClass, firstPct, lastPct, slowestMs);
+    KRKR_CHECK(firstPct >= 90.0);
+    KRKR_CHECK(lastPct >= 95.0);
+    // Leading silence is up to 80 ms; the window is 300 ms of audible frames, so a decision within 1 s.
+    KRKR_CHECK(slowestMs <= 1000.0);
+}
+
+void checkSettle() {
+    ContentSynth synth(kRate, 2);
+    for (const AudioContent label : {AudioContent::Speech, AudioContent::Music}) {
+        const auto clip = toClip(label == AudioContent::Speech ? synth.speech(10.0) : synth.music(10.0), kRate,
+                                 kChannels, audioContentName(label), synth);
+        SpeechMusicClassifier classifier(kRate, kChannels);
+        std::size_t settledAt = 0;
+        for (std::size_t pos = 0; pos < clip.samples.size() && !classifier.settled(); pos += kBufferSamples) {
+            classifier.feedPcm16(clip.samples.data() + pos, std::min(kBufferSamples, clip.samples.size() - pos));
+            settledAt = pos + kBufferSamples;
+        }
+        std::printf("%s settled after %.0f ms\n", audioContentName(label), 1000.0 * settledAt / kChannels / kRate);
+        KRKR_CHECK_MSG(classifier.settled(), audioContentName(label));
+        KRKR_CHECK_MSG(classifier.verdict() == label, audioContentName(label));
+        classifier.reset();
+        KRKR_CHECK(!classifier.settled());
+        KRKR_CHECK(classifier.verdict() == AudioContent::Unknown);
+    }
+}
+
+} // namespace
+
+int main() {
+    checkAccuracy();
+    checkSettle();
+    return krkrtest::finish("speech_music_classifier_test");
+}
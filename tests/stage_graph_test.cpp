@@ -0,0 +1,221 @@
+// StageGraph as the WASAPI render path compiles it: a chain whose formats do not line up must be rejected at
+// compile time, conversions to the format already in hand are dropped, and storage is assigned so a pcm16
+// stream stretches straight into the game's buffer (no scratch) while float and resampled streams get exactly
+// the scratch they need. run() must then give the same samples whether the destination aliases the source or
+// not, StretchStage must match AudioStreamProcessor::processTempoToSize byte for byte, and every stage run
+// must show up in the timings. isSpanSilent's early-exit compares must agree with the peak a full analyzeSpan
+// pass measures, wherever in the buffer the one loud sample sits.
+
+#include "TestSupport.h"
+#include "common/AudioStages.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/StreamAnalysis.h"
+#include "common/VoiceRenderCache.h"
+
+#include <limits>
+#include <type_traits>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::size_t kFrames = 441; // 10 ms callbacks
+constexpr float kSpeed = 1.5f;
+
+StreamFormat format(SampleFormat sample, std::uint32_t rate = kRate) {
+    StreamFormat fmt;
+    fmt.sample = sample;
+    fmt.channels = kChannels;
+    fmt.sampleRate = rate;
+    return fmt;
+}
+
+std::vector<std::string> stageNames(const StageGraph &graph) {
+    std::vector<std::string> names;
+    for (const auto &t : graph.timings()) names.push_back(t.name);
+    return names;
+}
+
+void checkCompile() {
+    std::string error;
+    StageGraph mismatched;
+    mismatched.emplace<ConvertStage>(SampleFormat::Float32).emplace<VadStage>();
+    KRKR_CHECK(!mismatched.compile(format(SampleFormat::Pcm16), kFrames, error));
+    KRKR_CHECK(!mismatched.compiled());
+    KRKR_CHECK_MSG(error.find("vad") != std::string::npos && error.find("float32") != std::string::npos, error);
+    std::printf("mismatch rejected: %s\n", error.c_str());
+
+    StageGraph limiter;
+    limiter.emplace<LimiterStage>();
+    error.clear();
+    KRKR_CHECK(!limiter.compile(format(SampleFormat::Pcm16), kFrames, error) && !error.empty());
+    KRKR_CHECK(!StageGraph().emplace<FitToSizeStage>().compile(StreamFormat{}, kFrames, error));
+
+    // The pcm16 render graph: both conversions are identities, stretch and fit write into the destination.
+    AudioStreamProcessor stream(kRate, kChannels, kChannels * sizeof(std::int16_t),
+                                dspPresetConfig(DspPreset::LowPower));
+    StageGraph pcm;
+    pcm.emplace<ConvertStage>(SampleFormat::Pcm16)
+        .emplace<StretchStage>(stream)
+        .emplace<FitToSizeStage>()
+        .emplace<ConvertStage>(SampleFormat::Pcm16);
+    KRKR_CHECK_MSG(pcm.compile(format(SampleFormat::Pcm16), kFrames, error), error);
+    KRKR_CHECK((stageNames(pcm) == std::vector<std::string>{"stretch", "fit"}));
+    KRKR_CHECK(pcm.scratchBytes() == 0);
+    KRKR_CHECK(pcm.outputFormat() == format(SampleFormat::Pcm16));
+
+    // Float: narrowing to pcm16 cannot go into the destination while a widening conversion follows, so the
+    // pcm16 stages share one scratch buffer and only the last conversion writes the destination.
+    StageGraph flt;
+    flt.emplace<ConvertStage>(SampleFormat::Pcm16)
+        .emplace<StretchStage>(stream)
+        .emplace<FitToSizeStage>()
+        .emplace<ConvertStage>(SampleFormat::Float32);
+    KRKR_CHECK_MSG(flt.compile(format(SampleFormat::Float32), kFrames, error), error);
+    KRKR_CHECK((stageNames(flt) == std::vector<std::string>{"convert", "stretch", "fit", "convert"}));
+    KRKR_CHECK(flt.scratchBytes() == kFrames * format(SampleFormat::Float32).frameBytes());
+    std::printf("pcm16 graph: %zu scratch bytes, float graph: %zu\n", pcm.scratchBytes(), flt.scratchBytes());
+
+    // A resampler needs its own output; its scratch covers the larger output rate.
+    StageGraph resample;
+    resample.emplace<ResampleStage>(48000);
+    KRKR_CHECK_MSG(resample.compile(format(SampleFormat::Pcm16), kFrames, error), error);
+    KRKR_CHECK(resample.outputFormat() == format(SampleFormat::Pcm16, 48000));
+    KRKR_CHECK(resample.scratchBytes() >= (kFrames * 48000 / kRate) * format(SampleFormat::Pcm16).frameBytes());
+    StageGraph sameRate;
+    sameRate.emplace<ResampleStage>(kRate);
+    KRKR_CHECK(sameRate.compile(format(SampleFormat::Pcm16), kFrames, error) && sameRate.timings().empty());
+}
+
+// Float -> pcm16 -> fit -> float, once into a separate buffer and once in place: the same samples, within one
+// pcm16 step of the input, and the source untouched when it is not the destination.
+void checkInPlace() {
+    StageGraph graph;
+    graph.emplace<ConvertStage>(SampleFormat::Pcm16).emplace<FitToSizeStage>().emplace<ConvertStage>(
+        SampleFormat::Float32);
+    std::string error;
+    KRKR_CHECK_MSG(graph.compile(format(SampleFormat::Float32), kFrames, error), error);
+
+    const auto pcm = krkrtest::sine(kRate, kChannels, static_cast<double>(kFrames) / kRate, 440.0);
+    std::vector<float> src(pcm.size());
+    for (std::size_t i = 0; i < pcm.size(); ++i) src[i] = static_cast<float>(pcm[i]) / 32768.0f;
+    const std::vector<float> original = src;
+
+    StageContext ctx;
+    ctx.targetFrames = kFrames;
+    std::vector<float> separate(src.size(), 1.0f);
+    KRKR_CHECK(graph.run(src.data(), kFrames, separate.data(), kFrames, ctx) == kFrames);
+    KRKR_CHECK(src == original);
+    std::vector<float> inPlace = src;
+    KRKR_CHECK(graph.run(inPlace.data(), kFrames, inPlace.data(), kFrames, ctx) == kFrames);
+    KRKR_CHECK(inPlace == separate);
+    float worst = 0.0f;
+    for (std::size_t i = 0; i < src.size(); ++i) worst = std::max(worst, std::fabs(separate[i] - src[i]));
+    KRKR_CHECK(worst <= 1.0f / 32768.0f);
+
+    // Fit pads a short call with silence up to targetFrames.
+    ctx.targetFrames = kFrames;
+    std::vector<float> padded(src.size(), 1.0f);
+    KRKR_CHECK(graph.run(src.data(), kFrames / 2, padded.data(), kFrames, ctx) == kFrames);
+    KRKR_CHECK(padded[(kFrames / 2) * kChannels - 1] == separate[(kFrames / 2) * kChannels - 1]);
+    KRKR_CHECK(std::all_of(padded.begin() + (kFrames / 2) * kChannels, padded.end(),
+                           [](float v) { return v == 0.0f; }));
+}
+
+// The pcm16 render graph run in place on 10 ms callbacks against processTempoToSize on a second stream.
+void checkStretch() {
+    const DspConfig cfg = dspPresetConfig(DspPreset::LowPower);
+    const std::uint32_t align = kChannels * sizeof(std::int16_t);
+    AudioStreamProcessor graphStream(kRate, kChannels, align, cfg);
+    AudioStreamProcessor reference(kRate, kChannels, align, cfg);
+    StageGraph graph;
+    graph.emplace<StretchStage>(graphStream).emplace<FitToSizeStage>();
+    std::string error;
+    KRKR_CHECK_MSG(graph.compile(format(SampleFormat::Pcm16), kFrames, error), error);
+
+    const auto pcm = krkrtest::dialogue(kRate, kChannels, 1.0);
+    constexpr std::size_t kCalls = 60; // fewer than a tier recovery takes, so a tier change would still show
+    std::size_t mismatched = 0;
+    std::size_t nonSilent = 0;
+    std::vector<std::int16_t> buffer(kFrames * kChannels);
+    for (std::size_t call = 0; call < kCalls; ++call) {
+        const std::int16_t *in = pcm.data() + call * kFrames * kChannels;
+        std::copy(in, in + buffer.size(), buffer.begin());
+        StageContext ctx;
+        ctx.speed = kSpeed;
+        ctx.targetFrames = kFrames;
+        KRKR_CHECK(graph.run(buffer.data(), kFrames, buffer.data(), kFrames, ctx) == kFrames);
+        const auto res = reference.processTempoToSize(reinterpret_cast<const std::uint8_t *>(in), kFrames * align,
+                                                      kFrames * align, kSpeed, false, 1);
+        KRKR_CHECK(res.output.size() == kFrames * align && ctx.backlogBytes == res.cbufferSize);
+        mismatched += std::memcmp(buffer.data(), res.output.data(), res.output.size()) != 0;
+        nonSilent += std::any_of(buffer.begin(), buffer.end(), [](std::int16_t v) { return v != 0; });
+    }
+    std::printf("stretch in place: %zu/%zu calls differ from processTempoToSize, %zu non-silent\n", mismatched, kCalls,
+                nonSilent);
+    // Both streams are timed by their own QualityGovernor; only compare output produced on the same tier.
+    if (graphStream.qualityTier(DspMode::Tempo) == QualityTier::Full &&
+        reference.qualityTier(DspMode::Tempo) == QualityTier::Full) {
+        KRKR_CHECK(mismatched == 0);
+    }
+    KRKR_CHECK(nonSilent > kCalls / 2);
+
+    const auto timings = graph.timings();
+    KRKR_CHECK(timings.size() == 2);
+    for (const auto &t : timings) {
+        KRKR_CHECK_MSG(t.calls == kCalls && t.maxNs <= t.totalNs && t.totalNs > 0, t.name);
+    }
+    const std::string summary = graph.timingSummary();
+    std::printf("timings: %s\n", summary.c_str());
+    KRKR_CHECK(summary.find("stretch=") == 0 && summary.find(" fit=") != std::string::npos);
+    graph.resetTimings();
+    for (const auto &t : graph.timings()) KRKR_CHECK(t.calls == 0 && t.totalNs == 0 && t.maxNs == 0);
+}
+
+// One sample at `level` (in the format's own units) at `pos` of a buffer of 1-LSB noise, against the verdict of
+// a full analyzeSpan pass.
+template <typename T> void checkSilentAt(SampleFormat sample, T level, std::size_t pos, std::size_t frames) {
+    std::vector<T> buffer(frames * kChannels);
+    for (std::size_t i = 0; i < buffer.size(); ++i) buffer[i] = static_cast<T>(i % 3 == 0 ? 0 : (i % 3 == 1 ? 1 : -1));
+    if constexpr (std::is_same_v<T, float>) {
+        for (auto &v : buffer) v *= 1.0f / 32768.0f;
+    }
+    if (pos < buffer.size()) buffer[pos] = level;
+    const AudioSpan span{buffer.data(), frames, format(sample)};
+    const StreamStats stats = analyzeSpan(span);
+    const float floor = sample == SampleFormat::Pcm16 ? 8.0f / 32768.0f
+                                                      : (sample == SampleFormat::Pcm32 ? 32.0f / 32768.0f : 1e-4f);
+    const bool expected = stats.nanInf == 0 && stats.peak < floor;
+    KRKR_CHECK_MSG(isSpanSilent(span) == expected, std::string(sampleFormatName(sample)) + " level at sample " +
+                                                       std::to_string(pos) + " of " + std::to_string(buffer.size()));
+}
+
+void checkSilence() {
+    // Every position of a buffer whose length is not a whole number of 64-sample blocks: blocks and tail.
+    constexpr std::size_t kOddFrames = 101;
+    std::size_t checks = 0;
+    for (std::size_t pos = 0; pos <= kOddFrames * kChannels; ++pos, checks += 8) {
+        checkSilentAt<std::int16_t>(SampleFormat::Pcm16, 7, pos, kOddFrames);
+        checkSilentAt<std::int16_t>(SampleFormat::Pcm16, -8, pos, kOddFrames);
+        checkSilentAt<std::int16_t>(SampleFormat::Pcm16, std::numeric_limits<std::int16_t>::min(), pos, kOddFrames);
+        checkSilentAt<std::int32_t>(SampleFormat::Pcm32, (32 << 16) - 1, pos, kOddFrames);
+        checkSilentAt<std::int32_t>(SampleFormat::Pcm32, -(32 << 16), pos, kOddFrames);
+        checkSilentAt<float>(SampleFormat::Float32, 0.99e-4f, pos, kOddFrames);
+        checkSilentAt<float>(SampleFormat::Float32, -1e-4f, pos, kOddFrames);
+        checkSilentAt<float>(SampleFormat::Float32, std::numeric_limits<float>::quiet_NaN(), pos, kOddFrames);
+    }
+    std::printf("silence: %zu placements agree with analyzeSpan\n", checks);
+}
+
+} // namespace
+
+int main() {
+    VoiceRenderCache::instance().setBudget(0);
+    checkCompile();
+    checkInPlace();
+    checkStretch();
+    checkSilence();
+    return krkrtest::finish("stage_graph_test");
+}
@@ -0,0 +1,207 @@
+// StreamProfile learning and StreamProfileStore persistence as the DirectSound hook uses them: a simulated
+// session records buffer outcomes (BGM, voice, a sound-effect size used for both), classify() must answer
+// only for signatures with enough agreeing evidence and relearn one whose behaviour flips. Profiles of
+// several executables are then saved, reloaded and merged the way the hook does every 30 s, and damaged
+// files must be rejected whole.
+
+#include "TestSupport.h"
+#include "common/StreamProfileStore.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace krkrspeed;
+
+namespace {
+
+const StreamSignature kBgm{44100, 44100 * 4 * 4, 2, 16};   // 4 s streaming buffer
+const StreamSignature kVoice{22050, 22050 * 2 * 3, 1, 16}; // 3 s one-shot
+const StreamSignature kEffect{44100, 44100 * 4 / 2, 2, 16}; // 0.5 s, used for jingles and effects alike
+
+const std::filesystem::path &dir() {
+    static const auto path = std::filesystem::temp_directory_path() / "krkr_stream_profile_test";
+    return path;
+}
+
+bool sameProfile(const StreamProfile &a, const StreamProfile &b) {
+    if (a.seenMono() != b.seenMono() || a.seenStereo() != b.seenStereo() ||
+        a.observations().size() != b.observations().size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.observations().size(); ++i) {
+        const auto &x = a.observations()[i];
+        const auto &y = b.observations()[i];
+        if (!(x.signature == y.signature) || x.voiceCount != y.voiceCount || x.bgmCount != y.bgmCount ||
+            x.meanLifetimeMs != y.meanLifetimeMs || x.meanPlayedMs != y.meanPlayedMs) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One run of a game: a BGM buffer per track, voice lines, and effects that are BGM one time in four.
+StreamProfile session(std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    StreamProfile profile;
+    profile.noteChannels(2);
+    profile.noteChannels(1);
+    for (int i = 0; i < 200; ++i) {
+        const std::uint32_t r = rng() % 10;
+        if (r == 0) {
+            profile.record(kBgm, true, 90000 + rng() % 60000, 90000);
+        } else if (r < 7) {
+            profile.record(kVoice, false, 2500 + rng() % 1000, 2400);
+        } else {
+            profile.record(kEffect, rng() % 4 == 0, 600, 500);
+        }
+    }
+    return profile;
+}
+
+void checkLearning() {
+    StreamProfile profile;
+    KRKR_CHECK(profile.empty());
+    KRKR_CHECK(profile.noteChannels(1) && !profile.noteChannels(1) && !profile.noteChannels(0));
+    KRKR_CHECK(profile.seenMono() && !profile.seenStereo() && !profile.empty());
+
+    // Nothing is claimed before kMinObservations outcomes.
+    for (std::uint32_t i = 1; i <= StreamProfile::kMinObservations; ++i) {
+        KRKR_CHECK(profile.classify(kBgm) == StreamClass::Unknown);
+        profile.record(kBgm, true, 120000, 118000);
+    }
+    KRKR_CHECK(profile.classify(kBgm) == StreamClass::Bgm);
+    KRKR_CHECK(profile.classify(kVoice) == StreamClass::Unknown);
+
+    // 90% agreement: 9 of 10 decides, 8 of 10 does not.
+    StreamProfile split;
+    for (int i = 0; i < 9; ++i) split.record(kVoice, false, 3000, 3000);
+    split.record(kVoice, true, 3000, 3000);
+    KRKR_CHECK(split.classify(kVoice) == StreamClass::Voice);
+    split.record(kVoice, true, 3000, 3000);
+    KRKR_CHECK(split.classify(kVoice) == StreamClass::Unknown);
+
+    const StreamProfile game = session(49);
+    KRKR_CHECK(game.classify(kBgm) == StreamClass::Bgm);
+    KRKR_CHECK(game.classify(kVoice) == StreamClass::Voice);
+    KRKR_CHECK(game.classify(kEffect) == StreamClass::Unknown);
+    KRKR_CHECK(game.classify(StreamSignature{48000, kVoice.bufferBytes, 1, 16}) == StreamClass::Unknown);
+    const auto *voice = game.find(kVoice);
+    KRKR_CHECK(voice && voice->bgmCount == 0 && voice->voiceCount <= StreamProfile::kMaxCount);
+    KRKR_CHECK(voice && voice->meanLifetimeMs >= 2500 && voice->meanLifetimeMs < 3500 && voice->meanPlayedMs == 2400);
+
+    // A signature that changes behaviour (a patch streams BGM through the voice size) is relearned: counts are
+    // halved past kMaxCount, so the old evidence fades.
+    StreamProfile flipped = game;
+    int plays = 0;
+    while (flipped.classify(kVoice) != StreamClass::Bgm && plays < 1000) {
+        flipped.record(kVoice, true, 60000, 60000);
+        ++plays;
+    }
+    std::printf("voice signature relearned as BGM after %d outcomes\n", plays);
+    KRKR_CHECK(plays <= 2 * static_cast<int>(StreamProfile::kMaxCount));
+
+    // Past kMaxSignatures the signature with the least evidence is forgotten.
+    StreamProfile crowded = game;
+    for (std::uint32_t i = 0; crowded.observations().size() < StreamProfile::kMaxSignatures; ++i) {
+        crowded.record(StreamSignature{8000 + i, 1000, 1, 16}, false, 100, 100);
+        crowded.record(StreamSignature{8000 + i, 1000, 1, 16}, false, 100, 100);
+    }
+    crowded.record(StreamSignature{7000, 1000, 1, 16}, false, 100, 100);
+    KRKR_CHECK(crowded.observations().size() == StreamProfile::kMaxSignatures);
+    KRKR_CHECK(crowded.find(StreamSignature{7000, 1000, 1, 16}) != nullptr);
+    KRKR_CHECK(crowded.classify(kBgm) == StreamClass::Bgm && crowded.classify(kVoice) == StreamClass::Voice);
+}
+
+void checkRoundTrip() {
+    const std::uint64_t exeA = StreamProfileStore::executableDigest("C:\\Games\\Novel\\Novel.exe");
+    const std::uint64_t exeB = StreamProfileStore::executableDigest("D:/Other/krkr.exe");
+    KRKR_CHECK(exeA == StreamProfileStore::executableDigest("c:/games/novel/NOVEL.EXE"));
+    KRKR_CHECK(exeA != exeB);
+
+    StreamProfileStore store;
+    store.update(exeA, session(1), 1000);
+    store.update(exeB, session(2), 2000);
+    const auto bytes = store.serialize();
+    StreamProfileStore parsed;
+    std::string error;
+    KRKR_CHECK_MSG(parsed.parse(bytes, error), error);
+    KRKR_CHECK(parsed.profiles() == 2);
+    KRKR_CHECK(sameProfile(parsed.profile(exeA), session(1)) && sameProfile(parsed.profile(exeB), session(2)));
+    KRKR_CHECK(parsed.serialize() == bytes);
+    KRKR_CHECK(parsed.profile(12345).empty());
+    std::printf("2 profiles, %zu signatures: %zu bytes\n",
+                session(1).observations().size() + session(2).observations().size(), bytes.size());
+
+    // The hook's save: load what is on disk, replace only its own profile, write it back.
+    const auto path = dir() / "krkr_stream_profiles.bin";
+    StreamProfileStore empty;
+    KRKR_CHECK_MSG(empty.load(path, error) && empty.profiles() == 0, error);
+    KRKR_CHECK_MSG(store.save(path, error), error);
+    StreamProfileStore other;
+    KRKR_CHECK_MSG(other.load(path, error), error);
+    StreamProfile learned = other.profile(exeB);
+    learned.record(kBgm, true, 100000, 100000);
+    other.update(exeB, learned, 3000);
+    KRKR_CHECK_MSG(other.save(path, error), error);
+    StreamProfileStore reloaded;
+    KRKR_CHECK_MSG(reloaded.load(path, error), error);
+    KRKR_CHECK(sameProfile(reloaded.profile(exeA), session(1)));
+    KRKR_CHECK(sameProfile(reloaded.profile(exeB), learned));
+    std::size_t files = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir())) files += entry.is_regular_file();
+    KRKR_CHECK_MSG(files == 1, "temporary file left behind");
+
+    // Full store: the least recently used executable goes.
+    StreamProfileStore full;
+    for (std::uint64_t i = 0; i < StreamProfileStore::kMaxProfiles; ++i) full.update(100 + i, session(3), 10 + i);
+    full.update(100, session(3), 5000); // used again
+    full.update(99, session(4), 6000);
+    KRKR_CHECK(full.profiles() == StreamProfileStore::kMaxProfiles);
+    KRKR_CHECK(!full.profile(100).empty() && !full.profile(99).empty() && full.profile(101).empty());
+    StreamProfileStore fullParsed;
+    KRKR_CHECK_MSG(fullParsed.parse(full.serialize(), error) && fullParsed.profiles() == full.profiles(), error);
+}
+
+void checkDamage() {
+    StreamProfileStore store;
+    store.update(1, session(1), 1000);
+    const auto good = store.serialize();
+    auto expectReject = [&](std::vector<std::uint8_t> bytes, const char *what) {
+        StreamProfileStore parsed;
+        parsed.update(7, session(2), 1);
+        std::string error;
+        KRKR_CHECK_MSG(!parsed.parse(bytes, error) && !error.empty(), what);
+        KRKR_CHECK_MSG(parsed.profiles() == 0, what);
+    };
+    auto flipped = good;
+    flipped[good.size() / 2] ^= 0x10;
+    expectReject(flipped, "flipped payload byte");
+    expectReject(std::vector<std::uint8_t>(good.begin(), good.end() - 24), "lost last observation");
+    expectReject(std::vector<std::uint8_t>(good.begin(), good.begin() + 16), "truncated header");
+    auto magic = good;
+    magic[0] ^= 0xFF;
+    expectReject(magic, "bad magic");
+    auto extra = good;
+    extra.insert(extra.end(), 24, 0);
+    expectReject(extra, "trailing bytes");
+
+    // The same damage on disk: load fails, and the hook starts from an empty profile.
+    const auto path = dir() / "damaged.bin";
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(flipped.data()),
+                                                static_cast<std::streamsize>(flipped.size()));
+    StreamProfileStore loaded;
+    std::string error;
+    KRKR_CHECK(!loaded.load(path, error) && loaded.profiles() == 0);
+}
+
+} // namespace
+
+int main() {
+    std::filesystem::remove_all(dir());
+    std::filesystem::create_directories(dir());
+    checkLearning();
+    checkRoundTrip();
+    checkDamage();
+    std::filesystem::remove_all(dir());
+    return krkrtest::finish("stream_profile_store_test");
+}
@@ -0,0 +1,103 @@
+// VirtualPaddingModel against a simulated WASAPI engine clock: a shared-mode endpoint of kBufferMs consuming
+// one kPeriodMs period at a time, and a drop-mode hook that releases written/speed frames. Two games drive it:
+// an event-driven one that tops the buffer up to full after every period, and a polling one that writes its
+// fixed period whenever the reported free space allows. At every speed the game must be able to write at
+// speed x real time, the endpoint must never run dry, and the real fill must stay above the model's floor
+// instead of settling at bufferFrames/speed.
+
+#include "TestSupport.h"
+#include "common/VirtualPaddingModel.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 48000;
+constexpr std::uint32_t kBufferFrames = kRate / 10; // 100 ms endpoint buffer
+constexpr std::uint32_t kPeriodFrames = kRate / 100; // 10 ms engine period
+constexpr std::uint32_t kTickFrames = kRate / 1000;  // 1 ms simulation step
+constexpr double kSeconds = 30.0;
+
+enum class Game { TopUp, Polling };
+
+struct Result {
+    double throughput = 0.0; // game frames written per real-time frame
+    double writesPerSec = 0.0;
+    double meanFill = 0.0; // real endpoint fill once a period is consumed, as a fraction of the buffer
+    double minFill = 1.0;
+    std::size_t underruns = 0;
+};
+
+Result run(Game game, double speed) {
+    VirtualPaddingModel model;
+    std::uint32_t real = 0;
+    double carry = 0.0;
+    std::uint64_t written = 0;
+    std::size_t writes = 0;
+    Result r;
+    std::size_t periods = 0;
+    double fillSum = 0.0;
+    auto write = [&](std::uint32_t frames) {
+        if (frames == 0) return;
+        // GetBuffer fails for more than the real free space; the game would retry on its next wake-up.
+        if (frames > kBufferFrames - real) return;
+        carry += frames / speed;
+        const auto released = static_cast<std::uint32_t>(carry);
+        carry -= released;
+        real += released;
+        model.onRelease(frames, released);
+        written += frames;
+        ++writes;
+    };
+    const std::size_t ticks = static_cast<std::size_t>(kSeconds * kRate / kTickFrames);
+    for (std::size_t t = 0; t < ticks; ++t) {
+        const bool periodEnd = (t + 1) % (kPeriodFrames / kTickFrames) == 0;
+        if (periodEnd) {
+            if (t > kPeriodFrames / kTickFrames && real < kPeriodFrames) ++r.underruns;
+            real -= std::min(real, kPeriodFrames);
+            if (t >= ticks / 10) {
+                const double fill = static_cast<double>(real) / kBufferFrames;
+                fillSum += fill;
+                r.minFill = std::min(r.minFill, fill);
+                ++periods;
+            }
+        }
+        const std::uint32_t reported = model.virtualPadding(real, kBufferFrames);
+        KRKR_CHECK(reported >= real && reported <= kBufferFrames);
+        if (game == Game::TopUp && periodEnd) {
+            write(kBufferFrames - reported);
+        } else if (game == Game::Polling && kBufferFrames - reported >= kPeriodFrames) {
+            write(kPeriodFrames);
+        }
+    }
+    r.throughput = static_cast<double>(written) / (kSeconds * kRate);
+    r.writesPerSec = writes / kSeconds;
+    r.meanFill = fillSum / std::max<std::size_t>(1, periods);
+    return r;
+}
+
+} // namespace
+
+int main() {
+    for (const Game game : {Game::TopUp, Game::Polling}) {
+        for (const double speed : {1.0, 2.0, 3.0}) {
+            const Result r = run(game, speed);
+            std::printf("%-7s %.1fx: %.3fx real time in %.0f writes/s, real fill mean %.0f%% min %.0f%%, "
+                        "%zu underruns\n",
+                        game == Game::TopUp ? "top-up" : "polling", speed, r.throughput, r.writesPerSec,
+                        100.0 * r.meanFill, 100.0 * r.minFill, r.underruns);
+            const std::string label = (game == Game::TopUp ? "top-up " : "polling ") + std::to_string(speed);
+            KRKR_CHECK_MSG(std::abs(r.throughput - speed) < 0.01 * speed, label);
+            KRKR_CHECK_MSG(r.underruns == 0, label);
+            // After the period just consumed the endpoint still holds more than a third of its buffer.
+            KRKR_CHECK_MSG(r.minFill >= 0.35, label);
+        }
+    }
+    VirtualPaddingModel model;
+    model.onRelease(960, 480);
+    KRKR_CHECK(model.virtualPadding(kBufferFrames / 2 + 480, kBufferFrames) > kBufferFrames / 2 + 480);
+    KRKR_CHECK(model.virtualPadding(kBufferFrames / 2 - 1, kBufferFrames) == kBufferFrames / 2 - 1);
+    model.reset();
+    KRKR_CHECK(model.virtualPadding(1000, kBufferFrames) == 1000);
+    return krkrtest::finish("virtual_padding_test");
+}
@@ -0,0 +1,77 @@
+// Voice gate: tempo-mode output must stay input/tempo long whether or not silent spans are shortened, the
+// gate must be off unless a caller asks for it, and output resuming after a cut must fade back in instead of
+// jumping from the faded-out cut to mid-waveform.
+
+#include "TestSupport.h"
+#include "common/DspPipeline.h"
+
+#include <cstdlib>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::size_t kBufferFrames = kRate / 50; // 20 ms callbacks
+
+std::vector<std::int16_t> render(const std::vector<std::int16_t> &pcm, float tempo, bool gate) {
+    DspConfig cfg;
+    cfg.voiceGate = gate;
+    DspPipeline dsp(kRate, kChannels, cfg);
+    std::vector<std::uint8_t> out;
+    const std::size_t bufferBytes = kBufferFrames * kChannels * sizeof(std::int16_t);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    for (std::size_t pos = 0; pos < total; pos += bufferBytes) {
+        const auto chunk = dsp.process(krkrtest::bytesOf(pcm) + pos, std::min(bufferBytes, total - pos), tempo,
+                                       DspMode::Tempo);
+        out.insert(out.end(), chunk.begin(), chunk.end());
+    }
+    const auto tail = dsp.finish();
+    out.insert(out.end(), tail.begin(), tail.end());
+    return krkrtest::samplesOf(out);
+}
+
+int maxStep(const std::vector<std::int16_t> &pcm) {
+    int step = 0;
+    for (std::size_t i = kChannels; i < pcm.size(); ++i) {
+        step = std::max(step, std::abs(pcm[i] - pcm[i - kChannels]));
+    }
+    return step;
+}
+
+void checkLength() {
+    const auto pcm = krkrtest::dialogue(kRate, kChannels, 30.0, 0.6);
+    const double inputFrames = static_cast<double>(pcm.size() / kChannels);
+    for (const float tempo : {0.75f, 1.5f, 2.0f}) {
+        for (const bool gate : {false, true}) {
+            const auto out = render(pcm, tempo, gate);
+            const double expected = inputFrames / tempo;
+            const double error = (static_cast<double>(out.size() / kChannels) - expected) / expected;
+            std::printf("tempo %.2f gate %-3s: %zu frames, expected %.0f (%+.2f%%)\n", tempo, gate ? "on" : "off",
+                        out.size() / kChannels, expected, 100.0 * error);
+            KRKR_CHECK_MSG(std::abs(error) < 0.01, std::to_string(tempo) + (gate ? " gated" : " ungated"));
+        }
+    }
+}
+
+// -52 dBFS 230 Hz tone: below the VAD's -50 dBFS threshold with a tonal zero-crossing rate, so every buffer is
+// a silent span that the gate cuts. The tone itself moves at most ~3 LSB per sample.
+void checkResumeFade() {
+    const auto quiet = krkrtest::sine(kRate, kChannels, 5.0, 230.0, 0.0025 * std::sqrt(2.0));
+    const auto out = render(quiet, 2.0f, true);
+    const int step = maxStep(out);
+    std::printf("quiet tone gated at 2x: max step %d LSB\n", step);
+    KRKR_CHECK_MSG(step <= 12, "resume after a cut jumps by " + std::to_string(step) + " LSB");
+    const double expected = static_cast<double>(quiet.size() / kChannels) / 2.0;
+    KRKR_CHECK(std::abs(static_cast<double>(out.size() / kChannels) - expected) < 0.01 * expected);
+}
+
+} // namespace
+
+int main() {
+    KRKR_CHECK_MSG(!DspConfig{}.voiceGate, "the gate must be opt-in");
+    checkLength();
+    checkResumeFade();
+    return krkrtest::finish("voice_gate_test");
+}
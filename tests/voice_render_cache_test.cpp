@@ -0,0 +1,88 @@
+// VoiceRenderCache with lines that share their opening: two one-buffer lines with the same 300 ms of leading
+// silence, and two lines streamed in 100 ms Unlocks whose first three buffers are identical. Each play runs a
+// fresh AudioStreamProcessor, as when the game creates and releases a buffer per line. Once both lines of a
+// pair have been heard, every later play must be served from the cache in full, byte-identical to the play
+// that recorded it.
+
+#include "TestSupport.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/VoiceRenderCache.h"
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::uint32_t kBlockAlign = kChannels * sizeof(std::int16_t);
+constexpr float kSpeed = 1.5f;
+
+// 300 ms of silence, then two seconds of dialogue that differs per seed.
+std::vector<std::int16_t> line(std::uint32_t seed) {
+    std::vector<std::int16_t> pcm(kRate * 3 / 10 * kChannels, 0);
+    const auto voice = krkrtest::dialogue(kRate, kChannels, 2.0, 1.0, seed);
+    pcm.insert(pcm.end(), voice.begin(), voice.end());
+    return pcm;
+}
+
+struct Play {
+    std::vector<std::uint8_t> output;
+    std::uint64_t served = 0; // output bytes that came from the cache
+};
+
+Play play(const std::vector<std::int16_t> &pcm, std::size_t chunkBytes) {
+    auto &cache = VoiceRenderCache::instance();
+    const std::uint64_t before = cache.stats().bytesSaved;
+    Play result;
+    const auto *bytes = krkrtest::bytesOf(pcm);
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    const std::size_t chunk = chunkBytes ? chunkBytes : total;
+    {
+        AudioStreamProcessor stream(kRate, kChannels, kBlockAlign, DspConfig{});
+        for (std::size_t pos = 0; pos < total; pos += chunk) {
+            const auto res = stream.process(bytes + pos, std::min(chunk, total - pos), kSpeed, false, 1);
+            result.output.insert(result.output.end(), res.output.begin(), res.output.end());
+        }
+    } // the finished line goes to the cache here
+    result.served = cache.stats().bytesSaved - before;
+    return result;
+}
+
+void checkPair(const char *name, std::size_t chunkBytes) {
+    auto &cache = VoiceRenderCache::instance();
+    cache.setBudget(0);
+    cache.setBudget(32u * 1024u * 1024u);
+    const std::vector<std::int16_t> lines[] = {line(1), line(2)};
+    // First hearing of each, then alternating repeats.
+    const int order[] = {0, 1, 1, 0, 0, 1, 0, 1};
+    std::vector<std::uint8_t> recorded[2];
+    std::size_t full = 0;
+    for (std::size_t i = 0; i < std::size(order); ++i) {
+        const int which = order[i];
+        const Play p = play(lines[which], chunkBytes);
+        const bool fromCache = p.served == p.output.size();
+        std::printf("%s play %zu (line %c): %zu of %zu bytes from the cache\n", name, i + 1, 'A' + which,
+                    static_cast<std::size_t>(p.served), p.output.size());
+        KRKR_CHECK(p.output.size() == lines[which].size() * sizeof(std::int16_t));
+        if (fromCache) {
+            ++full;
+            KRKR_CHECK_MSG(p.output == recorded[which], std::string(name) + " replay differs from its recording");
+        } else {
+            recorded[which] = p.output;
+        }
+    }
+    const std::size_t expected = chunkBytes ? 2 : 6;
+    std::printf("%s: %zu of %zu plays served in full\n", name, full, std::size(order));
+    KRKR_CHECK_MSG(full >= expected, name);
+}
+
+} // namespace
+
+int main() {
+    // One buffer per line: the keys differ once the whole first buffer is hashed.
+    checkPair("one buffer", 0);
+    // Identical first buffers share a key: a line that diverges from the cached one replaces it, so the
+    // immediate repeats (plays 3 and 5) are full hits and each switch replays the shared opening.
+    checkPair("100 ms Unlocks", kRate / 10 * kBlockAlign);
+    return krkrtest::finish("voice_render_cache_test");
+}
@@ -0,0 +1,69 @@
+// WorkerPool::parallelFor: every item runs exactly once, an exception thrown by any item (on a worker or on
+// the caller) reaches the caller only after all items finished, and the pool keeps working afterwards.
+
+#include "TestSupport.h"
+#include "common/WorkerPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace krkrspeed;
+
+int main() {
+    WorkerPool::setWorkerCount(3); // fan out even on a single-core machine
+    auto &pool = WorkerPool::instance();
+    std::printf("concurrency %zu\n", pool.concurrency());
+
+    for (int round = 0; round < 50; ++round) {
+        const std::size_t count = 3 + round % 13;
+        std::vector<std::atomic<int>> runs(count);
+        pool.parallelFor(count, [&](std::size_t i) { runs[i].fetch_add(1); });
+        for (std::size_t i = 0; i < count; ++i) KRKR_CHECK(runs[i].load() == 1);
+    }
+
+    // Each item index throws in turn; slow items make sure the throw happens while others still run.
+    const std::size_t count = 16;
+    for (std::size_t thrower = 0; thrower < count; ++thrower) {
+        std::vector<std::atomic<int>> finished(count);
+        bool caught = false;
+        try {
+            pool.parallelFor(count, [&](std::size_t i) {
+                if (i == thrower) throw std::runtime_error("item " + std::to_string(i));
+                std::this_thread::sleep_for(std::chrono::microseconds(200 * (i % 4)));
+                finished[i].fetch_add(1);
+            });
+        } catch (const std::runtime_error &e) {
+            caught = std::string(e.what()) == "item " + std::to_string(thrower);
+        }
+        KRKR_CHECK_MSG(caught, "thrower " + std::to_string(thrower));
+        std::size_t done = 0;
+        for (std::size_t i = 0; i < count; ++i) done += finished[i].load();
+        KRKR_CHECK_MSG(done == count - 1, "thrower " + std::to_string(thrower) + ": " + std::to_string(done) + " ran");
+    }
+
+    // Several items throwing: exactly one exception surfaces.
+    int caught = 0;
+    try {
+        pool.parallelFor(count, [](std::size_t i) {
+            if (i % 3 == 0) throw std::logic_error("boom");
+        });
+    } catch (const std::logic_error &) {
+        caught++;
+    }
+    KRKR_CHECK(caught == 1);
+
+    // Still usable, including from several callers at once (the busy one runs inline).
+    std::atomic<std::size_t> total{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t) {
+        callers.emplace_back([&]() {
+            for (int r = 0; r < 20; ++r) pool.parallelFor(8, [&](std::size_t) { total.fetch_add(1); });
+        });
+    }
+    for (auto &t : callers) t.join();
+    KRKR_CHECK(total.load() == 4u * 20u * 8u);
+
+    return krkrtest::finish("worker_pool_test");
+}
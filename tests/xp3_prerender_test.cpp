@@ -0,0 +1,329 @@
+// The XP3 pre-render path on archives built here: a zlib index behind a "cushion" block with a voice split
+// over a zlib and a raw segment, a UTF-16 name outside the BMP, a duplicate, an Ogg entry, an entry whose
+// Adler-32 does not match (what an encrypted archive looks like) and a 24-bit WAV, plus a raw-index archive
+// and broken headers. Readable 16-bit voices are rendered the way krkr_xp3_prerender does it (fresh stream,
+// whole line or 100 ms buffers, in parallel on WorkerPool) into a PrerenderPack, which must hand every
+// record back and, attached to VoiceRenderCache, serve a replay of each line in full.
+
+#include "TestSupport.h"
+#include "WavCorpus.h"
+#include "Xp3Archive.h"
+#include "common/AudioStreamProcessor.h"
+#include "common/PrerenderPack.h"
+#include "common/VoiceRenderCache.h"
+#include "common/WorkerPool.h"
+#include "common/XxHash64.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+using namespace krkrspeed;
+
+namespace {
+
+using Bytes = std::vector<unsigned char>;
+
+void put(Bytes &out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void putChunk(Bytes &out, const char *tag, const Bytes &body) {
+    out.insert(out.end(), tag, tag + 4);
+    put(out, body.size(), 8);
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+Bytes deflate(const Bytes &in) {
+    uLongf size = compressBound(static_cast<uLong>(in.size()));
+    Bytes out(size);
+    compress(out.data(), &size, in.data(), static_cast<uLong>(in.size()));
+    out.resize(size);
+    return out;
+}
+
+Bytes wav(const std::vector<std::int16_t> &pcm, std::uint32_t rate, std::uint32_t channels, std::uint32_t bits = 16) {
+    Bytes data;
+    for (const auto s : pcm) {
+        if (bits == 24) data.push_back(0);
+        put(data, static_cast<std::uint16_t>(s), 2);
+    }
+    Bytes out{'R', 'I', 'F', 'F'};
+    put(out, 36 + data.size(), 4);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    put(out, 16, 4);
+    put(out, 1, 2);
+    put(out, channels, 2);
+    put(out, rate, 4);
+    put(out, rate * channels * bits / 8, 4);
+    put(out, channels * bits / 8, 2);
+    put(out, bits, 2);
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    put(out, data.size(), 4);
+    out.insert(out.end(), data.begin(), data.end());
+    return out;
+}
+
+struct SourceEntry {
+    std::u16string name;
+    Bytes content;
+    std::vector<bool> segments{false}; // compressed flag per segment; content is split evenly
+    bool badAdler = false;
+};
+
+// Writes an XP3 archive: segment data after the header, then the index (zlib or raw), optionally reached
+// through a cushion block.
+void writeXp3(const std::filesystem::path &path, const std::vector<SourceEntry> &entries, bool zlibIndex,
+              bool cushion) {
+    Bytes file{'X', 'P', '3', 0x0D, 0x0A, 0x20, 0x0A, 0x1A, 0x8B, 0x67, 0x01};
+    put(file, 0, 8); // index offset, patched below
+    Bytes index;
+    for (const auto &entry : entries) {
+        Bytes segm;
+        const std::size_t parts = entry.segments.size();
+        for (std::size_t s = 0; s < parts; ++s) {
+            const std::size_t from = entry.content.size() * s / parts;
+            const std::size_t to = entry.content.size() * (s + 1) / parts;
+            const Bytes plain(entry.content.begin() + static_cast<std::ptrdiff_t>(from),
+                              entry.content.begin() + static_cast<std::ptrdiff_t>(to));
+            const Bytes stored = entry.segments[s] ? deflate(plain) : plain;
+            put(segm, entry.segments[s] ? 1 : 0, 4);
+            put(segm, file.size(), 8);
+            put(segm, plain.size(), 8);
+            put(segm, stored.size(), 8);
+            file.insert(file.end(), stored.begin(), stored.end());
+        }
+        Bytes info;
+        put(info, 0, 4);
+        put(info, entry.content.size(), 8);
+        put(info, entry.content.size(), 8);
+        put(info, entry.name.size(), 2);
+        for (const char16_t unit : entry.name) put(info, unit, 2);
+        Bytes adlr;
+        const uLong adler = adler32(adler32(0L, Z_NULL, 0), entry.content.data(), static_cast<uInt>(entry.content.size()));
+        put(adlr, entry.badAdler ? adler ^ 0x5A5A5A5A : adler, 4);
+        Bytes body;
+        putChunk(body, "info", info);
+        putChunk(body, "segm", segm);
+        putChunk(body, "adlr", adlr);
+        putChunk(index, "File", body);
+    }
+    std::uint64_t indexOffset = file.size();
+    if (cushion) {
+        file.push_back(0x80);
+        put(file, 0, 8);
+        put(file, file.size() + 8, 8);
+    }
+    if (zlibIndex) {
+        const Bytes packed = deflate(index);
+        file.push_back(1);
+        put(file, packed.size(), 8);
+        put(file, index.size(), 8);
+        file.insert(file.end(), packed.begin(), packed.end());
+    } else {
+        file.push_back(0);
+        put(file, index.size(), 8);
+        file.insert(file.end(), index.begin(), index.end());
+    }
+    for (int i = 0; i < 8; ++i) file[11 + i] = static_cast<unsigned char>(indexOffset >> (8 * i));
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(file.data()),
+                                                static_cast<std::streamsize>(file.size()));
+}
+
+const std::filesystem::path &dir() {
+    static const auto path = std::filesystem::temp_directory_path() / "krkr_xp3_prerender_test";
+    return path;
+}
+
+struct Line {
+    WavClip clip;
+    std::uint32_t chunkMs = 0;
+    float speed = 1.0f;
+    VoiceRenderKey key;
+    VoiceRender render;
+};
+
+std::size_t chunkBytes(const WavClip &clip, std::uint32_t chunkMs) {
+    const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+    const std::uint32_t blockAlign = clip.channels * sizeof(std::int16_t);
+    return chunkMs ? std::max<std::size_t>(blockAlign, clip.sampleRate * chunkMs / 1000 * blockAlign) : total;
+}
+
+// krkr_xp3_prerender's renderJob: a fresh stream fed chunkMs buffers, each call recorded as a step.
+void renderLine(Line &line, const DspConfig &config) {
+    const WavClip &clip = line.clip;
+    const std::uint32_t blockAlign = clip.channels * sizeof(std::int16_t);
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+    const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+    const std::size_t chunk = chunkBytes(clip, line.chunkMs);
+    line.key = VoiceRenderCache::makeKey(bytes, std::min(chunk, total), clip.sampleRate, clip.channels, blockAlign,
+                                         line.speed, config, QualityTier::Full);
+    AudioStreamProcessor stream(clip.sampleRate, clip.channels, blockAlign, config);
+    for (std::size_t pos = 0; pos < total; pos += chunk) {
+        const std::size_t n = std::min(chunk, total - pos);
+        const auto res = stream.process(bytes + pos, n, line.speed, false, 0);
+        VoiceRender::Step step;
+        step.inputHash = xxh64(bytes + pos, n);
+        step.inputBytes = static_cast<std::uint32_t>(n);
+        step.outputOffset = static_cast<std::uint32_t>(line.render.output.size());
+        step.outputBytes = static_cast<std::uint32_t>(res.output.size());
+        line.render.steps.push_back(step);
+        line.render.output.insert(line.render.output.end(), res.output.begin(), res.output.end());
+    }
+}
+
+std::vector<WavClip> checkArchives() {
+    const auto voiceA = krkrtest::dialogue(44100, 2, 1.2, 0.8, 1);
+    const auto voiceB = krkrtest::dialogue(22050, 1, 0.8, 0.8, 2);
+    const std::u16string nameB = u"voice/\u30DC\u30A4\u30B9\U0002000B.wav";
+    writeXp3(dir() / "data.xp3",
+             {
+                 {u"voice/a001.wav", wav(voiceA, 44100, 2), {true, false}},
+                 {nameB, wav(voiceB, 22050, 1), {true}},
+                 {u"patch/a001.wav", wav(voiceA, 44100, 2), {false, false, true}},
+                 {u"bgm/title.ogg", Bytes(4000, 0x4F), {false}},
+                 {u"voice/locked.wav", wav(voiceB, 22050, 1), {true}, true},
+                 {u"voice/hires.wav", wav(voiceB, 22050, 1, 24), {false}},
+                 {u"scenario/first.ks", Bytes{'*', 's', 't', 'a', 'r', 't'}, {false}},
+             },
+             true, true);
+    writeXp3(dir() / "patch.xp3", {{u"voice/b.wav", wav(voiceB, 22050, 1), {false}}}, false, false);
+
+    std::vector<WavClip> clips;
+    std::string error;
+    Xp3Archive archive;
+    KRKR_CHECK_MSG(archive.open(dir() / "data.xp3", error), error);
+    KRKR_CHECK(archive.entries().size() == 7);
+    if (archive.entries().size() != 7) return clips;
+    const auto &entries = archive.entries();
+    KRKR_CHECK(entries[0].name == "voice/a001.wav" && entries[0].segments.size() == 2 &&
+               entries[0].segments[0].compressed && !entries[0].segments[1].compressed);
+    KRKR_CHECK_MSG(entries[1].name == u8"voice/\u30DC\u30A4\u30B9\U0002000B.wav", entries[1].name);
+    Bytes data;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const bool readable = archive.read(entries[i], data, error);
+        KRKR_CHECK_MSG(readable == (i != 4), entries[i].name + ": " + error);
+        if (!readable) {
+            KRKR_CHECK_MSG(error.find("checksum") != std::string::npos, error);
+            continue;
+        }
+        KRKR_CHECK(data.size() == entries[i].originalSize);
+        WavClip clip;
+        const bool pcm16 = parseWav(data.data(), data.size(), clip);
+        KRKR_CHECK_MSG(pcm16 == (i < 3), entries[i].name);
+        if (pcm16) {
+            clip.name = entries[i].name;
+            clips.push_back(std::move(clip));
+        }
+    }
+    if (clips.size() == 3) {
+        KRKR_CHECK(clips[0].samples == voiceA && clips[0].sampleRate == 44100 && clips[0].channels == 2);
+        KRKR_CHECK(clips[1].samples == voiceB && clips[1].sampleRate == 22050 && clips[1].channels == 1);
+        KRKR_CHECK(clips[2].samples == clips[0].samples);
+        clips.pop_back(); // the tool drops duplicate PCM
+    }
+
+    Xp3Archive patch;
+    KRKR_CHECK_MSG(patch.open(dir() / "patch.xp3", error), error);
+    KRKR_CHECK(patch.entries().size() == 1 && patch.read(patch.entries()[0], data, error));
+
+    // Damaged archives fail to open with a reason instead of yielding entries.
+    const auto damage = [](const std::filesystem::path &path, std::uint64_t offset, unsigned char value) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.put(static_cast<char>(value));
+    };
+    const auto bad = dir() / "bad.xp3";
+    std::filesystem::copy_file(dir() / "data.xp3", bad, std::filesystem::copy_options::overwrite_existing);
+    damage(bad, 0, 'Y');
+    KRKR_CHECK(!archive.open(bad, error) && error == "not an XP3 archive");
+    std::filesystem::copy_file(dir() / "data.xp3", bad, std::filesystem::copy_options::overwrite_existing);
+    damage(bad, 18, 0x7F);
+    KRKR_CHECK(!archive.open(bad, error) && error == "index offset out of range");
+    std::filesystem::copy_file(dir() / "data.xp3", bad, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(bad, std::filesystem::file_size(bad) - 16);
+    KRKR_CHECK_MSG(!archive.open(bad, error), "truncated index opened");
+    return clips;
+}
+
+void checkPack(const std::vector<WavClip> &clips) {
+    auto &cache = VoiceRenderCache::instance();
+    cache.setBudget(0); // renders come from the DSP, as in the tool
+    const DspConfig config = dspPresetConfig(DspPreset::Balanced);
+    std::vector<Line> lines;
+    for (const auto &clip : clips) {
+        for (const float speed : {1.5f, 2.0f}) {
+            for (const std::uint32_t chunkMs : {0u, 100u}) {
+                Line line;
+                line.clip = clip;
+                line.speed = speed;
+                line.chunkMs = chunkMs;
+                lines.push_back(std::move(line));
+            }
+        }
+    }
+    WorkerPool::instance().parallelFor(lines.size(), [&](std::size_t i) { renderLine(lines[i], config); });
+
+    const auto path = dir() / "krkr_prerender.pack";
+    std::string error;
+    PrerenderPackWriter writer;
+    KRKR_CHECK_MSG(writer.open(path, error), error);
+    for (const auto &line : lines) KRKR_CHECK_MSG(writer.add(line.key, line.render, error), error);
+    KRKR_CHECK(writer.add(lines[0].key, lines[0].render, error) && writer.entries() == lines.size());
+    KRKR_CHECK_MSG(writer.finish(error), error);
+
+    auto pack = std::make_shared<PrerenderPack>(
+        [&cache](const VoiceRenderKey &key, std::shared_ptr<const VoiceRender> render) { cache.adopt(key, render); });
+    KRKR_CHECK_MSG(pack->open(path, error), error);
+    KRKR_CHECK(pack->entries() == lines.size());
+    for (const auto &line : lines) {
+        const auto loaded = pack->load(line.key);
+        KRKR_CHECK(loaded && loaded->output == line.render.output && loaded->steps.size() == line.render.steps.size());
+    }
+    VoiceRenderKey other = lines[0].key;
+    other.speed = 3.0f;
+    KRKR_CHECK(pack->load(other) == nullptr);
+
+    // The hook's path: a memory miss asks the pack, the line is adopted and the next play replays it.
+    cache.setBudget(32u * 1024u * 1024u);
+    cache.addStore(pack);
+    for (const auto &line : lines) {
+        KRKR_CHECK(cache.find(line.key) == nullptr);
+    }
+    pack->drain();
+    std::size_t served = 0;
+    for (const auto &line : lines) {
+        const WavClip &clip = line.clip;
+        const std::uint32_t blockAlign = clip.channels * sizeof(std::int16_t);
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+        const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+        const std::size_t chunk = chunkBytes(clip, line.chunkMs);
+        const std::uint64_t before = cache.stats().bytesSaved;
+        std::vector<std::uint8_t> output;
+        AudioStreamProcessor stream(clip.sampleRate, clip.channels, blockAlign, config);
+        for (std::size_t pos = 0; pos < total; pos += chunk) {
+            const auto res = stream.process(bytes + pos, std::min(chunk, total - pos), line.speed, false, 0);
+            output.insert(output.end(), res.output.begin(), res.output.end());
+        }
+        const bool full = cache.stats().bytesSaved - before == output.size() && output == line.render.output;
+        KRKR_CHECK_MSG(full, clip.name + " at " + std::to_string(line.speed) + "x, " + std::to_string(line.chunkMs) +
+                                 " ms buffers");
+        served += full;
+    }
+    std::printf("%zu voices x 2 speeds x 2 buffer sizes: %zu records, %zu replays served from the pack\n",
+                clips.size(), lines.size(), served);
+    pack->close();
+    cache.setBudget(0);
+}
+
+} // namespace
+
+int main() {
+    std::filesystem::remove_all(dir());
+    std::filesystem::create_directories(dir());
+    const auto clips = checkArchives();
+    KRKR_CHECK(clips.size() == 2);
+    checkPack(clips);
+    std::filesystem::remove_all(dir());
+    return krkrtest::finish("xp3_prerender_test");
+}
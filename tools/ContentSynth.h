@@ -0,0 +1,216 @@
+#pragma once
+
+// Labelled synthetic speech and music for the content classifier's benchmark and accuracy test.
+
+#include "WavCorpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace krkrspeed {
+
+constexpr double kSynthPi = 3.14159265358979323846;
+
+class ContentSynth {
+public:
+    ContentSynth(std::uint32_t rate, std::uint32_t seed) : m_rate(rate), m_rng(seed) {}
+
+    double uniform(double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(m_rng); }
+    double noise() { return uniform(-1.0, 1.0); }
+    bool chance(double p) { return uniform(0.0, 1.0) < p; }
+    std::size_t samples(double seconds) const { return static_cast<std::size_t>(seconds * m_rate); }
+
+    // Syllables of formant-filtered pulses (~4 per second), fricative onsets, gaps and the odd pause.
+    std::vector<float> speech(double seconds) {
+        static const double kVowels[][3] = {
+            {730, 1090, 2440}, {270, 2290, 3010}, {300, 870, 2240}, {530, 1840, 2480}, {570, 840, 2410}};
+        std::vector<float> out(samples(seconds), 0.0f);
+        const double f0 = uniform(90.0, 260.0);
+        const double formantScale = f0 > 160.0 ? uniform(1.1, 1.2) : uniform(0.95, 1.05);
+        std::size_t pos = samples(uniform(0.0, 0.08));
+        double phase = 0.0;
+        double tilt = 0.0;
+        double formants[3] = {500.0 * formantScale, 1500.0 * formantScale, 2500.0 * formantScale};
+        while (pos < out.size()) {
+            if (chance(0.6)) {
+                const std::size_t len = samples(uniform(0.03, 0.09));
+                const double amp = uniform(0.05, 0.2);
+                double prev = 0.0;
+                double prev2 = 0.0;
+                for (std::size_t i = 0; i < len && pos < out.size(); ++i, ++pos) {
+                    const double n = noise();
+                    const double hp = n - 2.0 * prev + prev2; // second difference: fricative hiss
+                    prev2 = prev;
+                    prev = n;
+                    const double env = std::sin(kSynthPi * static_cast<double>(i) / static_cast<double>(len));
+                    out[pos] += static_cast<float>(amp * env * hp * 0.25);
+                }
+            }
+            // Formants glide from the previous vowel (coarticulation) to this one over the first 80 ms.
+            const auto &vowel = kVowels[static_cast<std::size_t>(uniform(0.0, 4.999))];
+            const double from[3] = {formants[0], formants[1], formants[2]};
+            Resonator r1(80.0, m_rate);
+            Resonator r2(100.0, m_rate);
+            Resonator r3(120.0, m_rate);
+            const std::size_t glide = samples(0.08);
+            const std::size_t len = samples(uniform(0.12, 0.32));
+            const double startF0 = f0 * uniform(0.95, 1.15);
+            const double endF0 = f0 * uniform(0.85, 1.05);
+            const double amp = uniform(0.3, 0.8);
+            for (std::size_t i = 0; i < len && pos < out.size(); ++i, ++pos) {
+                const double t = static_cast<double>(i) / static_cast<double>(len);
+                if (i % 32 == 0) {
+                    const double g = std::min(1.0, static_cast<double>(i) / static_cast<double>(glide));
+                    for (int k = 0; k < 3; ++k) formants[k] = from[k] + (vowel[k] * formantScale - from[k]) * g;
+                    r1.tune(formants[0]);
+                    r2.tune(formants[1]);
+                    r3.tune(formants[2]);
+                }
+                phase += (startF0 + (endF0 - startF0) * t) * (1.0 + 0.01 * noise()) / m_rate;
+                double pulse = 0.0;
+                if (phase >= 1.0) {
+                    phase -= 1.0;
+                    pulse = 1.0;
+                }
+                tilt = 0.9 * tilt + pulse;
+                const double v = r3.step(r2.step(r1.step(tilt)));
+                const double env = std::pow(std::sin(kSynthPi * t), 0.6);
+                out[pos] += static_cast<float>(amp * env * v * 0.02);
+            }
+            pos += samples(chance(0.15) ? uniform(0.2, 0.5) : uniform(0.02, 0.12));
+        }
+        normalize(out, uniform(0.1, 0.5));
+        return out;
+    }
+
+    // One of: sustained chords, legato melody over chords, plucked arpeggios, a drum pattern with bass.
+    std::vector<float> music(double seconds) {
+        std::vector<float> out(samples(seconds), 0.0f);
+        const double beat = 60.0 / uniform(70.0, 160.0);
+        const double root = 110.0 * std::pow(2.0, static_cast<int>(uniform(0.0, 11.99)) / 12.0);
+        static const int kChords[][3] = {{0, 4, 7}, {5, 9, 12}, {7, 11, 14}, {9, 12, 16}, {2, 5, 9}};
+        const int style = static_cast<int>(uniform(0.0, 3.999));
+        double t = 0.0;
+        while (t < seconds) {
+            const auto &chord = kChords[static_cast<std::size_t>(uniform(0.0, 4.999))];
+            const double span = beat * (style == 0 ? 4.0 : 2.0);
+            for (int k = 0; k < 3; ++k) {
+                const double f = root * std::pow(2.0, chord[k] / 12.0);
+                if (style == 2) {
+                    // arpeggio: plucked notes on eighths
+                    for (double s = 0.0; s < span; s += beat * 1.5) {
+                        tone(out, t + s + k * beat * 0.5, 0.9, f * 2.0, 0.005, uniform(0.5, 1.2), 0.3);
+                    }
+                } else {
+                    tone(out, t, span + 0.05, f, 0.06, 0.0, 0.22);
+                }
+            }
+            if (style == 1) {
+                for (double s = 0.0; s < span; s += beat * 0.5) {
+                    const int step = kChords[static_cast<std::size_t>(uniform(0.0, 4.999))][static_cast<std::size_t>(uniform(0.0, 2.999))];
+                    tone(out, t + s, beat * 0.55, root * 4.0 * std::pow(2.0, step / 12.0), 0.02, 0.0, 0.25);
+                }
+            }
+            if (style == 3) {
+                for (double s = 0.0; s < span; s += beat) {
+                    kick(out, t + s);
+                    hat(out, t + s + beat * 0.5);
+                    tone(out, t + s, beat * 0.9, root * 0.5, 0.01, 0.0, 0.3);
+                }
+            }
+            t += span;
+        }
+        normalize(out, uniform(0.1, 0.5));
+        return out;
+    }
+
+private:
+    struct Resonator {
+        Resonator(double bandwidth, std::uint32_t rate)
+            : r(std::exp(-kSynthPi * bandwidth / rate)), a2(-r * r), rate(rate) {}
+        void tune(double freq) { a1 = 2.0 * r * std::cos(2.0 * kSynthPi * freq / rate); }
+        double step(double x) {
+            const double y = x + a1 * y1 + a2 * y2;
+            y2 = y1;
+            y1 = y;
+            return y;
+        }
+        double r = 0.0, a1 = 0.0, a2 = 0.0, y1 = 0.0, y2 = 0.0;
+        double rate = 0.0;
+    };
+
+    // Harmonic tone; decay 0 holds the note (with release), otherwise exponential pluck.
+    void tone(std::vector<float> &out, double start, double length, double freq, double attack, double decay,
+              double amp) {
+        const std::size_t begin = samples(start);
+        const std::size_t len = samples(length);
+        const double vibrato = uniform(4.5, 6.0);
+        for (std::size_t i = 0; i < len && begin + i < out.size(); ++i) {
+            const double t = static_cast<double>(i) / m_rate;
+            double env = std::min(1.0, t / attack) * std::min(1.0, (length - t) / 0.05);
+            if (decay > 0.0) env *= std::exp(-t / decay);
+            const double f = freq * (1.0 + 0.003 * std::sin(2.0 * kSynthPi * vibrato * t));
+            double v = 0.0;
+            for (int h = 1; h <= 6 && f * h < m_rate * 0.45; ++h) {
+                v += std::sin(2.0 * kSynthPi * f * h * t) / h;
+            }
+            out[begin + i] += static_cast<float>(amp * env * v);
+        }
+    }
+
+    void kick(std::vector<float> &out, double start) {
+        const std::size_t begin = samples(start);
+        double phase = 0.0;
+        for (std::size_t i = 0; i < samples(0.18) && begin + i < out.size(); ++i) {
+            const double t = static_cast<double>(i) / m_rate;
+            phase += (50.0 + 90.0 * std::exp(-t / 0.03)) / m_rate;
+            out[begin + i] += static_cast<float>(0.9 * std::exp(-t / 0.06) * std::sin(2.0 * kSynthPi * phase));
+        }
+    }
+
+    void hat(std::vector<float> &out, double start) {
+        const std::size_t begin = samples(start);
+        double prev = 0.0;
+        for (std::size_t i = 0; i < samples(0.04) && begin + i < out.size(); ++i) {
+            const double n = noise();
+            out[begin + i] += static_cast<float>(0.15 * std::exp(-static_cast<double>(i) / samples(0.01)) * (n - prev));
+            prev = n;
+        }
+    }
+
+    static void normalize(std::vector<float> &x, double peak) {
+        float max = 0.0f;
+        for (const float v : x) max = std::max(max, std::fabs(v));
+        if (max <= 0.0f) return;
+        const float gain = static_cast<float>(peak) / max;
+        for (auto &v : x) v *= gain;
+    }
+
+    std::uint32_t m_rate;
+    std::mt19937 m_rng;
+};
+
+// Mono synth output to an int16 clip over a -80 dB noise floor, panned slightly when stereo.
+inline WavClip toClip(const std::vector<float> &mono, std::uint32_t rate, std::uint32_t channels,
+                      const std::string &name, ContentSynth &synth) {
+    WavClip clip;
+    clip.name = name;
+    clip.sampleRate = rate;
+    clip.channels = channels;
+    clip.samples.reserve(mono.size() * channels);
+    const double pan = channels > 1 ? synth.uniform(0.6, 1.0) : 1.0;
+    for (const float v : mono) {
+        const double floor = synth.noise() * 1e-4;
+        clip.samples.push_back(static_cast<std::int16_t>(std::lround(std::clamp((v + floor) * 32767.0, -32768.0, 32767.0))));
+        if (channels > 1) {
+            clip.samples.push_back(static_cast<std::int16_t>(std::lround(std::clamp((v * pan + floor) * 32767.0, -32768.0, 32767.0))));
+        }
+    }
+    return clip;
+}
+
+} // namespace krkrspeed
@@ -0,0 +1,97 @@
+#pragma once
+
+// 16-bit PCM WAV loading shared by the offline tools.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace krkrspeed {
+
+struct WavClip {
+    std::string name;
+    std::uint32_t sampleRate = 0;
+    std::uint32_t channels = 0;
+    std::vector<std::int16_t> samples; // interleaved
+};
+
+inline std::uint32_t readLe(const unsigned char *p, int bytes) {
+    std::uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+// 16-bit PCM RIFF/WAVE only.
+inline bool parseWav(const unsigned char *data, std::size_t bytes, WavClip &clip) {
+    if (bytes < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    std::uint32_t format = 0;
+    std::uint32_t bits = 0;
+    std::size_t pos = 12;
+    while (pos + 8 <= bytes) {
+        const std::uint32_t size = readLe(&data[pos + 4], 4);
+        const std::size_t body = pos + 8;
+        if (body + size > bytes) break;
+        if (std::memcmp(&data[pos], "fmt ", 4) == 0 && size >= 16) {
+            format = readLe(&data[body], 2);
+            clip.channels = readLe(&data[body + 2], 2);
+            clip.sampleRate = readLe(&data[body + 4], 4);
+            bits = readLe(&data[body + 14], 2);
+        } else if (std::memcmp(&data[pos], "data", 4) == 0) {
+            if (format != 1 || bits != 16 || clip.channels == 0) return false;
+            clip.samples.resize(size / 2);
+            for (std::size_t i = 0; i < clip.samples.size(); ++i) {
+                clip.samples[i] = static_cast<std::int16_t>(readLe(&data[body + i * 2], 2));
+            }
+        }
+        pos = body + size + (size & 1);
+    }
+    if (clip.samples.empty()) return false;
+    clip.samples.resize(clip.samples.size() / clip.channels * clip.channels);
+    return true;
+}
+
+inline bool loadWav(const std::filesystem::path &path, WavClip &clip) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!parseWav(data.data(), data.size(), clip)) {
+        return false;
+    }
+    clip.name = path.filename().string();
+    return true;
+}
+
+// Files and directories (searched recursively for *.wav, sorted) to clips; unusable files are reported
+// on stderr and skipped.
+template <typename Clip> std::vector<Clip> loadWavCorpus(const std::vector<std::filesystem::path> &inputs) {
+    std::vector<Clip> corpus;
+    for (const auto &input : inputs) {
+        std::vector<std::filesystem::path> files;
+        if (std::filesystem::is_directory(input)) {
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".wav") files.push_back(entry.path());
+            }
+            std::sort(files.begin(), files.end());
+        } else {
+            files.push_back(input);
+        }
+        for (const auto &file : files) {
+            Clip clip;
+            if (loadWav(file, clip)) {
+                corpus.push_back(std::move(clip));
+            } else {
+                std::cerr << "skipping " << file.string() << " (not 16-bit PCM WAV)\n";
+            }
+        }
+    }
+    return corpus;
+}
+
+} // namespace krkrspeed
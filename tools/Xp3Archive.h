@@ -0,0 +1,281 @@
+#pragma once
+
+// Read-only KiriKiri XP3 archive access for the offline tools: the index chain (raw or zlib, including
+// the "cushion" header newer packers write), File/info/segm/adlr chunks, and raw or zlib segments.
+// Encrypted archives are detected by their Adler-32 mismatch, not decrypted.
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace krkrspeed {
+
+struct Xp3Segment {
+    bool compressed = false;
+    std::uint64_t start = 0;
+    std::uint64_t originalSize = 0;
+    std::uint64_t archivedSize = 0;
+};
+
+struct Xp3Entry {
+    std::string name; // UTF-8, '/' separated as stored
+    std::uint32_t flags = 0;
+    std::uint64_t originalSize = 0;
+    std::vector<Xp3Segment> segments;
+    bool hasAdler = false;
+    std::uint32_t adler = 0;
+};
+
+class Xp3Archive {
+public:
+    bool open(const std::filesystem::path &path, std::string &error) {
+        m_entries.clear();
+        m_file.close();
+        m_file.clear();
+        m_file.open(path, std::ios::binary);
+        if (!m_file) {
+            error = "cannot open";
+            return false;
+        }
+        static const unsigned char kMagic[11] = {'X', 'P', '3', 0x0D, 0x0A, 0x20, 0x0A, 0x1A, 0x8B, 0x67, 0x01};
+        unsigned char magic[11] = {};
+        if (!readAt(0, magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(magic)) != 0) {
+            error = "not an XP3 archive";
+            return false;
+        }
+        std::uint64_t next = 0;
+        if (!readU64(sizeof(kMagic), next)) {
+            error = "truncated header";
+            return false;
+        }
+        // Each index block is flag (low bits: 0 raw, 1 zlib; 0x80: another index offset follows the block),
+        // sizes, data. Newer archives point at a zero-length "cushion" block first.
+        for (int blocks = 0; blocks < 16; ++blocks) {
+            unsigned char flag = 0;
+            std::uint64_t pos = next;
+            if (!readAt(pos, &flag, 1)) {
+                error = "index offset out of range";
+                return false;
+            }
+            ++pos;
+            std::vector<unsigned char> index;
+            if ((flag & 0x07) == 1) {
+                std::uint64_t packed = 0;
+                std::uint64_t size = 0;
+                if (!readU64(pos, packed) || !readU64(pos + 8, size) || packed > kMaxIndexBytes || size > kMaxIndexBytes) {
+                    error = "bad compressed index";
+                    return false;
+                }
+                pos += 16;
+                std::vector<unsigned char> raw(static_cast<std::size_t>(packed));
+                if (!readAt(pos, raw.data(), raw.size()) || !inflateTo(raw, static_cast<std::size_t>(size), index)) {
+                    error = "cannot inflate index";
+                    return false;
+                }
+                pos += packed;
+            } else if ((flag & 0x07) == 0) {
+                std::uint64_t size = 0;
+                if (!readU64(pos, size) || size > kMaxIndexBytes) {
+                    error = "bad index";
+                    return false;
+                }
+                pos += 8;
+                index.resize(static_cast<std::size_t>(size));
+                if (!readAt(pos, index.data(), index.size())) {
+                    error = "truncated index";
+                    return false;
+                }
+                pos += size;
+            } else {
+                error = "unknown index encoding";
+                return false;
+            }
+            if (!parseIndex(index, error)) {
+                return false;
+            }
+            if (!(flag & 0x80)) {
+                return true;
+            }
+            if (!readU64(pos, next)) {
+                error = "truncated index chain";
+                return false;
+            }
+        }
+        error = "index chain too long";
+        return false;
+    }
+
+    const std::vector<Xp3Entry> &entries() const { return m_entries; }
+
+    bool read(const Xp3Entry &entry, std::vector<unsigned char> &out, std::string &error) {
+        out.clear();
+        if (entry.originalSize > kMaxEntryBytes) {
+            error = "entry too large";
+            return false;
+        }
+        out.reserve(static_cast<std::size_t>(entry.originalSize));
+        std::vector<unsigned char> raw;
+        for (const auto &segment : entry.segments) {
+            if (segment.archivedSize > kMaxEntryBytes || segment.originalSize > kMaxEntryBytes) {
+                error = "segment too large";
+                return false;
+            }
+            raw.resize(static_cast<std::size_t>(segment.archivedSize));
+            if (!readAt(segment.start, raw.data(), raw.size())) {
+                error = "segment out of range";
+                return false;
+            }
+            if (segment.compressed) {
+                std::vector<unsigned char> plain;
+                if (!inflateTo(raw, static_cast<std::size_t>(segment.originalSize), plain)) {
+                    error = "cannot inflate segment";
+                    return false;
+                }
+                out.insert(out.end(), plain.begin(), plain.end());
+            } else {
+                out.insert(out.end(), raw.begin(), raw.end());
+            }
+        }
+        if (out.size() != entry.originalSize) {
+            error = "size mismatch";
+            return false;
+        }
+        if (entry.hasAdler &&
+            adler32(adler32(0L, Z_NULL, 0), out.data(), static_cast<uInt>(out.size())) != entry.adler) {
+            error = "checksum mismatch (encrypted archive?)";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::uint64_t kMaxIndexBytes = 256ull * 1024 * 1024;
+    static constexpr std::uint64_t kMaxEntryBytes = 512ull * 1024 * 1024;
+
+    bool readAt(std::uint64_t offset, void *buffer, std::size_t bytes) {
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(offset));
+        return static_cast<bool>(m_file.read(static_cast<char *>(buffer), static_cast<std::streamsize>(bytes)));
+    }
+
+    bool readU64(std::uint64_t offset, std::uint64_t &value) {
+        unsigned char b[8];
+        if (!readAt(offset, b, sizeof(b))) return false;
+        value = le(b, 8);
+        return true;
+    }
+
+    static std::uint64_t le(const unsigned char *p, int bytes) {
+        std::uint64_t v = 0;
+        for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    static bool inflateTo(const std::vector<unsigned char> &in, std::size_t size, std::vector<unsigned char> &out) {
+        out.resize(size);
+        uLongf produced = static_cast<uLongf>(size);
+        if (uncompress(out.data(), &produced, in.data(), static_cast<uLong>(in.size())) != Z_OK || produced != size) {
+            return false;
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string &out, std::uint32_t cp) {
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    static std::string utf16ToUtf8(const unsigned char *p, std::size_t units) {
+        std::string out;
+        for (std::size_t i = 0; i < units; ++i) {
+            std::uint32_t cp = static_cast<std::uint32_t>(le(p + i * 2, 2));
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < units) {
+                const auto low = static_cast<std::uint32_t>(le(p + (i + 1) * 2, 2));
+                if (low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+            appendUtf8(out, cp);
+        }
+        return out;
+    }
+
+    bool parseIndex(const std::vector<unsigned char> &index, std::string &error) {
+        std::size_t pos = 0;
+        while (pos + 12 <= index.size()) {
+            const std::uint64_t size = le(&index[pos + 4], 8);
+            const std::size_t body = pos + 12;
+            if (size > index.size() - body) {
+                error = "index chunk overruns index";
+                return false;
+            }
+            if (std::memcmp(&index[pos], "File", 4) == 0) {
+                Xp3Entry entry;
+                if (!parseFile(&index[body], static_cast<std::size_t>(size), entry)) {
+                    error = "bad File chunk";
+                    return false;
+                }
+                m_entries.push_back(std::move(entry));
+            }
+            pos = body + static_cast<std::size_t>(size);
+        }
+        return true;
+    }
+
+    static bool parseFile(const unsigned char *p, std::size_t bytes, Xp3Entry &entry) {
+        bool haveInfo = false;
+        std::size_t pos = 0;
+        while (pos + 12 <= bytes) {
+            const std::uint64_t size = le(p + pos + 4, 8);
+            const std::size_t body = pos + 12;
+            if (size > bytes - body) return false;
+            const unsigned char *chunk = p + body;
+            if (std::memcmp(p + pos, "info", 4) == 0 && size >= 22) {
+                entry.flags = static_cast<std::uint32_t>(le(chunk, 4));
+                entry.originalSize = le(chunk + 4, 8);
+                const std::size_t units = static_cast<std::size_t>(le(chunk + 20, 2));
+                if (22 + units * 2 > size) return false;
+                entry.name = utf16ToUtf8(chunk + 22, units);
+                haveInfo = true;
+            } else if (std::memcmp(p + pos, "segm", 4) == 0) {
+                for (std::size_t s = 0; s + 28 <= size; s += 28) {
+                    Xp3Segment segment;
+                    segment.compressed = (le(chunk + s, 4) & 0x07) == 1;
+                    segment.start = le(chunk + s + 4, 8);
+                    segment.originalSize = le(chunk + s + 12, 8);
+                    segment.archivedSize = le(chunk + s + 20, 8);
+                    entry.segments.push_back(segment);
+                }
+            } else if (std::memcmp(p + pos, "adlr", 4) == 0 && size >= 4) {
+                entry.adler = static_cast<std::uint32_t>(le(chunk, 4));
+                entry.hasAdler = true;
+            }
+            pos = body + static_cast<std::size_t>(size);
+        }
+        return haveInfo;
+    }
+
+    std::ifstream m_file;
+    std::vector<Xp3Entry> m_entries;
+};
+
+} // namespace krkrspeed
@@ -0,0 +1,204 @@
+// Multichannel elision benchmark: an 8-channel (7.1) WASAPI-style stream fed through
+// AudioStreamProcessor::processTempoToSize in --buffer-ms callbacks under three layouts:
+//   full:     all eight channels carry signal, nothing is elided;
+//   stereo:   only the front pair carries signal, the other six drop out after 500 ms;
+//   toggling: the six surround channels go silent and come back every --toggle-sec, rebuilding the
+//             pipeline (and draining the old one into Cbuffer) at every switch.
+// The report gives DSP time per second of audio, the number of mask switches and the audio produced against
+// input/speed. A second table times the per-buffer channel-activity scan on its own: the per-channel strided
+// loop the processor used to run (a local copy) against loudChannels(), the single SSE2 pass it runs now.
+//
+//   krkr_channel_mask_bench [--seconds 60] [--rate 48000] [--buffer-ms 10] [--speed 1.5] [--toggle-sec 2]
+
+#include "common/AudioStreamProcessor.h"
+#include "common/StreamAnalysis.h"
+#include "common/VoiceRenderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kChannels = 8;
+constexpr int kSilenceLevel = 1;
+constexpr double kPi = 3.14159265358979323846;
+
+struct Options {
+    double seconds = 60.0;
+    std::uint32_t rate = 48000;
+    std::uint32_t bufferMs = 10;
+    float speed = 1.5f;
+    double toggleSec = 2.0;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (arg == "--rate" && value(v)) {
+            opts.rate = static_cast<std::uint32_t>(std::max(8000, std::stoi(v)));
+        } else if (arg == "--buffer-ms" && value(v)) {
+            opts.bufferMs = static_cast<std::uint32_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--toggle-sec" && value(v)) {
+            opts.toggleSec = std::max(0.6, std::stod(v));
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f;
+}
+
+enum class Layout { Full, Stereo, Toggling };
+
+const char *layoutName(Layout layout) {
+    switch (layout) {
+    case Layout::Full: return "full";
+    case Layout::Stereo: return "stereo";
+    default: return "toggling";
+    }
+}
+
+std::vector<std::int16_t> render(const Options &opts, Layout layout) {
+    const std::size_t frames = static_cast<std::size_t>(opts.seconds * opts.rate);
+    std::vector<std::int16_t> pcm(frames * kChannels, 0);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const double t = static_cast<double>(f) / opts.rate;
+        const double env = 0.5 - 0.5 * std::cos(2.0 * kPi * 4.0 * t);
+        double v = 0.0;
+        for (int h = 1; h <= 5; ++h) v += std::sin(2.0 * kPi * 150.0 * h * t) / h;
+        const auto front = static_cast<std::int16_t>(std::lround(6000.0 * env * v / 2.3));
+        pcm[f * kChannels] = front;
+        pcm[f * kChannels + 1] = front;
+        const bool surround = layout == Layout::Full ||
+                              (layout == Layout::Toggling && static_cast<long>(t / opts.toggleSec) % 2 == 0);
+        if (!surround) continue;
+        for (std::uint32_t c = 2; c < kChannels; ++c) {
+            pcm[f * kChannels + c] = static_cast<std::int16_t>(std::lround(3000.0 * std::sin(2.0 * kPi * 90.0 * c * t)));
+        }
+    }
+    return pcm;
+}
+
+struct Result {
+    double ms = 0.0;
+    std::size_t switches = 0;
+    double lengthErrorMs = 0.0;
+};
+
+Result runStream(const Options &opts, const std::vector<std::int16_t> &pcm) {
+    const std::uint32_t blockAlign = kChannels * sizeof(std::int16_t);
+    AudioStreamProcessor stream(opts.rate, kChannels, blockAlign, DspConfig{});
+    stream.setBacklogConfig(BacklogConfig{1e9f, BacklogPolicy::DropOldest});
+    const std::size_t bufferBytes = opts.rate * opts.bufferMs / 1000 * blockAlign;
+    // Slightly under what the DSP makes, so Cbuffer never runs dry and no output is padding.
+    const std::size_t askBytes = static_cast<std::size_t>(bufferBytes / opts.speed * 0.95) / blockAlign * blockAlign;
+    const std::size_t total = pcm.size() * sizeof(std::int16_t) / bufferBytes * bufferBytes;
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(pcm.data());
+    Result result;
+    std::size_t produced = 0;
+    std::size_t padded = 0;
+    bool started = false;
+    std::uint32_t mask = stream.activeChannelMask();
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t pos = 0; pos < total; pos += bufferBytes) {
+        const auto res = stream.processTempoToSize(bytes + pos, bufferBytes, askBytes, opts.speed, false, 1);
+        produced += res.output.size();
+        // Output is padding until the stream's start cushion has built up.
+        if (!started && std::all_of(res.output.begin(), res.output.end(), [](std::uint8_t b) { return b == 0; })) {
+            padded += res.output.size();
+        } else {
+            started = true;
+        }
+        if (pos + bufferBytes >= total) produced += res.cbufferSize;
+        if (stream.activeChannelMask() != mask) {
+            mask = stream.activeChannelMask();
+            ++result.switches;
+        }
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const double expected = static_cast<double>(total / blockAlign) / opts.speed;
+    result.lengthErrorMs = (static_cast<double>((produced - padded) / blockAlign) - expected) * 1000.0 / opts.rate;
+    return result;
+}
+
+// Activity scans: which channels have a sample above the silence level in this buffer.
+std::uint32_t scanStrided(const std::int16_t *pcm, std::size_t frames) {
+    std::uint32_t loud = 0;
+    for (std::uint32_t c = 0; c < kChannels; ++c) {
+        for (std::size_t f = 0; f < frames; ++f) {
+            const int v = pcm[f * kChannels + c];
+            if (v > kSilenceLevel || v < -kSilenceLevel) {
+                loud |= 1u << c;
+                break;
+            }
+        }
+    }
+    return loud;
+}
+
+std::uint32_t scanInterleaved(const std::int16_t *pcm, std::size_t frames) {
+    return loudChannels(pcm, frames, kChannels, kSilenceLevel);
+}
+
+template <typename Scan> double timeScan(const Options &opts, const std::vector<std::int16_t> &pcm, Scan scan,
+                                         std::uint32_t &sink) {
+    const std::size_t frames = opts.rate * opts.bufferMs / 1000;
+    const std::size_t buffers = pcm.size() / kChannels / frames;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t b = 0; b < buffers; ++b) sink ^= scan(pcm.data() + b * frames * kChannels, frames);
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return us / std::max<std::size_t>(1, buffers);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_channel_mask_bench [--seconds s] [--rate hz] [--buffer-ms ms] [--speed x]\n"
+                     "                               [--toggle-sec s]\n";
+        return 2;
+    }
+    VoiceRenderCache::instance().setBudget(0);
+    std::cout << kChannels << " channels, " << opts.rate << " Hz, " << opts.bufferMs << " ms buffers, " << opts.seconds
+              << " s, speed " << opts.speed << "\n";
+    std::uint32_t sink = 0;
+    std::vector<std::pair<Layout, std::vector<std::int16_t>>> layouts;
+    for (const Layout layout : {Layout::Full, Layout::Stereo, Layout::Toggling}) {
+        layouts.emplace_back(layout, render(opts, layout));
+    }
+    for (const auto &[layout, pcm] : layouts) {
+        const Result r = runStream(opts, pcm);
+        std::cout << std::left << std::setw(9) << layoutName(layout) << std::right << std::fixed
+                  << std::setprecision(2) << "  " << std::setw(7) << r.ms / opts.seconds << " ms/s  switches "
+                  << std::setw(3) << r.switches << "  length " << std::showpos << std::setprecision(1)
+                  << r.lengthErrorMs << std::noshowpos << " ms\n";
+    }
+    std::cout << "activity scan per buffer:\n";
+    for (const auto &[layout, pcm] : layouts) {
+        const double strided = timeScan(opts, pcm, scanStrided, sink);
+        const double interleaved = timeScan(opts, pcm, scanInterleaved, sink);
+        std::cout << std::left << std::setw(9) << layoutName(layout) << std::right << std::fixed
+                  << std::setprecision(3) << "  strided " << std::setw(7) << strided << " us  interleaved "
+                  << std::setw(7) << interleaved << " us  (" << std::setprecision(2)
+                  << strided / std::max(1e-6, interleaved) << "x)\n";
+    }
+    return sink == 0xFFFFFFFFu ? 1 : 0; // keeps the scans from being optimised away
+}
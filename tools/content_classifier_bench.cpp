@@ -0,0 +1,176 @@
+// SpeechMusicClassifier benchmark: per-buffer cost of the streaming classifier the hooks run on new
+// streams, and its accuracy on labelled clips. Without inputs it synthesizes both classes: speech as
+// formant-filtered glottal pulse trains in syllables with fricative onsets and pauses, music as chords,
+// legato melodies, plucked arpeggios and drum patterns. WAV directories can be added per class.
+// Accuracy counts the first verdict (after ~300 ms of audible signal) and the verdict at the end of the
+// clip; the run fails when either falls below --min-accuracy.
+//
+//   krkr_content_classifier_bench [--clips 200] [--seconds 3] [--rate 44100] [--channels 2] [--seed 1]
+//                                 [--buffer-ms 20] [--min-accuracy 90] [--speech dir] [--music dir]
+
+#include "common/SpeechMusicClassifier.h"
+#include "ContentSynth.h"
+#include "WavCorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace krkrspeed;
+
+namespace {
+
+struct Options {
+    std::size_t clips = 200; // per class
+    double seconds = 3.0;
+    std::uint32_t rate = 44100;
+    std::uint32_t channels = 2;
+    std::uint32_t seed = 1;
+    std::uint32_t bufferMs = 20;
+    double minAccuracy = 90.0;
+    std::vector<fs::path> speech;
+    std::vector<fs::path> music;
+};
+
+struct LabelledClip {
+    WavClip clip;
+    AudioContent label = AudioContent::Unknown;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--clips" && value(v)) {
+            opts.clips = static_cast<std::size_t>(std::max(0, std::stoi(v)));
+        } else if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(0.5, std::stod(v));
+        } else if (arg == "--rate" && value(v)) {
+            opts.rate = static_cast<std::uint32_t>(std::max(8000, std::stoi(v)));
+        } else if (arg == "--channels" && value(v)) {
+            opts.channels = static_cast<std::uint32_t>(std::min(2, std::max(1, std::stoi(v))));
+        } else if (arg == "--seed" && value(v)) {
+            opts.seed = static_cast<std::uint32_t>(std::stoul(v));
+        } else if (arg == "--buffer-ms" && value(v)) {
+            opts.bufferMs = static_cast<std::uint32_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--min-accuracy" && value(v)) {
+            opts.minAccuracy = std::stod(v);
+        } else if (arg == "--speech" && value(v)) {
+            opts.speech.emplace_back(v);
+        } else if (arg == "--music" && value(v)) {
+            opts.music.emplace_back(v);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Outcome {
+    AudioContent first = AudioContent::Unknown;
+    AudioContent last = AudioContent::Unknown;
+    double decisionMs = 0.0; // audio fed before the first verdict
+};
+
+Outcome classify(const WavClip &clip, std::size_t bufferSamples) {
+    SpeechMusicClassifier classifier(clip.sampleRate, clip.channels);
+    Outcome outcome;
+    for (std::size_t pos = 0; pos < clip.samples.size(); pos += bufferSamples) {
+        const std::size_t n = std::min(bufferSamples, clip.samples.size() - pos);
+        const AudioContent verdict = classifier.feedPcm16(clip.samples.data() + pos, n);
+        if (outcome.first == AudioContent::Unknown && verdict != AudioContent::Unknown) {
+            outcome.first = verdict;
+            outcome.decisionMs = static_cast<double>((pos + n) / clip.channels) * 1000.0 / clip.sampleRate;
+        }
+    }
+    outcome.last = classifier.verdict();
+    return outcome;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_content_classifier_bench [--clips N] [--seconds s] [--rate hz] [--channels 1|2]\n"
+                     "                                     [--seed n] [--buffer-ms ms] [--min-accuracy pct]\n"
+                     "                                     [--speech dir]... [--music dir]...\n";
+        return 2;
+    }
+    std::vector<LabelledClip> clips;
+    ContentSynth synth(opts.rate, opts.seed);
+    for (std::size_t i = 0; i < opts.clips; ++i) {
+        clips.push_back({toClip(synth.speech(opts.seconds), opts.rate, opts.channels, "speech", synth), AudioContent::Speech});
+        clips.push_back({toClip(synth.music(opts.seconds), opts.rate, opts.channels, "music", synth), AudioContent::Music});
+    }
+    for (auto &clip : loadWavCorpus<WavClip>(opts.speech)) clips.push_back({std::move(clip), AudioContent::Speech});
+    for (auto &clip : loadWavCorpus<WavClip>(opts.music)) clips.push_back({std::move(clip), AudioContent::Music});
+    if (clips.empty()) {
+        std::cerr << "no clips\n";
+        return 1;
+    }
+
+    std::size_t total[3] = {};
+    std::size_t firstOk[3] = {};
+    std::size_t lastOk[3] = {};
+    std::size_t undecided = 0;
+    std::vector<double> latencies;
+    double audioSeconds = 0.0;
+    std::size_t buffers = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &item : clips) {
+        const auto &clip = item.clip;
+        const std::size_t bufferSamples =
+            std::max<std::size_t>(clip.channels, clip.sampleRate * opts.bufferMs / 1000 * clip.channels);
+        const Outcome outcome = classify(clip, bufferSamples);
+        const auto label = static_cast<std::size_t>(item.label);
+        ++total[label];
+        firstOk[label] += outcome.first == item.label;
+        lastOk[label] += outcome.last == item.label;
+        if (outcome.first == AudioContent::Unknown) {
+            ++undecided;
+        } else {
+            latencies.push_back(outcome.decisionMs);
+        }
+        audioSeconds += static_cast<double>(clip.samples.size() / clip.channels) / clip.sampleRate;
+        buffers += (clip.samples.size() + bufferSamples - 1) / bufferSamples;
+    }
+    const double elapsedMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto pct = [](std::size_t ok, std::size_t n) { return n ? 100.0 * static_cast<double>(ok) / n : 100.0; };
+    const std::size_t speech = static_cast<std::size_t>(AudioContent::Speech);
+    const std::size_t music = static_cast<std::size_t>(AudioContent::Music);
+    const double firstAccuracy = pct(firstOk[speech] + firstOk[music], total[speech] + total[music]);
+    const double lastAccuracy = pct(lastOk[speech] + lastOk[music], total[speech] + total[music]);
+    std::sort(latencies.begin(), latencies.end());
+    auto quantile = [&](double q) {
+        return latencies.empty() ? 0.0 : latencies[static_cast<std::size_t>(q * (latencies.size() - 1))];
+    };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << total[speech] << " speech + " << total[music] << " music clips, " << audioSeconds << " s of audio, "
+              << opts.bufferMs << " ms buffers\n";
+    std::cout << "first verdict: " << firstAccuracy << "% (speech " << pct(firstOk[speech], total[speech])
+              << "%, music " << pct(firstOk[music], total[music]) << "%), " << undecided << " undecided\n";
+    std::cout << "end of clip:   " << lastAccuracy << "% (speech " << pct(lastOk[speech], total[speech])
+              << "%, music " << pct(lastOk[music], total[music]) << "%)\n";
+    std::cout << "decision after " << quantile(0.5) << " ms median, " << quantile(0.95) << " ms p95\n";
+    std::cout << std::setprecision(3) << "cost " << elapsedMs * 1000.0 / static_cast<double>(buffers) << " us per buffer, "
+              << elapsedMs / audioSeconds << " ms per second of audio ("
+              << (elapsedMs > 0.0 ? audioSeconds * 1000.0 / elapsedMs : 0.0) << "x realtime)\n";
+    return firstAccuracy >= opts.minAccuracy && lastAccuracy >= opts.minAccuracy ? 0 : 1;
+}
@@ -0,0 +1,429 @@
+// Offline DspConfig sweep: runs a speech corpus through DspPipeline at several speeds for every point of
+// a sequence/overlap/seek-window/quick-seek/AA grid, measures DSP time per second of audio and a band
+// log-spectral distance against the time-mapped input, and writes the cheapest config within a quality
+// margin of the best one per speed band as a table the hook loads (krkr_dsp_tuning.txt).
+// --presets measures the low-power/balanced/quality presets the same way instead of sweeping, and prints the
+// numbers behind them without writing a table. Without inputs, --synth-clips clips of synthetic speech
+// (ContentSynth, 44.1 kHz stereo) are used.
+//
+//   krkr_dsp_autotune [--speeds 1.25,1.5,2,3] [--mode tempo|pitch|both] [--lsd-margin 0.5]
+//                     [--repeat 3] [--out krkr_dsp_tuning.txt] [--presets] [--synth-clips 6]
+//                     [wav file or directory]...
+
+#include "common/DspPipeline.h"
+#include "common/DspTuningTable.h"
+#include "ContentSynth.h"
+#include "WavCorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace krkrspeed;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr std::size_t kChunkMs = 20;     // call size, roughly what the hooks see per Unlock/ReleaseBuffer
+constexpr std::size_t kBands = 24;       // log-spaced analysis bands
+constexpr double kBandLowHz = 100.0;
+constexpr double kBandHighHz = 7000.0;
+constexpr double kSilenceDb = -50.0;     // frames this far below the loudest input frame are not scored
+constexpr std::size_t kMaxLagMs = 250;   // pitch-path latency searched for before scoring
+// Written into the table header; bumped whenever the LSD changes meaning. Revision 1 scored pitch-mode output
+// without removing the engine's latency and with bands one side had no bins in, so its pitch rows are noise.
+constexpr int kScoringRevision = 2;
+constexpr std::uint32_t kSynthRate = 44100;
+constexpr double kSynthSeconds = 8.0;
+
+struct Clip : WavClip {
+    std::vector<float> mono;
+};
+
+struct Options {
+    std::vector<float> speeds{1.25f, 1.5f, 2.0f, 3.0f};
+    bool tempo = true;
+    bool pitch = true;
+    float lsdMargin = 0.5f;
+    int repeat = 3;
+    fs::path out = "krkr_dsp_tuning.txt";
+    bool presets = false;
+    std::size_t synthClips = 6;
+    std::vector<fs::path> inputs;
+};
+
+struct Point {
+    DspConfig config;
+    double cpuMsPerSec = 0.0;
+    double lsdDb = 0.0;
+};
+
+void downmix(Clip &clip) {
+    const std::size_t frames = clip.samples.size() / clip.channels;
+    clip.mono.resize(frames);
+    for (std::size_t f = 0; f < frames; ++f) {
+        float sum = 0.0f;
+        for (std::uint32_t c = 0; c < clip.channels; ++c) sum += clip.samples[f * clip.channels + c];
+        clip.mono[f] = sum / (32768.0f * static_cast<float>(clip.channels));
+    }
+}
+
+void fft(std::vector<std::complex<double>> &a) {
+    const std::size_t n = a.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (std::size_t len = 2; len <= n; len <<= 1) {
+        const std::complex<double> step = std::polar(1.0, -2.0 * kPi / static_cast<double>(len));
+        for (std::size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0);
+            for (std::size_t k = 0; k < len / 2; ++k) {
+                const auto u = a[i + k];
+                const auto v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+}
+
+// Energy in kBands log-spaced bands of the frame centred at `centre`; `rate` is the rate the signal is
+// heard at, so a pitch-mode output played back faster lands in the same bands as the input. The lowest bands
+// are narrower than a bin; those that no bin falls into are -1.
+std::vector<double> bandEnergies(const std::vector<float> &x, std::ptrdiff_t centre, std::size_t n, double rate) {
+    std::vector<std::complex<double>> frame(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::ptrdiff_t idx = centre - static_cast<std::ptrdiff_t>(n / 2) + static_cast<std::ptrdiff_t>(i);
+        const double w = 0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i) / static_cast<double>(n));
+        const double s = (idx >= 0 && idx < static_cast<std::ptrdiff_t>(x.size())) ? x[static_cast<std::size_t>(idx)] : 0.0;
+        frame[i] = s * w;
+    }
+    fft(frame);
+    std::vector<double> bands(kBands, -1.0);
+    const double high = std::min(kBandHighHz, rate * 0.45);
+    const double ratio = std::pow(high / kBandLowHz, 1.0 / static_cast<double>(kBands));
+    for (std::size_t k = 1; k < n / 2; ++k) {
+        const double hz = static_cast<double>(k) * rate / static_cast<double>(n);
+        if (hz < kBandLowHz || hz >= high) continue;
+        const auto b = std::min<std::size_t>(kBands - 1, static_cast<std::size_t>(std::log(hz / kBandLowHz) / std::log(ratio)));
+        bands[b] = std::max(0.0, bands[b]) + std::norm(frame[k]);
+    }
+    return bands;
+}
+
+double frameEnergy(const std::vector<double> &bands) {
+    double e = 0.0;
+    for (double b : bands) e += std::max(0.0, b);
+    return e;
+}
+
+// Mean band LSD (dB) over non-silent frames. Output sample o is heard at o / playRate seconds, which is
+// content time o * speed / playRate of the input.
+double distortion(const Clip &clip, const std::vector<float> &out, float speed, DspMode mode, std::size_t &frames) {
+    std::size_t n = 256;
+    while (n < clip.sampleRate / 48) n <<= 1; // ~21 ms
+    const double rate = clip.sampleRate;
+    const double playRate = mode == DspMode::Pitch ? rate * speed : rate;
+
+    double loudest = 0.0;
+    for (std::size_t c = n / 2; c < clip.mono.size(); c += n / 2) {
+        loudest = std::max(loudest, frameEnergy(bandEnergies(clip.mono, static_cast<std::ptrdiff_t>(c), n, rate)));
+    }
+    const double floor = loudest * std::pow(10.0, kSilenceDb / 10.0);
+
+    double sum = 0.0;
+    frames = 0;
+    for (std::size_t o = n / 2; o + n / 2 < out.size(); o += n / 2) {
+        const auto centre = static_cast<std::ptrdiff_t>(std::llround(static_cast<double>(o) * speed * rate / playRate));
+        if (centre >= static_cast<std::ptrdiff_t>(clip.mono.size())) break;
+        const auto ref = bandEnergies(clip.mono, centre, n, rate);
+        if (frameEnergy(ref) < floor || loudest <= 0.0) continue;
+        const auto got = bandEnergies(out, static_cast<std::ptrdiff_t>(o), n, playRate);
+        // Pitch-mode output is analysed at the playback rate, so its bins fall elsewhere: score the bands
+        // both analyses have bins in.
+        double acc = 0.0;
+        std::size_t scored = 0;
+        for (std::size_t b = 0; b < kBands; ++b) {
+            if (got[b] < 0.0 || ref[b] < 0.0) continue;
+            const double d = 10.0 * std::log10((got[b] + 1e-12) / (ref[b] + 1e-12));
+            acc += d * d;
+            ++scored;
+        }
+        if (scored == 0) continue;
+        sum += std::sqrt(acc / static_cast<double>(scored));
+        ++frames;
+    }
+    return sum;
+}
+
+// Frames the pitch path's output trails its input by (the engine's latency, which the caller hands back as a
+// lead of held or primed frames): the shift within kMaxLagMs that best lines up 1 ms envelopes.
+std::size_t pitchLag(const std::vector<float> &in, const std::vector<float> &out, std::uint32_t rate) {
+    const std::size_t block = std::max<std::size_t>(1, rate / 1000);
+    auto envelope = [block](const std::vector<float> &x) {
+        std::vector<double> env(x.size() / block);
+        for (std::size_t i = 0; i < env.size(); ++i) {
+            for (std::size_t k = 0; k < block; ++k) env[i] += std::fabs(x[i * block + k]);
+        }
+        return env;
+    };
+    const auto a = envelope(in);
+    const auto b = envelope(out);
+    std::size_t bestLag = 0;
+    double best = -1.0;
+    for (std::size_t lag = 0; lag <= kMaxLagMs && lag < b.size(); ++lag) {
+        double sum = 0.0;
+        for (std::size_t i = 0; i + lag < b.size() && i < a.size(); ++i) sum += a[i] * b[i + lag];
+        if (sum > best) {
+            best = sum;
+            bestLag = lag;
+        }
+    }
+    return bestLag * block;
+}
+
+Point evaluate(const std::vector<Clip> &corpus, const DspConfig &config, float speed, DspMode mode, int repeat) {
+    const float ratio = mode == DspMode::Pitch ? 1.0f / speed : speed;
+    double seconds = 0.0;
+    double best = 0.0;
+    double lsdSum = 0.0;
+    std::size_t lsdFrames = 0;
+    for (int r = 0; r < repeat; ++r) {
+        double spent = 0.0;
+        for (const auto &clip : corpus) {
+            DspPipeline dsp(clip.sampleRate, clip.channels, config);
+            const std::size_t frameBytes = clip.channels * sizeof(std::int16_t);
+            const std::size_t chunk = clip.sampleRate * kChunkMs / 1000 * frameBytes;
+            const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+            const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+            std::vector<std::uint8_t> out;
+            const auto start = std::chrono::steady_clock::now();
+            for (std::size_t pos = 0; pos < total; pos += chunk) {
+                const auto part = dsp.process(bytes + pos, std::min(chunk, total - pos), ratio, mode);
+                out.insert(out.end(), part.begin(), part.end());
+            }
+            const auto tail = dsp.finish();
+            spent += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            out.insert(out.end(), tail.begin(), tail.end());
+            if (r > 0) continue;
+
+            seconds += static_cast<double>(clip.mono.size()) / clip.sampleRate;
+            const std::size_t outFrames = out.size() / frameBytes;
+            std::vector<float> mono(outFrames);
+            const auto *pcm = reinterpret_cast<const std::int16_t *>(out.data());
+            for (std::size_t f = 0; f < outFrames; ++f) {
+                float sum = 0.0f;
+                for (std::uint32_t c = 0; c < clip.channels; ++c) sum += pcm[f * clip.channels + c];
+                mono[f] = sum / (32768.0f * static_cast<float>(clip.channels));
+            }
+            if (mode == DspMode::Pitch) {
+                const std::size_t lag = std::min(pitchLag(clip.mono, mono, clip.sampleRate), mono.size());
+                mono.erase(mono.begin(), mono.begin() + static_cast<std::ptrdiff_t>(lag));
+            }
+            std::size_t frames = 0;
+            lsdSum += distortion(clip, mono, speed, mode, frames);
+            lsdFrames += frames;
+        }
+        best = r == 0 ? spent : std::min(best, spent);
+    }
+    Point p;
+    p.config = config;
+    p.cpuMsPerSec = seconds > 0.0 ? best * 1000.0 / seconds : 0.0;
+    p.lsdDb = lsdFrames ? lsdSum / static_cast<double>(lsdFrames) : 0.0;
+    return p;
+}
+
+std::vector<DspConfig> grid(DspMode mode) {
+    std::vector<DspConfig> configs;
+    for (float seq : {20.0f, 30.0f, 35.0f, 40.0f, 50.0f, 60.0f}) {
+        for (float overlap : {6.0f, 8.0f, 10.0f, 12.0f}) {
+            for (float seek : {10.0f, 15.0f, 20.0f, 25.0f, 30.0f}) {
+                for (bool quick : {false, true}) {
+                    DspConfig cfg{};
+                    cfg.voiceGate = false; // gating reshapes the timeline and would break the time mapping
+                    cfg.sequenceMs = seq;
+                    cfg.overlapMs = overlap;
+                    cfg.seekWindowMs = seek;
+                    cfg.quickSeek = quick;
+                    if (mode == DspMode::Tempo) {
+                        configs.push_back(cfg); // no rate transposer in tempo mode; AA is irrelevant
+                        continue;
+                    }
+                    cfg.antiAlias = false;
+                    configs.push_back(cfg);
+                    cfg.antiAlias = true;
+                    for (std::uint32_t taps : {32u, 64u, 128u}) {
+                        cfg.aaFilterLength = taps;
+                        configs.push_back(cfg);
+                    }
+                }
+            }
+        }
+    }
+    return configs;
+}
+
+std::vector<Point> paretoFront(std::vector<Point> points) {
+    std::sort(points.begin(), points.end(), [](const Point &a, const Point &b) {
+        return a.cpuMsPerSec != b.cpuMsPerSec ? a.cpuMsPerSec < b.cpuMsPerSec : a.lsdDb < b.lsdDb;
+    });
+    std::vector<Point> front;
+    for (const auto &p : points) {
+        if (front.empty() || p.lsdDb < front.back().lsdDb) front.push_back(p);
+    }
+    return front;
+}
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--speeds" && value(v)) {
+            opts.speeds.clear();
+            std::istringstream list(v);
+            std::string item;
+            while (std::getline(list, item, ',')) opts.speeds.push_back(std::stof(item));
+            std::sort(opts.speeds.begin(), opts.speeds.end());
+        } else if (arg == "--mode" && value(v)) {
+            opts.tempo = v == "tempo" || v == "both";
+            opts.pitch = v == "pitch" || v == "both";
+        } else if (arg == "--lsd-margin" && value(v)) {
+            opts.lsdMargin = std::stof(v);
+        } else if (arg == "--repeat" && value(v)) {
+            opts.repeat = std::max(1, std::stoi(v));
+        } else if (arg == "--out" && value(v)) {
+            opts.out = v;
+        } else if (arg == "--presets") {
+            opts.presets = true;
+        } else if (arg == "--synth-clips" && value(v)) {
+            opts.synthClips = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (!arg.empty() && arg[0] != '-') {
+            opts.inputs.emplace_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return !opts.speeds.empty() && (opts.tempo || opts.pitch);
+}
+
+// Cost and distortion of each preset per mode and speed, with the balanced preset as the reference.
+int reportPresets(const std::vector<Clip> &corpus, const Options &opts) {
+    std::cout << "preset      mode   speed   DSP ms/s   vs balanced   LSD dB\n";
+    for (DspMode mode : {DspMode::Tempo, DspMode::Pitch}) {
+        if ((mode == DspMode::Tempo && !opts.tempo) || (mode == DspMode::Pitch && !opts.pitch)) continue;
+        for (const float speed : opts.speeds) {
+            Point balanced;
+            for (const auto preset : {DspPreset::Balanced, DspPreset::LowPower, DspPreset::Quality}) {
+                DspConfig cfg = dspPresetConfig(preset);
+                cfg.voiceGate = false; // see grid()
+                const Point p = evaluate(corpus, cfg, speed, mode, opts.repeat);
+                if (preset == DspPreset::Balanced) balanced = p;
+                std::cout << std::left << std::setw(11) << dspPresetName(preset) << " " << std::setw(6)
+                          << (mode == DspMode::Pitch ? "pitch" : "tempo") << std::right << std::fixed
+                          << std::setprecision(2) << std::setw(6) << speed << "x " << std::setw(10) << p.cpuMsPerSec
+                          << " " << std::setw(12) << p.cpuMsPerSec / std::max(1e-9, balanced.cpuMsPerSec) << "x "
+                          << std::setw(8) << p.lsdDb << "\n";
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_dsp_autotune [--speeds 1.25,1.5,2,3] [--mode tempo|pitch|both]\n"
+                     "                         [--lsd-margin dB] [--repeat N] [--out file] [--presets]\n"
+                     "                         [--synth-clips N] [wav|dir]...\n";
+        return 2;
+    }
+
+    auto corpus = loadWavCorpus<Clip>(opts.inputs);
+    if (opts.inputs.empty()) {
+        ContentSynth synth(kSynthRate, 1);
+        for (std::size_t i = 0; i < opts.synthClips; ++i) {
+            Clip clip;
+            static_cast<WavClip &>(clip) = toClip(synth.speech(kSynthSeconds), kSynthRate, 2, "synthetic speech", synth);
+            corpus.push_back(std::move(clip));
+        }
+    }
+    for (auto &clip : corpus) downmix(clip);
+    if (corpus.empty()) {
+        std::cerr << "no usable clips\n";
+        return 1;
+    }
+    if (opts.presets) return reportPresets(corpus, opts);
+
+    std::ofstream out(opts.out);
+    if (!out) {
+        std::cerr << "cannot write " << opts.out.string() << "\n";
+        return 1;
+    }
+    out << "# krkr_dsp_autotune: " << corpus.size() << (opts.inputs.empty() ? " synthetic" : "") << " clips, lsd margin "
+        << opts.lsdMargin << " dB, scoring r" << kScoringRevision << "\n";
+
+    DspTuningTable table;
+    for (DspMode mode : {DspMode::Tempo, DspMode::Pitch}) {
+        if ((mode == DspMode::Tempo && !opts.tempo) || (mode == DspMode::Pitch && !opts.pitch)) continue;
+        const auto configs = grid(mode);
+        for (std::size_t s = 0; s < opts.speeds.size(); ++s) {
+            const float speed = opts.speeds[s];
+            std::vector<Point> points;
+            for (const auto &cfg : configs) {
+                points.push_back(evaluate(corpus, cfg, speed, mode, opts.repeat));
+            }
+            const auto front = paretoFront(points);
+            double bestLsd = front.back().lsdDb;
+            const Point *pick = &front.back();
+            for (const auto &p : front) {
+                if (p.lsdDb <= bestLsd + opts.lsdMargin) {
+                    pick = &p; // front is sorted by cost: the first acceptable point is the cheapest
+                    break;
+                }
+            }
+
+            DspTuningEntry entry;
+            entry.mode = mode;
+            entry.minSpeed = s == 0 ? 0.0f : (opts.speeds[s - 1] + speed) / 2.0f;
+            entry.maxSpeed = s + 1 == opts.speeds.size() ? 100.0f : (speed + opts.speeds[s + 1]) / 2.0f;
+            entry.cpuMsPerSec = static_cast<float>(pick->cpuMsPerSec);
+            entry.distortionDb = static_cast<float>(pick->lsdDb);
+            out << "# " << (mode == DspMode::Pitch ? "pitch" : "tempo") << " @" << speed << "x Pareto front:\n";
+            for (const auto &p : front) {
+                DspTuningEntry row = entry;
+                row.config = p.config;
+                row.cpuMsPerSec = static_cast<float>(p.cpuMsPerSec);
+                row.distortionDb = static_cast<float>(p.lsdDb);
+                out << "#   " << DspTuningTable::formatEntry(row) << "\n";
+            }
+            entry.config = pick->config;
+            entry.config.voiceGate = DspConfig{}.voiceGate;
+            table.add(entry);
+            std::cerr << DspTuningTable::formatEntry(entry) << "\n";
+        }
+    }
+    table.write(out);
+    return 0;
+}
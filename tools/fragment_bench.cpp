@@ -0,0 +1,163 @@
+// Tiny-fragment benchmark: a stereo 44.1 kHz dialogue stream delivered to the DirectSound pitch path as Unlock
+// fragments of 64 B to 4 KB. For each size it reports the per-byte cost of
+//   batched:  AudioStreamProcessor::process, which queues fragments under 10 ms and runs one DSP call per
+//             20 ms of gathered input (what the hook does now);
+//   direct:   one DspPipeline::process call per fragment, the cost every fragment paid before batching;
+// and, as the floor both should approach, the same stream in regular 20 ms Unlocks. Output length is checked
+// against the input for every row (the pitch path returns exactly what it was given). --preset low-power runs
+// the integer WSOLA engine, which needs no SoundTouch; without SoundTouch the other presets fall back to a
+// resampler that lengthens pitch-path output, so their batched rows also pay for trimming the surplus.
+//
+//   krkr_fragment_bench [--seconds 20] [--speed 1.5] [--runs 3] [--preset balanced|low-power|quality]
+
+#include "common/AudioStreamProcessor.h"
+#include "common/DspPipeline.h"
+#include "common/VoiceRenderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::size_t kBlockAlign = kChannels * sizeof(std::int16_t);
+constexpr double kPi = 3.14159265358979323846;
+
+struct Options {
+    double seconds = 20.0;
+    float speed = 1.5f;
+    std::size_t runs = 3;
+    DspPreset preset = DspPreset::Balanced;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--preset" && value(v)) {
+            bool known = false;
+            for (const auto preset : {DspPreset::Balanced, DspPreset::LowPower, DspPreset::Quality}) {
+                if (v == dspPresetName(preset)) {
+                    opts.preset = preset;
+                    known = true;
+                }
+            }
+            if (!known) return false;
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f;
+}
+
+// Harmonic syllables with a 4 Hz envelope, no pauses, so every fragment carries signal.
+std::vector<std::int16_t> render(double seconds) {
+    const std::size_t frames = static_cast<std::size_t>(seconds * kRate);
+    std::vector<std::int16_t> pcm(frames * kChannels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const double t = static_cast<double>(f) / kRate;
+        const double f0 = 140.0 + 60.0 * std::sin(2.0 * kPi * 0.3 * t);
+        double v = 0.0;
+        for (int h = 1; h <= 6; ++h) v += std::sin(2.0 * kPi * f0 * h * t) / h;
+        const auto s = static_cast<std::int16_t>(std::lround(8000.0 * (0.5 - 0.5 * std::cos(8.0 * kPi * t)) * v / 2.45));
+        pcm[f * kChannels] = s;
+        pcm[f * kChannels + 1] = s;
+    }
+    return pcm;
+}
+
+struct Result {
+    double nsPerByte = 1e300;
+    bool lengthOk = true;
+};
+
+// Best of `runs`: feeds `total` bytes in `fragment`-byte pieces through `feed`, which returns the output size.
+template <typename Make> Result timeFeed(const std::vector<std::int16_t> &pcm, std::size_t fragment,
+                                        std::size_t runs, Make make) {
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(pcm.data());
+    const std::size_t total = pcm.size() * sizeof(std::int16_t) / fragment * fragment;
+    Result result;
+    for (std::size_t run = 0; run < runs; ++run) {
+        auto feed = make();
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t pos = 0; pos < total; pos += fragment) {
+            if (feed(bytes + pos, fragment) != fragment) result.lengthOk = false;
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        result.nsPerByte = std::min(result.nsPerByte, ns / static_cast<double>(total));
+    }
+    return result;
+}
+
+Result batched(const std::vector<std::int16_t> &pcm, std::size_t fragment, const Options &opts) {
+    const float speed = opts.speed;
+    const DspConfig cfg = dspPresetConfig(opts.preset);
+    return timeFeed(pcm, fragment, opts.runs, [speed, cfg]() {
+        auto stream = std::make_shared<AudioStreamProcessor>(kRate, kChannels, kBlockAlign, cfg);
+        return [stream, speed](const std::uint8_t *data, std::size_t bytes) {
+            return stream->process(data, bytes, speed, false, 1).output.size();
+        };
+    });
+}
+
+Result direct(const std::vector<std::int16_t> &pcm, std::size_t fragment, const Options &opts) {
+    const float speed = opts.speed;
+    const DspConfig cfg = dspPresetConfig(opts.preset);
+    return timeFeed(pcm, fragment, opts.runs, [speed, cfg]() {
+        auto dsp = std::make_shared<DspPipeline>(kRate, kChannels, cfg);
+        // The pipeline's own output length varies per call; only the cost is compared here.
+        return [dsp, speed](const std::uint8_t *data, std::size_t bytes) {
+            dsp->process(data, bytes, 1.0f / speed, DspMode::Pitch);
+            return bytes;
+        };
+    });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_fragment_bench [--seconds s] [--speed x] [--runs n] [--preset name]\n";
+        return 2;
+    }
+    VoiceRenderCache::instance().setBudget(0);
+    const auto pcm = render(opts.seconds);
+    std::cout << kChannels << " ch " << kRate << " Hz, " << opts.seconds << " s, pitch path at speed " << opts.speed
+              << ", preset " << dspPresetName(opts.preset) << ", best of " << opts.runs << "\n";
+    const std::size_t regular = kRate / 50 * kBlockAlign;
+    const Result floor = batched(pcm, regular, opts);
+    std::cout << std::fixed << std::setprecision(2) << "20 ms Unlocks (" << regular << " B): " << floor.nsPerByte
+              << " ns/B" << (floor.lengthOk ? "" : "  LENGTH MISMATCH") << "\n";
+    std::cout << "fragment   batched ns/B   direct ns/B   direct/batched   batched/20 ms\n";
+    int status = floor.lengthOk ? 0 : 1;
+    for (const std::size_t fragment : {64u, 128u, 256u, 512u, 1024u, 2048u, 4096u}) {
+        const Result b = batched(pcm, fragment, opts);
+        const Result d = direct(pcm, fragment, opts);
+        std::cout << std::setw(6) << fragment << " B  " << std::setw(12) << b.nsPerByte << "  " << std::setw(12)
+                  << d.nsPerByte << "  " << std::setw(14) << d.nsPerByte / b.nsPerByte << "x  " << std::setw(12)
+                  << b.nsPerByte / floor.nsPerByte << "x" << (b.lengthOk ? "" : "  LENGTH MISMATCH") << "\n";
+        if (!b.lengthOk) status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,170 @@
+// Integer vs float WSOLA benchmark: a stereo 44.1 kHz dialogue stream in 20 ms calls through DspPipeline with
+// the low-power preset (IntWsola, int16 end to end) and with the same settings on the float path (SoundTouch,
+// or IntWsola behind an int16 round trip when built without it), in tempo and pitch mode at each speed. It
+// reports DSP ms per second of audio for both, the int16 <-> float conversion the integer path skips, and
+// which correlation path IntWsola was compiled with. The case it exists for is a 32-bit build: configure a
+// separate tree for x86 (MSVC "-A Win32", or -DCMAKE_CXX_FLAGS="-m32 -msse2" with a multilib toolchain) and
+// compare its output with the 64-bit one. Built without SoundTouch the float column is not a SoundTouch
+// baseline: it only adds the round trip to the same engine, and the bench says so.
+//
+//   krkr_int_wsola_bench [--seconds 10] [--speeds 1.25,1.5,2,3] [--runs 3]
+
+#include "common/DspPipeline.h"
+#include "common/VoiceRenderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr std::uint32_t kChannels = 2;
+constexpr std::size_t kChunkFrames = kRate / 50;
+constexpr double kPi = 3.14159265358979323846;
+
+volatile std::int16_t g_sink; // keeps the conversion loop from being optimised away
+
+struct Options {
+    double seconds = 10.0;
+    std::vector<float> speeds{1.25f, 1.5f, 2.0f, 3.0f};
+    std::size_t runs = 3;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (arg == "--speeds" && value(v)) {
+            opts.speeds.clear();
+            std::istringstream list(v);
+            std::string item;
+            while (std::getline(list, item, ',')) opts.speeds.push_back(std::stof(item));
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else {
+            return false;
+        }
+    }
+    return !opts.speeds.empty() &&
+           std::all_of(opts.speeds.begin(), opts.speeds.end(), [](float s) { return s > 0.0f; });
+}
+
+// Harmonic syllables with a 4 Hz envelope and a short pause every 1.5 s.
+std::vector<std::int16_t> render(double seconds) {
+    const std::size_t frames = static_cast<std::size_t>(seconds * kRate);
+    std::vector<std::int16_t> pcm(frames * kChannels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const double t = static_cast<double>(f) / kRate;
+        if (std::fmod(t, 1.5) > 1.25) continue;
+        const double f0 = 140.0 + 60.0 * std::sin(2.0 * kPi * 0.3 * t);
+        double v = 0.0;
+        for (int h = 1; h <= 6; ++h) v += std::sin(2.0 * kPi * f0 * h * t) / h;
+        const auto s = static_cast<std::int16_t>(std::lround(8000.0 * (0.5 - 0.5 * std::cos(8.0 * kPi * t)) * v / 2.45));
+        pcm[f * kChannels] = s;
+        pcm[f * kChannels + 1] = static_cast<std::int16_t>(s * 3 / 4);
+    }
+    return pcm;
+}
+
+// Best-of-runs DSP ms per second of audio for `config` in `mode`.
+double dspCost(const std::vector<std::int16_t> &pcm, const DspConfig &config, DspMode mode, float speed,
+               std::size_t runs) {
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(pcm.data());
+    const std::size_t total = pcm.size() * sizeof(std::int16_t);
+    const std::size_t chunk = kChunkFrames * kChannels * sizeof(std::int16_t);
+    const float ratio = mode == DspMode::Pitch ? 1.0f / speed : speed;
+    double best = 1e300;
+    for (std::size_t run = 0; run < runs; ++run) {
+        DspPipeline dsp(kRate, kChannels, config);
+        std::size_t produced = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t pos = 0; pos < total; pos += chunk) {
+            produced += dsp.process(bytes + pos, std::min(chunk, total - pos), ratio, mode).size();
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ms);
+        if (produced == 0) std::cerr << "warning: no output\n";
+    }
+    return best / (static_cast<double>(pcm.size() / kChannels) / kRate);
+}
+
+// The float path's per-call int16 -> float -> int16 round trip on its own.
+double conversionCost(const std::vector<std::int16_t> &pcm, std::size_t runs) {
+    std::vector<float> floats(kChunkFrames * kChannels);
+    std::vector<std::int16_t> back(floats.size());
+    double best = 1e300;
+    for (std::size_t run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t pos = 0; pos + floats.size() <= pcm.size(); pos += floats.size()) {
+            for (std::size_t i = 0; i < floats.size(); ++i) floats[i] = static_cast<float>(pcm[pos + i]) * (1.0f / 32768.0f);
+            for (std::size_t i = 0; i < floats.size(); ++i) {
+                back[i] = static_cast<std::int16_t>(std::lround(std::clamp(floats[i] * 32768.0f, -32768.0f, 32767.0f)));
+            }
+            g_sink = back[pos % back.size()];
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best / (static_cast<double>(pcm.size() / kChannels) / kRate);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_int_wsola_bench [--seconds s] [--speeds 1.25,1.5,2,3] [--runs n]\n";
+        return 2;
+    }
+    VoiceRenderCache::instance().setBudget(0);
+    const auto pcm = render(opts.seconds);
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const char *correlation = "SSE2";
+#else
+    const char *correlation = "scalar";
+#endif
+#ifdef USE_SOUNDTOUCH
+    const char *floatEngine = "SoundTouch";
+#else
+    const char *floatEngine = "IntWsola (no SoundTouch)";
+#endif
+    std::cout << (sizeof(void *) * 8) << "-bit build, IntWsola correlation " << correlation << ", float path "
+              << floatEngine << "; " << kChannels << " ch " << kRate << " Hz, " << opts.seconds << " s in "
+              << kChunkFrames * 1000 / kRate << " ms calls, best of " << opts.runs << "\n";
+    std::cout << std::fixed << std::setprecision(2) << "int16 <-> float round trip alone: "
+              << conversionCost(pcm, opts.runs) << " ms/s\n";
+    const DspConfig integerConfig = dspPresetConfig(DspPreset::LowPower);
+    DspConfig floatConfig = integerConfig;
+    floatConfig.integerPath = false;
+#ifndef USE_SOUNDTOUCH
+    std::cout << "note: no SoundTouch in this build; float/integer is the round trip's share, not SoundTouch vs "
+                 "IntWsola\n";
+#endif
+    std::cout << "mode   speed   integer ms/s   float ms/s   float/integer\n";
+    for (const DspMode mode : {DspMode::Tempo, DspMode::Pitch}) {
+        for (const float speed : opts.speeds) {
+            const double integer = dspCost(pcm, integerConfig, mode, speed, opts.runs);
+            const double floating = dspCost(pcm, floatConfig, mode, speed, opts.runs);
+            std::cout << std::left << std::setw(6) << (mode == DspMode::Pitch ? "pitch" : "tempo") << std::right
+                      << std::setw(6) << speed << "x " << std::setw(13) << integer << "  " << std::setw(11) << floating
+                      << "  " << std::setw(13) << floating / integer << "x\n";
+        }
+    }
+    return 0;
+}
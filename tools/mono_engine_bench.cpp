@@ -0,0 +1,170 @@
+// Mono-in-stereo benchmark: DSP cost of a stereo stream whose channels are identical (a mono voice the game
+// mixes to both speakers) with DspPipeline's mono engine on and off, against a true mono stream of the same
+// signal. Tempo mode, voice gate off, fed through DspPipeline::process in --buffer-ms callbacks:
+//   stereo, mono engine on:  bit-identical channels; after 4 buffers the pipeline runs SoundTouch on channel 0
+//                            and duplicates its output;
+//   stereo, mono engine off: the same signal with the right channel's LSB flipped every 64 frames, so no
+//                            buffer is identical and the full stereo engine runs throughout (the 1-LSB change
+//                            does not change the WSOLA work);
+//   mono stream:             one channel, the floor the mono engine can reach.
+// Each row is the best of --runs, in ms of DSP time per second of audio; output frames are checked against
+// input/speed so a path that drops audio cannot look cheap. Built without SoundTouch every 16-bit stream runs
+// on IntWsola, which has no mono engine, so the first two rows then measure the same path.
+//
+//   krkr_mono_engine_bench [--seconds 30] [--rate 48000] [--buffer-ms 10] [--speed 1.5] [--runs 3]
+//                          [--preset balanced|quality]
+
+#include "common/DspPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr std::size_t kDecorrelateFrames = 64;
+
+struct Options {
+    double seconds = 30.0;
+    std::uint32_t rate = 48000;
+    std::uint32_t bufferMs = 10;
+    float speed = 1.5f;
+    std::size_t runs = 3;
+    DspPreset preset = DspPreset::Balanced;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (arg == "--rate" && value(v)) {
+            opts.rate = static_cast<std::uint32_t>(std::max(8000, std::stoi(v)));
+        } else if (arg == "--buffer-ms" && value(v)) {
+            opts.bufferMs = static_cast<std::uint32_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--preset" && value(v)) {
+            if (v == "balanced") {
+                opts.preset = DspPreset::Balanced;
+            } else if (v == "quality") {
+                opts.preset = DspPreset::Quality;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f;
+}
+
+// Voice-like harmonics under a 4 Hz syllable envelope, on every channel.
+std::vector<std::int16_t> render(const Options &opts, std::uint32_t channels) {
+    const std::size_t frames = static_cast<std::size_t>(opts.seconds * opts.rate);
+    std::vector<std::int16_t> pcm(frames * channels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const double t = static_cast<double>(f) / opts.rate;
+        const double env = 0.5 - 0.5 * std::cos(2.0 * kPi * 4.0 * t);
+        double v = 0.0;
+        for (int h = 1; h <= 5; ++h) v += std::sin(2.0 * kPi * 150.0 * h * t) / h;
+        const auto s = static_cast<std::int16_t>(std::lround(6000.0 * env * v / 2.3));
+        for (std::uint32_t c = 0; c < channels; ++c) pcm[f * channels + c] = s;
+    }
+    return pcm;
+}
+
+struct Result {
+    double msPerSec = 0.0;
+    double lengthErrorMs = 0.0;
+};
+
+// One pass over `pcm`: DSP milliseconds, and output length against input/speed.
+Result runStream(const Options &opts, const std::vector<std::int16_t> &pcm, std::uint32_t channels) {
+    DspConfig cfg = dspPresetConfig(opts.preset);
+    cfg.voiceGate = false;
+    const std::size_t bufferSamples = opts.rate * opts.bufferMs / 1000 * channels;
+    const std::size_t buffers = pcm.size() / bufferSamples;
+    DspPipeline dsp(opts.rate, channels, cfg);
+    std::size_t produced = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t b = 0; b < buffers; ++b) {
+        produced += dsp.process(reinterpret_cast<const std::uint8_t *>(pcm.data() + b * bufferSamples),
+                                bufferSamples * sizeof(std::int16_t), opts.speed)
+                        .size();
+    }
+    produced += dsp.finish().size();
+    Result result;
+    result.msPerSec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const double frames = static_cast<double>(produced / (channels * sizeof(std::int16_t)));
+    const double expected = static_cast<double>(buffers * bufferSamples / channels) / opts.speed;
+    result.lengthErrorMs = (frames - expected) * 1000.0 / opts.rate;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_mono_engine_bench [--seconds s] [--rate hz] [--buffer-ms ms] [--speed x]\n"
+                     "                              [--runs n] [--preset balanced|quality]\n";
+        return 2;
+    }
+#ifdef USE_SOUNDTOUCH
+    const char *engine = "SoundTouch";
+#else
+    const char *engine = "IntWsola (no SoundTouch: no mono engine)";
+#endif
+    std::cout << engine << ", preset " << dspPresetName(opts.preset) << ", " << opts.rate << " Hz, " << opts.bufferMs
+              << " ms buffers, " << opts.seconds << " s, speed " << opts.speed << ", best of " << opts.runs << "\n";
+
+    const auto duplicated = render(opts, 2);
+    auto decorrelated = duplicated;
+    for (std::size_t f = 0; f < decorrelated.size() / 2; f += kDecorrelateFrames) decorrelated[f * 2 + 1] ^= 1;
+    const auto mono = render(opts, 1);
+
+    struct Path {
+        const std::vector<std::int16_t> &pcm;
+        std::uint32_t channels;
+        Result best;
+    };
+    Path paths[] = {{duplicated, 2, {}}, {decorrelated, 2, {}}, {mono, 1, {}}};
+    // Runs are interleaved so clock ramp-up and cache warm-up do not favour whichever path goes last.
+    for (std::size_t run = 0; run < opts.runs; ++run) {
+        for (Path &path : paths) {
+            const Result r = runStream(opts, path.pcm, path.channels);
+            if (run == 0 || r.msPerSec < path.best.msPerSec) path.best = r;
+        }
+    }
+    for (Path &path : paths) path.best.msPerSec /= opts.seconds;
+    const Result &on = paths[0].best;
+    const Result &off = paths[1].best;
+    const Result &single = paths[2].best;
+    auto row = [&](const char *name, const Result &r) {
+        std::cout << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << r.msPerSec << " ms/s  " << std::setw(6) << r.msPerSec / off.msPerSec * 100.0
+                  << "% of off  length " << std::showpos << std::setprecision(1) << r.lengthErrorMs
+                  << std::noshowpos << " ms\n";
+    };
+    row("stereo, mono engine off", off);
+    row("stereo, mono engine on", on);
+    row("mono stream", single);
+    return 0;
+}
@@ -0,0 +1,150 @@
+// DspPipelinePool latency benchmark: the cost of the first Unlock/ReleaseBuffer of a voice line, measured as
+// getting a pipeline plus processing the first callback-sized buffer. Three ways of getting it are timed:
+//   cold:     constructing a DspPipeline inside the callback (no pool);
+//   prewarm:  acquire() of a pipeline the warm-up thread built and warmed in advance (pool hit after
+//             prewarmAsync at CreateSoundBuffer/Initialize time);
+//   recycled: acquire() of a pipeline a finished stream handed back with recycle().
+// Pipelines are destroyed outside the timed region. The report gives median, p95 and max per path.
+//
+//   krkr_pool_latency_bench [--trials 200] [--rate 44100] [--channels 2] [--buffer-ms 20] [--speed 1.5]
+//                           [--mode pitch|tempo]
+
+#include "common/DspPipeline.h"
+#include "common/DspPipelinePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+struct Options {
+    std::size_t trials = 200;
+    std::uint32_t rate = 44100;
+    std::uint32_t channels = 2;
+    std::uint32_t bufferMs = 20;
+    float speed = 1.5f;
+    DspMode mode = DspMode::Pitch;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--trials" && value(v)) {
+            opts.trials = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--rate" && value(v)) {
+            opts.rate = static_cast<std::uint32_t>(std::max(8000, std::stoi(v)));
+        } else if (arg == "--channels" && value(v)) {
+            opts.channels = static_cast<std::uint32_t>(std::clamp(std::stoi(v), 1, 8));
+        } else if (arg == "--buffer-ms" && value(v)) {
+            opts.bufferMs = static_cast<std::uint32_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--mode" && value(v)) {
+            if (v == "pitch") {
+                opts.mode = DspMode::Pitch;
+            } else if (v == "tempo") {
+                opts.mode = DspMode::Tempo;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f;
+}
+
+std::vector<std::int16_t> firstBuffer(const Options &opts) {
+    const std::size_t frames = static_cast<std::size_t>(opts.rate) * opts.bufferMs / 1000;
+    std::vector<std::int16_t> pcm(frames * opts.channels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const auto s = static_cast<std::int16_t>(std::lround(8000.0 * std::sin(2.0 * 3.14159265358979 * 220.0 * f / opts.rate)));
+        for (std::uint32_t c = 0; c < opts.channels; ++c) pcm[f * opts.channels + c] = s;
+    }
+    return pcm;
+}
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedUs(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void report(const char *name, std::vector<double> us) {
+    std::sort(us.begin(), us.end());
+    const auto at = [&](double q) { return us[std::min(us.size() - 1, static_cast<std::size_t>(q * us.size()))]; };
+    std::cout << std::left << std::setw(9) << name << std::right << std::fixed << std::setprecision(1)
+              << "  median " << std::setw(9) << at(0.5) << " us  p95 " << std::setw(9) << at(0.95) << " us  max "
+              << std::setw(9) << us.back() << " us\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_pool_latency_bench [--trials n] [--rate hz] [--channels n] [--buffer-ms ms]\n"
+                     "                               [--speed x] [--mode pitch|tempo]\n";
+        return 2;
+    }
+    const auto pcm = firstBuffer(opts);
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(pcm.data());
+    const std::size_t size = pcm.size() * sizeof(std::int16_t);
+    const DspConfig cfg{};
+    auto &pool = DspPipelinePool::instance();
+    std::vector<double> cold;
+    std::vector<double> prewarmed;
+    std::vector<double> recycled;
+
+    for (std::size_t i = 0; i < opts.trials; ++i) {
+        std::unique_ptr<DspPipeline> dsp;
+        auto start = Clock::now();
+        dsp = std::make_unique<DspPipeline>(opts.rate, opts.channels, cfg);
+        dsp->process(bytes, size, opts.speed, opts.mode);
+        cold.push_back(elapsedUs(start));
+        dsp.reset();
+
+        // Same hand-off as the hooks: ask at buffer creation, acquire on the first callback.
+        pool.prewarmAsync(opts.rate, opts.channels, cfg);
+        const auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (pool.idleFootprint() == 0 && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        start = Clock::now();
+        dsp = pool.acquire(opts.rate, opts.channels, cfg);
+        dsp->process(bytes, size, opts.speed, opts.mode);
+        prewarmed.push_back(elapsedUs(start));
+
+        pool.recycle(std::move(dsp));
+        start = Clock::now();
+        dsp = pool.acquire(opts.rate, opts.channels, cfg);
+        dsp->process(bytes, size, opts.speed, opts.mode);
+        recycled.push_back(elapsedUs(start));
+        dsp.reset(); // next trial's prewarm must build a fresh pipeline
+    }
+
+    std::cout << opts.trials << " trials, " << opts.rate << " Hz x" << opts.channels << ", first buffer "
+              << opts.bufferMs << " ms, speed " << opts.speed << (opts.mode == DspMode::Pitch ? " (pitch)" : " (tempo)")
+              << "\n";
+    report("cold", cold);
+    report("prewarm", prewarmed);
+    report("recycled", recycled);
+    std::cout << "pool hits " << pool.hits() << ", misses " << pool.misses() << "\n";
+    return 0;
+}
@@ -0,0 +1,178 @@
+// VoiceRenderCache benchmark: replays a voice corpus through AudioStreamProcessor's pitch path the way the
+// DirectSound hook sees it (a fresh stream per playback, fed whole or in --chunk-ms buffers), drawing lines
+// with a Zipf-skewed repetition pattern. The same schedule runs once with the cache disabled and once with
+// it enabled; the report gives processing time, hit rate and bytes saved, and counts playbacks whose
+// cached output differs from the uncached render (should be 0).
+//
+//   krkr_render_cache_bench [--plays 400] [--zipf 1.1] [--speed 1.5] [--chunk-ms 0] [--budget-mb 32]
+//                           [--seed 1] <wav file or directory>...
+
+#include "common/AudioStreamProcessor.h"
+#include "common/VoiceRenderCache.h"
+#include "common/XxHash64.h"
+#include "WavCorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace krkrspeed;
+
+namespace {
+
+struct Options {
+    std::size_t plays = 400;
+    double zipf = 1.1;
+    float speed = 1.5f;
+    std::uint32_t chunkMs = 0; // 0: one buffer per line
+    std::size_t budgetMb = 32;
+    std::uint32_t seed = 1;
+    std::vector<fs::path> inputs;
+};
+
+struct RunResult {
+    double ms = 0.0;
+    std::vector<std::uint64_t> outputHashes; // per playback
+    VoiceRenderCacheStats stats;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--plays" && value(v)) {
+            opts.plays = std::max(1, std::stoi(v));
+        } else if (arg == "--zipf" && value(v)) {
+            opts.zipf = std::stod(v);
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--chunk-ms" && value(v)) {
+            opts.chunkMs = static_cast<std::uint32_t>(std::max(0, std::stoi(v)));
+        } else if (arg == "--budget-mb" && value(v)) {
+            opts.budgetMb = static_cast<std::size_t>(std::max(0, std::stoi(v)));
+        } else if (arg == "--seed" && value(v)) {
+            opts.seed = static_cast<std::uint32_t>(std::stoul(v));
+        } else if (!arg.empty() && arg[0] != '-') {
+            opts.inputs.emplace_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return !opts.inputs.empty() && opts.speed > 0.0f;
+}
+
+// Playback order: clip ranks are shuffled, then drawn with P(rank k) ~ 1 / k^s.
+std::vector<std::size_t> schedule(std::size_t clips, const Options &opts) {
+    std::mt19937 rng(opts.seed);
+    std::vector<std::size_t> byRank(clips);
+    std::iota(byRank.begin(), byRank.end(), 0);
+    std::shuffle(byRank.begin(), byRank.end(), rng);
+    std::vector<double> weights(clips);
+    for (std::size_t k = 0; k < clips; ++k) weights[k] = 1.0 / std::pow(static_cast<double>(k + 1), opts.zipf);
+    std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+    std::vector<std::size_t> plays(opts.plays);
+    for (auto &p : plays) p = byRank[pick(rng)];
+    return plays;
+}
+
+RunResult run(const std::vector<WavClip> &corpus, const std::vector<std::size_t> &plays, const Options &opts,
+              std::size_t budget) {
+    auto &cache = VoiceRenderCache::instance();
+    cache.setBudget(0); // drops entries from a previous run
+    cache.setBudget(budget);
+    const auto before = cache.stats();
+
+    RunResult result;
+    std::vector<std::uint8_t> rendered;
+    for (const std::size_t index : plays) {
+        const auto &clip = corpus[index];
+        const std::uint32_t blockAlign = clip.channels * sizeof(std::int16_t);
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+        const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+        const std::size_t chunk =
+            opts.chunkMs ? std::max<std::size_t>(blockAlign, clip.sampleRate * opts.chunkMs / 1000 * blockAlign) : total;
+        rendered.clear();
+        const auto start = std::chrono::steady_clock::now();
+        {
+            AudioStreamProcessor stream(clip.sampleRate, clip.channels, blockAlign, DspConfig{});
+            for (std::size_t pos = 0; pos < total; pos += chunk) {
+                const auto res = stream.process(bytes + pos, std::min(chunk, total - pos), opts.speed, false, 0);
+                rendered.insert(rendered.end(), res.output.begin(), res.output.end());
+            }
+        } // the finished line is handed to the cache here, as when the game releases its buffer
+        result.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.outputHashes.push_back(xxh64(rendered.data(), rendered.size()));
+    }
+
+    result.stats = cache.stats();
+    result.stats.hits -= before.hits;
+    result.stats.misses -= before.misses;
+    result.stats.bytesSaved -= before.bytesSaved;
+    result.stats.evictions -= before.evictions;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_render_cache_bench [--plays N] [--zipf s] [--speed x] [--chunk-ms ms]\n"
+                     "                               [--budget-mb MB] [--seed n] <wav|dir>...\n";
+        return 2;
+    }
+    const auto corpus = loadWavCorpus<WavClip>(opts.inputs);
+    if (corpus.empty()) {
+        std::cerr << "no usable clips\n";
+        return 1;
+    }
+    const auto plays = schedule(corpus.size(), opts);
+
+    double seconds = 0.0;
+    std::vector<bool> seen(corpus.size(), false);
+    std::size_t unique = 0;
+    for (const std::size_t index : plays) {
+        seconds += static_cast<double>(corpus[index].samples.size() / corpus[index].channels) / corpus[index].sampleRate;
+        if (!seen[index]) {
+            seen[index] = true;
+            ++unique;
+        }
+    }
+
+    const auto baseline = run(corpus, plays, opts, 0);
+    const auto cached = run(corpus, plays, opts, opts.budgetMb * 1024 * 1024);
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < plays.size(); ++i) {
+        if (baseline.outputHashes[i] != cached.outputHashes[i]) ++mismatches;
+    }
+
+    const auto &st = cached.stats;
+    const double lookups = static_cast<double>(st.hits + st.misses);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "plays " << plays.size() << " (" << unique << " distinct lines, " << seconds << " s of audio), speed "
+              << opts.speed << ", chunk " << (opts.chunkMs ? std::to_string(opts.chunkMs) + " ms" : "whole line")
+              << "\n";
+    std::cout << "uncached " << baseline.ms << " ms, cached " << cached.ms << " ms ("
+              << (cached.ms > 0.0 ? baseline.ms / cached.ms : 0.0) << "x)\n";
+    std::cout << "hits " << st.hits << ", misses " << st.misses << ", hit rate "
+              << (lookups > 0.0 ? 100.0 * st.hits / lookups : 0.0) << "%, saved "
+              << static_cast<double>(st.bytesSaved) / (1024.0 * 1024.0) << " MB\n";
+    std::cout << "cache " << static_cast<double>(st.bytes) / (1024.0 * 1024.0) << " MB in " << st.entries
+              << " entries, " << st.evictions << " evictions\n";
+    std::cout << "output mismatches " << mismatches << "\n";
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Segmented pitch benchmark: renders long one-shot voice buffers the way the DirectSound hook hands them to
+// AudioStreamProcessor (one Unlock per clip, pitch mode) and compares the time against a single DspPipeline
+// run over the same clip. The segmented run splits the clip across WorkerPool; --threads pins the number of
+// worker threads (default: hardware threads - 1). The report gives per-clip time for both paths, the speedup,
+// and the largest sample step on either side of every seam relative to the serial rendering's largest step,
+// which stays near 1 when the crossfades are clean.
+//
+//   krkr_segmented_pitch_bench [--threads n] [--speed 1.5] [--runs 3] [--seconds 12] [wav file or directory]...
+//
+// Without inputs a synthetic stereo dialogue clip of --seconds is used.
+
+#include "common/AudioStreamProcessor.h"
+#include "common/DspPipeline.h"
+#include "common/VoiceRenderCache.h"
+#include "common/WorkerPool.h"
+#include "WavCorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace krkrspeed;
+
+namespace {
+
+struct Options {
+    int threads = -1;
+    float speed = 1.5f;
+    std::size_t runs = 3;
+    double seconds = 12.0;
+    std::vector<fs::path> inputs;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--threads" && value(v)) {
+            opts.threads = std::max(0, std::stoi(v));
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (!arg.empty() && arg[0] != '-') {
+            opts.inputs.emplace_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f;
+}
+
+// Harmonic phrases with a syllable envelope and short pauses, identical on both channels.
+WavClip syntheticClip(double seconds) {
+    WavClip clip;
+    clip.name = "synthetic";
+    clip.sampleRate = 44100;
+    clip.channels = 2;
+    const std::size_t frames = static_cast<std::size_t>(seconds * clip.sampleRate);
+    clip.samples.assign(frames * clip.channels, 0);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> pitch(110.0, 240.0);
+    const double pi = 3.14159265358979323846;
+    std::size_t f = 0;
+    while (f < frames) {
+        const double f0 = pitch(rng);
+        const std::size_t phrase = std::min<std::size_t>(frames - f, clip.sampleRate * 3 / 2);
+        for (std::size_t i = 0; i < phrase; ++i) {
+            const double t = static_cast<double>(i) / clip.sampleRate;
+            const double env = 0.5 - 0.5 * std::cos(2.0 * pi * 4.0 * t);
+            double v = 0.0;
+            for (int h = 1; h <= 6; ++h) v += std::sin(2.0 * pi * f0 * h * t) / h;
+            const auto s = static_cast<std::int16_t>(std::lround(8000.0 * env * v / 2.45));
+            clip.samples[(f + i) * 2] = s;
+            clip.samples[(f + i) * 2 + 1] = s;
+        }
+        f += phrase + clip.sampleRate / 4;
+    }
+    return clip;
+}
+
+double maxStep(const std::vector<std::int16_t> &pcm, std::size_t channels, std::size_t from, std::size_t to) {
+    int step = 0;
+    for (std::size_t f = std::max<std::size_t>(from, 1); f < std::min(to, pcm.size() / channels); ++f) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            step = std::max(step, std::abs(pcm[f * channels + c] - pcm[(f - 1) * channels + c]));
+        }
+    }
+    return step;
+}
+
+std::vector<std::int16_t> toSamples(const std::vector<std::uint8_t> &bytes) {
+    std::vector<std::int16_t> pcm(bytes.size() / sizeof(std::int16_t));
+    if (!pcm.empty()) std::memcpy(pcm.data(), bytes.data(), pcm.size() * sizeof(std::int16_t));
+    return pcm;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_segmented_pitch_bench [--threads n] [--speed x] [--runs n] [--seconds s]\n"
+                     "                                  [wav|dir]...\n";
+        return 2;
+    }
+    if (opts.threads >= 0) WorkerPool::setWorkerCount(static_cast<unsigned>(opts.threads));
+    VoiceRenderCache::instance().setBudget(0); // every run must render
+    std::vector<WavClip> corpus;
+    if (opts.inputs.empty()) {
+        corpus.push_back(syntheticClip(opts.seconds));
+    } else {
+        corpus = loadWavCorpus<WavClip>(opts.inputs);
+    }
+    if (corpus.empty()) {
+        std::cerr << "no usable clips\n";
+        return 1;
+    }
+    std::cout << "concurrency " << WorkerPool::instance().concurrency() << ", speed " << opts.speed << ", "
+              << opts.runs << " runs per clip\n";
+
+    using Clock = std::chrono::steady_clock;
+    double serialTotal = 0.0;
+    double segmentedTotal = 0.0;
+    for (const auto &clip : corpus) {
+        const std::uint32_t blockAlign = clip.channels * sizeof(std::int16_t);
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+        const std::size_t size = clip.samples.size() * sizeof(std::int16_t);
+        // AudioStreamProcessor pitches by 1/speed; the serial reference does the same.
+        const float pitch = 1.0f / opts.speed;
+        double serialMs = 1e300;
+        double segmentedMs = 1e300;
+        std::vector<std::int16_t> serial;
+        std::vector<std::int16_t> segmented;
+        for (std::size_t run = 0; run < opts.runs; ++run) {
+            auto start = Clock::now();
+            {
+                DspPipeline dsp(clip.sampleRate, clip.channels, DspConfig{});
+                auto out = dsp.process(bytes, size, pitch, DspMode::Pitch);
+                const auto tail = dsp.finish();
+                out.insert(out.end(), tail.begin(), tail.end());
+                serial = toSamples(out);
+            }
+            serialMs = std::min(serialMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+            start = Clock::now();
+            {
+                AudioStreamProcessor stream(clip.sampleRate, clip.channels, blockAlign, DspConfig{});
+                segmented = toSamples(stream.process(bytes, size, opts.speed, false, 1).output);
+            }
+            segmentedMs =
+                std::min(segmentedMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        serialTotal += serialMs;
+        segmentedTotal += segmentedMs;
+
+        // Seams sit at frames * k / segments of the input; look 50 ms either side of each candidate position
+        // and report the worst step relative to the serial rendering's worst step.
+        const std::size_t frames = clip.samples.size() / clip.channels;
+        const std::size_t span = clip.sampleRate / 20; // covers the start-up latency the stream front-pads
+        const std::size_t segments = WorkerPool::instance().concurrency();
+        double seamStep = 0.0;
+        for (std::size_t k = 1; k < segments; ++k) {
+            const std::size_t seam = frames * k / segments;
+            seamStep = std::max(seamStep, maxStep(segmented, clip.channels, seam - std::min(seam, span), seam + span));
+        }
+        const double reference = std::max(1.0, maxStep(serial, clip.channels, 0, serial.size() / clip.channels));
+        std::cout << std::left << std::setw(24) << clip.name.substr(0, 23) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(7) << frames / static_cast<double>(clip.sampleRate) << " s"
+                  << "  serial " << std::setw(8) << serialMs << " ms  segmented " << std::setw(8) << segmentedMs
+                  << " ms  speedup " << std::setprecision(2) << serialMs / std::max(0.001, segmentedMs)
+                  << "x  seam step " << seamStep / reference << "\n";
+    }
+    std::cout << "total: serial " << std::fixed << std::setprecision(1) << serialTotal << " ms, segmented "
+              << segmentedTotal << " ms, speedup " << std::setprecision(2)
+              << serialTotal / std::max(0.001, segmentedTotal) << "x\n";
+    return 0;
+}
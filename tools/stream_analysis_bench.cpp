@@ -0,0 +1,383 @@
+// WASAPI silence and format checks: the StreamAnalysis kernels the hook uses now against the scalar code they
+// replaced, copied here from WasapiHook.cpp as it was before StreamAnalysis (only StreamContext is replaced by
+// plain arguments). --buffer-ms buffers of a voice-like signal in each sample format, three contents:
+//   silent: noise below every silence floor (±3 LSB at 16 bits);
+//   voice:  harmonics under a 4 Hz syllable envelope;
+//   onset:  the voice buffer with its first 10 ms zeroed, so the first 256 samples are silent.
+// Silence check, ns per buffer and buffers called silent:
+//   old 256:   the old isBufferSilent (first 256 samples, early exit on the first loud one);
+//   old whole: the same scalar loop over the whole buffer, the coverage the hook has now;
+//   span:      isSpanSilent() (reachesLevel: SSE2 compares over the whole buffer, stopping at the first
+//              64-sample block over the floor).
+// Format guess on a guessed stream, ns per buffer and buffers decided correctly (wrong, undecided):
+//   old:   maybeAdjustGuessedFormat (the first 512 bytes, float32 or looksLikePcm16, never PCM32);
+//   guess: guessSampleFormat() over frames x channels x 2 bytes.
+//
+//   krkr_stream_analysis_bench [--seconds 10] [--rate 48000] [--channels 2] [--buffer-ms 20] [--runs 5]
+
+#include "common/AudioStages.h"
+#include "common/StreamAnalysis.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct Options {
+    double seconds = 10.0;
+    std::uint32_t rate = 48000;
+    std::uint32_t channels = 2;
+    std::uint32_t bufferMs = 20;
+    std::size_t runs = 5;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (arg == "--rate" && value(v)) {
+            opts.rate = static_cast<std::uint32_t>(std::max(8000, std::stoi(v)));
+        } else if (arg == "--channels" && value(v)) {
+            opts.channels = static_cast<std::uint32_t>(std::clamp(std::stoi(v), 1, 8));
+        } else if (arg == "--buffer-ms" && value(v)) {
+            opts.bufferMs = static_cast<std::uint32_t>(std::max(11, std::stoi(v)));
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---- The old scalar checks, as WasapiHook.cpp had them ----
+
+bool oldLooksLikePcm16(const std::uint8_t *buffer, std::size_t bytes) {
+    if (!buffer || bytes < sizeof(std::int16_t) * 8) {
+        return false;
+    }
+    const std::size_t count = bytes / sizeof(std::int16_t);
+    const auto *samples = reinterpret_cast<const std::int16_t *>(buffer);
+    std::size_t smooth = 0;
+    std::int64_t sumAbs = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        const std::int32_t cur = samples[i];
+        const std::int32_t prev = samples[i - 1];
+        sumAbs += std::abs(cur);
+        if (std::abs(cur - prev) < 2000) {
+            smooth++;
+        }
+    }
+    const double avgAbs = static_cast<double>(sumAbs) / static_cast<double>(count);
+    const double smoothPct = (count > 1) ? (static_cast<double>(smooth) * 100.0 / static_cast<double>(count - 1)) : 0.0;
+    return (avgAbs > 100.0 && smoothPct > 12.0);
+}
+
+// `maxSamples` was fixed at 256; the whole-buffer variant passes SIZE_MAX.
+bool oldIsBufferSilent(SampleFormat format, std::uint32_t channels, const std::uint8_t *buffer, std::uint32_t frames,
+                       std::size_t sampleCap) {
+    if (!buffer || frames == 0 || channels == 0) {
+        return true;
+    }
+    const std::size_t maxSamples = std::min<std::size_t>(static_cast<std::size_t>(frames) * channels, sampleCap);
+    if (maxSamples == 0) {
+        return true;
+    }
+    if (format == SampleFormat::Float32) {
+        const float *samples = reinterpret_cast<const float *>(buffer);
+        float maxAbs = 0.0f;
+        for (std::size_t i = 0; i < maxSamples; ++i) {
+            const float v = samples[i];
+            if (!std::isfinite(v)) {
+                return false;
+            }
+            const float av = std::fabs(v);
+            if (av > maxAbs) {
+                maxAbs = av;
+                if (maxAbs >= 1e-4f) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    if (format == SampleFormat::Pcm32) {
+        const std::int32_t *samples = reinterpret_cast<const std::int32_t *>(buffer);
+        std::int32_t maxAbs = 0;
+        for (std::size_t i = 0; i < maxSamples; ++i) {
+            const std::int32_t v = samples[i];
+            const std::int32_t av = (v == std::numeric_limits<std::int32_t>::min())
+                ? std::numeric_limits<std::int32_t>::max()
+                : std::abs(v);
+            if (av > maxAbs) {
+                maxAbs = av;
+                if (maxAbs >= (32 << 16)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    const std::int16_t *samples = reinterpret_cast<const std::int16_t *>(buffer);
+    std::int16_t maxAbs = 0;
+    for (std::size_t i = 0; i < maxSamples; ++i) {
+        const std::int16_t v = samples[i];
+        const std::int16_t av = (v == std::numeric_limits<std::int16_t>::min())
+            ? std::numeric_limits<std::int16_t>::max()
+            : static_cast<std::int16_t>(std::abs(v));
+        if (av > maxAbs) {
+            maxAbs = av;
+            if (maxAbs >= 8) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns false while undecided; the old code could only settle on float32 or PCM16.
+bool oldGuessFormat(const std::uint8_t *buffer, std::uint32_t frames, std::uint32_t channels, SampleFormat &format) {
+    if (!buffer || frames == 0) {
+        return false;
+    }
+    const std::size_t maxBytes = std::min<std::size_t>(512, static_cast<std::size_t>(frames) * channels * 4);
+    if (maxBytes < 8) {
+        return false;
+    }
+    const std::size_t wordBytes = maxBytes & ~static_cast<std::size_t>(3);
+    const std::size_t wordCount = wordBytes / sizeof(std::uint32_t);
+    if (wordCount == 0) {
+        return false;
+    }
+    const std::uint32_t *words = reinterpret_cast<const std::uint32_t *>(buffer);
+    std::size_t normalCount = 0;
+    std::size_t denormCount = 0;
+    std::size_t nanInfCount = 0;
+    std::size_t finiteCount = 0;
+    std::size_t within2Count = 0;
+    double maxAbs = 0.0;
+    double sumAbs = 0.0;
+    for (std::size_t i = 0; i < wordCount; ++i) {
+        const std::uint32_t u = words[i];
+        const std::uint32_t exp = (u >> 23) & 0xFFu;
+        if (exp == 0) {
+            denormCount++;
+        } else if (exp == 0xFFu) {
+            nanInfCount++;
+        } else {
+            normalCount++;
+        }
+        float v;
+        std::memcpy(&v, &u, sizeof(v));
+        if (std::isfinite(v)) {
+            const double av = std::fabs(static_cast<double>(v));
+            sumAbs += av;
+            finiteCount++;
+            if (av <= 2.0) {
+                within2Count++;
+            }
+            if (av > maxAbs) {
+                maxAbs = av;
+            }
+        }
+    }
+    const std::size_t total = normalCount + denormCount + nanInfCount;
+    if (total == 0 || finiteCount == 0) {
+        return false;
+    }
+    const double avgAbs = sumAbs / static_cast<double>(finiteCount);
+    const double within2Pct = static_cast<double>(within2Count) * 100.0 / static_cast<double>(finiteCount);
+    if (avgAbs < 1e-5 && maxAbs < 1e-4) {
+        return false;
+    }
+    if (within2Pct >= 90.0 && nanInfCount * 100 < total * 1 && maxAbs <= 2.5) {
+        format = SampleFormat::Float32;
+        return true;
+    }
+    if (maxAbs > 8.0 || nanInfCount * 100 >= total * 5) {
+        if (oldLooksLikePcm16(buffer, wordBytes)) {
+            format = SampleFormat::Pcm16;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---- Signals ----
+
+enum class Content { Silent, Voice, Onset };
+
+const char *contentName(Content content) {
+    switch (content) {
+    case Content::Silent: return "silent";
+    case Content::Voice: return "voice";
+    default: return "onset";
+    }
+}
+
+// Full-scale-normalized interleaved samples, one buffer after another.
+std::vector<double> render(const Options &opts, Content content, std::size_t bufferFrames) {
+    const std::size_t frames = static_cast<std::size_t>(opts.seconds * opts.rate) / bufferFrames * bufferFrames;
+    const std::size_t onsetFrames = opts.rate / 100;
+    std::vector<double> out(frames * opts.channels);
+    std::mt19937 rng(31);
+    std::uniform_int_distribution<int> lsb(-3, 3);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const double t = static_cast<double>(f) / opts.rate;
+        double v = 0.0;
+        if (content == Content::Silent || (content == Content::Onset && f % bufferFrames < onsetFrames)) {
+            v = lsb(rng) / 32768.0;
+        } else {
+            const double env = 0.55 - 0.45 * std::cos(2.0 * kPi * 4.0 * t);
+            for (int h = 1; h <= 5; ++h) v += std::sin(2.0 * kPi * 150.0 * h * t) / h;
+            v *= 0.25 * env / 2.3;
+        }
+        for (std::uint32_t c = 0; c < opts.channels; ++c) out[f * opts.channels + c] = v;
+    }
+    return out;
+}
+
+// The samples stored as `format`; PCM32 carries the low 16 bits a real 32-bit source has.
+std::vector<std::uint8_t> encode(const std::vector<double> &x, SampleFormat format) {
+    std::vector<std::uint8_t> bytes(x.size() * sampleBytes(format));
+    std::mt19937 rng(7);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        const double v = std::clamp(x[i], -1.0, 32767.0 / 32768.0);
+        if (format == SampleFormat::Pcm16) {
+            const auto s = static_cast<std::int16_t>(std::lround(v * 32768.0));
+            std::memcpy(bytes.data() + i * 2, &s, 2);
+        } else if (format == SampleFormat::Pcm32) {
+            const auto s = static_cast<std::int32_t>(std::lround(v * 2147483648.0 - 32768.0)) +
+                           static_cast<std::int32_t>(rng() & 0xFFFF);
+            std::memcpy(bytes.data() + i * 4, &s, 4);
+        } else {
+            const auto s = static_cast<float>(v);
+            std::memcpy(bytes.data() + i * 4, &s, 4);
+        }
+    }
+    return bytes;
+}
+
+struct Timed {
+    double ns = 0.0;          // best of runs, per buffer
+    std::size_t hits = 0;     // buffers called silent / guessed correctly
+    std::size_t wrong = 0;    // format guess: decided on the wrong format
+    std::size_t buffers = 0;
+};
+
+// `check(buffer) -> int`: 1 hit, -1 wrong, 0 neither.
+template <typename Check>
+Timed timeBuffers(const Options &opts, const std::vector<std::uint8_t> &data, std::size_t bufferBytes, Check check) {
+    Timed result;
+    result.buffers = data.size() / bufferBytes;
+    result.ns = 1e300;
+    for (std::size_t run = 0; run < opts.runs; ++run) {
+        std::size_t hits = 0;
+        std::size_t wrong = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t b = 0; b < result.buffers; ++b) {
+            const int r = check(data.data() + b * bufferBytes);
+            hits += r > 0;
+            wrong += r < 0;
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        result.ns = std::min(result.ns, ns / static_cast<double>(std::max<std::size_t>(1, result.buffers)));
+        result.hits = hits;
+        result.wrong = wrong;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_stream_analysis_bench [--seconds s] [--rate hz] [--channels n] [--buffer-ms ms]\n"
+                     "                                  [--runs n]\n";
+        return 2;
+    }
+    const std::uint32_t frames = opts.rate * opts.bufferMs / 1000;
+    std::cout << opts.rate << " Hz x" << opts.channels << ", " << opts.bufferMs << " ms buffers (" << frames
+              << " frames), " << opts.seconds << " s per content, best of " << opts.runs << "\n";
+
+    const Content contents[] = {Content::Silent, Content::Voice, Content::Onset};
+    const SampleFormat formats[] = {SampleFormat::Pcm16, SampleFormat::Pcm32, SampleFormat::Float32};
+    std::vector<std::vector<double>> signals;
+    for (const Content content : contents) signals.push_back(render(opts, content, frames));
+
+    std::cout << "silence check           old 256           old whole            span\n";
+    std::cout << std::fixed;
+    for (const SampleFormat format : formats) {
+        StreamFormat fmt;
+        fmt.sample = format;
+        fmt.channels = opts.channels;
+        fmt.sampleRate = opts.rate;
+        const std::size_t bufferBytes = frames * fmt.frameBytes();
+        for (std::size_t c = 0; c < std::size(contents); ++c) {
+            const auto data = encode(signals[c], format);
+            const Timed old256 = timeBuffers(opts, data, bufferBytes, [&](const std::uint8_t *b) {
+                return oldIsBufferSilent(format, opts.channels, b, frames, 256) ? 1 : 0;
+            });
+            const Timed oldWhole = timeBuffers(opts, data, bufferBytes, [&](const std::uint8_t *b) {
+                return oldIsBufferSilent(format, opts.channels, b, frames, SIZE_MAX) ? 1 : 0;
+            });
+            const Timed span = timeBuffers(opts, data, bufferBytes, [&](const std::uint8_t *b) {
+                return isSpanSilent(AudioSpan{const_cast<std::uint8_t *>(b), frames, fmt}) ? 1 : 0;
+            });
+            std::cout << std::left << std::setw(8) << sampleFormatName(format) << std::setw(7)
+                      << contentName(contents[c]) << std::right;
+            for (const Timed *t : {&old256, &oldWhole, &span}) {
+                std::cout << std::setprecision(0) << std::setw(9) << t->ns << " ns " << std::setw(3)
+                          << t->hits * 100 / std::max<std::size_t>(1, t->buffers) << "% ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    std::cout << "format guess (voice)        old                      guess\n";
+    for (const SampleFormat format : formats) {
+        const auto data = encode(signals[1], format);
+        const std::size_t bufferBytes = static_cast<std::size_t>(frames) * opts.channels * sampleBytes(format);
+        auto score = [format](bool decided, SampleFormat guessed) { return !decided ? 0 : guessed == format ? 1 : -1; };
+        const Timed old = timeBuffers(opts, data, bufferBytes, [&](const std::uint8_t *b) {
+            SampleFormat guessed = SampleFormat::Float32;
+            const bool decided = oldGuessFormat(b, frames, opts.channels, guessed);
+            return score(decided, guessed);
+        });
+        const Timed guess = timeBuffers(opts, data, bufferBytes, [&](const std::uint8_t *b) {
+            SampleFormat guessed = SampleFormat::Float32;
+            const std::size_t bytes = static_cast<std::size_t>(frames) * opts.channels * sizeof(std::int16_t);
+            const bool decided = guessSampleFormat(b, bytes, opts.channels, guessed);
+            return score(decided, guessed);
+        });
+        std::cout << std::left << std::setw(15) << sampleFormatName(format) << std::right;
+        for (const Timed *t : {&old, &guess}) {
+            const std::size_t n = std::max<std::size_t>(1, t->buffers);
+            std::cout << std::setprecision(0) << std::setw(8) << t->ns << " ns " << std::setw(3) << t->hits * 100 / n
+                      << "% ok " << std::setw(3) << t->wrong * 100 / n << "% wrong  ";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
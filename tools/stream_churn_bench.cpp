@@ -0,0 +1,264 @@
+// DirectSound stream churn benchmark: replays the buffer pattern of a KiriKiri title (a steady trickle of
+// CreateSoundBuffer calls, most of them BGM or one-shot SE buffers that never reach the DSP, a share of voice
+// lines processed in 100 ms Unlocks) against two stream lifecycles:
+//   eager: every buffer owns a DSP pipeline from creation until the game releases it (the pre-lazy behaviour);
+//   lazy:  DSP state is acquired on the first processed Unlock, released to DspPipelinePool after the idle
+//          timeout, and streams plus parked pipelines are trimmed to the global cap as the hook does.
+// Time is simulated, so the run is bound only by DSP cost. The report gives peak and final DSP/carry bytes
+// (the figure the hook's cap is enforced on) and the process RSS; run one --mode per process for clean RSS.
+//
+//   krkr_stream_churn_bench [--minutes 20] [--buffers-per-sec 4] [--voice-share 0.25] [--lifetime-sec 120]
+//                           [--cap-mb 24] [--rate 44100] [--channels 2] [--speed 1.5] [--mode both|eager|lazy]
+//                           [--seed 1]
+
+#include "common/AudioStreamProcessor.h"
+#include "common/DspPipeline.h"
+#include "common/DspPipelinePool.h"
+#include "common/VoiceRenderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace krkrspeed;
+
+namespace {
+
+// Mirrors the DirectSound hook's trim policy (DirectSoundHook.cpp).
+constexpr double kTickSec = 0.1;
+constexpr double kIdleReleaseSec = 5.0;
+constexpr double kTrimIntervalSec = 0.5;
+constexpr double kVoiceLineSec = 3.0;
+
+struct Options {
+    double minutes = 20.0;
+    double buffersPerSec = 4.0;
+    double voiceShare = 0.25;
+    double lifetimeSec = 120.0;
+    std::size_t capMb = 24;
+    std::uint32_t rate = 44100;
+    std::uint32_t channels = 2;
+    float speed = 1.5f;
+    std::string mode = "both";
+    std::uint32_t seed = 1;
+};
+
+struct Buffer {
+    std::unique_ptr<AudioStreamProcessor> stream;
+    std::unique_ptr<DspPipeline> eagerDsp;
+    double created = 0.0;
+    double lastUse = 0.0;
+    double voiceLeft = 0.0; // seconds of voice still to be unlocked; 0 for BGM/SE buffers
+};
+
+struct RunResult {
+    std::size_t peakBytes = 0;
+    std::size_t finalBytes = 0;
+    std::size_t peakLive = 0;
+    std::size_t rssBefore = 0;
+    std::size_t rssAfter = 0;
+    double ms = 0.0;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--minutes" && value(v)) {
+            opts.minutes = std::max(0.1, std::stod(v));
+        } else if (arg == "--buffers-per-sec" && value(v)) {
+            opts.buffersPerSec = std::max(0.1, std::stod(v));
+        } else if (arg == "--voice-share" && value(v)) {
+            opts.voiceShare = std::clamp(std::stod(v), 0.0, 1.0);
+        } else if (arg == "--lifetime-sec" && value(v)) {
+            opts.lifetimeSec = std::max(1.0, std::stod(v));
+        } else if (arg == "--cap-mb" && value(v)) {
+            opts.capMb = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--rate" && value(v)) {
+            opts.rate = static_cast<std::uint32_t>(std::max(8000, std::stoi(v)));
+        } else if (arg == "--channels" && value(v)) {
+            opts.channels = static_cast<std::uint32_t>(std::clamp(std::stoi(v), 1, 8));
+        } else if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--mode" && value(v)) {
+            opts.mode = v;
+        } else if (arg == "--seed" && value(v)) {
+            opts.seed = static_cast<std::uint32_t>(std::stoul(v));
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f && (opts.mode == "both" || opts.mode == "eager" || opts.mode == "lazy");
+}
+
+std::size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int read = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    return read == 2 ? static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// 100 ms of a harmonic voice-like tone, reused for every Unlock.
+std::vector<std::int16_t> voiceChunk(const Options &opts) {
+    const std::size_t frames = static_cast<std::size_t>(opts.rate * kTickSec);
+    std::vector<std::int16_t> pcm(frames * opts.channels);
+    for (std::size_t f = 0; f < frames; ++f) {
+        double v = 0.0;
+        for (int h = 1; h <= 5; ++h) v += std::sin(2.0 * 3.14159265358979 * 160.0 * h * f / opts.rate) / h;
+        const auto s = static_cast<std::int16_t>(std::lround(0.2 * 32767.0 * v / 2.3));
+        for (std::uint32_t c = 0; c < opts.channels; ++c) pcm[f * opts.channels + c] = s;
+    }
+    return pcm;
+}
+
+RunResult run(const Options &opts, bool lazy) {
+    RunResult result;
+    result.rssBefore = residentBytes();
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint32_t blockAlign = opts.channels * sizeof(std::int16_t);
+    const std::size_t cap = opts.capMb * 1024u * 1024u;
+    const auto chunk = voiceChunk(opts);
+    const auto *chunkBytes = reinterpret_cast<const std::uint8_t *>(chunk.data());
+    const std::size_t chunkSize = chunk.size() * sizeof(std::int16_t);
+    auto &pool = DspPipelinePool::instance();
+
+    std::mt19937 rng(opts.seed);
+    std::poisson_distribution<int> arrivals(opts.buffersPerSec * kTickSec);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<Buffer> buffers;
+    double lastTrim = 0.0;
+    const std::size_t ticks = static_cast<std::size_t>(opts.minutes * 60.0 / kTickSec);
+    for (std::size_t tick = 0; tick < ticks; ++tick) {
+        const double now = tick * kTickSec;
+        // The game releases buffers it no longer needs.
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                     [&](const Buffer &b) { return now - b.created > opts.lifetimeSec; }),
+                      buffers.end());
+        for (int n = arrivals(rng); n > 0; --n) {
+            Buffer b;
+            b.stream = std::make_unique<AudioStreamProcessor>(opts.rate, opts.channels, blockAlign, DspConfig{});
+            b.created = b.lastUse = now;
+            b.voiceLeft = unit(rng) < opts.voiceShare ? kVoiceLineSec : 0.0;
+            if (!lazy && b.voiceLeft == 0.0) {
+                // Voice streams get theirs on the first Unlock below and keep it; the rest hold one unused.
+                b.eagerDsp = std::make_unique<DspPipeline>(opts.rate, opts.channels, DspConfig{});
+            }
+            buffers.push_back(std::move(b));
+        }
+        std::size_t live = 0;
+        for (std::size_t i = 0; i < buffers.size(); ++i) {
+            auto &b = buffers[i];
+            if (b.voiceLeft > 0.0) {
+                b.stream->process(chunkBytes, chunkSize, opts.speed, false, i + 1);
+                b.voiceLeft -= kTickSec;
+                b.lastUse = now;
+                live++;
+            }
+        }
+        result.peakLive = std::max(result.peakLive, live);
+
+        std::size_t bytes = 0;
+        if (lazy && now - lastTrim >= kTrimIntervalSec) {
+            lastTrim = now;
+            std::vector<std::pair<double, AudioStreamProcessor *>> lru;
+            for (auto &b : buffers) {
+                if (!b.stream->hasDsp()) continue;
+                if (now - b.lastUse > kIdleReleaseSec) {
+                    b.stream->releaseDsp();
+                    continue;
+                }
+                bytes += b.stream->memoryFootprint();
+                lru.emplace_back(b.lastUse, b.stream.get());
+            }
+            std::sort(lru.begin(), lru.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+            for (auto &entry : lru) {
+                if (bytes <= cap) break;
+                bytes -= std::min(bytes, entry.second->memoryFootprint());
+                entry.second->releaseDsp();
+            }
+            pool.trim(cap - std::min(bytes, cap));
+        }
+        bytes = 0;
+        for (const auto &b : buffers) {
+            bytes += b.stream->memoryFootprint();
+            if (b.eagerDsp) bytes += b.eagerDsp->memoryFootprint();
+        }
+        if (lazy) bytes += pool.idleFootprint();
+        result.peakBytes = std::max(result.peakBytes, bytes);
+        result.finalBytes = bytes;
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.rssAfter = residentBytes();
+    return result;
+}
+
+void report(const char *name, const RunResult &r) {
+    std::cout << std::left << std::setw(6) << name << std::right << std::fixed << std::setprecision(1)
+              << "  peak " << std::setw(8) << r.peakBytes / 1048576.0 << " MB"
+              << "  final " << std::setw(8) << r.finalBytes / 1048576.0 << " MB"
+              << "  rss " << std::setw(7) << r.rssBefore / 1048576.0 << " -> " << std::setw(7)
+              << r.rssAfter / 1048576.0 << " MB"
+              << "  (" << std::setprecision(0) << r.ms << " ms, " << r.peakLive << " voices at once)\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_stream_churn_bench [--minutes m] [--buffers-per-sec n] [--voice-share f]\n"
+                     "                               [--lifetime-sec s] [--cap-mb MB] [--rate hz] [--channels n]\n"
+                     "                               [--speed x] [--mode both|eager|lazy] [--seed n]\n";
+        return 2;
+    }
+    VoiceRenderCache::instance().setBudget(0); // every voice Unlock must reach the DSP
+    std::cout << opts.minutes << " min, " << opts.buffersPerSec << " buffers/s, voice share " << opts.voiceShare
+              << ", lifetime " << opts.lifetimeSec << " s, " << opts.rate << " Hz x" << opts.channels << "\n";
+    RunResult eager;
+    RunResult lazy;
+    if (opts.mode != "lazy") {
+        eager = run(opts, false);
+        report("eager", eager);
+    }
+    if (opts.mode != "eager") {
+        lazy = run(opts, true);
+        report("lazy", lazy);
+    }
+    if (opts.mode == "both" && eager.peakBytes > 0) {
+        const double saved = static_cast<double>(eager.peakBytes) - static_cast<double>(lazy.peakBytes);
+        std::cout << "saved " << std::fixed << std::setprecision(1) << saved / 1048576.0 << " MB at peak ("
+                  << 100.0 * saved / eager.peakBytes << "%)\n";
+    }
+    return 0;
+}
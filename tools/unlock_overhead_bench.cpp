@@ -0,0 +1,176 @@
+// DirectSound Unlock hook overhead with processing switched off (speed 1.0), per call, against calling the
+// original Unlock directly. Each thread plays the Unlocks of its own buffer, as a game's mixer and streaming
+// threads do; the hook's disengaged path is reproduced line for line:
+//   settled:   engagement load, then FrequencyRestore::needsLock() on a restore that has ended;
+//   open:      after a disengage while --pending buffers (silent ones) still wait for their restore, checked
+//              lock-free by buffers that are not listed;
+//   locked:    the same state before FrequencyRestore (for up to 2 s): every Unlock took the hook mutex, looked
+//              its buffer up and scanned all --buffers tracked buffers for one still retuned.
+//
+//   krkr_unlock_overhead_bench [--calls 5000000] [--threads 1] [--buffers 64] [--pending 3] [--runs 3]
+
+#include "common/FrequencyPolicy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace krkrspeed;
+
+namespace {
+
+struct Options {
+    std::size_t calls = 5000000;
+    std::size_t threads = 1;
+    std::size_t buffers = 64;
+    std::size_t pending = 3;
+    std::size_t runs = 3;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--calls" && value(v)) {
+            opts.calls = static_cast<std::size_t>(std::max(1000LL, std::stoll(v)));
+        } else if (arg == "--threads" && value(v)) {
+            opts.threads = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--buffers" && value(v)) {
+            opts.buffers = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--pending" && value(v)) {
+            opts.pending = static_cast<std::size_t>(std::max(0, std::stoi(v)));
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else {
+            return false;
+        }
+    }
+    return opts.pending < opts.buffers && opts.threads + opts.pending <= opts.buffers;
+}
+
+// The original IDirectSoundBuffer::Unlock, reached through a pointer as the hook reaches it.
+std::atomic<std::uint64_t> g_unlocks{0};
+using UnlockFn = long (*)(std::uintptr_t);
+long originalUnlock(std::uintptr_t) {
+    g_unlocks.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+UnlockFn volatile g_origUnlock = &originalUnlock;
+
+// SharedSettingsManager's engagement word: even while processing is off.
+std::atomic<std::uint32_t> g_engagement{2};
+bool isEngaged(std::uint32_t engagement) { return (engagement & 1u) != 0; }
+
+// Tracked buffers as the hook keeps them; only retuned() matters on this path.
+struct Tracked {
+    std::mutex mutex;
+    std::unordered_map<std::uintptr_t, FrequencyPolicy> buffers;
+    std::atomic<std::uint32_t> restoredEngagement{0};
+};
+
+// Best of `runs`: ns per Unlock, averaged over threads that each make `calls` Unlocks on their own buffer key.
+template <typename Unlock> double timeUnlocks(const Options &opts, Unlock unlock) {
+    double best = 1e300;
+    for (std::size_t run = 0; run < opts.runs; ++run) {
+        std::atomic<std::size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<double> ns(opts.threads);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < opts.threads; ++t) {
+            threads.emplace_back([&, t]() {
+                const auto key = static_cast<std::uintptr_t>(opts.pending + t + 1);
+                ++ready;
+                while (!go.load()) std::this_thread::yield();
+                const auto start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < opts.calls; ++i) unlock(key);
+                ns[t] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            });
+        }
+        while (ready.load() < opts.threads) std::this_thread::yield();
+        go = true;
+        for (auto &thread : threads) thread.join();
+        double sum = 0.0;
+        for (const double v : ns) sum += v;
+        best = std::min(best, sum / static_cast<double>(opts.threads * opts.calls));
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_unlock_overhead_bench [--calls n] [--threads n] [--buffers n] [--pending n] "
+                     "[--runs n]\n";
+        return 2;
+    }
+    // Buffers 1..pending are still retuned (silent, so never restored during the run); the threads play others.
+    Tracked tracked;
+    std::vector<std::uintptr_t> retuned;
+    for (std::uintptr_t key = 1; key <= opts.buffers; ++key) {
+        FrequencyPolicy policy(44100, true);
+        if (key <= opts.pending) {
+            policy.onApplied(1.5f, true);
+            retuned.push_back(key);
+        }
+        tracked.buffers.emplace(key, policy);
+    }
+    FrequencyRestore settled;
+    settled.begin(2, {});
+    settled.settle(2);
+    FrequencyRestore open;
+    open.begin(2, retuned);
+
+    const double direct = timeUnlocks(opts, [](std::uintptr_t key) { g_origUnlock(key); });
+    const double settledNs = timeUnlocks(opts, [&settled](std::uintptr_t key) {
+        const std::uint32_t engagement = g_engagement.load(std::memory_order_relaxed);
+        if (!isEngaged(engagement) && settled.needsLock(engagement, key)) std::abort();
+        g_origUnlock(key);
+    });
+    const double openNs = timeUnlocks(opts, [&open](std::uintptr_t key) {
+        const std::uint32_t engagement = g_engagement.load(std::memory_order_relaxed);
+        if (!isEngaged(engagement) && open.needsLock(engagement, key)) std::abort();
+        g_origUnlock(key);
+    });
+    const double lockedNs = timeUnlocks(opts, [&tracked](std::uintptr_t key) {
+        const std::uint32_t engagement = g_engagement.load(std::memory_order_relaxed);
+        if (!isEngaged(engagement) && engagement != tracked.restoredEngagement.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(tracked.mutex);
+            auto it = tracked.buffers.find(key);
+            if (it != tracked.buffers.end() && it->second.retuned()) std::abort();
+            const bool pending = std::any_of(tracked.buffers.begin(), tracked.buffers.end(),
+                                             [](const auto &entry) { return entry.second.retuned(); });
+            if (!pending) tracked.restoredEngagement.store(engagement, std::memory_order_relaxed);
+        }
+        g_origUnlock(key);
+    });
+
+    std::cout << opts.threads << " thread(s), " << opts.buffers << " tracked buffers, " << opts.pending
+              << " pending restore, " << opts.calls << " Unlocks per thread, best of " << opts.runs << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "path                          ns/Unlock   hook overhead\n";
+    auto row = [&](const char *name, double ns) {
+        std::cout << std::left << std::setw(30) << name << std::right << std::setw(9) << ns << "   "
+                  << std::setw(9) << ns - direct << " ns\n";
+    };
+    row("original Unlock", direct);
+    row("settled (speed 1.0)", settledNs);
+    row("restore open, not listed", openNs);
+    row("restore open, locked scan", lockedNs);
+    return 0;
+}
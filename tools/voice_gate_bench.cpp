@@ -0,0 +1,187 @@
+// Voice gate benchmark: renders clips in tempo mode the way the WASAPI hook feeds them (20 ms callbacks, then
+// finish) with DspConfig::voiceGate off and on, and reports for each the DSP time per second of input, the
+// output length against input/tempo, and the share of input frames that skipped SoundTouch. The gate only
+// pays off on speech with pauses; the quiet-music row shows what it would cost a mix it should not run on.
+//
+//   krkr_voice_gate_bench [--speed 1.5] [--runs 3] [--seconds 30] [wav file or directory]...
+//
+// Without inputs, synthetic dialogue at three pause densities and a -53 dBFS music bed are used.
+
+#include "common/DspPipeline.h"
+#include "common/StreamAnalysis.h"
+#include "WavCorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::uint32_t kRate = 44100;
+constexpr double kPi = 3.14159265358979323846;
+
+struct Options {
+    float speed = 1.5f;
+    std::size_t runs = 3;
+    double seconds = 30.0;
+    std::vector<fs::path> inputs;
+};
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--speed" && value(v)) {
+            opts.speed = std::stof(v);
+        } else if (arg == "--runs" && value(v)) {
+            opts.runs = static_cast<std::size_t>(std::max(1, std::stoi(v)));
+        } else if (arg == "--seconds" && value(v)) {
+            opts.seconds = std::max(1.0, std::stod(v));
+        } else if (!arg.empty() && arg[0] != '-') {
+            opts.inputs.emplace_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return opts.speed > 0.0f;
+}
+
+// Harmonic phrases with a syllable envelope separated by digital silence; `voicedShare` of the time is speech.
+WavClip dialogueClip(double seconds, double voicedShare) {
+    WavClip clip;
+    clip.name = "dialogue " + std::to_string(static_cast<int>(voicedShare * 100.0)) + "% voiced";
+    clip.sampleRate = kRate;
+    clip.channels = 2;
+    const std::size_t frames = static_cast<std::size_t>(seconds * kRate);
+    clip.samples.assign(frames * 2, 0);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> pitch(110.0, 240.0);
+    const std::size_t phrase = kRate * 6 / 5;
+    const std::size_t pause = static_cast<std::size_t>(phrase * (1.0 - voicedShare) / voicedShare);
+    for (std::size_t f = 0; f < frames; f += phrase + pause) {
+        const double f0 = pitch(rng);
+        for (std::size_t i = 0; i < std::min(phrase, frames - f); ++i) {
+            const double t = static_cast<double>(i) / kRate;
+            double v = 0.0;
+            for (int h = 1; h <= 6; ++h) v += std::sin(2.0 * kPi * f0 * h * t) / h;
+            const auto s = static_cast<std::int16_t>(std::lround(8000.0 * (0.5 - 0.5 * std::cos(8.0 * kPi * t)) * v / 2.45));
+            clip.samples[(f + i) * 2] = s;
+            clip.samples[(f + i) * 2 + 1] = s;
+        }
+    }
+    return clip;
+}
+
+// A soft pad (three detuned partials) under the VAD threshold: the case the gate must not be enabled for.
+WavClip quietMusicClip(double seconds) {
+    WavClip clip;
+    clip.name = "music bed -53 dBFS";
+    clip.sampleRate = kRate;
+    clip.channels = 2;
+    const std::size_t frames = static_cast<std::size_t>(seconds * kRate);
+    clip.samples.resize(frames * 2);
+    for (std::size_t f = 0; f < frames; ++f) {
+        const double t = static_cast<double>(f) / kRate;
+        const double v = std::sin(2.0 * kPi * 220.0 * t) + std::sin(2.0 * kPi * 277.2 * t) + std::sin(2.0 * kPi * 329.6 * t);
+        const auto s = static_cast<std::int16_t>(std::lround(60.0 * v));
+        clip.samples[f * 2] = s;
+        clip.samples[f * 2 + 1] = s;
+    }
+    return clip;
+}
+
+struct Result {
+    double ms = 1e300;
+    std::size_t outFrames = 0;
+};
+
+Result render(const WavClip &clip, float speed, bool gate, std::size_t runs) {
+    DspConfig cfg;
+    cfg.voiceGate = gate;
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+    const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+    const std::size_t buffer = clip.sampleRate / 50 * clip.channels * sizeof(std::int16_t);
+    Result result;
+    for (std::size_t run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        DspPipeline dsp(clip.sampleRate, clip.channels, cfg);
+        std::size_t outBytes = 0;
+        for (std::size_t pos = 0; pos < total; pos += buffer) {
+            outBytes += dsp.process(bytes + pos, std::min(buffer, total - pos), speed, DspMode::Tempo).size();
+        }
+        outBytes += dsp.finish().size();
+        result.ms = std::min(result.ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        result.outFrames = outBytes / (clip.channels * sizeof(std::int16_t));
+    }
+    return result;
+}
+
+// Fraction of frames in blocks the gate treats as silent (same 10 ms blocks and 200 ms hangover as DspPipeline).
+double gatedShare(const WavClip &clip) {
+    const std::size_t block = clip.sampleRate / 100;
+    const std::size_t frames = clip.samples.size() / clip.channels;
+    std::size_t quiet = 0;
+    std::size_t skipped = 0;
+    for (std::size_t start = 0; start < frames; start += block) {
+        const std::size_t len = std::min(block, frames - start);
+        if (isVoiceActive(analyzePcm16(clip.samples.data() + start * clip.channels, len * clip.channels, clip.channels))) {
+            quiet = 0;
+        } else if (quiet < 20) {
+            ++quiet;
+        }
+        if (quiet >= 20) skipped += len;
+    }
+    return frames ? static_cast<double>(skipped) / frames : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_voice_gate_bench [--speed x] [--runs n] [--seconds s] [wav|dir]...\n";
+        return 2;
+    }
+    std::vector<WavClip> corpus;
+    if (opts.inputs.empty()) {
+        for (const double share : {0.5, 0.7, 0.9}) corpus.push_back(dialogueClip(opts.seconds, share));
+        corpus.push_back(quietMusicClip(opts.seconds));
+    } else {
+        corpus = loadWavCorpus<WavClip>(opts.inputs);
+    }
+    if (corpus.empty()) {
+        std::cerr << "no usable clips\n";
+        return 1;
+    }
+    std::cout << "speed " << opts.speed << ", best of " << opts.runs << " runs\n";
+    for (const auto &clip : corpus) {
+        const double seconds = static_cast<double>(clip.samples.size() / clip.channels) / clip.sampleRate;
+        const double expected = static_cast<double>(clip.samples.size() / clip.channels) / opts.speed;
+        const Result off = render(clip, opts.speed, false, opts.runs);
+        const Result on = render(clip, opts.speed, true, opts.runs);
+        std::cout << std::left << std::setw(22) << clip.name.substr(0, 21) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(6) << seconds << " s  skipped " << std::setw(5)
+                  << 100.0 * gatedShare(clip) << "%  off " << std::setprecision(2) << std::setw(7)
+                  << off.ms / seconds << " ms/s (" << std::showpos << 100.0 * (off.outFrames - expected) / expected
+                  << "%)  on " << std::noshowpos << std::setw(7) << on.ms / seconds << " ms/s (" << std::showpos
+                  << 100.0 * (on.outFrames - expected) / expected << std::noshowpos << "%)  saved "
+                  << std::setprecision(0) << 100.0 * (1.0 - on.ms / std::max(0.001, off.ms)) << "%\n";
+    }
+    return 0;
+}
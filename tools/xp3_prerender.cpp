@@ -0,0 +1,301 @@
+// Offline pre-renderer for KiriKiri voice archives: reads XP3 archives, decodes their 16-bit PCM WAV
+// entries and renders each at the requested speeds through AudioStreamProcessor (the pitch path the
+// DirectSound hook runs), in parallel on WorkerPool. The result is a pack of VoiceRender records keyed
+// like VoiceRenderCache (content hash and size of the first buffer, format, speed, DSP config,
+// full quality tier); placed in the controller directory (above the x86/x64 hook folders) as
+// krkr_prerender.pack it lets the hook replay those lines instead of running the DSP.
+//
+// A record only matches when the game hands the hook the same buffer sizes, so --chunk-ms must list the
+// sizes the game uses (0: the whole line in one buffer). Ogg/Opus entries and encrypted archives are
+// counted and skipped.
+//
+//   krkr_xp3_prerender [--speeds 1.5,2] [--preset balanced|low-power|quality] [--chunk-ms 0,250]
+//                      [--out krkr_prerender.pack] <archive.xp3 or directory>...
+
+#include "common/AudioStreamProcessor.h"
+#include "common/PrerenderPack.h"
+#include "common/VoiceRenderCache.h"
+#include "common/WorkerPool.h"
+#include "common/XxHash64.h"
+#include "WavCorpus.h"
+#include "Xp3Archive.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace krkrspeed;
+
+namespace {
+
+constexpr std::size_t kBatchBytes = 256u * 1024 * 1024; // decoded PCM held at once
+
+struct Options {
+    std::vector<float> speeds{1.5f};
+    DspPreset preset = DspPreset::Balanced;
+    std::vector<std::uint32_t> chunkMs{0};
+    fs::path out = "krkr_prerender.pack";
+    std::vector<fs::path> inputs;
+};
+
+struct Job {
+    const WavClip *clip = nullptr;
+    float speed = 1.0f;
+    std::uint32_t chunkMs = 0;
+    VoiceRenderKey key;
+    VoiceRender render;
+    bool fullTier = true;
+};
+
+struct Totals {
+    std::size_t archives = 0;
+    std::size_t entries = 0;
+    std::size_t wav = 0;
+    std::size_t duplicates = 0;
+    std::size_t rendered = 0;
+    std::size_t retried = 0;
+    double audioSeconds = 0.0;
+    std::map<std::string, std::size_t> skipped; // reason -> count
+};
+
+template <typename T, typename Parse> bool parseList(const std::string &text, std::vector<T> &out, Parse parse) {
+    out.clear();
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) out.push_back(parse(item));
+    return !out.empty();
+}
+
+bool parseArgs(int argc, char **argv, Options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string &v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        std::string v;
+        if (arg == "--speeds" && value(v)) {
+            if (!parseList(v, opts.speeds, [](const std::string &s) { return std::stof(s); })) return false;
+        } else if (arg == "--chunk-ms" && value(v)) {
+            if (!parseList(v, opts.chunkMs, [](const std::string &s) {
+                    return static_cast<std::uint32_t>(std::max(0, std::stoi(s)));
+                })) {
+                return false;
+            }
+        } else if (arg == "--preset" && value(v)) {
+            bool known = false;
+            for (const auto preset : {DspPreset::Balanced, DspPreset::LowPower, DspPreset::Quality}) {
+                if (v == dspPresetName(preset)) {
+                    opts.preset = preset;
+                    known = true;
+                }
+            }
+            if (!known) return false;
+        } else if (arg == "--out" && value(v)) {
+            opts.out = v;
+        } else if (!arg.empty() && arg[0] != '-') {
+            opts.inputs.emplace_back(arg);
+        } else {
+            return false;
+        }
+    }
+    const bool speedsOk = std::all_of(opts.speeds.begin(), opts.speeds.end(), [](float s) { return s > 0.0f; });
+    return !opts.inputs.empty() && speedsOk;
+}
+
+std::string lowerExtension(const std::string &name) {
+    const auto dot = name.find_last_of('.');
+    std::string ext = dot == std::string::npos ? std::string() : name.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+std::vector<fs::path> collectArchives(const std::vector<fs::path> &inputs) {
+    std::vector<fs::path> archives;
+    for (const auto &input : inputs) {
+        if (fs::is_directory(input)) {
+            std::vector<fs::path> found;
+            for (const auto &entry : fs::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && lowerExtension(entry.path().filename().string()) == ".xp3") {
+                    found.push_back(entry.path());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            archives.insert(archives.end(), found.begin(), found.end());
+        } else {
+            archives.push_back(input);
+        }
+    }
+    return archives;
+}
+
+// Feeds the line the way the hook sees it (a fresh stream, chunkMs buffers) and records each call as
+// AudioStreamProcessor::recordRender does.
+void renderJob(Job &job, const DspConfig &config) {
+    const WavClip &clip = *job.clip;
+    const std::uint32_t blockAlign = clip.channels * sizeof(std::int16_t);
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(clip.samples.data());
+    const std::size_t total = clip.samples.size() * sizeof(std::int16_t);
+    const std::size_t chunk =
+        job.chunkMs ? std::max<std::size_t>(blockAlign, clip.sampleRate * job.chunkMs / 1000 * blockAlign) : total;
+
+    job.key = VoiceRenderCache::makeKey(bytes, std::min(chunk, total), clip.sampleRate, clip.channels, blockAlign,
+                                        job.speed, config, QualityTier::Full);
+    job.render = VoiceRender{};
+    job.fullTier = true;
+    AudioStreamProcessor stream(clip.sampleRate, clip.channels, blockAlign, config);
+    for (std::size_t pos = 0; pos < total; pos += chunk) {
+        const std::size_t n = std::min(chunk, total - pos);
+        const auto res = stream.process(bytes + pos, n, job.speed, false, 0);
+        if (stream.qualityTier(DspMode::Pitch) != QualityTier::Full) {
+            job.fullTier = false;
+            return;
+        }
+        VoiceRender::Step step;
+        step.inputHash = xxh64(bytes + pos, n);
+        step.inputBytes = static_cast<std::uint32_t>(n);
+        step.outputOffset = static_cast<std::uint32_t>(job.render.output.size());
+        step.outputBytes = static_cast<std::uint32_t>(res.output.size());
+        job.render.steps.push_back(step);
+        job.render.output.insert(job.render.output.end(), res.output.begin(), res.output.end());
+    }
+}
+
+bool renderBatch(std::vector<WavClip> &batch, const Options &opts, const DspConfig &config,
+                 PrerenderPackWriter &writer, Totals &totals, std::string &error) {
+    std::vector<Job> jobs;
+    for (const auto &clip : batch) {
+        for (const float speed : opts.speeds) {
+            for (const std::uint32_t chunkMs : opts.chunkMs) {
+                Job job;
+                job.clip = &clip;
+                job.speed = speed;
+                job.chunkMs = chunkMs;
+                jobs.push_back(std::move(job));
+            }
+        }
+    }
+    WorkerPool::instance().parallelFor(jobs.size(), [&](std::size_t i) { renderJob(jobs[i], config); });
+    for (auto &job : jobs) {
+        // The governor stepped down under load; a serial retry normally stays at full quality.
+        if (!job.fullTier) {
+            ++totals.retried;
+            renderJob(job, config);
+            if (!job.fullTier) {
+                ++totals.skipped["quality tier dropped"];
+                continue;
+            }
+        }
+        if (!writer.add(job.key, job.render, error)) {
+            return false;
+        }
+        ++totals.rendered;
+    }
+    batch.clear();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: krkr_xp3_prerender [--speeds 1.5,2] [--preset balanced|low-power|quality]\n"
+                     "                          [--chunk-ms 0,250] [--out krkr_prerender.pack] <xp3|dir>...\n";
+        return 2;
+    }
+    // Renders must come from the DSP, not from lines this process already rendered.
+    VoiceRenderCache::instance().setBudget(0);
+    const DspConfig config = dspPresetConfig(opts.preset);
+
+    PrerenderPackWriter writer;
+    std::string error;
+    if (!writer.open(opts.out, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    Totals totals;
+    std::unordered_set<std::uint64_t> seen; // PCM content already queued (patch archives repeat voices)
+    std::vector<WavClip> batch;
+    std::size_t batchBytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> data;
+    for (const auto &path : collectArchives(opts.inputs)) {
+        Xp3Archive archive;
+        if (!archive.open(path, error)) {
+            std::cerr << path.string() << ": " << error << "\n";
+            ++totals.skipped["unreadable archive"];
+            continue;
+        }
+        ++totals.archives;
+        for (const auto &entry : archive.entries()) {
+            ++totals.entries;
+            const std::string ext = lowerExtension(entry.name);
+            if (ext == ".ogg" || ext == ".opus") {
+                ++totals.skipped["compressed audio (" + ext + ")"];
+                continue;
+            }
+            if (ext != ".wav") {
+                continue;
+            }
+            ++totals.wav;
+            if (!archive.read(entry, data, error)) {
+                ++totals.skipped[error];
+                continue;
+            }
+            WavClip clip;
+            if (!parseWav(data.data(), data.size(), clip)) {
+                ++totals.skipped["not 16-bit PCM"];
+                continue;
+            }
+            const std::uint64_t format = (static_cast<std::uint64_t>(clip.sampleRate) << 16) | clip.channels;
+            if (!seen.insert(xxh64(clip.samples.data(), clip.samples.size() * sizeof(std::int16_t), format)).second) {
+                ++totals.duplicates;
+                continue;
+            }
+            clip.name = entry.name;
+            totals.audioSeconds += static_cast<double>(clip.samples.size() / clip.channels) / clip.sampleRate;
+            batchBytes += clip.samples.size() * sizeof(std::int16_t);
+            batch.push_back(std::move(clip));
+            if (batchBytes >= kBatchBytes) {
+                if (!renderBatch(batch, opts, config, writer, totals, error)) {
+                    std::cerr << error << "\n";
+                    return 1;
+                }
+                batchBytes = 0;
+            }
+        }
+    }
+    if (!renderBatch(batch, opts, config, writer, totals, error) || !writer.finish(error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << totals.archives << " archives, " << totals.entries << " entries, " << totals.wav << " WAV ("
+              << totals.duplicates << " duplicates), " << totals.audioSeconds << " s of audio\n";
+    std::cout << totals.rendered << " renders (" << opts.speeds.size() << " speeds x " << opts.chunkMs.size()
+              << " buffer sizes, preset " << dspPresetName(opts.preset) << ") in " << seconds << " s on "
+              << WorkerPool::instance().concurrency() << " threads";
+    if (totals.retried) std::cout << ", " << totals.retried << " re-rendered serially";
+    std::cout << "\n";
+    for (const auto &[reason, count] : totals.skipped) {
+        std::cout << "skipped " << count << ": " << reason << "\n";
+    }
+    std::cout << "wrote " << opts.out.string() << ": " << writer.entries() << " records, "
+              << static_cast<double>(writer.bytes()) / (1024.0 * 1024.0) << " MB\n";
+    return 0;
+}